@@ -48,14 +48,14 @@ namespace ante {
              *   during compile-time (eg. are mut, loop bindings, or a parameter).
              */
             AnteValue(Compiler *c, std::vector<TypedValue> const& val,
-                    std::vector<std::unique_ptr<parser::Node>> const& exprs);
+                    std::vector<parser::ArenaPtr<parser::Node>> const& exprs);
 
             /**
              * Constructs an AnteValue of a single value from the given argument.
              * - Can throw if the given expressions aren't able to be evaluated
              *   during compile-time (eg. are mut, loop bindings, or a parameter).
              */
-            AnteValue(Compiler *c, TypedValue const& val, std::unique_ptr<parser::Node> const& expr);
+            AnteValue(Compiler *c, TypedValue const& val, parser::ArenaPtr<parser::Node> const& expr);
 
             AnteValue(Compiler *c, TypedValue const& val, parser::Node *expr);
 
@@ -43,7 +43,9 @@ namespace ante {
         bool isGeneric;
 
         // Exact equality
-        // Matches typevars to only other typevars of the same name
+        // Matches typevars to only other typevars of the same name, so 'a != 'b
+        // and Maybe 'a != Maybe 'b.  Use approxEq to let a typevar match any type.
+        // Since types are interned this is usually just a pointer comparison.
         bool operator==(AnType const& other) const noexcept;
         bool operator!=(AnType const& other) const noexcept;
 
@@ -107,6 +109,14 @@ namespace ante {
     bool isGeneric(const std::vector<AnType*> &vec);
     bool isGeneric(AnType *retTy, std::vector<AnType*> const& params, std::vector<TraitImpl*> const& traits);
 
+    /**
+     * True if a typevar occurs anywhere within t.  Unlike AnType::isGeneric,
+     * which is always false for data types and anything containing them,
+     * this also checks the type arguments of data types.  Since types are
+     * interned and never change the result is memoized for each type.
+     */
+    bool containsTypeVar(const AnType *t);
+
     /**
      *  Virtual base class for modifier types.
      *
@@ -340,8 +350,8 @@ namespace ante {
      *  Typevar types are always generic. */
     class AnTypeVarType : public AnType {
         protected:
-        AnTypeVarType(std::string const& n) :
-            AnType(TT_TypeVar, true), name(n), isRowVariable(false){}
+        AnTypeVarType(std::string const& n, bool isRowVar) :
+            AnType(TT_TypeVar, true), name(n), isRowVariable(isRowVar){}
 
         public:
 
@@ -351,7 +361,7 @@ namespace ante {
 
         bool isRowVariable;
 
-        static AnTypeVarType* get(std::string const& name);
+        static AnTypeVarType* get(std::string const& name, bool isRowVar = false);
 
         /** Returns a version of the current type with an additional modifier m. */
         const AnType* addModifier(TokenType m) const override;
@@ -11,18 +11,28 @@ namespace ante {
      * For detail on each option, see the output of $ ante -help
      */
     enum Args {
+        BuildCacheDir,
         Check,
         CompileAndRun,
         CompileToObj,
+        Cpu,
+        CpuFeatures,
+        CtCache,
+        EmitInterface,
         EmitLLVM,
         Eval,
         Help,
+        Jobs,
+        Lazy,
         Lib,
         NoColor,
+        NoVectorize,
         OptLvl,
         OutputName,
         Parse,
-        Time
+        Passes,
+        Time,
+        Verify
     };
 
     struct Argument {
@@ -36,6 +46,9 @@ namespace ante {
         std::vector<Argument> args;
         std::vector<std::string> inputFiles;
 
+        /** Arguments after -- which are passed to the program run by -r */
+        std::vector<std::string> programArgs;
+
         void addArg(Args &&a, std::string &&s);
         bool hasArg(Args a) const;
         const Argument* getArg(Args a) const;
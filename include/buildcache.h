@@ -0,0 +1,100 @@
+#ifndef AN_BUILDCACHE_H
+#define AN_BUILDCACHE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+
+namespace llvm {
+    class SHA1;
+}
+
+namespace ante {
+    struct CompilerArgs;
+    struct Module;
+    class ModuleInterface;
+
+    /** Return the hex SHA1 of the given contents */
+    std::string hashContents(llvm::StringRef contents);
+
+    /** Add the identity of the running compiler to the given hash */
+    void hashCompilerVersion(llvm::SHA1 &hash);
+
+    /**
+     * Write contents to path atomically, so concurrent builds never see
+     * a partially written file.  Returns false if nothing was written.
+     */
+    bool writeFile(std::string const& path, llvm::StringRef contents);
+
+    /**
+     * Caches the interface of each imported module and the obj files of
+     * each input so unchanged modules are not recompiled on the next build.
+     *
+     * Entries are keyed by the hash of the module's source, the interface
+     * hash of each module it imports, and every flag that may change the
+     * output.  Since an interface hash covers the hashes of the module's
+     * own imports, changing any module transitively imported misses every
+     * entry depending on it.  A module importing one which holds something
+     * an interface cannot express is not cached.  The names each source
+     * imports are stored by the hash of the source alone, so a lookup can
+     * load the imports of a module to find its key without parsing it.
+     *
+     * Only inputs have objs.  Imported functions are compiled into the objs
+     * of the input calling them, generic ones once per instance, so an
+     * import is only cached as an interface.
+     */
+    class BuildCache {
+    public:
+        BuildCache(std::string const& directory, std::string const& inputFile, CompilerArgs const* args);
+
+        /**
+         * Returns the cached interface of the module with the given source,
+         * whose imports are loaded already, or nullptr if there is none.
+         */
+        std::unique_ptr<ModuleInterface> lookupInterface(Module const* m, llvm::StringRef source);
+
+        /** Saves the given interface of m along with the names of m's imports */
+        void storeInterface(Module const* m, llvm::StringRef source, llvm::StringRef interface);
+
+        /**
+         * Fills importNames with the names imported by the module with the
+         * given source and returns true if they were stored previously.
+         */
+        bool lookupImports(llvm::StringRef source, std::vector<std::string> &importNames);
+
+        /**
+         * Fills objs with the cached obj files for the input and returns
+         * true if neither the input nor any module it imports has changed.
+         * The input's imports are loaded to find their interface hashes.
+         */
+        bool lookup(std::vector<llvm::SmallVector<char, 0>> &objs);
+
+        /** Saves the given objs compiled from input, the module of the input file */
+        void store(Module const* input, std::vector<llvm::SmallVector<char, 0>> const& objs);
+
+    private:
+        std::string directory;
+
+        /** Full path of the input file */
+        std::string inputPath;
+
+        /** Hash of the compiler, the target cpu, and the flags the input was compiled with */
+        std::string flagsHash;
+
+        /**
+         * Key of the entry for the given source and imports, or an empty
+         * string if one of the imports cannot be stored as an interface.  An import
+         * of self is skipped since its hash is not known until it is stored.
+         */
+        std::string getKey(llvm::StringRef source, std::vector<Module*> const& imports,
+                Module const* self, llvm::StringRef salt) const;
+
+        std::string getPath(std::string const& dir, std::string const& name) const;
+
+        void storeImports(llvm::StringRef source, std::vector<Module*> const& imports);
+    };
+}
+
+#endif /* end of include guard: AN_BUILDCACHE_H */
@@ -7,6 +7,7 @@
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
 #include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/DenseMap.h>
 
 #include <string>
 #include <memory>
@@ -20,6 +21,9 @@
 #include "variable.h"
 #include "antevalue.h"
 #include "typedvalue.h"
+#include "buildcache.h"
+#include "ctcache.h"
+#include "jitsession.h"
 #include "unification.h"
 
 #define AN_MANGLED_SELF "_$self$"
@@ -33,7 +37,7 @@ namespace ante {
         CompilingVisitor(Compiler *cc) : c(cc){}
         virtual ~CompilingVisitor(){}
 
-        static TypedValue compile(Compiler *c, std::unique_ptr<parser::Node> &n){
+        static TypedValue compile(Compiler *c, parser::ArenaPtr<parser::Node> &n){
             return compile(c, n.get());
         }
         static TypedValue compile(Compiler *c, std::shared_ptr<parser::Node> &n){
@@ -53,7 +57,7 @@ namespace ante {
 
         virtual ~PrintingVisitor(){}
 
-        static void print(std::unique_ptr<parser::Node> &n){
+        static void print(parser::ArenaPtr<parser::Node> &n){
             return print(n.get());
         }
         static void print(std::shared_ptr<parser::Node> &n){
@@ -78,6 +82,10 @@ namespace ante {
         //Map of typevar names to concrete types whenever a generic funcion is monomorphised
         Substitutions monomorphisationMappings;
 
+        //Incremented whenever monomorphisationMappings changes so that
+        //anything computed from the old mappings can be discarded
+        unsigned int mappingsVersion = 0;
+
         //the continue and break labels of each for/while loop to jump out of
         //the pointer is swapped/nullified when a function is called to prevent
         //cross-function jumps
@@ -90,6 +98,7 @@ namespace ante {
             for(auto &sub : subs){
                 if(sub.first != sub.second){
                     monomorphisationMappings.push_back(sub);
+                    mappingsVersion++;
                 }
             }
         }
@@ -105,6 +114,31 @@ namespace ante {
         /** @brief arguments to current ante function being called.
          * Will be empty if !isJIT */
         std::vector<TypedValue> args;
+
+        /** @brief The context of every Compiler in this compilation.  It is
+         * shared with the JIT so code given to it is never copied into another context. */
+        llvm::orc::ThreadSafeContext llvmCtxt;
+
+        /** @brief The JIT used to evaluate ante expressions.  Created on
+         * first use and shared by every Compiler in this compilation. */
+        std::unique_ptr<JitSession> jitSession;
+
+        /** @brief Functions finished since the JIT last took them.
+         * See JitSession::addNewDefinitions */
+        std::vector<llvm::WeakVH> finishedDefinitions;
+
+        /** @brief Results of pure functions called during compile-time */
+        CtResultCache resultCache;
+
+        CompilerCtCtxt(llvm::orc::ThreadSafeContext llvmCtxt) : llvmCtxt{llvmCtxt}{}
+
+        JitSession& getJitSession(){
+            if(!jitSession){
+                jitSession = std::make_unique<JitSession>(llvmCtxt);
+                jitSession->onRedefinition = [this](llvm::Function *f){ resultCache.forget(f); };
+            }
+            return *jitSession;
+        }
     };
 
     /**
@@ -112,7 +146,6 @@ namespace ante {
      */
     struct Compiler {
         std::shared_ptr<llvm::LLVMContext> ctxt;
-        std::unique_ptr<llvm::ExecutionEngine> jit;
         std::unique_ptr<llvm::Module> module;
         llvm::IRBuilder<> builder;
 
@@ -120,7 +153,8 @@ namespace ante {
 
         /** The abstract syntax tree.
          *  This is gradually filled with more information
-         *  during each compilation phase. */
+         *  during each compilation phase.  The input file is
+         *  only parsed once this is first needed, see getAST. */
         parser::RootNode* ast;
 
         std::unique_ptr<CompilerCtxt> compCtxt;
@@ -128,17 +162,45 @@ namespace ante {
         std::shared_ptr<CompilerCtCtxt> ctCtxt;
 
         bool compiled, isLib, isJIT;
+
+        /** True if fileName is an input file that has not been parsed yet */
+        bool unparsed;
         std::string fileName, outFile, funcPrefix;
         unsigned int scope, optLvl, fnScope;
 
+        /** @brief Number of threads to split code generation across */
+        unsigned int jobs;
+
+        /** @brief 1 when optimizing for size (-O s), 2 when aggressively optimizing for size (-O z) */
+        unsigned int sizeLvl;
+
+        /** @brief Set if the loop and SLP vectorizers should run when optimizing */
+        bool vectorize;
+
+        /** @brief Set if the module should be verified in release builds.
+         *  Debug builds always verify it. */
+        bool verify;
+
+        /** @brief Custom pipeline in the syntax of opt -passes, replacing the -O pipeline when non-empty */
+        std::string passPipeline;
+
+        /** @brief Set by -build-cache to reuse the objs of an unchanged input instead of compiling it */
+        std::unique_ptr<BuildCache> buildCache;
+
+        /** @brief Each type lowered by anTypeToLlvmType along with the mappingsVersion it was
+         *  lowered under.  The version is 0 for types without typevars since they never change. */
+        llvm::DenseMap<const AnType*, std::pair<llvm::Type*, unsigned int>> llvmTypeCache;
+
         /**
         * @brief The main constructor for Compiler
         *
         * @param fileName Name of the file being compiled
         * @param lib Set to true if this module should be compiled as a library
-        * @param ctxt The LLVMContext possibly shared with another Compiler
+        * @param ctxt The LLVMContext possibly shared with another Compiler.
+        *        The JitSession of this compilation uses it as well.
         */
-        Compiler(const char *fileName, bool lib=false, std::shared_ptr<llvm::LLVMContext> ctxt = nullptr);
+        Compiler(const char *fileName, bool lib=false,
+                llvm::orc::ThreadSafeContext ctxt = llvm::orc::ThreadSafeContext(std::make_unique<llvm::LLVMContext>()));
 
         /**
         * @brief Constructor for a Compiler compiling a sub-module within the current file.  Currently only
@@ -159,6 +221,17 @@ namespace ante {
         /** @brief Compiles a native binary */
         void compileNative();
 
+        /**
+        * @brief Compiles this module into in-memory obj files, or loads them from
+        *        the build cache if none of the sources they were built from changed.
+        *
+        * @param objs Filled with the contents of each obj file
+        * @param split If set, code generation may be split into one obj per -j thread
+        *
+        * @return 0 on success
+        */
+        int compileToObjs(std::vector<llvm::SmallVector<char, 0>> &objs, bool split);
+
         /**
         * @brief Compiles a module to an object file
         *
@@ -182,10 +255,9 @@ namespace ante {
         /** @brief Dumps current contents of module to stdout */
         void emitIR();
 
-        /** @brief Returns a pointer to the RootNode of the current Module. */
-        parser::RootNode* getAST() const {
-            return ast;
-        }
+        /** @brief Returns a pointer to the RootNode of the current Module,
+         * parsing the input file first if it has not been parsed yet. */
+        parser::RootNode* getAST();
 
         /**
         * @brief Sweeps through parse tree registering all functions, type
@@ -200,8 +272,11 @@ namespace ante {
         *        the command line arguments
         *
         * @param args The command line arguments
+        *
+        * @return The exit code of the program run by -r, otherwise 0,
+        *         or 1 if the arguments are invalid
         */
-        void processArgs(CompilerArgs *args);
+        int processArgs(CompilerArgs *args);
 
 
         /**
@@ -257,11 +332,15 @@ namespace ante {
         TypedValue compLogicalAnd(parser::Node *l, parser::Node *r, parser::BinOpNode *op);
 
         /**
-        * @brief JIT compiles a function with no arguments and calls it afterward
+        * @brief Compiles this module and runs its main function in a JIT
+        *        without producing an executable.
+        *
+        * @param programArgs Arguments passed to main after the program name
+        * @param lazy If set each function is only compiled once it is first called
         *
-        * @param f the function to JIT
+        * @return main's result, or -1 if it could not be run
         */
-        void jitFunction(llvm::Function *fnName);
+        int jitRun(std::vector<std::string> const& programArgs, bool lazy);
 
         FuncDecl* getCurrentFunction() const;
 
@@ -296,9 +375,15 @@ namespace ante {
          * The force flag should generally be avoided unless type inferencing is
          * needed/guarenteed to be performed at a later step to retractively
          * fix the translated type.
+         *
+         * Results are cached in llvmTypeCache until the monomorphisation
+         * mappings they depend on change.
          */
         llvm::Type* anTypeToLlvmType(const AnType *ty, int recursionLimit = 1000);
 
+        /** @brief Translates ty without consulting llvmTypeCache, used by anTypeToLlvmType */
+        llvm::Type* lowerAnType(const AnType *ty, int recursionLimit);
+
         /**
         * @brief Compiles a module into an obj file to be used for linking.
         *
@@ -309,18 +394,43 @@ namespace ante {
         */
         int compileIRtoObj(llvm::Module *mod, std::string outFile);
 
+        /**
+        * @brief Compiles a module into an obj file kept in memory.
+        *
+        * @param mod The already-compiled module
+        * @param obj Buffer the contents of the obj file are appended to
+        *
+        * @return 0 on success
+        */
+        int compileIRtoObj(llvm::Module *mod, llvm::SmallVectorImpl<char> &obj);
+
+        /**
+        * @brief Splits a module into partitions and compiles each into
+        *        its own in-memory obj file on a separate thread.
+        *
+        * @param mod The already-compiled module.  Its internal symbols
+        *        are externalized when it is split.
+        * @param partitions Number of partitions and threads to use
+        * @param objs Filled with the contents of each obj file
+        *
+        * @return 0 on success
+        */
+        int compileIRtoObjs(llvm::Module *mod, unsigned int partitions,
+                std::vector<llvm::SmallVector<char, 0>> &objs);
+
         TypedValue getUnitLiteral();
 
         /**
         * @brief Invokes the linker specified by AN_LINKER (in target.h) to
-        *        link each object file
+        *        link each object file.  The linker is started directly
+        *        rather than through a shell.
         *
-        * @param inFiles String containing each obj file to link separated with spaces
+        * @param inFiles Path of each obj file to link
         * @param outFile Name of the file to output
         *
         * @return 0 on success
         */
-        static int linkObj(std::string inFiles, std::string outFile);
+        static int linkObj(std::vector<std::string> const& inFiles, std::string outFile);
     };
 
     /*
@@ -336,28 +446,31 @@ namespace ante {
     *
     *  - Assumes arguments are already type-checked
     */
-    TypedValue compMetaFunctionResult(Compiler *c, LOC_TY const& loc, std::string const& baseName,
-            std::string const& mangledName, std::vector<TypedValue> const& typedArgs,
-            std::vector<std::unique_ptr<parser::Node>> const& argExprs);
+    TypedValue compMetaFunctionResult(Compiler *c, parser::BinOpNode *call,
+            std::vector<TypedValue> const& typedArgs,
+            std::vector<parser::ArenaPtr<parser::Node>> const& argExprs);
 
 
     /**
-     * Compile and call an ante function with the given arguments.
+     * Compile and call the ante function called by the given call node with the
+     * given arguments in the compilation's JitSession.  Calls to pure functions
+     * are memoized by the function's key and the bytes of their arguments.
      *
      * The result of the call will be translated into a TypedValue.
      * This function will throw a CtError on error
      */
-    TypedValue compileAndCallAnteFunction(Compiler *c, std::string const& baseName,
-        std::string const& mangledName, std::vector<TypedValue> const& typedArgs,
-        std::vector<std::unique_ptr<parser::Node>> const& argExprs);
+    TypedValue compileAndCallAnteFunction(Compiler *c, parser::BinOpNode *call,
+        std::vector<TypedValue> const& typedArgs,
+        std::vector<parser::ArenaPtr<parser::Node>> const& argExprs);
 
     /**
-     * Compile and call an ante expression from its node in the AST.
+     * Compile and call an ante expression, eg. the expr of x = ante expr,
+     * in the compilation's JitSession.
      *
      * The result of the call will be translated into a TypedValue.
      * This function will throw a CtError on error
      */
-    TypedValue compileAndCallAnteFunction(Compiler *c, parser::ModNode *n);
+    TypedValue compileAndCallAnteFunction(Compiler *c, parser::Node *expr);
 
     /**
     * Compiles the given Node and catches any CtError
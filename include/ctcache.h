@@ -0,0 +1,92 @@
+#ifndef AN_CTCACHE_H
+#define AN_CTCACHE_H
+
+#include <string>
+#include <vector>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/IR/ValueMap.h>
+
+namespace llvm {
+    class Function;
+}
+
+namespace ante {
+    struct Compiler;
+    struct TypedValue;
+    class AnType;
+    class AnteValue;
+
+    /**
+     * Memoizes the results of pure functions called during compile-time.
+     *
+     * Each result is keyed by a hash of the called function's IR along with
+     * every function and constant it may reach, followed by the bytes of
+     * its arguments.  Since the key is derived from the code itself rather
+     * than just its name, results may also be saved to a directory and reused
+     * by later compilations.
+     */
+    class CtResultCache {
+    public:
+        /**
+         * Returns the key identifying calls to f, or an empty string if calls
+         * to f cannot be memoized.  This is the case if f or any function it
+         * may call has side effects (eg. calls Ante.error or any C function not
+         * known to be pure), reads a mutable global, or if f returns a pointer.
+         */
+        std::string getFunctionKey(Compiler *c, llvm::Function *f, llvm::StringRef mangledName, AnType *retTy);
+
+        /**
+         * Extends the key for a function with the given arguments, returning an
+         * empty string if the arguments contain pointers and thus cannot be compared.
+         */
+        std::string getCallKey(Compiler *c, std::string const& fnKey,
+                std::vector<TypedValue> const& args, AnteValue const& argData);
+
+        /** Returns the stored result of the given call, or nullptr if there is none. */
+        const std::vector<char>* lookup(std::string const& key);
+
+        void insert(std::string const& key, const void *result, size_t size);
+
+        /** Save results to and load results from the given directory. */
+        void setDirectory(std::string const& dir);
+
+        /** Discard everything remembered about f, which has been redefined. */
+        void forget(const llvm::Function *f);
+
+    private:
+        llvm::StringMap<std::vector<char>> results;
+
+        /** Whether a single function is pure along with a hash of its IR
+         * and the functions it calls directly. */
+        struct FunctionSummary {
+            bool pure;
+            std::string hash;
+            std::vector<llvm::Function*> callees;
+        };
+
+        struct NoRAUW : llvm::ValueMapConfig<const llvm::Function*> {
+            enum { FollowRAUW = false };
+        };
+
+        /** Entries of both maps are dropped when their function is deleted */
+        llvm::ValueMap<const llvm::Function*, FunctionSummary, NoRAUW> summaries;
+
+        /** Hash of every function reachable from each function, empty if any is impure */
+        llvm::ValueMap<const llvm::Function*, std::string, NoRAUW> reachableHashes;
+
+        FunctionSummary const& getSummary(llvm::Function *f);
+
+        /** Returns the hash of f and every function it may reach, or an empty string
+         * if any of them is impure.  The second element is false if the result
+         * depends on an unfinished function and thus may not be remembered. */
+        std::pair<std::string, bool> hashReachable(llvm::Function *f);
+
+        /** Directory used as a persistent store, or empty if results are not saved. */
+        std::string directory;
+
+        std::string getPath(std::string const& key) const;
+    };
+}
+
+#endif /* end of include guard: AN_CTCACHE_H */
@@ -1,6 +1,7 @@
 #ifndef AN_FUNCDECL_H
 #define AN_FUNCDECL_H
 
+#include <unordered_map>
 #include "parser.h"
 #include "typedvalue.h"
 #include "declaration.h"
@@ -9,6 +10,7 @@ namespace ante {
     struct Module;
 
     class AnFunctionType;
+    class ModuleInterface;
 
     /**
     * @brief Contains information about a function that is not contained
@@ -29,6 +31,25 @@ namespace ante {
         /** True if this is a decl from a trait, used as a flag to swap with impl later */
         bool traitFuncDecl = false;
 
+        /**
+         * Each monomorphised instance of this function compiled so far, keyed by
+         * its concrete type.  Types are interned so equal signatures share a key.
+         */
+        std::unordered_map<const AnFunctionType*, TypedValue> instances;
+
+        /** The interface this function's body has yet to be read from, see loadBody */
+        ModuleInterface *bodySource = nullptr;
+
+        /** The index of this function within bodySource */
+        size_t bodyIndex = 0;
+
+        /**
+         * Read the body of a function loaded from a module interface.
+         * Bodies are only read once the function is compiled so
+         * the parse tree must not be used before this is called.
+         */
+        void loadBody();
+
         parser::FuncDeclNode* getFDN() const noexcept {
             return static_cast<parser::FuncDeclNode*>(this->definition);
         }
@@ -10,6 +10,9 @@ namespace ante {
     bool isCompileTimeFunction(TypedValue &tv);
     bool isCompileTimeFunction(AnType *fty);
 
+    /** True if decl is a function declared with the ante modifier */
+    bool isCompileTimeFunction(Declaration *decl);
+
     llvm::Type* parameterize(Compiler *c, AnType *t);
     bool implicitPassByRef(AnType* t);
 
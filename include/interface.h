@@ -0,0 +1,139 @@
+#ifndef AN_INTERFACE_H
+#define AN_INTERFACE_H
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include "parser.h"
+
+namespace ante {
+    struct Module;
+    struct FuncDecl;
+    struct TraitImpl;
+    struct Declaration;
+    class AnType;
+
+    /**
+     * The resolved and inferred contents of a module stored in a binary
+     * file next to its source, eg. prelude.ani for prelude.an, so importing
+     * the module does not need to parse, resolve, and infer it again.
+     *
+     * An interface holds the module's types, traits, trait impls, and the
+     * inferred type and parse tree of each of its functions, including those
+     * of its submodules.  The file is memory-mapped and the parse tree of each
+     * function body is only read once the function is first compiled, see
+     * FuncDecl::loadBody, so importing a large module only pays for the
+     * functions actually used.
+     *
+     * An interface records the hash of its source, of the compiler that
+     * wrote it, and of each import's own interface.  It is only used while
+     * all of these are unchanged.  Since each interface hash covers the
+     * hashes of its imports, an unchanged hash means the module and
+     * everything it transitively imports are unchanged.
+     */
+    class ModuleInterface {
+    public:
+        /**
+         * Open the interface at the given path, returning nullptr if there
+         * is none or if it was written by a different build of the compiler
+         * or from a source other than the given one.
+         */
+        static std::unique_ptr<ModuleInterface> open(std::string const& path, llvm::StringRef source);
+
+        /** Same as open but for an interface already in memory */
+        static std::unique_ptr<ModuleInterface> get(std::unique_ptr<llvm::MemoryBuffer> buffer, llvm::StringRef source);
+
+        /**
+         * Serialize the given module, which must have been resolved and
+         * inferred from the given source, to out.  Returns false if the
+         * module holds something an interface cannot express, eg. a function
+         * using a global, in which case importers compile its source instead.
+         * Each import of the module must itself have an interface hash.
+         * On success m->interfaceHash is set to the hash of out.
+         */
+        static bool write(Module *m, llvm::StringRef source, std::string &out);
+
+        /**
+         * Fill the empty module m, whose imports are already loaded, with the
+         * contents of the interface.  m takes ownership of the interface
+         * since the bodies of its functions are read from it later.
+         * Returns false without changing m if a module the interface
+         * refers to is not loaded.  fileName is used in the locations of
+         * the module's nodes and must outlive them.
+         */
+        static bool load(std::unique_ptr<ModuleInterface> interface, Module *m, std::string *fileName);
+
+        /** The path of the interface for the given source file */
+        static std::string getPath(std::string const& sourcePath);
+
+        /** Name of each module imported by the interface's module, as given to importFile */
+        std::vector<std::string> const& getImportNames() const noexcept {
+            return importNames;
+        }
+
+        /** The interface hash of each import when this interface was written */
+        std::vector<std::string> const& getImportHashes() const noexcept {
+            return importHashes;
+        }
+
+        /** Hash of the whole interface, see Module::interfaceHash */
+        std::string const& getHash() const noexcept {
+            return hash;
+        }
+
+        /** Read the parse tree of the given function's body */
+        void readBody(FuncDecl *fd);
+
+        ~ModuleInterface();
+
+    private:
+        ModuleInterface(std::unique_ptr<llvm::MemoryBuffer> buffer);
+
+        /** Reads values from the interface's buffer */
+        struct Decoder;
+
+        std::unique_ptr<llvm::MemoryBuffer> buffer;
+
+        std::string hash;
+        std::vector<std::string> importNames;
+        std::vector<std::string> importHashes;
+
+        /** Start of each section within the buffer */
+        std::vector<const char*> sections;
+
+        std::vector<llvm::StringRef> strings;
+
+        /** Each module referred to by the interface, the first is always the interface's own */
+        std::vector<Module*> modules;
+
+        /** Types and trait impls are decoded the first time they are referred to */
+        std::vector<AnType*> types;
+        std::vector<TraitImpl*> traitImpls;
+
+        std::vector<FuncDecl*> functions;
+
+        /** Where the body of each function starts, or nullptr if it has none */
+        std::vector<const char*> bodies;
+
+        /** The parameters and other declarations within each function's header */
+        std::vector<std::vector<Declaration*>> functionDecls;
+
+        /** The ExtNode of each impl in the module by trait name, in declaration order */
+        llvm::StringMap<std::vector<parser::ExtNode*>> extNodes;
+
+        /** Type variable names in the interface mapped to fresh ones */
+        llvm::StringMap<std::string> typeVars;
+
+        /** Locations referred to by TypeDecls, which do not store their own */
+        std::deque<LOC_TY> locs;
+
+        std::string *fileName = nullptr;
+        parser::NodeArena *arena = nullptr;
+    };
+}
+
+#endif /* end of include guard: AN_INTERFACE_H */
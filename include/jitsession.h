@@ -0,0 +1,121 @@
+#ifndef AN_JITSESSION_H
+#define AN_JITSESSION_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/ExecutionEngine/JITSymbol.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/IR/ValueHandle.h>
+#include <llvm/IR/ValueMap.h>
+
+namespace llvm {
+    class Function;
+    class GlobalValue;
+    class MemoryBuffer;
+    class Module;
+    namespace orc {
+        class LLLazyJIT;
+    }
+}
+
+namespace ante {
+
+    /**
+     * A single JIT shared by every compile-time evaluation within
+     * one compilation.
+     *
+     * Each function is given to the JIT only once.  Later ante expressions
+     * only add the functions finished since the previous one and reuse
+     * the symbols already compiled.
+     *
+     * A function redefined after being added is given a new symbol rather
+     * than replacing its old one.  Code the JIT already compiled keeps
+     * calling the definition it was linked against either way, so removing
+     * the old symbol would only break later lookups of it.
+     */
+    class JitSession {
+    public:
+        /** Every module given to this session must be in the context of llvmCtxt */
+        explicit JitSession(llvm::orc::ThreadSafeContext llvmCtxt);
+        ~JitSession();
+
+        /**
+         * Add each function in finished to the JIT along with any globals
+         * they use that have not been added yet, then clear finished.
+         * Only these definitions are copied, the rest of mod is untouched.
+         * The copies are made directly in the JIT's context, which must be mod's.
+         * Functions that are still being compiled, ie. those with a block
+         * lacking a terminator, are only declared and are added by a later
+         * call once finished.
+         *
+         * Returns false and prints the error if the definitions could not be added.
+         */
+        bool addNewDefinitions(llvm::Module &mod, std::vector<llvm::WeakVH> &finished);
+
+        /**
+         * Rename the given value so its name is never reused by another value
+         * added to this session.  This is needed for values that are removed
+         * from their module after being called, such as the AnteCall driver,
+         * since a later value with the same name would conflict in the JIT.
+         */
+        void giveUniqueName(llvm::GlobalValue *gv);
+
+        /** Returns the address of the given symbol, or 0 if it could not be found */
+        llvm::JITTargetAddress lookup(llvm::StringRef name);
+
+        /** Called with each function finished again after it was added */
+        std::function<void(llvm::Function*)> onRedefinition;
+
+    private:
+        std::unique_ptr<llvm::orc::LLLazyJIT> jit;
+
+        /** Context of the compiler, which also holds each module given to the JIT */
+        llvm::orc::ThreadSafeContext tsctx;
+
+        struct NoRAUW : llvm::ValueMapConfig<const llvm::GlobalValue*> {
+            enum { FollowRAUW = false };
+        };
+
+        /** Symbol each global already added was given in the JIT.  Entries
+         * are dropped automatically when their global is deleted. */
+        llvm::ValueMap<const llvm::GlobalValue*, std::string, NoRAUW> jitNames;
+
+        /** Every symbol defined in the JIT so far */
+        llvm::StringSet<> definedNames;
+
+        size_t uniqueNameCount;
+
+        /** Pick the symbol gv will be defined as.  This is its own name
+         * unless gv is unnamed or the name is already defined in the JIT. */
+        std::string claimName(const llvm::GlobalValue *gv);
+
+        friend class IncrementMaterializer;
+    };
+
+    /** Returns false if gv is a declaration or a function with a block lacking a terminator */
+    bool isComplete(const llvm::GlobalValue *gv);
+
+    /**
+     * Runs the main function of the given obj file in a new JIT, passing
+     * programName and args as its argv.
+     *
+     * Returns main's result, or -1 if it could not be run.
+     */
+    int runObjInJit(std::unique_ptr<llvm::MemoryBuffer> obj, std::string const& programName,
+            std::vector<std::string> const& args);
+
+    /**
+     * Runs the main function of the given finished module in a new JIT.
+     * Each function is only compiled once it is first called so functions
+     * that are never called are never compiled.
+     *
+     * Returns main's result, or -1 if it could not be run.
+     */
+    int runModuleLazilyInJit(llvm::Module &mod, std::string const& programName,
+            std::vector<std::string> const& args);
+}
+
+#endif /* end of include guard: AN_JITSESSION_H */
@@ -26,6 +26,10 @@ namespace ante{
     public:
         std::string *fileName;
 
+        /* Raw text of the last identifier, type, or literal token lexed.
+         * Ownership is passed to the parser, which frees it when done. */
+        char *lextxt;
+
         Lexer(std::string* fileName);
         Lexer(std::string* fileName, std::string& pseudoFile,
                 unsigned int rowOffset, unsigned int colOffset,
@@ -40,13 +44,13 @@ namespace ante{
         unsigned int getManualScopeLevel() const;
 
     private:
-        /* the ifstream to take from */
-        std::istream *in;
+        /* The null-terminated source being lexed, positioned at the character after nxt.
+         * This is either a file loaded by the SourceManager or the string given as a
+         * pseudo-file, which is used for Str interpolation and the repl. */
+        const char *src;
 
-        /* If this is set to true then the psuedoFile string should be parsed
-         * as a string containing ante src code.  Used for Str interpolation */
-        bool isPseudoFile;
-        char* pseudoFile;
+        /* One past the last character of the source, used to bound vectorized scans */
+        const char *srcEnd;
 
         /* How many ${  } block's are we in? If >1 then convert } to Tok_InterpolateEnd */
         unsigned int interpolationLevel;
@@ -100,9 +104,11 @@ namespace ante{
 
         void incPos(void);
         void incPos(int end);
+        void skipTo(const char *pos);
         yy::position getPos(bool inclusiveEnd = true) const;
 
         void setlextxt(std::string &str);
+        void setlextxt(const char *str, size_t len);
         int handleComment(yy::parser::location_type* loc);
         int handlePossibleScopeChange();
         int genEndOfInputTok();
@@ -119,7 +125,6 @@ namespace ante{
 }
 
 
-extern ante::Lexer *yylexer;
-void setLexer(ante::Lexer *l);
+int yylex(yy::parser::semantic_type* st, yy::location* yyloc, ante::parser::ParseContext &ctxt);
 
 #endif
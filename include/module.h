@@ -1,8 +1,11 @@
 #ifndef AN_MODULE_H
 #define AN_MODULE_H
 
+#include <atomic>
 #include <string>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <llvm/ADT/StringMap.h>
 #include "funcdecl.h"
 #include "typedecl.h"
@@ -11,9 +14,44 @@ namespace ante {
     struct TraitDecl;
     struct TraitImpl;
     class AnType;
+    class ModuleInterface;
+    class UnionFind;
 
     using TypeArgs = std::vector<AnType*>;
 
+    /**
+     * Every impl of a single trait within a module.
+     *
+     * Impls are bucketed by the outermost type constructor of each of
+     * their type arguments (the TypeTag, plus the name for data types)
+     * so that lookups only need to unify against impls that could
+     * plausibly match.  Impls with a type variable in head position of
+     * any type argument cannot be bucketed and are kept in a separate
+     * generic bucket that is checked for every lookup.
+     */
+    class TraitImplIndex {
+        /** Every impl in declaration order */
+        std::vector<TraitImpl*> impls;
+
+        /** Indices into impls keyed by the head type constructors of the impl's type arguments */
+        llvm::StringMap<std::vector<size_t>> byHead;
+
+        /** Indices into impls of each impl with a generic head type */
+        std::vector<size_t> generic;
+
+    public:
+        void add(TraitImpl *impl);
+
+        /** Return the first impl, in declaration order, whose type
+         *  arguments unify with typeArgs or nullptr if there are none. */
+        TraitImpl* lookup(TypeArgs const& typeArgs, UnionFind &scratch) const;
+
+        /** Every impl in declaration order */
+        std::vector<TraitImpl*> const& getImpls() const noexcept {
+            return impls;
+        }
+    };
+
     /**
      * A virtual filesystem tree node containing information on
      * types, functions, imports, and traits of the current module.
@@ -57,15 +95,42 @@ namespace ante {
         /**
          * @brief Map of all trait implementations keyed by name.
          */
-        llvm::StringMap<std::vector<TraitImpl*>> traitImpls;
+        llvm::StringMap<TraitImplIndex> traitImpls;
+
+        /** The name this module was first imported by, eg. "vec.an".  Empty for submodules. */
+        std::string importName;
+
+        /** Hash of this module's interface if it was loaded from or written
+         *  to one, empty otherwise.  See ModuleInterface. */
+        std::string interfaceHash;
+
+        /** The interface this module was loaded from, if it was */
+        std::unique_ptr<ModuleInterface> interface;
 
         private:
+        /** Results of previous lookupTraitImpl calls whose type arguments were fully known.
+         *  Only successful lookups are cached.  An impl added to an imported module can
+         *  change the result so the cache is cleared whenever an impl is added to any module. */
+        mutable std::unordered_map<std::pair<std::string, TypeArgs>, TraitImpl*> traitImplCache;
+
+        /** The number of impls added to all modules when traitImplCache was last cleared */
+        mutable size_t traitImplCacheGeneration = 0;
+
+        /** Incremented for each impl added to any module, invalidating every traitImplCache.
+         *  Atomic since modules are resolved in parallel, see resolveImports. */
+        static std::atomic<size_t> traitImplGeneration;
+
+
         /** The submodules of the current node */
         llvm::StringMap<Module> children;
 
+        /** Guards the children of every module since separate threads
+         *  may add modules to the tree or look them up at once */
+        static std::mutex treeMutex;
+
         public:
-            Module(std::string const& name) : name{name} {}
-            ~Module() = default;
+            Module(std::string const& name);
+            ~Module();
 
             /** Return the root of the virtual file/module system. */
             static Module& getRoot();
@@ -84,40 +149,39 @@ namespace ante {
             /** Lookup the given TraitInstance* and return it if found, null otherwise */
             TraitImpl* lookupTraitImpl(std::string const& name, TypeArgs const& typeArgs) const;
 
+            /** Register a new trait implementation in this module */
+            void addTraitImpl(TraitImpl *impl);
+
             /** Lookup the TraitDecl and return a new, unimplemented instance of it */
             TraitImpl* freshTraitImpl(std::string const& name) const;
 
             /** For some TraitDecl  D 'a 'b  create a TraitImpl exactly matching it with no fresh typevars */
             TraitImpl* createTraitImplFromDecl(std::string const& traitName) const;
 
-            /** Find a single direct child with the given name */
-            llvm::StringMap<Module>::iterator findChild(std::string const& name);
+            /** Find a single direct child with the given name, or nullptr if there is none */
+            Module* findChild(std::string const& name);
 
 
-            /**
-             * Return children.end().
-             *
-             * Can be used to check if returned iterators from the find methods are valid.
-             */
+            /** Return children.begin(), the submodules are in no particular order.
+             *  Iterating is only safe once no more children are being added to this module. */
+            llvm::StringMap<Module>::iterator childrenBegin();
+
+            /** Return children.end() */
             llvm::StringMap<Module>::iterator childrenEnd();
 
-            /** Add a single direct child with the given name. */
+            /** Add a single direct child with the given name, or return it if it already exists. */
             Module& addChild(std::string const& childName);
 
-            /** Find a child with the given relative path from the current node. */
+            /** Find a child with the given relative path from the current node, or nullptr if there is none. */
             template<class StringIt>
-            llvm::StringMap<Module>::iterator findPath(StringIt path) {
+            Module* findPath(StringIt path) {
                 Module *node = this;
-                llvm::StringMap<Module>::iterator ret = children.end();
-
                 for(std::string const& name : path){
-                    ret = node->findChild(name);
-                    if(ret == node->childrenEnd()){
-                        return children.end();
-                    }
-                    node = &ret->getValue();
+                    node = node->findChild(name);
+                    if(!node)
+                        return nullptr;
                 }
-                return ret;
+                return node == this ? nullptr : node;
             }
 
             /** Add a child at the given relative path, adding any intermediate children as necessary. */
@@ -125,12 +189,7 @@ namespace ante {
             Module& addPath(StringIt path){
                 Module *node = this;
                 for(std::string const& name : path){
-                    auto child = node->findChild(name);
-                    if(child == node->childrenEnd()){
-                        node = &node->addChild(name);
-                    }else{
-                        node = &child->getValue();
-                    }
+                    node = &node->addChild(name);
                 }
                 return *node;
             }
@@ -8,6 +8,60 @@
 #include "antype.h"
 
 namespace ante {
+    class BuildCache;
+
+    /**
+     * Discover the import graph of the given parse tree and parse each
+     * module within that is not yet loaded, using one thread per hardware
+     * thread that share a queue of the modules found so far.
+     * The resulting trees are used by later imports in place of parsing
+     * the file again.  Modules with an up to date interface are not
+     * parsed, only the imports it records are followed.  The graph
+     * replaces that of any earlier call and is kept for resolveImports.
+     */
+    void preparseImports(parser::RootNode *root);
+
+    /**
+     * Resolve and infer each module found by the last preparseImports in
+     * topological order.  Each module is loaded on a pool of threads once
+     * all of its imports are, so independent subtrees of the import graph
+     * are loaded concurrently.  The type interning tables, the containsTypeVar
+     * memo, and the module tree are each guarded by a mutex for this.
+     * Modules within an import cycle are never ready and are left to be
+     * loaded serially when their import is visited.
+     */
+    void resolveImports();
+
+    /** True if the module at the given path was parsed by
+     * preparseImports and has not been imported since */
+    bool isPreparsed(std::string const& fullPath);
+
+    /**
+     * Returns the first path to the given module's file within
+     * the import search path, or an empty string if there is none.
+     */
+    std::string findFile(std::string const& fName);
+
+    /**
+     * Import each of the given modules, loading those not yet loaded, and
+     * return them in modules.  Returns false if one cannot be found or
+     * has errors.
+     */
+    bool importModules(std::vector<std::string> const& names, std::vector<Module*> &modules);
+
+    /**
+     * Load imported modules from the interfaces cached in the given build
+     * cache when possible, and store the interface of each module compiled
+     * from source to it.  Pass nullptr to stop using the cache.
+     */
+    void setBuildCache(BuildCache *cache);
+
+    /**
+     * Compile the given module and write its interface next to its
+     * source, see ModuleInterface.  Returns false if the module has
+     * errors or holds something an interface cannot express.
+     */
+    bool emitInterface(std::string const& fileName);
 
     /**
      * Perform name resolution for modules.
@@ -42,6 +96,9 @@ namespace ante {
 
         DECLARE_NODE_VISIT_METHODS();
 
+        /** Import the given file into compUnit, loading it first if this is its first import */
+        void importFile(std::string const& fileName, LOC_TY &loc);
+
         private:
             /** Declare a variable with its type unknown */
             void declare(std::string const& name, parser::VarNode *decl);
@@ -71,8 +128,6 @@ namespace ante {
 
             size_t getScope() const;
 
-            void importFile(std::string const& fileName, LOC_TY &loc);
-
             void newScope();
 
             void exitScope();
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <memory>
+#include <llvm/Support/Allocator.h>
 #include "lexer.h"
 #include "tokens.h"
 #include "location.hh"
@@ -39,6 +40,50 @@ namespace ante {
 
         struct Node;
 
+        /**
+         * Deleter for the links between Nodes.  Every Node is owned by the
+         * NodeArena it was allocated in so the links never free anything.
+         */
+        struct ArenaOwned {
+            template<typename T>
+            void operator()(T*) const noexcept {}
+        };
+
+        /**
+         * A link to another Node in the same parse tree.  The Node is owned
+         * by the tree's NodeArena rather than this pointer, resetting or
+         * destroying the pointer never frees it.
+         */
+        template<typename T>
+        using ArenaPtr = std::unique_ptr<T, ArenaOwned>;
+
+        /**
+         * Bump allocator owning every Node of a single parse tree.
+         *
+         * Nodes are allocated contiguously in the order they are parsed and
+         * are all destroyed at once along with the arena instead of being
+         * freed one at a time while walking the tree.
+         */
+        class NodeArena {
+            llvm::BumpPtrAllocator allocator;
+
+            /** Every Node allocated so far, destroyed in reverse order */
+            std::vector<Node*> nodes;
+
+        public:
+            NodeArena() = default;
+            NodeArena(NodeArena const&) = delete;
+            NodeArena& operator=(NodeArena const&) = delete;
+            ~NodeArena();
+
+            template<typename T, typename... Args>
+            T* make(Args&&... args){
+                T *node = new (allocator.Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+                nodes.push_back(node);
+                return node;
+            }
+        };
+
         template<typename T>
         struct NodeIterator {
             T *cur;
@@ -61,7 +106,7 @@ namespace ante {
             typedef Node* pointer;
             typedef Node& reference;
 
-            std::unique_ptr<Node> next;
+            ArenaPtr<Node> next;
             LOC_TY loc;
 
             virtual void accept(NodeVisitor& v) = 0;
@@ -92,7 +137,7 @@ namespace ante {
          * by a modifier or compiler directive.
          */
         struct ModifiableNode : public Node{
-            std::vector<std::unique_ptr<ModNode>> modifiers;
+            std::vector<ArenaPtr<ModNode>> modifiers;
 
             /*
              * The body should always be known when a
@@ -110,9 +155,12 @@ namespace ante {
         * Specialized Node to act as root
         * - Separates top-level definitions from code that is compiled
         *   into the 'main' or "init_${module}" function
+        * - Unlike other Nodes, a RootNode is allocated on the heap and owns
+        *   the NodeArena containing the rest of its tree
         */
         struct RootNode : public Node{
-            std::vector<std::unique_ptr<Node>> funcs, traits, extensions, types, imports, main;
+            std::vector<ArenaPtr<Node>> funcs, traits, extensions, types, imports, main;
+            std::unique_ptr<NodeArena> arena;
 
             void accept(NodeVisitor& v){ v.visit(this); }
 
@@ -154,24 +202,24 @@ namespace ante {
         };
 
         struct ArrayNode : public Node{
-            std::vector<std::unique_ptr<Node>> exprs;
+            std::vector<ArenaPtr<Node>> exprs;
             void accept(NodeVisitor& v){ v.visit(this); }
-            ArrayNode(LOC_TY& loc, std::vector<std::unique_ptr<Node>>& e) : Node(loc), exprs(move(e)){}
+            ArrayNode(LOC_TY& loc, std::vector<ArenaPtr<Node>>& e) : Node(loc), exprs(move(e)){}
             ~ArrayNode(){}
         };
 
         struct TupleNode : public Node{
-            std::vector<std::unique_ptr<Node>> exprs;
+            std::vector<ArenaPtr<Node>> exprs;
             void accept(NodeVisitor& v){ v.visit(this); }
 
             std::vector<TypedValue> unpack(Compiler*);
-            TupleNode(LOC_TY& loc, std::vector<std::unique_ptr<Node>>& e) : Node(loc), exprs(move(e)){}
+            TupleNode(LOC_TY& loc, std::vector<ArenaPtr<Node>>& e) : Node(loc), exprs(move(e)){}
             ~TupleNode(){}
         };
 
         struct UnOpNode : public Node{
             int op;
-            std::unique_ptr<Node> rval;
+            ArenaPtr<Node> rval;
             void accept(NodeVisitor& v){ v.visit(this); }
             UnOpNode(LOC_TY& loc, int s, Node *rv) : Node(loc), op(s), rval(rv){}
             ~UnOpNode(){}
@@ -179,7 +227,7 @@ namespace ante {
 
         struct BinOpNode : public Node{
             int op;
-            std::unique_ptr<Node> lval, rval;
+            ArenaPtr<Node> lval, rval;
             Declaration* decl;
 
             void accept(NodeVisitor& v){ v.visit(this); }
@@ -188,14 +236,14 @@ namespace ante {
         };
 
         struct SeqNode : public Node{
-            std::vector<std::unique_ptr<Node>> sequence;
+            std::vector<ArenaPtr<Node>> sequence;
             void accept(NodeVisitor& v){ v.visit(this); }
             SeqNode(LOC_TY& loc) : Node(loc), sequence(){}
             ~SeqNode(){}
         };
 
         struct BlockNode : public Node{
-            std::unique_ptr<Node> block;
+            ArenaPtr<Node> block;
             void accept(NodeVisitor& v){ v.visit(this); }
             BlockNode(LOC_TY& loc, Node *b) : Node(loc), block(b){}
             ~BlockNode(){}
@@ -210,7 +258,7 @@ namespace ante {
          */
         struct ModNode : public Node{
             int mod;
-            std::unique_ptr<Node> directive, expr;
+            ArenaPtr<Node> directive, expr;
 
             //this ModNode is a compiler directive iff its mod == preproc_id
             //otherwise, it is a normal modifier, and expr is null
@@ -233,8 +281,8 @@ namespace ante {
         struct TypeNode : public ModifiableNode{
             TypeTag typeTag;
             std::string typeName; //used for usertypes
-            std::unique_ptr<TypeNode> extTy; //Used for pointers and non-single anonymous types.
-            std::vector<std::unique_ptr<TypeNode>> params; //type parameters for generic types
+            ArenaPtr<TypeNode> extTy; //Used for pointers and non-single anonymous types.
+            std::vector<ArenaPtr<TypeNode>> params; //type parameters for generic types
             bool isRowVar = false;
 
             void accept(NodeVisitor& v){ v.visit(this); }
@@ -244,16 +292,16 @@ namespace ante {
         };
 
         struct TypeCastNode : public Node{
-            std::unique_ptr<TypeNode> typeExpr;
-            std::vector<std::unique_ptr<Node>> args;
+            ArenaPtr<TypeNode> typeExpr;
+            std::vector<ArenaPtr<Node>> args;
             void accept(NodeVisitor& v){ v.visit(this); }
-            TypeCastNode(LOC_TY& loc, TypeNode *ty, std::vector<std::unique_ptr<Node>> &&a)
+            TypeCastNode(LOC_TY& loc, TypeNode *ty, std::vector<ArenaPtr<Node>> &&a)
                 : Node(loc), typeExpr(ty), args(std::move(a)){}
             ~TypeCastNode(){}
         };
 
         struct RetNode : public Node{
-            std::unique_ptr<Node> expr;
+            ArenaPtr<Node> expr;
             void accept(NodeVisitor& v){ v.visit(this); }
             RetNode(LOC_TY& loc, Node* e) : Node(loc), expr(e){}
             ~RetNode(){}
@@ -261,7 +309,7 @@ namespace ante {
 
         struct NamedValNode : public Node{
             std::string name;
-            std::unique_ptr<Node> typeExpr;
+            ArenaPtr<Node> typeExpr;
             Declaration* decl = 0;
             void accept(NodeVisitor& v){ v.visit(this); }
             NamedValNode(LOC_TY& loc, std::string s, Node* t) : Node(loc), name(s), typeExpr(t), decl(0){}
@@ -298,18 +346,17 @@ namespace ante {
 
         struct VarAssignNode : public ModifiableNode{
             Node* ref_expr;
-            std::unique_ptr<Node> expr;
-            bool freeLval;
+            ArenaPtr<Node> expr;
             void accept(NodeVisitor& v){ v.visit(this); }
-            VarAssignNode(LOC_TY& loc, Node* v, Node* exp, bool b)
-                : ModifiableNode(loc), ref_expr(v), expr(exp), freeLval(b){}
-            ~VarAssignNode(){ if(freeLval) delete ref_expr; }
+            VarAssignNode(LOC_TY& loc, Node* v, Node* exp)
+                : ModifiableNode(loc), ref_expr(v), expr(exp){}
+            ~VarAssignNode(){}
         };
 
         struct ExtNode : public ModifiableNode{
-            std::unique_ptr<TypeNode> typeExpr;
-            std::unique_ptr<TypeNode> trait;
-            std::unique_ptr<Node> methods;
+            ArenaPtr<TypeNode> typeExpr;
+            ArenaPtr<TypeNode> trait;
+            ArenaPtr<Node> methods;
 
             /** Set to (trait?toAnType(trait):nullptr) to hold onto a traits impl. */
             TraitImpl *traitType;
@@ -321,14 +368,14 @@ namespace ante {
         };
 
         struct ImportNode : public Node{
-            std::unique_ptr<Node> expr;
+            ArenaPtr<Node> expr;
             void accept(NodeVisitor& v){ v.visit(this); }
             ImportNode(LOC_TY& loc, Node* e) : Node(loc), expr(e){}
             ~ImportNode(){}
         };
 
         struct JumpNode : public Node{
-            std::unique_ptr<Node> expr;
+            ArenaPtr<Node> expr;
             int jumpType;
             void accept(NodeVisitor& v){ v.visit(this); }
             JumpNode(LOC_TY& loc, int jt, Node* e) : Node(loc), expr(e), jumpType(jt){}
@@ -336,7 +383,7 @@ namespace ante {
         };
 
         struct WhileNode : public Node{
-            std::unique_ptr<Node> condition, child;
+            ArenaPtr<Node> condition, child;
             void accept(NodeVisitor& v){ v.visit(this); }
             WhileNode(LOC_TY& loc, Node *cond, Node *body)
                 : Node(loc), condition(cond), child(body){}
@@ -344,7 +391,7 @@ namespace ante {
         };
 
         struct ForNode : public Node{
-            std::unique_ptr<Node> pattern, range, child;
+            ArenaPtr<Node> pattern, range, child;
             TraitImpl *iterableInstance = 0;
 
             void accept(NodeVisitor& v){ v.visit(this); }
@@ -354,24 +401,24 @@ namespace ante {
         };
 
         struct MatchBranchNode : public Node{
-            std::unique_ptr<Node> pattern, branch;
+            ArenaPtr<Node> pattern, branch;
             void accept(NodeVisitor& v){ v.visit(this); }
             MatchBranchNode(LOC_TY& loc, Node *p, Node *b) : Node(loc), pattern(p), branch(b){}
             ~MatchBranchNode(){}
         };
 
         struct MatchNode : public Node{
-            std::unique_ptr<Node> expr;
-            std::vector<std::unique_ptr<MatchBranchNode>> branches;
+            ArenaPtr<Node> expr;
+            std::vector<ArenaPtr<MatchBranchNode>> branches;
 
             void accept(NodeVisitor& v){ v.visit(this); }
-            MatchNode(LOC_TY& loc, Node *e, std::vector<std::unique_ptr<MatchBranchNode>> &b)
+            MatchNode(LOC_TY& loc, Node *e, std::vector<ArenaPtr<MatchBranchNode>> &b)
                 : Node(loc), expr(e), branches(move(b)){}
             ~MatchNode(){}
         };
 
         struct IfNode : public Node{
-            std::unique_ptr<Node> condition, thenN, elseN;
+            ArenaPtr<Node> condition, thenN, elseN;
             void accept(NodeVisitor& v){ v.visit(this); }
             IfNode(LOC_TY& loc, Node* c, Node* then, Node* els)
                 : Node(loc), condition(c), thenN(then), elseN(els){}
@@ -380,10 +427,10 @@ namespace ante {
 
         struct FuncDeclNode : public ModifiableNode{
             std::string name;
-            std::unique_ptr<Node> child;
-            std::unique_ptr<TypeNode> returnType;
-            std::unique_ptr<NamedValNode> params;
-            std::unique_ptr<TypeNode> typeClassConstraints;
+            ArenaPtr<Node> child;
+            ArenaPtr<TypeNode> returnType;
+            ArenaPtr<NamedValNode> params;
+            ArenaPtr<TypeNode> typeClassConstraints;
             bool varargs;
             Declaration* decl;
 
@@ -405,10 +452,10 @@ namespace ante {
         };
 
         struct DataDeclNode : public ModifiableNode{
-            std::unique_ptr<Node> child;
+            ArenaPtr<Node> child;
             std::string name;
             size_t fields;
-            std::vector<std::unique_ptr<TypeNode>> generics;
+            std::vector<ArenaPtr<TypeNode>> generics;
             bool isAlias;
             bool isUnion;
 
@@ -417,26 +464,40 @@ namespace ante {
                 : ModifiableNode(loc), child(b), name(s), fields(f), isAlias(a), isUnion(u){}
 
             DataDeclNode(LOC_TY& loc, std::string s, Node* b, size_t f,
-                    std::vector<std::unique_ptr<TypeNode>> &&g, bool a, bool u)
+                    std::vector<ArenaPtr<TypeNode>> &&g, bool a, bool u)
                 : ModifiableNode(loc), child(b), name(s), fields(f), generics(move(g)), isAlias(a), isUnion(u){}
             ~DataDeclNode(){}
         };
 
         struct TraitNode : public ModifiableNode{
-            std::unique_ptr<Node> child;
+            ArenaPtr<Node> child;
             std::string name;
-            std::vector<std::unique_ptr<TypeNode>> generics;
-            std::vector<std::unique_ptr<TypeNode>> fundeps;
+            std::vector<ArenaPtr<TypeNode>> generics;
+            std::vector<ArenaPtr<TypeNode>> fundeps;
 
             void accept(NodeVisitor& v){ v.visit(this); }
             TraitNode(LOC_TY& loc, std::string s,
-                    std::vector<std::unique_ptr<TypeNode>> &&g,
-                    std::vector<std::unique_ptr<TypeNode>> &&f, Node* b)
+                    std::vector<ArenaPtr<TypeNode>> &&g,
+                    std::vector<ArenaPtr<TypeNode>> &&f, Node* b)
                 : ModifiableNode(loc), child(b), name(s), generics(move(g)), fundeps(move(f)){}
             ~TraitNode(){}
         };
 
-        RootNode* getRootNode();
+        /**
+         * Parse the file with the given name, returning its parse tree or
+         * nullptr if there was a syntax error.  All lexer and parser state is
+         * local to each call so this is safe to call from several threads at once.
+         * Nodes keep a pointer to fileName so it must outlive the returned tree.
+         */
+        std::unique_ptr<RootNode> parseFile(std::string *fileName);
+
+        /**
+         * Parse the given source buffer.  fileName is only used in
+         * the locations of each node, it is never opened.
+         */
+        std::unique_ptr<RootNode> parseBuffer(std::string *fileName, std::string &source,
+                unsigned int rowOffset = 0, unsigned int colOffset = 0);
+
         void printBlock(Node *block, size_t indent_level);
         void parseErr(ParseErr e, std::string s, bool showTok);
     } // end of ante::parser
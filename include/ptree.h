@@ -7,28 +7,52 @@
 #define LOC_TY yy::location
 #endif
 
-//defined in lexer.cpp
-extern char* lextxt;
+#include <stack>
 
 namespace ante {
+    class Lexer;
+
     namespace parser {
 
-        Node* setRoot(Node* root);
-        Node* getRoot();
+        /**
+         * All mutable state used while parsing a single file.
+         *
+         * Each parse gets its own ParseContext and Lexer so that
+         * several files may be parsed at once on separate threads.
+         */
+        struct ParseContext {
+            Lexer &lexer;
+
+            //stack of relative roots, eg. a FuncDeclNode's first statement would be set as the
+            //relative root, where the last would be returned by the parser.  Relative roots are
+            //returned through getRoot() which also pops the stack.
+            std::stack<Node*> roots;
+
+            //The single true-root of the file being parsed.
+            RootNode *root;
+
+            //Number of syntax errors issued so far
+            size_t errorCount;
+
+            ParseContext(Lexer &lexer) : lexer{lexer}, roots{}, root{nullptr}, errorCount{0}{}
+        };
+
+        Node* setRoot(ParseContext &ctxt, Node* root);
+        Node* getRoot(ParseContext &ctxt);
         Node* setNext(Node* cur, Node* nxt);
         Node* setElse(Node *ifn, Node *elseN);
         Node* addMatch(Node *matchExpr, Node *newMatch);
         Node* applyMods(Node *mods, Node *decls);
 
-        void createRoot();
-        void createRoot(LOC_TY& loc);
+        void createRoot(ParseContext &ctxt);
+        void createRoot(ParseContext &ctxt, LOC_TY& loc);
 
-        Node* append_main(Node *n);
-        Node* append_fn(Node *n);
-        Node* append_type(Node *n);
-        Node* append_extension(Node *n);
-        Node* append_trait(Node *n);
-        Node* append_import(Node *n);
+        Node* append_main(ParseContext &ctxt, Node *n);
+        Node* append_fn(ParseContext &ctxt, Node *n);
+        Node* append_type(ParseContext &ctxt, Node *n);
+        Node* append_extension(ParseContext &ctxt, Node *n);
+        Node* append_trait(ParseContext &ctxt, Node *n);
+        Node* append_import(ParseContext &ctxt, Node *n);
         Node* append_modifiers(Node *modifiers, Node *modifiableNode);
 
         Node* nextVarArgsTypeNode(LOC_TY loc);
@@ -60,7 +84,7 @@ namespace ante {
         Node* mkVarNode(LOC_TY loc, char* s);
         Node* mkRetNode(LOC_TY loc, Node* expr);
         Node* mkImportNode(LOC_TY loc, Node* expr);
-        Node* mkVarAssignNode(LOC_TY loc, Node* var, Node* expr, bool shouldFreeLval = true);
+        Node* mkVarAssignNode(LOC_TY loc, Node* var, Node* expr);
         Node* mkExtNode(LOC_TY loc, Node* typeExpr, Node* methods, Node* traits);
         Node* mkMatchNode(LOC_TY loc, Node* expr, Node* branch);
         Node* mkMatchBranchNode(LOC_TY loc, Node* pattern, Node* branch);
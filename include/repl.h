@@ -6,10 +6,13 @@
 namespace ante {
     /**
      * Merge the contents of rn into the current RootNode
-     * of the compiler and update declarations accordingly
+     * of the compiler and update declarations accordingly.
+     *
+     * rn is owned by the module it is resolved in, which is
+     * returned through unit.
      */
     TypedValue mergeAndCompile(Compiler *c, parser::RootNode *rn,
-            parser::ModNode *anteExpr);
+            parser::ModNode *anteExpr, std::unique_ptr<Module> &unit);
 
     /**
      * Starts the read-eval printline loop.
@@ -2,6 +2,8 @@
 #define AN_RESULT_H
 
 #include <iostream>
+#include <new>
+#include <utility>
 
 namespace ante {
 
@@ -46,15 +48,20 @@ namespace ante {
         }
 
         Result<T, E>& operator=(const Result<T, E>& rhs){
-            if(rhs.isVal){
-                isVal = true;
-                auto t = rhs.getVal();
-                valOrErr = *reinterpret_cast<Box*>(&t);
+            if(this == &rhs) return *this;
+
+            //copy out first in case rhs is owned by the value being replaced
+            bool rhsIsVal = rhs.isVal;
+            if(rhsIsVal){
+                T t = rhs.getVal();
+                this->~Result();
+                ::new (&valOrErr) T(std::move(t));
             }else{
-                isVal = false;
-                auto e = rhs.getErr();
-                valOrErr = *reinterpret_cast<Box*>(&e);
+                E e = rhs.getErr();
+                this->~Result();
+                ::new (&valOrErr) E(std::move(e));
             }
+            isVal = rhsIsVal;
             return *this;
         }
 
@@ -0,0 +1,42 @@
+#ifndef AN_SCAN_H
+#define AN_SCAN_H
+
+/*
+ * Vectorized helpers used by the lexer to skip over long runs of
+ * uninteresting characters.  Each function scans the range [begin, end)
+ * and returns a pointer to the first character that stops the scan, or
+ * end if there is none.  On x86-64 the widest instruction set supported
+ * by the host (AVX2 or SSE2) is chosen at runtime, otherwise a scalar
+ * fallback is used.
+ */
+namespace ante {
+    namespace scan {
+        enum class Isa {
+            Scalar, SSE2, AVX2
+        };
+
+        /** The instruction set used by the scan functions below */
+        Isa getIsa();
+
+        /** Use the given instruction set for all future scans, if supported by the host.
+         *  Returns false and leaves the current instruction set unchanged otherwise. */
+        bool setIsa(Isa isa);
+
+        const char* getIsaName(Isa isa);
+
+        /** Skip identifier characters: [a-zA-Z0-9_] */
+        const char* skipIdentChars(const char *begin, const char *end);
+
+        /** Skip ' ' characters */
+        const char* skipSpaces(const char *begin, const char *end);
+
+        /** Find the end of a line comment: the next '\n' or '\0' */
+        const char* findLineEnd(const char *begin, const char *end);
+
+        /** Find the next character within a string literal that needs
+         *  special handling: '"', '\\', '\n', '$', or '\0' */
+        const char* findStrLitSpecial(const char *begin, const char *end);
+    }
+}
+
+#endif /* end of include guard: AN_SCAN_H */
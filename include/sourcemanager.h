@@ -0,0 +1,62 @@
+#ifndef AN_SOURCEMANAGER_H
+#define AN_SOURCEMANAGER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+namespace ante {
+
+    /**
+     * The contents of a single source file, loaded into memory once.
+     *
+     * Larger files are memory-mapped rather than read.  The buffer is
+     * always null-terminated so the lexer may treat '\0' as the end of input.
+     */
+    class SourceFile {
+        std::unique_ptr<llvm::MemoryBuffer> buffer;
+
+        /** Offset of the first character of each line, the first line starts at index 0 */
+        std::vector<size_t> lineOffsets;
+
+    public:
+        SourceFile(std::unique_ptr<llvm::MemoryBuffer> buffer);
+
+        const char* begin() const noexcept {
+            return buffer->getBufferStart();
+        }
+
+        const char* end() const noexcept {
+            return buffer->getBufferEnd();
+        }
+
+        llvm::StringRef getContents() const noexcept {
+            return buffer->getBuffer();
+        }
+
+        /** Return the given line (starting at 1) without its trailing newline,
+         *  or an empty string if the file has fewer lines. */
+        llvm::StringRef getLine(unsigned int line) const;
+    };
+
+    /**
+     * Owns every source file loaded during compilation.  Files stay
+     * loaded until the compiler exits since diagnostics may reference
+     * any file at any time.  Safe to call from multiple threads.
+     */
+    struct SourceManager {
+        /** Load the given file, or return the existing SourceFile if it was already loaded.
+         *  Returns nullptr if the file could not be read. */
+        static SourceFile* getFile(std::string const& fileName);
+
+        /** Read all of stdin into a new SourceFile */
+        static SourceFile* getStdin();
+
+        /** Returns the name of each file loaded so far, not including stdin */
+        static std::vector<std::string> getLoadedFileNames();
+    };
+}
+
+#endif /* end of include guard: AN_SOURCEMANAGER_H */
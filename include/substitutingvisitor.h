@@ -11,16 +11,16 @@ namespace ante {
     struct SubstitutingVisitor : public NodeVisitor {
         DECLARE_NODE_VISIT_METHODS();
 
-        SubstitutingVisitor(Substitutions const& s, Module *module)
-            : substitutions{s}, module{module}{}
+        SubstitutingVisitor(UnionFind &bindings, Module *module)
+            : bindings{bindings}, module{module}{}
 
-        static void substituteIntoAst(parser::Node *ast, Substitutions const& subs, Module *module){
-            SubstitutingVisitor v{subs, module};
+        static void substituteIntoAst(parser::Node *ast, UnionFind &bindings, Module *module){
+            SubstitutingVisitor v{bindings, module};
             ast->accept(v);
         }
 
     private:
-        Substitutions const& substitutions;
+        UnionFind &bindings;
         Module *module;
         std::vector<llvm::StringMap<const AnTypeVarType*>> typevarsInScope;
 
@@ -0,0 +1,48 @@
+#ifndef AN_TARGETCPU_H
+#define AN_TARGETCPU_H
+
+#include <string>
+
+namespace llvm {
+    class Module;
+}
+
+namespace ante {
+
+    /**
+     * The cpu and llvm feature string that generated code is specialized for.
+     * Both are empty by default, selecting a baseline cpu of the native arch.
+     */
+    struct TargetCpu {
+        std::string cpu;
+        std::string features;
+    };
+
+    /**
+     * Sets the cpu to generate code for from -march/-mcpu and any extra
+     * features from -mattr, eg. "+avx2,-fma".  A cpu of "native" is
+     * replaced with the host cpu and all of its features.
+     */
+    void setTargetCpu(std::string const& cpu, std::string const& extraFeatures);
+
+    TargetCpu const& getTargetCpu();
+
+    /** @brief Returns the cpu and features of the machine the compiler is running on */
+    TargetCpu getHostCpu();
+
+    /**
+     * @brief Returns true if code generated for target can run on the host.
+     * Its cpu must be empty or the host's, and it may not enable a feature
+     * the host lacks.
+     */
+    bool runsOnHost(TargetCpu const& target);
+
+    /**
+     * Stamps each function defined in the module with target-cpu and
+     * target-features attributes matching getTargetCpu() so the
+     * optimizer and code generator agree on which instructions are legal.
+     */
+    void addTargetCpuAttributes(llvm::Module &mod);
+}
+
+#endif
@@ -1,10 +1,36 @@
 #ifndef AN_TYPEDECL_H
 #define AN_TYPEDECL_H
 
-#include <llvm/IR/Type.h>
+#include <llvm/IR/DerivedTypes.h>
 #include "antype.h"
 
 namespace ante {
+    /**
+     * A union with one empty variant and one variant holding a single value
+     * with unused bit patterns is stored as just that value, using one of the
+     * unused patterns for the empty variant instead of a separate tag.
+     */
+    struct UnionNiche {
+        enum class Kind {
+            /** The union has a tag */
+            None,
+            /** A null pointer, only for ![nonnull] unions since Ante pointers may be null */
+            NullPtr,
+            /** A tag value not used by the nested union or enum that is stored */
+            SpareTag,
+            /** A value other than 0 or 1 of a bool, which is stored as a byte */
+            SpareBool,
+        };
+
+        Kind kind = Kind::None;
+
+        /** The variant stored without a tag, or -1 if the union has a tag */
+        int variant = -1;
+
+        /** The spare tag or bool value standing for the empty variant */
+        uint8_t value = 0;
+    };
+
     /**
      * Contains additional information about a user-declared type.
      * Unlike AnDataType, there is only 1 TypeDecl for each declared type.
@@ -24,11 +50,25 @@ namespace ante {
         bool isUnionType;
         bool isAlias;
 
+        /** Set by ![repr_c] to keep fields in declaration order as C would.
+         *  Otherwise fields are reordered to minimize padding. */
+        bool isReprC;
+
+        /** Set by ![nonnull] on a union to declare that the pointer held by its
+         *  pointer variant is never null, letting null represent its empty variant. */
+        bool isNonNull;
+
         AnType *aliasedType;
 
         mutable std::unordered_map<TypeArgs, llvm::Type*> variantTypes;
 
-        TypeDecl(AnType *type, LOC_TY &loc) : type{type}, loc{loc}, isUnionType{false}, isAlias{false}{}
+        /** The index within the llvm struct of each field, in declaration order */
+        mutable std::unordered_map<TypeArgs, std::vector<unsigned int>> fieldIndices;
+
+        /** How each instance of a union is stored without a tag, if it is */
+        mutable std::unordered_map<TypeArgs, UnionNiche> niches;
+
+        TypeDecl(AnType *type, LOC_TY &loc) : type{type}, loc{loc}, isUnionType{false}, isAlias{false}, isReprC{false}, isNonNull{false}{}
 
         std::vector<std::string> fields;
 
@@ -36,17 +76,52 @@ namespace ante {
 
         std::vector<AnType*> getBoundFieldTypes(const AnDataType *dt) const;
         std::vector<AnType*>& getUnboundFieldTypes();
-        std::vector<AnType*> getLargestVariantFieldTypes(Compiler *c, const AnDataType *dt) const;
 
         llvm::Type* toLlvmType(Compiler *c, const AnDataType *type) const;
         Result<size_t, std::string> getSizeInBits(Compiler *c, std::string const& incompleteType, const AnDataType *type) const;
         size_t getTagIndex(std::string const& tag) const;
         llvm::Value* getTagValue(Compiler *c, const AnDataType *type, std::string const& variantName, std::vector<TypedValue> const& args) const;
-        const AnType* getLargestVariant(Compiler *c, const AnDataType *type) const;
-        size_t getFieldIndex(std::string const& field) const;
+
+        /** Returns the llvm type of the given variant of a union along with its tag, (u8, variant) */
+        llvm::StructType* getVariantLlvmType(Compiler *c, const AnDataType *type, size_t tag) const;
+
+        /** Returns how the given union is stored without a tag, see UnionNiche */
+        UnionNiche const& getNiche(Compiler *c, const AnDataType *type) const;
+
+        /**
+         * Returns the index of the variant stored without a tag if type is stored
+         * in a niche of that variant's value, otherwise -1.
+         */
+        int getNicheVariant(Compiler *c, const AnDataType *type) const;
+
+        /**
+         * Returns the lowest value the first byte of the given union never holds,
+         * letting a union containing it use that value as its own tag.
+         * Returns -1 if there is no such value.
+         */
+        int getSpareTagValue(Compiler *c, const AnDataType *type) const;
+
+        /** Returns the value held by a union stored in a niche of its non-empty variant */
+        llvm::Value* getNichePayload(Compiler *c, const AnDataType *type, llvm::Value *unionVal, llvm::Type *payloadTy) const;
+
+        /** Returns an i1 which is true if the given union value is the variant tag */
+        llvm::Value* isVariant(Compiler *c, const AnDataType *type, llvm::Value *unionVal, size_t tag) const;
+
+        /** Returns the u8 tag of the given union value */
+        llvm::Value* getTag(Compiler *c, const AnDataType *type, llvm::Value *unionVal) const;
+
+        /** Returns the index of the given field within the llvm struct of type */
+        size_t getFieldIndex(Compiler *c, const AnDataType *type, std::string const& field) const;
+
+        /** Returns the index within the llvm struct of type of each field in declaration order */
+        std::vector<unsigned int> const& getFieldIndices(Compiler *c, const AnDataType *type) const;
 
     private:
         std::vector<AnType*> fieldTypes;
+
+        std::vector<llvm::Type*> getStructBody(Compiler *c, const AnDataType *type) const;
+        std::vector<llvm::Type*> getUnionBody(Compiler *c, const AnDataType *type) const;
+        UnionNiche findNiche(Compiler *c, const AnDataType *type) const;
     };
 }
 
@@ -40,10 +40,11 @@ namespace ante {
 
             auto unifystart = high_resolution_clock::now();
             auto constraints = step2.getConstraints();
-            auto substitutions = unify(constraints);
+            UnionFind bindings;
+            unify(constraints, bindings);
 
             auto substart = high_resolution_clock::now();
-            SubstitutingVisitor::substituteIntoAst(n, substitutions, module);
+            SubstitutingVisitor::substituteIntoAst(n, bindings, module);
             auto end = high_resolution_clock::now();
 
             if(showTimingInformation()){
@@ -57,7 +58,7 @@ namespace ante {
         }
 
 
-        static void infer(std::unique_ptr<parser::Node> &n, Module *module){
+        static void infer(parser::ArenaPtr<parser::Node> &n, Module *module){
             return infer(n.get(), module);
         }
 
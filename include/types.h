@@ -24,6 +24,10 @@ namespace ante {
 
     bool isEmptyType(Compiler *c, AnType *ty);
 
+    /** Replace each typevar within t that is bound by the current monomorphisation
+     *  mappings, including those in the type arguments of data types. */
+    AnType* bindTypeVars(Compiler *c, AnType *t);
+
     //conversions
     AnType* toAnType(const parser::TypeNode *tn, Module *module);
 
@@ -47,6 +51,10 @@ namespace ante {
      */
     char getBitWidthOfTypeTag(const TypeTag tagTy);
 
+    /** Return the offset in bytes of each field of the given tuple
+     *  within its llvm struct, as laid out by the target. */
+    std::vector<size_t> getFieldOffsets(Compiler *c, const AnTupleType *tuple);
+
     /** True for any type that has no additional type arguments.
      *  As a result, a primitive typetag will always be a base
      *  case for recursion over AnTypes. */
@@ -4,6 +4,7 @@
 #include "antype.h"
 #include "typeerror.h"
 #include <tuple>
+#include <unordered_map>
 
 namespace ante {
     using Substitutions = std::list<std::pair<AnType*, AnType*>>;
@@ -53,8 +54,84 @@ namespace ante {
      * Returns a new substituted type or t if subType was not contained within */
     AnType* substitute(AnType *u, AnType *subType, AnType *t, int recursionLimit = 10000);
 
+    /**
+     * A disjoint-set forest over type variables.
+     *
+     * Each bound type variable points to another type in its equivalence
+     * class; the representative of a class is either an unbound type variable
+     * or a non-typevar type.  find compresses paths as it walks them so
+     * long chains of typevar-to-typevar bindings are only walked once.
+     *
+     * A single UnionFind is kept for all the constraints of a function and
+     * then used to substitute the solved types into its body.  bind refuses
+     * any binding that would form a cycle so find always terminates.
+     */
+    class UnionFind {
+        std::unordered_map<const AnTypeVarType*, AnType*> parent;
+
+        /** Bound typevars in the order they were bound, used to
+         * produce a deterministic Substitutions list. */
+        std::vector<AnTypeVarType*> bindOrder;
+
+        /** Previous parent of each typevar written since the last checkpoint,
+         * nullptr if it was unbound.  Undone in reverse by rollback. */
+        std::vector<std::pair<const AnTypeVarType*, AnType*>> trail;
+
+    public:
+        UnionFind(){}
+
+        /** Returns the representative of t's equivalence class.
+         * This only resolves t itself, any types contained within t are left untouched. */
+        AnType* find(AnType *t);
+
+        /** Bind the unbound typevar tv to t.  Returns false without binding
+         * anything if tv occurs within t since that would form a cycle. */
+        bool bind(AnTypeVarType *tv, AnType *t);
+
+        bool empty() const noexcept {
+            return parent.empty();
+        }
+
+        /** Remove all bindings while keeping the allocated storage for reuse */
+        void clear();
+
+        /** Mark the current bindings so any made afterward can be undone with
+         * rollback.  Only the most recent checkpoint may be rolled back to. */
+        size_t checkpoint();
+
+        /** Undo every binding and path compression made since checkpoint c */
+        void rollback(size_t c);
+
+        /** True if the typevar tv occurs anywhere within t, after following all bindings. */
+        bool occurs(AnTypeVarType *tv, AnType *t);
+
+        /** Replace every bound typevar in t with its representative in a single walk. */
+        AnType* resolve(AnType *t, int recursionLimit = 10000);
+        TraitImpl* resolve(TraitImpl *impl, int recursionLimit = 10000);
+
+        /** Flatten the forest into a list of fully-resolved substitutions,
+         * most recent binding first. */
+        Substitutions getSubstitutions();
+    };
+
+    /** Solve each equality constraint in list, adding the resulting bindings to bindings */
+    void unify(UnificationList const& list, UnionFind &bindings);
+
     Substitutions unify(UnificationList const& list);
 
+    enum class UnifyStatus {
+        Success, Mismatch, InfiniteType
+    };
+
+    /**
+     * Non-throwing unification for callers that only need to know whether
+     * two types are compatible, eg. trait impl lookup.  scratch is cleared
+     * before use and holds the resulting bindings afterward, so a single
+     * UnionFind can be reused across many candidates.
+     */
+    UnifyStatus tryUnify(AnType *a, AnType *b, UnionFind &scratch);
+    UnifyStatus tryUnify(std::vector<AnType*> const& a, std::vector<AnType*> const& b, UnionFind &scratch);
+
     std::pair<bool, Substitutions> tryUnify(AnType *a, AnType *b);
     std::pair<bool, Substitutions> tryUnify(std::vector<AnType*> const& a, std::vector<AnType*> const& b);
 
@@ -168,7 +168,7 @@ namespace ante {
 
     void show(parser::Node *n);
     void show(std::shared_ptr<parser::Node> const& n);
-    void show(std::unique_ptr<parser::Node> const& n);
+    void show(parser::ArenaPtr<parser::Node> const& n);
     std::ostream& operator<<(std::ostream &out, parser::Node &n);
     std::ostream& operator<<(std::ostream &out, AnType &n);
 }
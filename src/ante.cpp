@@ -38,17 +38,28 @@ void showParseTree(RootNode *root, string const& fileName){
  */
 void printHelp(){
     puts("Compiler for the Ante programming language\n");
-    puts("Usage: ante [options] <inputs>");
+    puts("Usage: ante [options] <inputs> [-- <program args>]");
     puts("options:");
     puts("\t-c\t\tcompile to object file");
     puts("\t-o <filename>\tspecify output name");
     puts("\t-p\t\tprint parse tree");
-    puts("\t-O <number>\tSet optimization level. Arg of 0 = none, 3 = all");
-    puts("\t-r\t\tcompile and run");
+    puts("\t-O <level>\tSet optimization level. Arg of 0 = none, 3 = all, s/z = optimize for size");
+    puts("\t-march=<cpu>\tgenerate code for the given cpu, or the host cpu and its features if native");
+    puts("\t-mcpu=<cpu>\tsame as -march");
+    puts("\t-mattr=<list>\tenable (+feature) or disable (-feature) cpu features, eg. +avx2,-fma");
+    puts("\t-no-vectorize\tdisable the loop and SLP vectorizers");
+    puts("\t-passes <list>\trun a custom llvm pass pipeline instead of the one selected by -O");
+    puts("\t-verify\t\tverify the generated llvm-IR before optimizing it");
+    puts("\t-r\t\tcompile and run in a JIT without producing a binary.  Arguments after -- are passed to the program");
+    puts("\t-lazy\t\twith -r, only compile each function once it is first called");
+    puts("\t-j <number>\tsplit code generation of executables across this many threads");
     puts("\t-help\t\tprint this message");
     puts("\t-lib\t\tcompile as library (include all functions in binary and compile to object file)");
+    puts("\t-emit-interface\twrite the interface of each input next to it, eg. vec.ani for vec.an, to be imported in place of its source");
     puts("\t-emit-llvm\tprint llvm-IR as output");
     puts("\t-check\t\tCheck program for errors without compiling");
+    puts("\t-build-cache <dir>\treuse the interfaces and objs saved to dir for modules whose source and imports are unchanged");
+    puts("\t-ct-cache <dir>\tsave results of pure compile-time function calls to dir for later builds");
     puts("\t-no-color\tprint uncolored output");
 
     puts("\nNative target: " AN_TARGET_TRIPLE);
@@ -71,22 +82,28 @@ int main(int argc, const char **argv){
     if(args->hasArg(Args::Help)) printHelp();
     if(args->hasArg(Args::NoColor)) colored_output = false;
 
+    int exitCode = 0;
     for(auto input : args->inputFiles){
+        if(args->hasArg(Args::EmitInterface)){
+            if(!emitInterface(input))
+                exitCode = 1;
+            continue;
+        }
+
         Compiler ante{input.c_str()};
         if(args->hasArg(Args::Parse)){
             showParseTree(ante.getAST(), ante.getModuleName());
         }
-        ante.processArgs(args);
+        if(int res = ante.processArgs(args))
+            exitCode = res;
     }
     if(args->hasArg(Args::Eval) || (args->args.empty() && args->inputFiles.empty()))
         Compiler(0).eval();
-    if(yylexer)
-        delete yylexer;
     //delete args;
 
     auto end = high_resolution_clock::now();
     if(showTimingInformation())
         cout << "Total: " << duration_cast<milliseconds>(end - start).count() << "ms\n";
-    return 0;
+    return exitCode;
 }
 #endif
@@ -21,10 +21,10 @@ namespace ante {
         auto anElemTys = vecOf<AnType*>(tn->fields.size());
 
         map<unsigned, Value*> nonConstants;
-        size_t offset = 0;
+        auto offsets = getFieldOffsets(c, tn);
 
         for(unsigned i = 0; i < tn->fields.size(); i++){
-            char* elem = (char*)arg.asRawData() + offset;
+            char* elem = (char*)arg.asRawData() + offsets[i];
             AnteValue elemTup{(void*)elem, tn->fields[i]};
             TypedValue tval = elemTup.asTypedValue(c);
 
@@ -35,12 +35,6 @@ namespace ante {
                 elems.push_back(UndefValue::get(tval.getType()));
             }
 
-            auto res = tn->fields[i]->getSizeInBits(c);
-            if(!res){
-                error("Unknown/Unimplemented TypeTag " + typeTagToStr(tn->typeTag), unknownLoc());
-            }
-
-            offset += res.getVal() / 8;
             elemTys.push_back(tval.getType());
             anElemTys.push_back(tval.type);
         }
@@ -210,17 +204,13 @@ namespace ante {
         auto *sty = try_cast<AnTupleType>(tup.type);
         if(ConstantStruct *ca = dyn_cast<ConstantStruct>(tup.val)){
             void *orig_data = this->data;
+            auto offsets = getFieldOffsets(c, sty);
             for(size_t i = 0; i < ca->getNumOperands(); i++){
                 Value *elem = ca->getAggregateElement(i);
                 AnType *ty = sty->fields[i];
                 auto field = TypedValue(elem, ty);
+                data = (char*)orig_data + offsets[i];
                 storeValue(c, field);
-
-                auto size = ty->getSizeInBits(c);
-                if(!size){
-                    error("storeTuple: " + size.getErr(), unknownLoc());
-                }
-                data = (char*)data + size.getVal() / 8;
             }
             data = orig_data;
         }else{
@@ -321,10 +311,25 @@ namespace ante {
 
     void AnteValue::printUnion(Compiler *c, std::ostream &os) const{
         auto *dt = try_cast<AnDataType>(type);
+
+        //unions stored in a niche of their value have no tag, the niche
+        //is always at the start of the value
+        auto &niche = dt->decl->getNiche(c, dt);
+        if(niche.kind != UnionNiche::Kind::None){
+            bool isEmpty = niche.kind == UnionNiche::Kind::NullPtr
+                ? !castTo<void*>()
+                : castTo<uint8_t>() == niche.value;
+            size_t tag = isEmpty ? 1 - niche.variant : niche.variant;
+            AnteValue(data, dt->getBoundFieldTypes()[tag]).printTupleOrData(c, os);
+            return;
+        }
+
         char tag = castTo<char>();
 
         auto &tagty = dt->getBoundFieldTypes()[tag];
-        AnteValue((char*)data + 1, tagty).printTupleOrData(c, os);
+        auto *variantTy = dt->decl->getVariantLlvmType(c, dt, tag);
+        auto offset = c->module->getDataLayout().getStructLayout(variantTy)->getElementOffset(1);
+        AnteValue((char*)data + offset, tagty).printTupleOrData(c, os);
     }
 
     void AnteValue::printTupleOrData(Compiler *c, std::ostream &os) const{
@@ -345,14 +350,12 @@ namespace ante {
             throw CtError();
         }
 
-        char* dataptr = (char*)data;
-        for(auto &ty : agg->fields){
-            auto size = ty->getSizeInBits(c);
-            AnteValue(dataptr, ty).printCtVal(c, os);
-            if(&ty != &agg->fields.back()){
+        auto offsets = getFieldOffsets(c, agg);
+        for(size_t i = 0; i < agg->fields.size(); i++){
+            AnteValue((char*)data + offsets[i], agg->fields[i]).printCtVal(c, os);
+            if(i + 1 != agg->fields.size()){
                 cout << ", ";
             }
-            dataptr += size.getVal() / 8;
         }
         putchar(')');
     }
@@ -409,7 +412,7 @@ namespace ante {
     *  - Assumes the Value* within the TypedValue is a Constant*
     */
     AnteValue::AnteValue(Compiler *c, vector<TypedValue> const& tvals,
-            vector<unique_ptr<parser::Node>> const& exprs)
+            vector<parser::ArenaPtr<parser::Node>> const& exprs)
             : data(nullptr){
 
         for(auto &n : exprs){
@@ -444,7 +447,7 @@ namespace ante {
         }
     }
 
-    AnteValue::AnteValue(Compiler *c, TypedValue const& val, unique_ptr<parser::Node> const& expr){
+    AnteValue::AnteValue(Compiler *c, TypedValue const& val, parser::ArenaPtr<parser::Node> const& expr){
         *this = AnteValue(c, val, expr.get());
     }
 
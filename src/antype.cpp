@@ -4,6 +4,7 @@
 #include "uniontag.h"
 #include "unification.h"
 #include "util.h"
+#include <mutex>
 
 using namespace std;
 using namespace ante::parser;
@@ -37,6 +38,55 @@ namespace ante {
         return false;
     }
 
+    bool containsTypeVarHelper(const AnType *t){
+        if(t->isGeneric)
+            return true;
+
+        if(t->isModifierType())
+            return containsTypeVar(static_cast<const AnModifier*>(t)->extTy);
+
+        auto anyContainsTypeVar = [](vector<AnType*> const& vec){
+            return ante::any(vec, [](AnType *t){ return containsTypeVar(t); });
+        };
+
+        if(auto fn = try_cast<AnFunctionType>(t)){
+            return containsTypeVar(fn->retTy) || anyContainsTypeVar(fn->paramTys)
+                || ante::any(fn->typeClassConstraints, [&](TraitImpl *tc){ return anyContainsTypeVar(tc->typeArgs); });
+
+        }else if(auto dt = try_cast<AnDataType>(t)){
+            return anyContainsTypeVar(dt->typeArgs);
+
+        }else if(auto tup = try_cast<AnTupleType>(t)){
+            return anyContainsTypeVar(tup->fields);
+
+        }else if(auto ptr = try_cast<AnPtrType>(t)){
+            return containsTypeVar(ptr->elemTy);
+
+        }else if(auto arr = try_cast<AnArrayType>(t)){
+            return containsTypeVar(arr->extTy);
+        }
+        return false;
+    }
+
+    bool containsTypeVar(const AnType *t){
+        //modules are inferred in parallel so the memo is shared between threads
+        static unordered_map<const AnType*, bool> memo;
+        static std::mutex memoMutex;
+
+        {
+            std::lock_guard<std::mutex> lock{memoMutex};
+            auto it = memo.find(t);
+            if(it != memo.end())
+                return it->second;
+        }
+
+        //The lock is not held here since the helper recurses into containsTypeVar
+        bool ret = containsTypeVarHelper(t);
+        std::lock_guard<std::mutex> lock{memoMutex};
+        memo[t] = ret;
+        return ret;
+    }
+
     bool AnType::hasModifier(TokenType m) const{
         return false;
     }
@@ -173,30 +223,99 @@ namespace ante {
         return &typeContainer[TT_Unit];
     }
 
+    /**
+     * Every non-primitive type is hash-consed into one of these tables so that
+     * each structurally distinct type is allocated exactly once.  This lets
+     * AnType::operator== and any map keyed on AnType* compare by address.
+     */
+    namespace interned {
+        unordered_map<pair<const AnType*, TokenType>, unique_ptr<BasicModifier>> basicModifiers;
+        unordered_map<pair<const AnType*, Node*>, unique_ptr<CompilerDirectiveModifier>> directiveModifiers;
+        unordered_map<AnType*, unique_ptr<AnPtrType>> ptrTypes;
+        unordered_map<pair<AnType*, size_t>, unique_ptr<AnArrayType>> arrayTypes;
+        unordered_map<pair<vector<AnType*>, vector<string>>, unique_ptr<AnTupleType>> tupleTypes;
+        unordered_map<pair<string, bool>, unique_ptr<AnTypeVarType>> typeVarTypes;
+
+        // Data types are keyed by their declaration as well so same-named
+        // types declared in different modules remain distinct.
+        unordered_map<pair<pair<string, TypeArgs>, TypeDecl*>, unique_ptr<AnDataType>> dataTypes;
+
+        // Trait constraints are keyed by address rather than by contents since
+        // their impl field is filled in later once the impl is resolved.
+        unordered_map<pair<pair<AnType*, vector<AnType*>>, vector<TraitImpl*>>,
+            unique_ptr<AnFunctionType>> functionTypes;
+
+        // Imports are parsed, resolved, and inferred in parallel so each table
+        // has its own mutex.  No type's constructor interns another type so a
+        // thread never holds more than one of these at once.
+        std::mutex basicModifiersMutex;
+        std::mutex directiveModifiersMutex;
+        std::mutex ptrTypesMutex;
+        std::mutex arrayTypesMutex;
+        std::mutex tupleTypesMutex;
+        std::mutex typeVarTypesMutex;
+        std::mutex dataTypesMutex;
+        std::mutex functionTypesMutex;
+    }
+
     BasicModifier* BasicModifier::get(const AnType *modifiedType, TokenType mod){
-        return new BasicModifier(modifiedType, mod);
+        auto key = make_pair(modifiedType, mod);
+        std::lock_guard<std::mutex> lock{interned::basicModifiersMutex};
+        if(auto *existing = search(interned::basicModifiers, key))
+            return existing;
+
+        auto ret = new BasicModifier(modifiedType, mod);
+        addKVPair(interned::basicModifiers, key, ret);
+        return ret;
     }
 
     CompilerDirectiveModifier* CompilerDirectiveModifier::get(const AnType *modifiedType, Node *directive){
-        return new CompilerDirectiveModifier(modifiedType, directive);
+        auto key = make_pair(modifiedType, directive);
+        std::lock_guard<std::mutex> lock{interned::directiveModifiersMutex};
+        if(auto *existing = search(interned::directiveModifiers, key))
+            return existing;
+
+        auto ret = new CompilerDirectiveModifier(modifiedType, directive);
+        addKVPair(interned::directiveModifiers, key, ret);
+        return ret;
     }
 
     AnPtrType* AnPtrType::get(AnType* ext){
-        return new AnPtrType(ext);
+        std::lock_guard<std::mutex> lock{interned::ptrTypesMutex};
+        if(auto *existing = search(interned::ptrTypes, ext))
+            return existing;
+
+        auto ret = new AnPtrType(ext);
+        addKVPair(interned::ptrTypes, ext, ret);
+        return ret;
     }
 
     AnArrayType* AnArrayType::get(AnType* t, size_t len){
-        return new AnArrayType(t, len);
+        auto key = make_pair(t, len);
+        std::lock_guard<std::mutex> lock{interned::arrayTypesMutex};
+        if(auto *existing = search(interned::arrayTypes, key))
+            return existing;
+
+        auto ret = new AnArrayType(t, len);
+        addKVPair(interned::arrayTypes, key, ret);
+        return ret;
     }
 
     AnTupleType* AnTupleType::get(vector<AnType*> const& fields){
-        return new AnTupleType(fields, {});
+        return AnTupleType::getAnonRecord(fields, {});
     }
 
     AnTupleType* AnTupleType::getAnonRecord(vector<AnType*> const& fields,
             vector<string> const& fieldNames){
 
-        return new AnTupleType(fields, fieldNames);
+        auto key = make_pair(fields, fieldNames);
+        std::lock_guard<std::mutex> lock{interned::tupleTypesMutex};
+        if(auto *existing = search(interned::tupleTypes, key))
+            return existing;
+
+        auto ret = new AnTupleType(fields, fieldNames);
+        addKVPair(interned::tupleTypes, key, ret);
+        return ret;
     }
 
     AnFunctionType* AnFunctionType::get(AnType* retty,
@@ -217,16 +336,38 @@ namespace ante {
             vector<TraitImpl*> const& tcConstrains){
 
         auto const& params = elems.empty() ? vector<AnType*>{AnType::getUnit()} : elems;
-        return new AnFunctionType(retTy, params, tcConstrains);
+
+        auto key = make_pair(make_pair(retTy, params), tcConstrains);
+        std::lock_guard<std::mutex> lock{interned::functionTypesMutex};
+        if(auto *existing = search(interned::functionTypes, key))
+            return existing;
+
+        auto ret = new AnFunctionType(retTy, params, tcConstrains);
+        addKVPair(interned::functionTypes, key, ret);
+        return ret;
     }
 
 
-    AnTypeVarType* AnTypeVarType::get(string const& name){
-        return new AnTypeVarType(name);
+    AnTypeVarType* AnTypeVarType::get(string const& name, bool isRowVar){
+        auto key = make_pair(name, isRowVar);
+        std::lock_guard<std::mutex> lock{interned::typeVarTypesMutex};
+        if(auto *existing = search(interned::typeVarTypes, key))
+            return existing;
+
+        auto ret = new AnTypeVarType(name, isRowVar);
+        addKVPair(interned::typeVarTypes, key, ret);
+        return ret;
     }
 
     AnDataType* AnDataType::get(std::string const& name, TypeArgs const& args, TypeDecl *decl){
-        return new AnDataType(name, args, decl);
+        auto key = make_pair(make_pair(name, args), decl);
+        std::lock_guard<std::mutex> lock{interned::dataTypesMutex};
+        if(auto *existing = search(interned::dataTypes, key))
+            return existing;
+
+        auto ret = new AnDataType(name, args, decl);
+        addKVPair(interned::dataTypes, key, ret);
+        return ret;
     }
 
 
@@ -390,9 +531,7 @@ namespace ante {
                 break;
             }
             case TT_TypeVar: {
-                auto tv = AnTypeVarType::get(tn->typeName);
-                tv->isRowVariable = tn->isRowVar;
-                ret = tv;
+                ret = AnTypeVarType::get(tn->typeName, tn->isRowVar);
                 break;
             }
             default:
@@ -480,42 +619,20 @@ namespace ante {
         if(this == &other) return true;
         if(typeTag != other.typeTag) return false;
 
-        if(this->isModifierType()){
-            if(other.isModifierType()){
-                auto lmod = dynamic_cast<const BasicModifier*>(this);
-                auto rmod = dynamic_cast<const BasicModifier*>(&other);
-                return lmod && rmod
-                    && lmod->mod == rmod->mod
-                    && *lmod->extTy == *rmod->extTy;
-            }else{
-                return false;
-            }
+        // All types are interned so differing addresses imply differing types,
+        // with two exceptions:  a primitive type compared with a modified version
+        // of itself (eg. u64 == mut u64), and function types, which are interned
+        // by their trait constraints as well but compare without them.
+        if(this->isModifierType() || other.isModifierType()){
+            return !this->isModifierType() && isPrimitiveTy();
         }
 
-        if(typeTag == TT_Tuple){
-            auto l = static_cast<const AnTupleType*>(this);
-            auto r = static_cast<const AnTupleType*>(&other);
-            return allEq(l->fields, r->fields) && allEq(l->fieldNames, r->fieldNames);
-
-        }else if(typeTag == TT_Data){
-            auto l = static_cast<const AnDataType*>(this);
-            auto r = static_cast<const AnDataType*>(&other);
-            return l->name == r->name && allEq(l->typeArgs, r->typeArgs);
-        }else if(typeTag == TT_Array){
-            auto l = static_cast<const AnArrayType*>(this);
-            auto r = static_cast<const AnArrayType*>(&other);
-            return *l->extTy == *r->extTy;
-        }else if(typeTag == TT_Ptr){
-            auto l = static_cast<const AnPtrType*>(this);
-            auto r = static_cast<const AnPtrType*>(&other);
-            return *l->elemTy == *r->elemTy;
-        }else if(typeTag == TT_Function){
+        if(typeTag == TT_Function){
             auto l = static_cast<const AnFunctionType*>(this);
             auto r = static_cast<const AnFunctionType*>(&other);
-            return *l->retTy == *r->retTy && allEq(l->paramTys, r->paramTys);
+            return l->retTy == r->retTy && l->paramTys == r->paramTys;
         }
-        /* Should only be reached with primitive types with modifiers, eg mut u64 == u64 */
-        return true;
+        return false;
     }
 
     bool allApproxEq(vector<AnType*> const& l, vector<AnType*> const& r){
@@ -6,18 +6,29 @@ using namespace ante;
 using namespace std;
 
 map<string, Args> argsMap = {
+    {"-build-cache", Args::BuildCacheDir},
     {"-check",     Args::Check},
     {"-c",         Args::CompileToObj},
     {"-r",         Args::CompileAndRun},
+    {"-ct-cache",  Args::CtCache},
+    {"-emit-interface", Args::EmitInterface},
     {"-emit-llvm", Args::EmitLLVM},
     {"-e",         Args::Eval},
     {"-help",      Args::Help},
+    {"-j",         Args::Jobs},
+    {"-lazy",      Args::Lazy},
     {"-lib",       Args::Lib},
+    {"-march",     Args::Cpu},
+    {"-mattr",     Args::CpuFeatures},
+    {"-mcpu",      Args::Cpu},
     {"-no-color",  Args::NoColor},
+    {"-no-vectorize", Args::NoVectorize},
     {"-O",         Args::OptLvl},
     {"-o",         Args::OutputName},
     {"-p",         Args::Parse},
-    {"-time",      Args::Time}
+    {"-passes",    Args::Passes},
+    {"-time",      Args::Time},
+    {"-verify",    Args::Verify}
 };
 
 void CompilerArgs::addArg(Args &&a, string &&s){
@@ -49,10 +60,10 @@ bool CompilerArgs::empty() const{
 enum ArgTy { None, Str, Int };
 
 ArgTy requiresArg(Args a){
-    if(a == OutputName)
+    if(a == OutputName || a == BuildCacheDir || a == CtCache || a == OptLvl || a == Passes || a == Cpu || a == CpuFeatures)
         return ArgTy::Str;
 
-    if(a == OptLvl)
+    if(a == Jobs)
         return ArgTy::Int;
 
     return ArgTy::None;
@@ -69,20 +80,41 @@ CompilerArgs* ante::parseArgs(int argc, const char** argv){
     CompilerArgs* ret = new CompilerArgs();
 
     for(int i = 1; i < argc; i++){
+        //everything after -- is given to the program run with -r
+        if(argv[i] == string("--")){
+            ret->programArgs.assign(argv + i + 1, argv + argc);
+            break;
+        }
+
         if(argv[i][0] == '-'){
+            //options taking a parameter may also be given as -option=param
+            string name = argv[i];
+            string s = "";
+            bool hasParam = false;
+            auto eq = name.find('=');
+            if(eq != string::npos){
+                s = name.substr(eq + 1);
+                name.erase(eq);
+                hasParam = true;
+            }
+
             try{
-                Args a = argsMap.at(argv[i]);
-                string s = "";
+                Args a = argsMap.at(name);
 
                 //check to see if this argument requires an addition arg, eg -c <filename>
                 ArgTy ty;
                 if((ty = requiresArg(a)) != ArgTy::None){
-                    if(i + 1 < argc && argv[i+1][0] != '-'){
+                    if(hasParam){
+                        //already given with -option=param
+                    }else if(i + 1 < argc && argv[i+1][0] != '-'){
                         s = argv[++i];
                     }else{
                         cerr << "Argument '" << argv[i] << "' requires a " << argTyToStr(ty) << " parameter.\n";
                         exit(1);
                     }
+                }else if(hasParam){
+                    cerr << "Argument '" << name << "' does not take a parameter.\n";
+                    exit(1);
                 }
 
                 ret->addArg(move(a), move(s));
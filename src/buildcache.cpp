@@ -0,0 +1,278 @@
+#include "buildcache.h"
+#include "args.h"
+#include "interface.h"
+#include "module.h"
+#include "nameresolution.h"
+#include "sourcemanager.h"
+#include "targetcpu.h"
+#include <iostream>
+#include <unordered_set>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/SHA1.h>
+#include <llvm/Support/raw_ostream.h>
+
+using namespace std;
+using namespace llvm;
+
+namespace ante {
+
+    string hashContents(StringRef contents){
+        return toHex(SHA1::hash(arrayRefFromStringRef(contents)));
+    }
+
+    /**
+     * Objs from a different build of the compiler may differ so the
+     * compiler's own executable is identified by its size and the
+     * time it was last modified.
+     */
+    void hashCompilerVersion(SHA1 &hash){
+        static int anchor;
+        string exe = sys::fs::getMainExecutable(nullptr, &anchor);
+
+        sys::fs::file_status status;
+        if(!sys::fs::status(exe, status)){
+            hash.update(exe);
+            hash.update(to_string(status.getSize()));
+            hash.update(to_string(status.getLastModificationTime().time_since_epoch().count()));
+        }
+        hash.update(__DATE__ " " __TIME__);
+    }
+
+
+    BuildCache::BuildCache(string const& dir, string const& inputFile, CompilerArgs const* args){
+        for(auto sub : {"imports", "modules", "objs"}){
+            SmallString<128> path{dir};
+            sys::path::append(path, sub);
+            if(auto err = sys::fs::create_directories(path)){
+                cerr << "Warning: Could not create build cache directory '"
+                     << path.str().str() << "': " << err.message() << endl;
+                return;
+            }
+        }
+        directory = dir;
+
+        SmallString<128> path{inputFile};
+        sys::fs::make_absolute(path);
+        inputPath = path.str().str();
+
+        SHA1 hash;
+        hashCompilerVersion(hash);
+
+        for(auto &arg : args->args){
+            //flags which do not change the output
+            if(arg.argTy == Args::BuildCacheDir || arg.argTy == Args::Time || arg.argTy == Args::NoColor
+                    || arg.argTy == Args::Help || arg.argTy == Args::Parse)
+                continue;
+
+            hash.update(to_string(arg.argTy) + '=' + arg.arg + '\0');
+        }
+
+        //-march=native depends on the machine compiling
+        auto &cpu = getTargetCpu();
+        hash.update(cpu.cpu + '\0' + cpu.features);
+
+        flagsHash = toHex(hash.final());
+    }
+
+
+    /**
+     * Set the interface hash of m, and of each module it imports, if m was
+     * loaded before the build cache was used.  Returns false if m cannot be
+     * stored as an interface.
+     */
+    bool hashInterface(Module *m, unordered_set<Module*> &visited){
+        if(!m->interfaceHash.empty())
+            return true;
+        if(m->importName.empty() || !visited.insert(m).second)
+            return false;
+
+        for(auto *import : m->imports){
+            if(import != m && !hashInterface(import, visited))
+                return false;
+        }
+
+        auto *source = SourceManager::getFile(findFile(m->importName));
+        string interface;
+        return source && ModuleInterface::write(m, source->getContents(), interface);
+    }
+
+
+    string BuildCache::getKey(StringRef source, vector<Module*> const& imports,
+            Module const* self, StringRef salt) const {
+        SHA1 hash;
+        hash.update(flagsHash);
+        hash.update(salt);
+        hash.update(hashContents(source));
+
+        unordered_set<Module*> visited;
+        for(auto *import : imports){
+            if(import == self)
+                continue;
+            if(!hashInterface(import, visited))
+                return "";
+            hash.update(import->importName + '\0' + import->interfaceHash);
+        }
+        return toHex(hash.final());
+    }
+
+
+    string BuildCache::getPath(string const& dir, string const& name) const {
+        SmallString<128> path{directory};
+        sys::path::append(path, dir, name);
+        return path.str().str();
+    }
+
+
+    /*
+     * The import record of a source holds the name each of its imports
+     * was imported by, one per line, in the order they were imported.
+     */
+    bool BuildCache::lookupImports(StringRef source, vector<string> &importNames){
+        if(directory.empty())
+            return false;
+
+        auto record = MemoryBuffer::getFile(getPath("imports", hashContents(source)));
+        if(!record)
+            return false;
+
+        SmallVector<StringRef, 16> lines;
+        (*record)->getBuffer().split(lines, '\n', -1, false);
+
+        importNames.clear();
+        for(auto &line : lines)
+            importNames.push_back(line.str());
+        return true;
+    }
+
+
+    void BuildCache::storeImports(StringRef source, vector<Module*> const& imports){
+        string record;
+        for(auto *import : imports)
+            record += import->importName + '\n';
+        writeFile(getPath("imports", hashContents(source)), record);
+    }
+
+
+    unique_ptr<ModuleInterface> BuildCache::lookupInterface(Module const* m, StringRef source){
+        if(directory.empty())
+            return nullptr;
+
+        string key = getKey(source, m->imports, m, "");
+        if(key.empty())
+            return nullptr;
+        return ModuleInterface::open(getPath("modules", key + ".ani"), source);
+    }
+
+
+    void BuildCache::storeInterface(Module const* m, StringRef source, StringRef interface){
+        if(directory.empty())
+            return;
+
+        string key = getKey(source, m->imports, m, "");
+        if(key.empty())
+            return;
+
+        //The import record is written last so a lookup never finds the
+        //imports of a source without the interface they lead to
+        if(writeFile(getPath("modules", key + ".ani"), interface))
+            storeImports(source, m->imports);
+    }
+
+
+    /*
+     * The entry of an input holds the number of objs stored, which are
+     * each stored next to it, eg. <key>.0.o for the first.
+     */
+    bool BuildCache::lookup(vector<SmallVector<char, 0>> &objs){
+        if(directory.empty())
+            return false;
+
+        auto *input = SourceManager::getFile(inputPath);
+        vector<string> importNames;
+        if(!input || !lookupImports(input->getContents(), importNames))
+            return false;
+
+        vector<Module*> imports;
+        if(!importModules(importNames, imports))
+            return false;
+
+        string key = getKey(input->getContents(), imports, nullptr, inputPath);
+        if(key.empty())
+            return false;
+
+        auto entry = MemoryBuffer::getFile(getPath("objs", key));
+        size_t objCount;
+        if(!entry || (*entry)->getBuffer().trim().getAsInteger(10, objCount))
+            return false;
+
+        objs.clear();
+        objs.resize(objCount);
+        for(size_t i = 0; i < objCount; i++){
+            auto obj = MemoryBuffer::getFile(getPath("objs", key + "." + to_string(i) + ".o"));
+            if(!obj)
+                return false;
+
+            StringRef contents = (*obj)->getBuffer();
+            objs[i].assign(contents.begin(), contents.end());
+        }
+        return true;
+    }
+
+
+    /**
+     * Write contents to a uniquely named file then move it to path, so
+     * concurrent builds never write to the same file and path is never
+     * left partially written.  Returns false if nothing was written, eg.
+     * if the disk is full or the cache directory is read-only.
+     */
+    bool writeFile(string const& path, StringRef contents){
+        int fd;
+        SmallString<128> tmpPath;
+        if(sys::fs::createUniqueFile(path + ".%%%%%%.tmp", fd, tmpPath))
+            return false;
+
+        bool failed;
+        {
+            raw_fd_ostream out{fd, /*shouldClose*/true};
+            out << contents;
+            out.close();
+            //an unchecked error would abort the compiler once out is destroyed
+            failed = out.has_error();
+            out.clear_error();
+        }
+
+        if(failed || sys::fs::rename(tmpPath, path)){
+            sys::fs::remove(tmpPath);
+            return false;
+        }
+        return true;
+    }
+
+
+    void BuildCache::store(Module const* input, vector<SmallVector<char, 0>> const& objs){
+        if(directory.empty())
+            return;
+
+        auto *source = SourceManager::getFile(inputPath);
+        if(!source)
+            return;
+
+        string key = getKey(source->getContents(), input->imports, input, inputPath);
+        if(key.empty())
+            return;
+
+        for(size_t i = 0; i < objs.size(); i++){
+            if(!writeFile(getPath("objs", key + "." + to_string(i) + ".o"), StringRef(objs[i].data(), objs[i].size())))
+                return;
+        }
+
+        //The entry and then the import record are written last so an
+        //interrupted build never leaves an entry with missing objs
+        if(writeFile(getPath("objs", key), to_string(objs.size()) + '\n'))
+            storeImports(source->getContents(), input->imports);
+    }
+}
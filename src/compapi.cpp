@@ -28,9 +28,9 @@ extern "C" {
         string n = f->getName();
 
         yy::location lloc = mkLoc(mkPos(0,0,0), mkPos(0,0,0));
-        auto *strlit = new StrLitNode(lloc, n);
+        StrLitNode strlit{lloc, n};
 
-        return new TypedValue(CompilingVisitor::compile(c, strlit));
+        return new TypedValue(CompilingVisitor::compile(c, &strlit));
     }
 
     TypedValue* Ante_sizeof(Compiler *c, AnteValue &tv){
@@ -1,23 +1,38 @@
 #include <llvm/IR/Verifier.h>          //for verifying basic structure of functions
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/IR/CFG.h>
 #include <llvm/Support/FileSystem.h>   //for r/w when outputting bitcode
 #include <llvm/Support/raw_ostream.h>  //for ostream when outputting bitcode
 #include <llvm/Passes/PassBuilder.h>
 #include <llvm/Support/raw_os_ostream.h>
 #include <llvm/Transforms/Scalar.h>    //for most passes
 #include <llvm/Transforms/IPO.h>
-#include <llvm/IR/LegacyPassManager.h>
 #include <llvm/Support/TargetRegistry.h>
 #include <llvm/Target/TargetMachine.h>
 #include <llvm/Linker/Linker.h>
-#include <llvm/ExecutionEngine/SectionMemoryManager.h>
-#include <llvm/ExecutionEngine/GenericValue.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Transforms/Utils/SplitModule.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Support/SmallVectorMemoryBuffer.h>
 #include <llvm/Transforms/IPO/AlwaysInliner.h>
-#include <llvm/Transforms/IPO/PassManagerBuilder.h>
 
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <chrono>
+#include <thread>
+
+#ifndef _WIN32
+#  include <spawn.h>
+#  include <sys/wait.h>
+#  include <unistd.h>
+extern char **environ;
+#endif
+#ifdef __linux__
+#  include <sys/mman.h>
+#endif
 
 #include "parser.h"
 #include "compiler.h"
@@ -27,6 +42,7 @@
 #include "repl.h"
 #include "uniontag.h"
 #include "target.h"
+#include "targetcpu.h"
 #include "nameresolution.h"
 #include "typeinference.h"
 #include "util.h"
@@ -288,15 +304,257 @@ TypedValue callForLoopTraitFn(Compiler *c, string const& fnName, TypedValue cons
 }
 
 
-void CompilingVisitor::visit(ForNode *n){
+/**
+ * A for loop over the prelude's LazyRange or over a Vec is lowered to a loop
+ * counting an index from 0 up to a trip count computed before the loop,
+ * rather than calling has_next, cur_elem, and advance on each iteration.
+ * This is the canonical form LLVM needs to find the loop's trip count and
+ * vectorize it.
+ */
+struct CountedLoop {
+    bool isVec = false;
+    Value *tripCount = nullptr;
+
+    /** The range's start and step as i64s, or the Vec's data pointer and null */
+    Value *start = nullptr;
+    Value *step = nullptr;
+
+    AnType *elemTy = nullptr;
+};
+
+/**
+ * Returns the declaration of the type defined by the given file in the
+ * standard library, or nullptr if the file was never imported.  Types from
+ * other modules with the same name are not returned.
+ */
+TypeDecl* lookupStdlibTypeDecl(string const& file, string const& typeName){
+    Module *m = Module::getRoot().findPath(ModulePath(file));
+    if(!m)
+        return nullptr;
+
+    auto &userTypes = m->userTypes;
+    auto decl = userTypes.find(typeName);
+    return decl == userTypes.end() ? nullptr : &decl->getValue();
+}
+
+/**
+ * Fill in loop if the given range can be iterated over with a counted loop.
+ * Returns false if it must be iterated over with the Iterator trait instead.
+ */
+bool getCountedLoop(Compiler *c, TypedValue const& range, CountedLoop &loop){
+    auto *dt = try_cast<AnDataType>(applySubstitutions(c->compCtxt->monomorphisationMappings, range.type));
+    if(!dt || dt->decl->isUnionType)
+        return false;
+
+    auto &fields = dt->decl->fields;
+    auto hasFields = [&](vector<string> const& names){
+        return std::all_of(names.begin(), names.end(), [&](string const& name){
+            return ante::find(fields, name) != fields.end();
+        });
+    };
+
+    auto fieldTypes = dt->decl->getBoundFieldTypes(dt);
+    auto getField = [&](string const& name, AnType **fieldTy){
+        *fieldTy = fieldTypes[ante::find(fields, name) - fields.begin()];
+        return c->builder.CreateExtractValue(range.val, dt->decl->getFieldIndex(c, dt, name));
+    };
+
+    if(dt->decl == lookupStdlibTypeDecl(AN_PRELUDE_FILE, "LazyRange") && hasFields({"start", "end", "step"})){
+        auto *i64Ty = Type::getInt64Ty(*c->ctxt);
+        AnType *fieldTy;
+        auto *start = c->builder.CreateSExt(getField("start", &fieldTy), i64Ty);
+        auto *end = c->builder.CreateSExt(getField("end", &fieldTy), i64Ty);
+        auto *step = c->builder.CreateSExt(getField("step", &fieldTy), i64Ty);
+
+        //Matches has_next: nothing is iterated over if the step is 0 or points away from end
+        auto *zero = ConstantInt::get(i64Ty, 0);
+        auto *one = ConstantInt::get(i64Ty, 1);
+        auto *ascending = c->builder.CreateICmpSGT(step, zero);
+        auto *dist = c->builder.CreateSelect(ascending, c->builder.CreateSub(end, start), c->builder.CreateSub(start, end));
+        auto *absStep = c->builder.CreateSelect(ascending, step, c->builder.CreateNeg(step));
+        auto *isEmpty = c->builder.CreateOr(c->builder.CreateICmpEQ(step, zero), c->builder.CreateICmpSLE(dist, zero));
+
+        //trip count = ceil(dist / |step|), the divisor is kept non-zero for empty ranges
+        auto *divisor = c->builder.CreateSelect(isEmpty, one, absStep);
+        auto *trips = c->builder.CreateUDiv(c->builder.CreateSub(c->builder.CreateAdd(dist, divisor), one), divisor);
+
+        loop.tripCount = c->builder.CreateSelect(isEmpty, zero, trips);
+        loop.start = start;
+        loop.step = step;
+        loop.elemTy = fieldTy;
+        return true;
+    }
+
+    if(dt->decl == lookupStdlibTypeDecl("vec.an", "Vec") && hasFields({"data", "len"})){
+        //Elements of an empty type have no llvm type to load, these are left to the Iterator trait
+        auto *dataTy = try_cast<AnPtrType>(fieldTypes[ante::find(fields, "data") - fields.begin()]);
+        if(!dataTy || isEmptyType(c, dataTy->elemTy))
+            return false;
+
+        AnType *fieldTy;
+        loop.isVec = true;
+        loop.start = getField("data", &fieldTy);
+        loop.tripCount = getField("len", &fieldTy);
+        loop.elemTy = dataTy->elemTy;
+        return true;
+    }
+    return false;
+}
+
+/** Returns the element of a counted loop at the given index */
+TypedValue getCountedLoopElem(Compiler *c, CountedLoop const& loop, Value *idx){
+    if(loop.isVec){
+        auto *elemTy = c->anTypeToLlvmType(loop.elemTy);
+        auto *elemPtr = c->builder.CreateInBoundsGEP(elemTy, loop.start, idx);
+        return {c->builder.CreateLoad(elemTy, elemPtr), loop.elemTy};
+    }
+
+    //start + idx * step, computed in i64 so it cannot overflow before the truncation
+    auto *offset = c->builder.CreateMul(idx, loop.step);
+    auto *elem = c->builder.CreateAdd(loop.start, offset);
+    return {c->builder.CreateTrunc(elem, c->anTypeToLlvmType(loop.elemTy)), loop.elemTy};
+}
+
+/**
+ * Bind the pattern of a for loop to the current element of its range
+ */
+void bindForLoopPattern(Compiler *c, ForNode *n, TypedValue const& elem){
+    TypeError err{"A for-loop's binding pattern should match the return type of the iterator's unwrap function, but found " +
+            anTypeToColoredStr(n->pattern->getType()) + " and " + anTypeToColoredStr(elem.type) + " respectively", n->pattern->loc};
+
+    auto subs = unify({{n->pattern->getType(), elem.type, err}});
+    c->compCtxt->insertMonomorphisationMappings(subs);
+
+    auto vn = dynamic_cast<VarNode*>(n->pattern.get());
+    if(vn){
+        vn->decl->tval = elem;
+    }
+
+    //TODO: handle arbitrary patterns
+    // auto *decl = n->pattern->decls[0];
+    // decl->tval = uwrap;
+}
+
+/**
+ * Returns true if any block reachable from body before it returns to
+ * cond or leaves the loop through end calls a function other than an intrinsic.
+ */
+bool loopBodyHasCalls(BasicBlock *body, BasicBlock *cond, BasicBlock *end){
+    SmallPtrSet<BasicBlock*, 8> visited{cond, end};
+    vector<BasicBlock*> worklist{body};
+
+    while(!worklist.empty()){
+        BasicBlock *bb = worklist.back();
+        worklist.pop_back();
+        if(!visited.insert(bb).second)
+            continue;
+
+        for(auto &inst : *bb){
+            if(auto *call = dyn_cast<CallBase>(&inst)){
+                if(!isa<IntrinsicInst>(call))
+                    return true;
+            }
+        }
+        for(auto *succ : successors(bb))
+            worklist.push_back(succ);
+    }
+    return false;
+}
+
+/**
+ * Mark the given loop latch so the vectorizer always considers the loop.
+ * The hint overrides the vectorizer's own flags and cost model, so it is only
+ * attached when vectorization is enabled and not optimizing for size.  Loops
+ * which call functions are left to the cost model since forcing them would
+ * only print a "loop not vectorized" warning for each.
+ */
+void addVectorizeMetadata(Compiler *c, BranchInst *latch, BasicBlock *body, BasicBlock *end){
+    if(!c->vectorize || c->optLvl <= 1 || c->sizeLvl != 0
+            || loopBodyHasCalls(body, latch->getSuccessor(0), end))
+        return;
+
+    auto &ctxt = *c->ctxt;
+    Metadata *vectorize[] = {
+        MDString::get(ctxt, "llvm.loop.vectorize.enable"),
+        ConstantAsMetadata::get(ConstantInt::getTrue(ctxt))
+    };
+
+    //loop ids refer to themselves as their first operand
+    auto tmp = MDNode::getTemporary(ctxt, None);
+    Metadata *ops[] = {tmp.get(), MDNode::get(ctxt, vectorize)};
+    auto *loopId = MDNode::getDistinct(ctxt, ops);
+    loopId->replaceOperandWith(0, loopId);
+
+    latch->setMetadata(LLVMContext::MD_loop, loopId);
+}
+
+/**
+ * Compile a for loop over a range with a known trip count
+ */
+void compCountedForLoop(CompilingVisitor &cv, ForNode *n, CountedLoop const& loop){
+    Compiler *c = cv.c;
     Function *f = c->builder.GetInsertBlock()->getParent();
+    BasicBlock *preheader = c->builder.GetInsertBlock();
     BasicBlock *cond  = BasicBlock::Create(*c->ctxt, "for_cond", f);
     BasicBlock *begin = BasicBlock::Create(*c->ctxt, "for", f);
     BasicBlock *incr = BasicBlock::Create(*c->ctxt, "for_incr", f);
     BasicBlock *end   = BasicBlock::Create(*c->ctxt, "end_for", f);
 
+    c->builder.CreateBr(cond);
+    c->builder.SetInsertPoint(cond);
+
+    auto *idxTy = loop.tripCount->getType();
+    auto *idx = c->builder.CreatePHI(idxTy, 2, "idx");
+    idx->addIncoming(ConstantInt::get(idxTy, 0), preheader);
+
+    c->builder.CreateCondBr(c->builder.CreateICmpULT(idx, loop.tripCount), begin, end);
+    c->builder.SetInsertPoint(begin);
+
+    bindForLoopPattern(c, n, getCountedLoopElem(c, loop, idx));
+
+    c->compCtxt->breakLabels->push_back(end);
+    c->compCtxt->continueLabels->push_back(incr);
+
+    try{
+        n->child->accept(cv);
+    }catch(CtError const& e){
+        c->compCtxt->breakLabels->pop_back();
+        c->compCtxt->continueLabels->pop_back();
+        throw e;
+    }
+
+    c->compCtxt->breakLabels->pop_back();
+    c->compCtxt->continueLabels->pop_back();
+
+    if(!cv.val || (!dyn_cast<ReturnInst>(cv.val.val) && !dyn_cast<BranchInst>(cv.val.val)))
+        c->builder.CreateBr(incr);
+
+    //incr is always emitted since continue may jump to it even if the body never falls through
+    c->builder.SetInsertPoint(incr);
+    auto *next = c->builder.CreateAdd(idx, ConstantInt::get(idxTy, 1), "idx_next", true, true);
+    idx->addIncoming(next, incr);
+    addVectorizeMetadata(c, c->builder.CreateBr(cond), begin, end);
+
+    c->builder.SetInsertPoint(end);
+    cv.val = c->getUnitLiteral();
+}
+
+
+void CompilingVisitor::visit(ForNode *n){
     auto rangev = CompilingVisitor::compile(c, n->range);
 
+    CountedLoop loop;
+    if(rangev && getCountedLoop(c, rangev, loop)){
+        compCountedForLoop(*this, n, loop);
+        return;
+    }
+
+    Function *f = c->builder.GetInsertBlock()->getParent();
+    BasicBlock *cond  = BasicBlock::Create(*c->ctxt, "for_cond", f);
+    BasicBlock *begin = BasicBlock::Create(*c->ctxt, "for", f);
+    BasicBlock *incr = BasicBlock::Create(*c->ctxt, "for_incr", f);
+    BasicBlock *end   = BasicBlock::Create(*c->ctxt, "end_for", f);
+
     //check if the range expression is its own iterator and thus implements Iterator
     //If it does not, see if it implements Iterable by attempting to call into_iter on it
     rangev = callForLoopTraitFn(c, "into_iter", rangev, n->range->loc);
@@ -332,20 +590,7 @@ void CompilingVisitor::visit(ForNode *n){
     if(!uwrap) error("Range expression of type " + anTypeToColoredStr(rangev.type) + " does not implement " +
             lazy_str("Iterable", AN_TYPE_COLOR) + ", which it needs to be used in a for loop", n->range->loc);
 
-    TypeError err{"A for-loop's binding pattern should match the return type of the iterator's unwrap function, but found " +
-            anTypeToColoredStr(n->pattern->getType()) + " and " + anTypeToColoredStr(uwrap.type) + " respectively", n->pattern->loc};
-
-    auto subs = unify({{n->pattern->getType(), uwrap.type, err}});
-    c->compCtxt->insertMonomorphisationMappings(subs);
-
-    auto vn = dynamic_cast<VarNode*>(n->pattern.get());
-    if(vn){
-        vn->decl->tval = uwrap;
-    }
-
-    //TODO: handle arbitrary patterns
-    // auto *decl = n->pattern->decls[0];
-    // decl->tval = uwrap;
+    bindForLoopPattern(c, n, uwrap);
 
     //register the branches to break/continue to right before the body
     //is compiled in case there was an error compiling the range
@@ -501,7 +746,13 @@ void compLetBinding(VarAssignNode *node, CompilingVisitor &cv){
 
     auto *decl = static_cast<VarNode*>(node->ref_expr)->decl;
 
-    TypedValue val = CompilingVisitor::compile(c, node->expr);
+    //x = ante expr evaluates expr during compilation
+    bool isCompileTime = !c->isJIT && std::any_of(node->modifiers.begin(), node->modifiers.end(),
+            [](ArenaPtr<ModNode> const& m){ return m->mod == Tok_Ante; });
+
+    TypedValue val = isCompileTime
+        ? compileAndCallAnteFunction(c, node->expr.get())
+        : CompilingVisitor::compile(c, node->expr);
 
     for(auto &n : node->modifiers){
         TokenType m = (TokenType)n->mod;
@@ -527,6 +778,12 @@ void compLetBinding(VarAssignNode *node, CompilingVisitor &cv){
 
 
 void CompilingVisitor::visit(ModNode *n){
+    //ante expressions are evaluated during compilation unless they are already being evaluated
+    if(n->mod == Tok_Ante && n->expr && !c->isJIT){
+        this->val = compileAndCallAnteFunction(c, n->expr.get());
+        return;
+    }
+
     cerr << "Warning: " << Lexer::getTokStr(n->mod) << " unimplemented in expr:\n";
     PrintingVisitor::print(n);
     n->expr->accept(*this);
@@ -575,7 +832,7 @@ TypedValue compFieldInsert(Compiler *c, BinOpNode *bop, Node *expr){
 
     //check to see if this is a field index
     auto dataTy = try_cast<AnDataType>(tyn);
-    auto index = dataTy->decl->getFieldIndex(field->name);
+    auto index = dataTy->decl->getFieldIndex(c, dataTy, field->name);
 
     if(index != -1){
         auto newval = CompilingVisitor::compile(c, expr);
@@ -817,6 +1074,8 @@ void compileAll(Compiler *c, vector<T> &vec){
 bool Compiler::scanAllDecls(RootNode *root){
     NameResolutionVisitor v{getModuleName()};
     this->compUnit = v.compUnit;
+    preparseImports(root);
+    resolveImports();
     root->accept(v);
     if(!errorCount())
         TypeInferenceVisitor::infer(root, compUnit);
@@ -877,26 +1136,78 @@ void CompilingVisitor::visit(RootNode *n){
         this->val = c->getUnitLiteral();
 }
 
+TargetMachine* getTargetMachine();
+
 /**
- * @brief Fills the given PassManager with passes appropriate
- * for the given optLvl.
+ * @brief Translates the -O flags of the given Compiler into
+ * the PassBuilder::OptimizationLevel of the same name.
+ */
+PassBuilder::OptimizationLevel getOptimizationLevel(Compiler *c){
+    using OptimizationLevel = PassBuilder::OptimizationLevel;
+
+    if(c->sizeLvl == 1) return OptimizationLevel::Os;
+    if(c->sizeLvl == 2) return OptimizationLevel::Oz;
+
+    switch(c->optLvl){
+        case 0: return OptimizationLevel::O0;
+        case 1: return OptimizationLevel::O1;
+        case 2: return OptimizationLevel::O2;
+        default: return OptimizationLevel::O3;
+    }
+}
+
+/**
+ * @brief Runs the optimization pipeline selected by the Compiler's
+ * -O, -no-vectorize, and -passes flags over the given module.
  *
- * @param pm The PassManager to add passes to
- * @param optLvl The optimization level in the range 0..3.
- * Determines which passes should be added.  With 3 being
- * all passes.
+ * @param c The Compiler whose flags select the passes to run
+ * @param m The module to optimize
  */
-void addPasses(llvm::Module *m, char optLvl){
+void addPasses(Compiler *c, llvm::Module *m){
     using namespace std::chrono;
     auto start = high_resolution_clock::now();
-    if(optLvl > 0){
-        llvm::verifyModule(*m, &dbgs());
 
-        llvm::legacy::PassManager pm;
-        llvm::PassManagerBuilder pmb;
-        pmb.OptLevel = optLvl;
-        pmb.populateModulePassManager(pm);
-        pm.run(*m);
+#ifdef NDEBUG
+    bool verify = c->verify;
+#else
+    bool verify = true;
+#endif
+    if(verify && llvm::verifyModule(*m, &dbgs())){
+        cerr << "Module " << m->getName().str() << " failed to verify.\n";
+        exit(1);
+    }
+
+    if(c->optLvl > 0 || !c->passPipeline.empty()){
+        //The TargetMachine gives the vectorizers and inliner accurate cost models
+        unique_ptr<TargetMachine> tm{getTargetMachine()};
+        m->setTargetTriple(tm->getTargetTriple().str());
+        m->setDataLayout(tm->createDataLayout());
+
+        PipelineTuningOptions pto;
+        pto.LoopVectorization = c->vectorize && c->optLvl > 1;
+        pto.SLPVectorization = c->vectorize && c->optLvl > 1;
+
+        PassBuilder pb{tm.get(), pto};
+        LoopAnalysisManager lam;
+        FunctionAnalysisManager fam;
+        CGSCCAnalysisManager cgam;
+        ModuleAnalysisManager mam;
+        pb.registerModuleAnalyses(mam);
+        pb.registerCGSCCAnalyses(cgam);
+        pb.registerFunctionAnalyses(fam);
+        pb.registerLoopAnalyses(lam);
+        pb.crossRegisterProxies(lam, fam, cgam, mam);
+
+        ModulePassManager mpm;
+        if(!c->passPipeline.empty()){
+            if(auto err = pb.parsePassPipeline(mpm, c->passPipeline)){
+                cerr << "Invalid pass pipeline '" << c->passPipeline << "': " << toString(move(err)) << endl;
+                exit(1);
+            }
+        }else{
+            mpm = pb.buildPerModuleDefaultPipeline(getOptimizationLevel(c));
+        }
+        mpm.run(*m, mam);
     }
     auto end = high_resolution_clock::now();
     if(showTimingInformation())
@@ -918,7 +1229,7 @@ void Compiler::compile(){
         //create implicit main function and import the prelude
         createMainFn();
 
-        CompilingVisitor::compile(this, ast);
+        CompilingVisitor::compile(this, getAST());
 
         //always return 0
         builder.CreateRet(ConstantInt::get(*ctxt, APInt(32, 0)));
@@ -928,8 +1239,10 @@ void Compiler::compile(){
         if(showTimingInformation())
             std::cout << "Compiling: " << duration_cast<milliseconds>(end - start).count() << "ms\n";
 
-        if(!errorCount() && !isLib){
-            addPasses(module.get(), optLvl);
+        if(!errorCount()){
+            addTargetCpuAttributes(*module);
+            if(!isLib)
+                addPasses(this, module.get());
         }
 
         //flag this module as compiled.
@@ -947,25 +1260,107 @@ void Compiler::compile(){
 }
 
 
-void Compiler::compileNative(){
+/**
+ * An obj file given to the linker.  Where possible it stays in memory and
+ * the linker reads it through /dev/fd, otherwise it is written to disk and
+ * removed once this is destroyed.
+ */
+struct LinkerInput {
+    string path;
+    int fd;
+
+    LinkerInput(StringRef obj, string const& fileName) : fd(-1){
+#ifdef __linux__
+        fd = memfd_create(fileName.c_str(), 0);
+        if(fd >= 0){
+            if(write(fd, obj.data(), obj.size()) == (ssize_t)obj.size()){
+                path = "/dev/fd/" + to_string(fd);
+                return;
+            }
+            close(fd);
+            fd = -1;
+        }
+#endif
+        error_code err;
+        raw_fd_ostream out{fileName, err, sys::fs::OF_None};
+        if(!err){
+            out << obj;
+            path = fileName;
+        }
+    }
+
+    LinkerInput(LinkerInput const&) = delete;
+
+    ~LinkerInput(){
+#ifdef __linux__
+        if(fd >= 0){
+            close(fd);
+            return;
+        }
+#endif
+        if(!path.empty())
+            remove(path.c_str());
+    }
+};
+
+
+int Compiler::compileToObjs(vector<SmallVector<char, 0>> &objs, bool split){
+    if(buildCache && buildCache->lookup(objs))
+        return 0;
+
     if(!compiled) compile();
 
-    //this file will become the obj file before linking
-    string objFile = outFile + ".o";
+    int res;
+    if(split && jobs > 1){
+        res = compileIRtoObjs(module.get(), jobs, objs);
+    }else{
+        objs.resize(1);
+        res = compileIRtoObj(module.get(), objs[0]);
+    }
+
+    if(!res && buildCache)
+        buildCache->store(compUnit, objs);
+    return res;
+}
+
+
+void Compiler::compileNative(){
+    vector<SmallVector<char, 0>> objs;
+    if(compileToObjs(objs, true))
+        return;
 
-    if(!compileIRtoObj(module.get(), objFile)){
-        linkObj(objFile, outFile);
-        remove(objFile.c_str());
+    list<LinkerInput> inputs;
+    vector<string> inFiles;
+    for(size_t i = 0; i < objs.size(); i++){
+        string name = objs.size() == 1 ? outFile + ".o" : outFile + "." + to_string(i) + ".o";
+        inputs.emplace_back(StringRef(objs[i].data(), objs[i].size()), name);
+
+        if(inputs.back().path.empty()){
+            cerr << "Could not write obj file " << name << " for linking\n";
+            return;
+        }
+        inFiles.push_back(inputs.back().path);
     }
+
+    linkObj(inFiles, outFile);
 }
 
 int Compiler::compileObj(string &outName){
-    if(!compiled) compile();
-
     string modName = getModuleName();
     string objFile = outName.length() > 0 ? outName : modName + ".o";
 
-    return compileIRtoObj(module.get(), objFile);
+    vector<SmallVector<char, 0>> objs;
+    int res = compileToObjs(objs, false);
+    if(res) return res;
+
+    error_code err;
+    raw_fd_ostream out{objFile, err, sys::fs::OF_None};
+    if(err){
+        cerr << "Could not open " << objFile << ": " << err.message() << endl;
+        return 1;
+    }
+    out.write(objs[0].data(), objs[0].size());
+    return 0;
 }
 
 
@@ -992,12 +1387,11 @@ const Target* getTarget(){
 TargetMachine* getTargetMachine(){
     auto *target = getTarget();
 
-    string cpu = "";
-    string features = "";
+    auto &cpu = getTargetCpu();
     string triple = Triple(AN_NATIVE_ARCH, AN_NATIVE_VENDOR, AN_NATIVE_OS).getTriple();
     TargetOptions op;
 
-    TargetMachine *tm = target->createTargetMachine(triple, cpu, features, op, Reloc::Model::PIC_,
+    TargetMachine *tm = target->createTargetMachine(triple, cpu.cpu, cpu.features, op, Reloc::Model::PIC_,
             None, CodeGenOpt::Level::Aggressive);
 
     if(!tm){
@@ -1008,57 +1402,169 @@ TargetMachine* getTargetMachine(){
     return tm;
 }
 
+/**
+ * Types are laid out as soon as they are translated to llvm types so each
+ * module needs the target's DataLayout before any code is compiled into it.
+ * The layout only depends on the target triple, never on the cpu.
+ */
+const DataLayout& getTargetDataLayout(){
+    static DataLayout layout = unique_ptr<TargetMachine>(getTargetMachine())->createDataLayout();
+    return layout;
+}
 
-void Compiler::jitFunction(Function *f){
-    if(!jit.get()){
-        auto* eBuilder = new EngineBuilder(unique_ptr<llvm::Module>(module.get()));
-
-        string err;
 
-        jit.reset(eBuilder->setErrorStr(&err).setEngineKind(EngineKind::JIT).create());
-        if(err.length() > 0) cerr << err << endl;
+int Compiler::jitRun(vector<string> const& programArgs, bool lazy){
+    if(lazy){
+        if(!compiled) compile();
+        return runModuleLazilyInJit(*module, outFile, programArgs);
     }
 
-    compileIRtoObj(module.get(), (".tmp_" + f->getName()).str());
-    jit->addModule(move(module));
-    jit->finalizeObject();
-    remove((".tmp_" + f->getName()).str().c_str());
+    vector<SmallVector<char, 0>> objs;
+    if(compileToObjs(objs, false))
+        return -1;
+
+    return runObjInJit(make_unique<SmallVectorMemoryBuffer>(move(objs[0])), outFile, programArgs);
+}
+
+
+/**
+ * Emits the given module as an obj file into the given buffer using a new
+ * TargetMachine.  The native target must already be initialized by
+ * getTarget() if this is called from multiple threads.
+ */
+int emitObj(llvm::Module *mod, SmallVectorImpl<char> &obj){
+    unique_ptr<TargetMachine> tm{getTargetMachine()};
+    mod->setDataLayout(tm->createDataLayout());
 
-    auto* fn = jit->getPointerToFunction(f);
+    raw_svector_ostream os{obj};
+    llvm::legacy::PassManager pm;
+    if(tm->addPassesToEmitFile(pm, os, nullptr, CGFT_ObjectFile))
+        return 1;
 
-    if(fn)
-        reinterpret_cast<void(*)()>(fn)();
+    pm.run(*mod);
+    return 0;
+}
+
+
+int Compiler::compileIRtoObj(llvm::Module *mod, SmallVectorImpl<char> &obj){
+    using namespace std::chrono;
+    auto start = high_resolution_clock::now();
+
+    int res = emitObj(mod, obj);
+
+    auto end = high_resolution_clock::now();
+    if(showTimingInformation())
+        std::cout << "Writing .ll: " << duration_cast<milliseconds>(end - start).count() << "ms\n";
+    return res;
 }
 
 
 int Compiler::compileIRtoObj(llvm::Module *mod, string outFile){
+    SmallVector<char, 0> obj;
+    int res = compileIRtoObj(mod, obj);
+    if(res) return res;
+
+    error_code err;
+    raw_fd_ostream out{outFile, err, sys::fs::OF_None};
+    if(err){
+        cerr << "Could not open " << outFile << ": " << err.message() << endl;
+        return 1;
+    }
+    out.write(obj.data(), obj.size());
+    return 0;
+}
+
+
+int Compiler::compileIRtoObjs(llvm::Module *mod, unsigned int partitions,
+        vector<SmallVector<char, 0>> &objs){
+
     using namespace std::chrono;
     auto start = high_resolution_clock::now();
 
-    auto *tm = getTargetMachine();
+    //An LLVMContext cannot be used from several threads at once so each
+    //partition is written to bitcode here and read back into its own context.
+    //SplitModule consumes the module it splits so a copy is split instead.
+    vector<SmallString<0>> bitcode;
+    SplitModule(CloneModule(*mod), partitions, [&](unique_ptr<llvm::Module> part){
+        bitcode.emplace_back();
+        raw_svector_ostream os{bitcode.back()};
+        WriteBitcodeToFile(*part, os);
+    });
+
+    objs.resize(bitcode.size());
+
+    //initialize the native target once before any thread creates a TargetMachine
+    getTarget();
+
+    vector<int> results(bitcode.size());
+    vector<std::thread> threads;
+    for(size_t i = 0; i < bitcode.size(); i++){
+        threads.emplace_back([&, i]{
+            LLVMContext partCtxt;
+            auto part = parseBitcodeFile(MemoryBufferRef(bitcode[i], "partition" + to_string(i)), partCtxt);
+            if(!part){
+                consumeError(part.takeError());
+                results[i] = 1;
+                return;
+            }
+            results[i] = emitObj(part->get(), objs[i]);
+        });
+    }
 
-    char **err = nullptr;
-    char *filename = (char*)outFile.c_str();
-    int res = LLVMTargetMachineEmitToFile(
-        (LLVMTargetMachineRef)tm,
-        (LLVMModuleRef)mod,
-        filename,
-        (LLVMCodeGenFileType)CGFT_ObjectFile, err);
+    int res = 0;
+    for(size_t i = 0; i < threads.size(); i++){
+        threads[i].join();
+        if(results[i]) res = results[i];
+    }
 
-    delete tm;
     auto end = high_resolution_clock::now();
     if(showTimingInformation())
-        std::cout << "Writing .ll: " << duration_cast<milliseconds>(end - start).count() << "ms\n";
+        std::cout << "Writing .ll (" << partitions << " threads): "
+                  << duration_cast<milliseconds>(end - start).count() << "ms\n";
     return res;
 }
 
 
-int Compiler::linkObj(string inFiles, string outFile){
+/**
+ * Runs the given program and waits for it to finish.  The program is
+ * started directly rather than through a shell so its arguments are
+ * passed through unchanged.
+ *
+ * @return The program's exit status, or -1 if it could not be run
+ */
+int runProgram(vector<string> const& args){
+#ifdef _WIN32
+    string cmd;
+    for(auto &arg : args)
+        cmd += '"' + arg + "\" ";
+    return system(cmd.c_str());
+#else
+    vector<char*> argv;
+    for(auto &arg : args)
+        argv.push_back((char*)arg.c_str());
+    argv.push_back(nullptr);
+
+    pid_t pid;
+    if(posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ))
+        return -1;
+
+    int status;
+    if(waitpid(pid, &status, 0) < 0)
+        return -1;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+#endif
+}
+
+
+int Compiler::linkObj(vector<string> const& inFiles, string outFile){
     using namespace std::chrono;
     auto start = high_resolution_clock::now();
 
-    string cmd = AN_LINKER " " + inFiles + " -o " + outFile;
-    int ret = system(cmd.c_str());
+    vector<string> cmd = {AN_LINKER};
+    cmd.insert(cmd.end(), inFiles.begin(), inFiles.end());
+    cmd.push_back("-o");
+    cmd.push_back(outFile);
+    int ret = runProgram(cmd);
 
     auto end = high_resolution_clock::now();
     if(showTimingInformation())
@@ -1124,45 +1630,38 @@ string dirprefix(string &f){
 }
 
 
+/**
+ * The LLVMContext owned by the given ThreadSafeContext, kept alive
+ * for as long as the returned pointer or any copy of it is.
+ */
+static shared_ptr<LLVMContext> shareContext(orc::ThreadSafeContext llvmCtxt){
+    return shared_ptr<LLVMContext>(llvmCtxt.getContext(), [llvmCtxt](LLVMContext*){});
+}
+
+
 /**
  * @brief The main constructor for Compiler
  *
  * @param _fileName Name of the file being compiled
  * @param lib Set to true if this module should be compiled as a library
- * @param llvmCtxt The llvmCtxt possibly shared with another module
+ * @param llvmCtxt The llvmCtxt possibly shared with another module.
+ *        The JitSession of this compilation uses it as well.
  */
-Compiler::Compiler(const char *_fileName, bool lib, shared_ptr<LLVMContext> llvmCtxt) :
-        ctxt(llvmCtxt ? llvmCtxt : shared_ptr<LLVMContext>(new LLVMContext())),
+Compiler::Compiler(const char *_fileName, bool lib, orc::ThreadSafeContext llvmCtxt) :
+        ctxt(shareContext(llvmCtxt)),
         builder(*ctxt),
         compUnit(nullptr),
+        ast(nullptr),
         compCtxt(new CompilerCtxt()),
-        ctCtxt(new CompilerCtCtxt()),
+        ctCtxt(new CompilerCtCtxt(llvmCtxt)),
         compiled(false),
         isLib(lib),
         isJIT(false),
+        unparsed(_fileName),
         fileName(_fileName? _fileName : "(stdin)"),
         funcPrefix(""),
-        scope(0), optLvl(2), fnScope(1){
-
-    if(_fileName){
-        string* fileName_cpy = new string(fileName);
-        setLexer(new Lexer(fileName_cpy));
-        yy::parser p{};
-        int flag = p.parse();
-        if(flag != PE_OK){ //parsing error, cannot procede
-            //print out remaining errors
-            int tok;
-            yy::location loc;
-            while((tok = yylexer->next(&loc)) != Tok_Newline && tok != 0);
-            while(p.parse() != PE_OK && yylexer->peek() != 0);
-
-            fputs("Syntax error, aborting.\n", stderr);
-            exit(flag);
-        }
-
-        RootNode* root = parser::getRootNode();
-        this->ast = root;
-    }
+        scope(0), optLvl(2), fnScope(1), jobs(1),
+        sizeLvl(0), vectorize(true), verify(false){
 
     //Add this module to the cache to ensure it is not compiled twice
     outFile = getModuleName();
@@ -1170,6 +1669,7 @@ Compiler::Compiler(const char *_fileName, bool lib, shared_ptr<LLVMContext> llvm
         outFile = "a.out";
 
     module.reset(new llvm::Module(outFile, *ctxt));
+    module->setDataLayout(getTargetDataLayout());
 }
 
 /**
@@ -1191,12 +1691,15 @@ Compiler::Compiler(Compiler *c, Node *root, string modName, bool lib) :
         compiled(false),
         isLib(lib),
         isJIT(false),
+        unparsed(false),
         fileName(c->fileName),
         outFile(modName),
         funcPrefix(""),
-        scope(0), optLvl(2), fnScope(1){
+        scope(0), optLvl(2), fnScope(1), jobs(1),
+        sizeLvl(0), vectorize(true), verify(false){
 
     module.reset(new llvm::Module(outFile, *ctxt));
+    module->setDataLayout(getTargetDataLayout());
     this->ast = (RootNode*)root;
 }
 
@@ -1207,7 +1710,7 @@ bool showTimingInformation() {
     return showTimingInformationGlobal;
 }
 
-void Compiler::processArgs(CompilerArgs *args){
+int Compiler::processArgs(CompilerArgs *args){
     string out = "";
     bool shouldGenerateExecutable = true;
     showTimingInformationGlobal = args->hasArg(Args::Time);
@@ -1218,13 +1721,51 @@ void Compiler::processArgs(CompilerArgs *args){
     }
 
     if(auto *arg = args->getArg(Args::OptLvl)){
+        sizeLvl = 0;
         if(arg->arg == "0") optLvl = 0;
         else if(arg->arg == "1") optLvl = 1;
         else if(arg->arg == "2") optLvl = 2;
         else if(arg->arg == "3") optLvl = 3;
-        else{ cerr << "Unrecognized OptLvl " << arg->arg << endl; return; }
+        else if(arg->arg == "s"){ optLvl = 2; sizeLvl = 1; }
+        else if(arg->arg == "z"){ optLvl = 2; sizeLvl = 2; }
+        else{ cerr << "Unrecognized OptLvl " << arg->arg << endl; return 1; }
+    }
+
+    if(args->hasArg(Args::Cpu) || args->hasArg(Args::CpuFeatures)){
+        auto *cpu = args->getArg(Args::Cpu);
+        auto *features = args->getArg(Args::CpuFeatures);
+        setTargetCpu(cpu ? cpu->arg : "", features ? features->arg : "");
+
+        //-r runs the program on this machine, which may lack the selected cpu's features
+        if(args->hasArg(Args::CompileAndRun) && !runsOnHost(getTargetCpu())){
+            cerr << "-r can only be combined with -march, -mcpu, or -mattr when they select this machine's cpu and features" << endl;
+            return 1;
+        }
+    }
+
+    if(args->hasArg(Args::NoVectorize))
+        vectorize = false;
+
+    if(auto *arg = args->getArg(Args::Passes))
+        passPipeline = arg->arg;
+
+    if(args->hasArg(Args::Verify))
+        verify = true;
+
+    if(auto *arg = args->getArg(Args::Jobs)){
+        int n = atoi(arg->arg.c_str());
+        if(n < 1){ cerr << "Number of jobs must be at least 1, got " << arg->arg << endl; return 1; }
+        jobs = n;
+    }
+
+    if(auto *arg = args->getArg(Args::BuildCacheDir)){
+        buildCache = make_unique<BuildCache>(arg->arg, fileName, args);
+        setBuildCache(buildCache.get());
     }
 
+    if(auto *arg = args->getArg(Args::CtCache))
+        ctCtxt->resultCache.setDirectory(arg->arg);
+
 
     //make sure even non-called functions are included in the binary
     //if the -lib flag is set
@@ -1232,7 +1773,7 @@ void Compiler::processArgs(CompilerArgs *args){
         isLib = true;
         if(!compiled) compile();
 
-        for(auto &f : ast->funcs)
+        for(auto &f : getAST()->funcs)
             CompilingVisitor::compile(this, f);
     }
 
@@ -1254,24 +1795,41 @@ void Compiler::processArgs(CompilerArgs *args){
         shouldGenerateExecutable = false;
     }
 
-    if(args->hasArg(Args::CompileAndRun))
-        shouldGenerateExecutable = true;
+    int result = 0;
+    if(args->hasArg(Args::CompileAndRun)){
+        result = jitRun(args->programArgs, args->hasArg(Args::Lazy));
+        shouldGenerateExecutable = false;
+    }
 
-    if(shouldGenerateExecutable){
+    if(shouldGenerateExecutable)
         compileNative();
 
-        if(!errorCount() && args->hasArg(Args::CompileAndRun)){
-            int res = system((AN_EXEC_STR + outFile).c_str());
-            if(res) return; //silence unused return result warning
+    return result;
+}
+
+/**
+ * The input file is parsed on first use rather than when the Compiler is
+ * created so a build whose objs are all found in the build cache never
+ * parses it.
+ */
+RootNode* Compiler::getAST(){
+    if(unparsed){
+        unparsed = false;
+        string* fileName_cpy = new string(fileName);
+        auto root = parser::parseFile(fileName_cpy);
+        if(!root){ //parsing error, cannot procede
+            fputs("Syntax error, aborting.\n", stderr);
+            exit(EXIT_FAILURE);
         }
+
+        this->ast = root.release();
     }
+    return ast;
 }
 
 Compiler::~Compiler(){
-    if(yylexer){
-        delete yylexer;
-        yylexer = 0;
-    }
+    if(buildCache)
+        setBuildCache(nullptr);
 }
 
 } //end of namespace ante
@@ -0,0 +1,398 @@
+#include "ctcache.h"
+#include "compiler.h"
+#include "jitsession.h"
+#include "typedecl.h"
+#include "types.h"
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/InlineAsm.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Operator.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/SHA1.h>
+#include <llvm/Support/raw_ostream.h>
+
+using namespace std;
+using namespace llvm;
+
+namespace ante {
+
+    bool containsPointers(Type *t){
+        if(t->isPointerTy())
+            return true;
+
+        for(Type *contained : t->subtypes()){
+            if(containsPointers(contained))
+                return true;
+        }
+        return false;
+    }
+
+    /**
+     * External functions are only pure if LLVM knows they
+     * cannot touch any memory other than their arguments.
+     * Allocation functions are not pure: their results are
+     * addresses which would be stale if replayed from the cache.
+     */
+    bool isPureExternalFunction(Function *f){
+        return f->doesNotAccessMemory() || f->onlyAccessesArgMemory();
+    }
+
+    /**
+     * Append the bytes of a value of the given type to out, skipping the padding
+     * between fields and the bytes of a union past its current variant since
+     * they are never initialized and would make equal values hash differently.
+     */
+    void appendValueBytes(Compiler *c, AnType *t, const char *data, string &out){
+        auto &layout = c->module->getDataLayout();
+
+        if(auto *tup = try_cast<AnTupleType>(t)){
+            auto offsets = getFieldOffsets(c, tup);
+            for(size_t i = 0; i < tup->fields.size(); i++)
+                appendValueBytes(c, tup->fields[i], data + offsets[i], out);
+
+        }else if(auto *arr = try_cast<AnArrayType>(t)){
+            uint64_t stride = layout.getTypeAllocSize(c->anTypeToLlvmType(arr->extTy));
+            for(size_t i = 0; i < arr->len; i++)
+                appendValueBytes(c, arr->extTy, data + i * stride, out);
+
+        }else if(auto *dt = try_cast<AnDataType>(t)){
+            auto fields = dt->decl->getBoundFieldTypes(dt);
+
+            if(dt->decl->isUnionType){
+                //Unions holding pointers are never cached so a union without a tag
+                //stores its empty variant as a spare tag or bool value in its first byte
+                auto &niche = dt->decl->getNiche(c, dt);
+                if(niche.kind != UnionNiche::Kind::None){
+                    bool isEmpty = (uint8_t)data[0] == niche.value;
+                    out += (char)isEmpty;
+                    if(!isEmpty)
+                        appendValueBytes(c, fields[niche.variant], data, out);
+                    return;
+                }
+
+                uint8_t tag = data[0];
+                auto *variantLayout = layout.getStructLayout(dt->decl->getVariantLlvmType(c, dt, tag));
+                out += (char)tag;
+                appendValueBytes(c, fields[tag], data + variantLayout->getElementOffset(1), out);
+                return;
+            }
+
+            auto *structLayout = layout.getStructLayout(cast<StructType>(c->anTypeToLlvmType(dt)));
+            auto &indices = dt->decl->getFieldIndices(c, dt);
+            for(size_t i = 0; i < fields.size(); i++)
+                appendValueBytes(c, fields[i], data + structLayout->getElementOffset(indices[i]), out);
+
+        }else if(t->typeTag != TT_Unit){
+            out.append(data, layout.getTypeStoreSize(c->anTypeToLlvmType(t)));
+        }
+    }
+
+
+    /**
+     * Returns true if ptr is derived from stack memory, or from a constant
+     * global if it is only read through.  Pointers passed in as arguments,
+     * loaded from memory or returned from calls are accepted since every
+     * pointer escaping to them is checked by isCheckedPointer as well.
+     */
+    bool isCheckedPointer(Value *ptr, bool readOnly, SmallPtrSet<const Value*, 8> &seen){
+        if(!seen.insert(ptr).second)
+            return true;
+
+        if(auto *gep = dyn_cast<GEPOperator>(ptr))
+            return isCheckedPointer(gep->getPointerOperand(), readOnly, seen);
+
+        if(auto *op = dyn_cast<Operator>(ptr)){
+            if(op->getOpcode() == Instruction::BitCast || op->getOpcode() == Instruction::AddrSpaceCast)
+                return isCheckedPointer(op->getOperand(0), readOnly, seen);
+        }
+
+        if(auto *phi = dyn_cast<PHINode>(ptr)){
+            for(Value *incoming : phi->incoming_values()){
+                if(!isCheckedPointer(incoming, readOnly, seen))
+                    return false;
+            }
+            return true;
+        }
+
+        if(auto *select = dyn_cast<SelectInst>(ptr)){
+            return isCheckedPointer(select->getTrueValue(), readOnly, seen)
+                && isCheckedPointer(select->getFalseValue(), readOnly, seen);
+        }
+
+        if(auto *global = dyn_cast<GlobalVariable>(ptr))
+            return readOnly && global->isConstant();
+
+        return isa<AllocaInst>(ptr) || isa<llvm::Argument>(ptr) || isa<LoadInst>(ptr)
+            || isa<CallBase>(ptr) || isa<ExtractValueInst>(ptr);
+    }
+
+    bool isCheckedPointer(Value *ptr, bool readOnly){
+        SmallPtrSet<const Value*, 8> seen;
+        return isCheckedPointer(ptr, readOnly, seen);
+    }
+
+    /**
+     * Walks the IR of a single function, ensuring it is pure and
+     * hashing its body along with each constant global it uses.
+     */
+    struct PurityChecker {
+        SmallPtrSet<const Value*, 32> visited;
+        vector<Function*> callees;
+        string ir;
+        raw_string_ostream os{ir};
+
+        bool visitOperand(Value *v){
+            if(!visited.insert(v).second)
+                return true;
+
+            if(auto *f = dyn_cast<Function>(v)){
+                callees.push_back(f);
+            }else if(auto *global = dyn_cast<GlobalVariable>(v)){
+                if(!global->isConstant() || !global->hasInitializer())
+                    return false;
+                global->print(os);
+                return visitOperand(global->getInitializer());
+            }else if(isa<GlobalValue>(v)){
+                return false;
+            }else if(auto *constant = dyn_cast<Constant>(v)){
+                //addresses made from integers could point anywhere
+                auto *expr = dyn_cast<ConstantExpr>(constant);
+                if(expr && expr->getOpcode() == Instruction::IntToPtr)
+                    return false;
+
+                for(Value *op : constant->operands()){
+                    if(!visitOperand(op))
+                        return false;
+                }
+            }
+            return true;
+        }
+
+        /** Pointers stored, passed to calls, returned or put into an aggregate
+         * may later be read through so they must be checked as well */
+        bool checkEscapingPointers(Instruction &inst){
+            Value *escaping = nullptr;
+            if(auto *store = dyn_cast<StoreInst>(&inst)){
+                escaping = store->getValueOperand();
+            }else if(auto *ret = dyn_cast<ReturnInst>(&inst)){
+                escaping = ret->getReturnValue();
+            }else if(auto *insert = dyn_cast<InsertValueInst>(&inst)){
+                escaping = insert->getInsertedValueOperand();
+            }else if(auto *call = dyn_cast<CallBase>(&inst)){
+                for(Value *arg : call->args()){
+                    if(arg->getType()->isPointerTy() && !isCheckedPointer(arg, true))
+                        return false;
+                }
+            }
+            return !escaping || !escaping->getType()->isPointerTy() || isCheckedPointer(escaping, true);
+        }
+
+        bool visitInstruction(Instruction &inst){
+            if(inst.isAtomic() || isa<FenceInst>(inst))
+                return false;
+
+            if(auto *load = dyn_cast<LoadInst>(&inst)){
+                if(load->isVolatile() || !isCheckedPointer(load->getPointerOperand(), true))
+                    return false;
+            }else if(auto *store = dyn_cast<StoreInst>(&inst)){
+                if(store->isVolatile() || !isCheckedPointer(store->getPointerOperand(), false))
+                    return false;
+            }else if(auto *call = dyn_cast<CallBase>(&inst)){
+                //indirect calls and inline assembly cannot be checked
+                if(!call->getCalledFunction())
+                    return false;
+            }
+
+            if(!checkEscapingPointers(inst))
+                return false;
+
+            for(Value *op : inst.operands()){
+                if(!visitOperand(op))
+                    return false;
+            }
+            return true;
+        }
+
+        bool check(Function *f){
+            for(auto &bb : *f){
+                for(auto &inst : bb){
+                    if(!visitInstruction(inst))
+                        return false;
+                }
+            }
+            f->print(os);
+            return true;
+        }
+    };
+
+
+    CtResultCache::FunctionSummary const& CtResultCache::getSummary(Function *f){
+        auto it = summaries.find(f);
+        if(it != summaries.end())
+            return it->second;
+
+        FunctionSummary summary;
+        if(f->isDeclaration()){
+            summary.pure = isPureExternalFunction(f);
+            summary.hash = ("declare " + f->getName()).str();
+        }else{
+            PurityChecker checker;
+            summary.pure = checker.check(f);
+            summary.hash = toHex(SHA1::hash(arrayRefFromStringRef(checker.os.str())));
+            summary.callees = move(checker.callees);
+        }
+        return summaries[f] = move(summary);
+    }
+
+
+    pair<string, bool> CtResultCache::hashReachable(Function *f){
+        SmallPtrSet<Function*, 32> visited{f};
+        vector<Function*> worklist{f};
+        SHA1 hash;
+
+        while(!worklist.empty()){
+            Function *fn = worklist.back();
+            worklist.pop_back();
+
+            //the body of an unfinished function may still change
+            if(!fn->isDeclaration() && !isComplete(fn))
+                return {"", false};
+
+            auto &summary = getSummary(fn);
+            if(!summary.pure)
+                return {"", true};
+
+            hash.update(summary.hash);
+            for(Function *callee : summary.callees){
+                if(visited.insert(callee).second)
+                    worklist.push_back(callee);
+            }
+        }
+        return {toHex(hash.final()), true};
+    }
+
+
+    string CtResultCache::getFunctionKey(Compiler *c, Function *f, StringRef mangledName, AnType *retTy){
+        if(containsPointers(c->anTypeToLlvmType(retTy)))
+            return "";
+
+        string reachable;
+        auto it = reachableHashes.find(f);
+        if(it != reachableHashes.end()){
+            reachable = it->second;
+        }else{
+            auto result = hashReachable(f);
+            reachable = result.first;
+            if(result.second)
+                reachableHashes[f] = reachable;
+        }
+
+        if(reachable.empty())
+            return "";
+
+        SHA1 hash;
+        hash.update(mangledName);
+        hash.update(reachable);
+        return mangledName.str() + '$' + toHex(hash.final());
+    }
+
+
+    string CtResultCache::getCallKey(Compiler *c, string const& fnKey,
+            vector<TypedValue> const& args, AnteValue const& argData){
+
+        if(fnKey.empty())
+            return "";
+
+        //each argument is stored after the previous one, see AnteValue's constructor
+        auto *data = (const char*)argData.asRawData();
+        string bytes;
+        for(auto &arg : args){
+            if(containsPointers(arg.getType()))
+                return "";
+
+            auto argSize = arg.type->getSizeInBits(c);
+            if(!argSize)
+                return "";
+
+            appendValueBytes(c, arg.type, data, bytes);
+            data += argSize.getVal() / 8;
+        }
+
+        return fnKey + '$' + toHex(bytes);
+    }
+
+
+    void CtResultCache::forget(const Function *f){
+        summaries.erase(f);
+        //any function reaching f may have a stale hash
+        reachableHashes.clear();
+    }
+
+
+    void CtResultCache::setDirectory(string const& dir){
+        if(auto err = sys::fs::create_directories(dir)){
+            cerr << "Warning: Could not create compile-time cache directory '"
+                 << dir << "': " << err.message() << endl;
+            return;
+        }
+        directory = dir;
+    }
+
+
+    string CtResultCache::getPath(string const& key) const {
+        SmallString<128> path{directory};
+        sys::path::append(path, toHex(SHA1::hash(arrayRefFromStringRef(key))));
+        return path.str().str();
+    }
+
+
+    const vector<char>* CtResultCache::lookup(string const& key){
+        if(key.empty())
+            return nullptr;
+
+        auto it = results.find(key);
+        if(it != results.end())
+            return &it->second;
+
+        if(directory.empty())
+            return nullptr;
+
+        //Each file holds its full key followed by the result so hash collisions can be detected
+        auto file = MemoryBuffer::getFile(getPath(key));
+        if(!file)
+            return nullptr;
+
+        StringRef contents = (*file)->getBuffer();
+        if(!contents.startswith(key) || contents.size() <= key.size() || contents[key.size()] != '\0')
+            return nullptr;
+
+        StringRef result = contents.drop_front(key.size() + 1);
+        auto &entry = results[key];
+        entry.assign(result.begin(), result.end());
+        return &entry;
+    }
+
+
+    void CtResultCache::insert(string const& key, const void *result, size_t size){
+        if(key.empty())
+            return;
+
+        auto *begin = (const char*)result;
+        auto &entry = results[key];
+        entry.assign(begin, begin + size);
+
+        if(directory.empty())
+            return;
+
+        error_code err;
+        raw_fd_ostream out{getPath(key), err, sys::fs::OF_None};
+        if(!err){
+            out << key << '\0';
+            out.write(begin, size);
+        }
+    }
+}
@@ -2,36 +2,20 @@
 #include "target.h"
 #include "error.h"
 #include "types.h"
+#include "sourcemanager.h"
+#include <atomic>
+#include <mutex>
 
 using namespace std;
 using namespace ante::parser;
 
 namespace ante {
 
-size_t globalErrorCount = 0;
+atomic<size_t> globalErrorCount{0};
 
-/*
- * Skips input in a given istream until it encounters the given coordinates,
- * with each newline signalling the end of a row.
- *
- * precondition: coordinates must be valid
- */
-void skipToLine(istream& ifs, unsigned int row){
-    unsigned int line = 1;
-    if(line != row){
-        while(true){
-            int c = ifs.get();
-            if(c == '\n'){
-                line++;
-                if(line >= row){
-                    break;
-                }
-            }else if(c == EOF){
-                break;
-            }
-        }
-    }
-}
+/* Held while printing an error so errors from modules parsed
+ * on separate threads are not interleaved with each other */
+mutex errorOutputMutex;
 
 void printErrorTypeColor(ErrorType t){
     if(colored_output){
@@ -61,17 +45,13 @@ void setTermFGColor(AN_COLOR_TYPE fg){
  */
 void printErrLine(const yy::location& loc, ErrorType t){
     if(!loc.begin.filename) return;
-    ifstream f{*loc.begin.filename};
+    SourceFile *file = SourceManager::getFile(*loc.begin.filename);
+    if(!file) return;
 
     // highlight the whole first line if the error spans multiple lines
     unsigned int end_col = loc.begin.line == loc.end.line ? loc.end.column : -1;
 
-    //skip to line in question
-    skipToLine(f, loc.begin.line);
-
-    //print line
-    string s;
-    getline(f, s);
+    llvm::StringRef s = file->getLine(loc.begin.line);
 
     for(size_t i = 0; i < s.size(); i++){
         if(i == loc.begin.column - 1){
@@ -133,6 +113,7 @@ void showFileInfo(const yy::location &loc, ErrorType t){
 
 
 void showError(lazy_printer msg, const yy::location& loc, ErrorType t){
+    lock_guard<mutex> lock{errorOutputMutex};
     if(t == ErrorType::Error)
         globalErrorCount++;
 
@@ -171,7 +152,7 @@ lazy_str typeNodeToColoredStr(const TypeNode *tn){
     return s;
 }
 
-lazy_str typeNodeToColoredStr(const unique_ptr<TypeNode>& tn){
+lazy_str typeNodeToColoredStr(const ArenaPtr<TypeNode>& tn){
     lazy_str s = typeNodeToStr(tn.get());
     if(colored_output)
         s.fmt = AN_TYPE_COLOR;
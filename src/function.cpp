@@ -125,6 +125,22 @@ TypedValue compFnWithModifiers(Compiler *c, FuncDecl *fd){
 }
 
 
+bool isCompileTimeFunction(Declaration *decl){
+    if(!decl || !decl->isFuncDecl())
+        return false;
+
+    auto *fdn = static_cast<FuncDecl*>(decl)->getFDN();
+    if(!fdn)
+        return false;
+
+    for(auto &mod : fdn->modifiers){
+        if(!mod->isCompilerDirective() && mod->mod == Tok_Ante)
+            return true;
+    }
+    return false;
+}
+
+
 /**
  * Removes compile-time-only parameters and wraps each mut type in a pointer.
  */
@@ -228,6 +244,7 @@ void CompilingVisitor::visit(FuncDeclNode *n){
 //Provide a wrapper for function-compiling methods so that each
 //function is compiled in its own isolated module
 TypedValue Compiler::compFn(FuncDecl *fd){
+    fd->loadBody();
     compCtxt->callStack.push_back(fd);
     auto *continueLabels = compCtxt->continueLabels.release();
     auto *breakLabels = compCtxt->breakLabels.release();
@@ -237,6 +254,10 @@ TypedValue Compiler::compFn(FuncDecl *fd){
     TMP_SET(this->fnScope, this->scope);
     TypedValue ret = compFnHelper(this, fd);
 
+    auto *f = dyn_cast_or_null<Function>(ret.val);
+    if(f && !f->isDeclaration())
+        ctCtxt->finishedDefinitions.emplace_back(f);
+
     compCtxt->callStack.pop_back();
     compCtxt->continueLabels.reset(continueLabels);
     compCtxt->breakLabels.reset(breakLabels);
@@ -0,0 +1,1644 @@
+#include "interface.h"
+#include "buildcache.h"
+#include "module.h"
+#include "nodecl.h"
+#include "trait.h"
+#include "types.h"
+#include "unification.h"
+#include "util.h"
+#include "variable.h"
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/SHA1.h>
+
+using namespace std;
+using namespace llvm;
+
+/*
+ * An interface file starts with an 8 byte magic number followed by the hex
+ * SHA1 of everything after it, which is the interface's hash.  The rest is
+ * made of unsigned LEB128 varints, strings stored as their length followed
+ * by their bytes, and a few fixed 4 byte offsets into tables that are read
+ * out of order:
+ *
+ *   version, compiler hash, source hash, (import name, import hash)*,
+ *   offset of each section, then the sections themselves:
+ *
+ *   Strings     every name used below, which refer to it by index
+ *   Types       a table of offsets then one record per AnType
+ *   Modules     each module referred to, the first being the module itself
+ *   TraitImpls  a table of offsets then one record per TraitImpl
+ *   Decls       the module's TypeDecls, TraitDecls, impls, functions and submodules
+ *   Bodies      the parse tree of each function body
+ *
+ * A reference to a type, trait impl or ExtNode is 0 for null or one plus
+ * its index.  Types and TraitImpls are only decoded when first referred
+ * to.  Parse trees are stored in preorder, each node followed by its next
+ * node, and refer to declarations local to their function by index.
+ */
+
+namespace ante {
+    using namespace parser;
+
+    namespace {
+        const char magic[] = "ANTEINTF";
+        constexpr size_t magicSize = 8;
+        constexpr size_t hashSize = 40;
+        constexpr uint64_t formatVersion = 1;
+
+        enum Section { Strings, Types, Modules, TraitImpls, Decls, Bodies, SectionCount };
+
+        enum TypeKind { TK_Primitive, TK_Modifier, TK_Ptr, TK_Array, TK_Tuple, TK_TypeVar, TK_Function, TK_Data };
+
+        enum ModuleKind { MK_Self, MK_Child, MK_Path };
+
+        enum DeclKind {
+            DK_None,
+            /** A declaration already read within the same function */
+            DK_Local,
+            /** The first reference to a new Variable, NoDecl, or lambda */
+            DK_Variable, DK_NoDecl, DK_Lambda,
+            /** A function of the module */
+            DK_Function,
+            /** A function of another module, by name */
+            DK_External,
+        };
+
+        enum NodeKind {
+            NK_None, NK_IntLit, NK_FltLit, NK_BoolLit, NK_CharLit, NK_Array, NK_Tuple, NK_UnOp,
+            NK_BinOp, NK_Seq, NK_Block, NK_Mod, NK_Type, NK_TypeCast, NK_Ret, NK_NamedVal, NK_Var,
+            NK_StrLit, NK_VarAssign, NK_Jump, NK_While, NK_For, NK_MatchBranch, NK_Match, NK_If,
+            NK_FuncDecl,
+        };
+
+        enum TypeDeclFlags { TD_Union = 1, TD_Alias = 2, TD_ReprC = 4, TD_NonNull = 8 };
+
+        /** Thrown while writing a module that cannot be expressed as an interface */
+        struct Unsupported {
+            string reason;
+        };
+
+        /** Thrown while reading an interface that is truncated or otherwise malformed */
+        struct Malformed {};
+
+        void writeVarint(string &out, uint64_t value){
+            while(value >= 0x80){
+                out += char((value & 0x7f) | 0x80);
+                value >>= 7;
+            }
+            out += char(value);
+        }
+
+        void writeRaw(string &out, StringRef s){
+            writeVarint(out, s.size());
+            out.append(s.data(), s.size());
+        }
+
+        void writeU32(string &out, uint32_t value){
+            for(int i = 0; i < 4; i++)
+                out += char((value >> (8 * i)) & 0xff);
+        }
+
+        string const& getCompilerHash(){
+            static const string hash = []{
+                SHA1 sha;
+                hashCompilerVersion(sha);
+                return toHex(sha.final());
+            }();
+            return hash;
+        }
+
+        /**
+         * Type variables created by the compiler are named by a global
+         * counter, eg. '132, which differs between runs.  They are renumbered
+         * by order of appearance when written and given fresh names when read.
+         * Any suffix, as on the '132... of varargs, is kept.
+         */
+        template<typename NewName>
+        string renameTypeVar(string const& name, StringMap<string> &names, NewName newName){
+            if(name.size() < 2 || name[0] != '\'' || !isdigit(name[1]))
+                return name;
+
+            size_t end = 1;
+            while(end < name.size() && isdigit(name[end]))
+                end++;
+
+            auto it = names.find(name.substr(0, end));
+            if(it == names.end())
+                it = names.try_emplace(name.substr(0, end), newName(names.size())).first;
+
+            return it->getValue() + name.substr(end);
+        }
+
+        template<typename T>
+        vector<StringRef> sortedKeys(StringMap<T> const& map){
+            vector<StringRef> keys;
+            for(auto &entry : map)
+                keys.push_back(entry.getKey());
+            std::sort(keys.begin(), keys.end());
+            return keys;
+        }
+
+        vector<Module*> sortedChildren(Module *m){
+            vector<Module*> children;
+            for(auto it = m->childrenBegin(); it != m->childrenEnd(); ++it)
+                children.push_back(&it->getValue());
+
+            std::sort(children.begin(), children.end(), [](Module *l, Module *r){
+                return l->name < r->name;
+            });
+            return children;
+        }
+
+
+        struct InterfaceWriter;
+
+        /**
+         * Writes a single parse tree.  Declarations introduced in the
+         * tree are numbered in order of appearance, continuing from those
+         * of any earlier tree of the same function.
+         */
+        struct NodeWriter : public NodeVisitor {
+            InterfaceWriter &w;
+            string &out;
+            unordered_map<const Declaration*, size_t> &decls;
+
+            /** Written without its next node or body, which are stored elsewhere */
+            Node *root;
+
+            unordered_map<const Node*, size_t> nodeIds;
+            vector<const Declaration*> newDecls;
+
+            NodeWriter(InterfaceWriter &w, string &out, unordered_map<const Declaration*, size_t> &decls, Node *root = nullptr)
+                : w{w}, out{out}, decls{decls}, root{root}{}
+
+            void write(Node *n){
+                if(n) n->accept(*this);
+                else writeVarint(out, NK_None);
+            }
+
+            /** Write the definition of each declaration introduced by the tree */
+            void finish();
+
+            DECLARE_NODE_VISIT_METHODS();
+
+        private:
+            void begin(Node *n, NodeKind kind);
+            void end(Node *n){
+                write(n == root ? nullptr : n->next.get());
+            }
+
+            void writeModifiers(ModifiableNode *n){
+                writeVarint(out, n->modifiers.size());
+                for(auto &mod : n->modifiers)
+                    write(mod.get());
+            }
+
+            template<typename T>
+            void writeAll(vector<ArenaPtr<T>> const& nodes){
+                writeVarint(out, nodes.size());
+                for(auto &n : nodes)
+                    write(n.get());
+            }
+
+            void writeString(StringRef s);
+            void writeDecl(Declaration *decl);
+        };
+
+
+        struct InterfaceWriter {
+            Module *self;
+
+            /** Where each declaration outside the module is found */
+            unordered_map<const Module*, vector<string>> paths;
+            unordered_map<const TypeDecl*, pair<Module*, string>> typeDecls;
+            unordered_map<const TraitDecl*, pair<Module*, string>> traitDecls;
+            unordered_map<const ExtNode*, tuple<Module*, string, size_t>> extNodes;
+
+            /** Each submodule of self */
+            unordered_map<const Module*, string> children;
+
+            string strings;
+            unordered_map<string, size_t> stringIds;
+
+            string modules;
+            unordered_map<const Module*, size_t> moduleIds;
+
+            vector<string> types;
+            unordered_map<const AnType*, size_t> typeIds;
+
+            vector<string> traitImpls;
+            unordered_map<const TraitImpl*, size_t> traitImplIds;
+
+            vector<FuncDecl*> functions;
+            unordered_map<const FuncDecl*, size_t> functionIds;
+
+            StringMap<string> typeVars;
+
+            InterfaceWriter(Module *self) : self{self}{
+                index(&Module::getRoot(), {});
+                indexDecls(self);
+                for(Module *child : sortedChildren(self)){
+                    children[child] = child->name;
+                    indexDecls(child);
+                }
+                writeModule(self);
+            }
+
+            void indexDecls(Module *m){
+                for(auto &entry : m->userTypes)
+                    typeDecls[&entry.getValue()] = {m, entry.getKey().str()};
+
+                for(auto &entry : m->traitDecls)
+                    traitDecls[entry.getValue()] = {m, entry.getKey().str()};
+
+                for(auto &entry : m->traitImpls){
+                    auto &impls = entry.getValue().getImpls();
+                    for(size_t i = 0; i < impls.size(); i++)
+                        extNodes[impls[i]->impl] = make_tuple(m, entry.getKey().str(), i);
+                }
+            }
+
+            void index(Module *m, vector<string> path){
+                paths[m] = path;
+                indexDecls(m);
+                for(auto it = m->childrenBegin(); it != m->childrenEnd(); ++it){
+                    path.push_back(it->getKey().str());
+                    index(&it->getValue(), path);
+                    path.pop_back();
+                }
+            }
+
+            void writeString(string &out, StringRef s){
+                auto it = stringIds.find(s.str());
+                if(it == stringIds.end()){
+                    it = stringIds.emplace(s.str(), stringIds.size()).first;
+                    writeRaw(strings, s);
+                }
+                writeVarint(out, it->second);
+            }
+
+            void writeLoc(string &out, LOC_TY const& loc){
+                writeVarint(out, loc.begin.line);
+                writeVarint(out, loc.begin.column);
+                writeVarint(out, loc.end.line);
+                writeVarint(out, loc.end.column);
+            }
+
+            void writeModule(string &out, Module *m){
+                writeVarint(out, writeModule(m));
+            }
+
+            size_t writeModule(Module *m){
+                auto it = moduleIds.find(m);
+                if(it != moduleIds.end())
+                    return it->second;
+
+                if(m == self){
+                    writeVarint(modules, MK_Self);
+                }else if(children.count(m)){
+                    writeVarint(modules, MK_Child);
+                    writeString(modules, children[m]);
+                }else{
+                    auto path = paths.find(m);
+                    if(path == paths.end() || path->second.empty())
+                        throw Unsupported{"it refers to the module " + m->name + " which was not imported"};
+
+                    writeVarint(modules, MK_Path);
+                    writeVarint(modules, path->second.size());
+                    for(auto &name : path->second)
+                        writeString(modules, name);
+                }
+                return moduleIds[m] = moduleIds.size();
+            }
+
+            template<typename T>
+            void writeDeclRef(string &out, unordered_map<const T*, pair<Module*, string>> &index, const T *decl){
+                auto it = index.find(decl);
+                if(it == index.end())
+                    throw Unsupported{"it refers to a type or trait outside of any module"};
+
+                writeModule(out, it->second.first);
+                writeString(out, it->second.second);
+            }
+
+            void writeType(string &out, const AnType *t){
+                writeVarint(out, t ? writeType(t) + 1 : 0);
+            }
+
+            void writeTypes(string &out, vector<AnType*> const& types){
+                writeVarint(out, types.size());
+                for(auto *t : types)
+                    writeType(out, t);
+            }
+
+            size_t writeType(const AnType *t){
+                auto it = typeIds.find(t);
+                if(it != typeIds.end())
+                    return it->second;
+
+                string record;
+                if(auto *mod = dynamic_cast<const BasicModifier*>(t)){
+                    writeVarint(record, TK_Modifier);
+                    writeVarint(record, mod->mod);
+                    writeType(record, mod->extTy);
+                }else if(t->isModifierType()){
+                    throw Unsupported{"it uses a compiler directive within a type"};
+                }else if(auto *ptr = try_cast<AnPtrType>(t)){
+                    writeVarint(record, TK_Ptr);
+                    writeType(record, ptr->elemTy);
+                }else if(auto *arr = try_cast<AnArrayType>(t)){
+                    writeVarint(record, TK_Array);
+                    writeType(record, arr->extTy);
+                    writeVarint(record, arr->len);
+                }else if(auto *tup = try_cast<AnTupleType>(t)){
+                    writeVarint(record, TK_Tuple);
+                    writeTypes(record, tup->fields);
+                    writeVarint(record, tup->fieldNames.size());
+                    for(auto &name : tup->fieldNames)
+                        writeString(record, name);
+                }else if(auto *tv = try_cast<AnTypeVarType>(t)){
+                    writeVarint(record, TK_TypeVar);
+                    writeString(record, renameTypeVar(tv->name));
+                    writeVarint(record, tv->isRowVariable);
+                }else if(auto *fn = try_cast<AnFunctionType>(t)){
+                    writeVarint(record, TK_Function);
+                    writeType(record, fn->retTy);
+                    writeTypes(record, fn->paramTys);
+                    writeVarint(record, fn->typeClassConstraints.size());
+                    for(auto *tc : fn->typeClassConstraints)
+                        writeTraitImpl(record, tc);
+                }else if(auto *data = try_cast<AnDataType>(t)){
+                    writeVarint(record, TK_Data);
+                    writeString(record, data->name);
+                    writeVarint(record, data->decl != nullptr);
+                    if(data->decl)
+                        writeDeclRef(record, typeDecls, data->decl);
+                    writeTypes(record, data->typeArgs);
+                }else{
+                    writeVarint(record, TK_Primitive);
+                    writeVarint(record, t->typeTag);
+                }
+
+                types.push_back(move(record));
+                return typeIds[t] = types.size() - 1;
+            }
+
+            string renameTypeVar(string const& name){
+                return ante::renameTypeVar(name, typeVars, [](size_t count){
+                    return "'" + to_string(count + 1);
+                });
+            }
+
+            void writeTraitImpl(string &out, TraitImpl *impl){
+                writeVarint(out, impl ? writeTraitImpl(impl) + 1 : 0);
+            }
+
+            size_t writeTraitImpl(TraitImpl *impl){
+                auto it = traitImplIds.find(impl);
+                if(it != traitImplIds.end())
+                    return it->second;
+
+                string record;
+                writeDeclRef(record, traitDecls, impl->decl);
+                auto args = impl->typeArgs;
+                args.insert(args.end(), impl->fundeps.begin(), impl->fundeps.end());
+                writeTypes(record, args);
+                writeExtNode(record, impl->impl);
+
+                traitImpls.push_back(move(record));
+                return traitImplIds[impl] = traitImpls.size() - 1;
+            }
+
+            void writeExtNode(string &out, ExtNode *n){
+                if(!n){
+                    writeVarint(out, 0);
+                    return;
+                }
+
+                auto it = extNodes.find(n);
+                if(it == extNodes.end())
+                    throw Unsupported{"it refers to an impl outside of any module"};
+
+                writeVarint(out, writeModule(get<0>(it->second)) + 1);
+                writeString(out, get<1>(it->second));
+                writeVarint(out, get<2>(it->second));
+            }
+
+            void addFunction(FuncDecl *fd){
+                if(functionIds.count(fd))
+                    return;
+
+                if(!dynamic_cast<FuncDeclNode*>(fd->definition))
+                    throw Unsupported{"the function " + fd->name + " has no definition"};
+
+                functionIds[fd] = functions.size();
+                functions.push_back(fd);
+            }
+
+            /** Every function declared by the module, its submodules, traits, and impls */
+            void collectFunctions(){
+                for(auto &name : sortedKeys(self->fnDecls))
+                    addFunction(self->fnDecls[name]);
+
+                for(Module *child : sortedChildren(self))
+                    for(auto &name : sortedKeys(child->fnDecls))
+                        addFunction(child->fnDecls[name]);
+
+                for(auto &name : sortedKeys(self->traitDecls))
+                    for(auto &fd : self->traitDecls[name]->funcs)
+                        addFunction(fd.get());
+
+                for(auto &name : sortedKeys(self->traitImpls)){
+                    for(auto *impl : self->traitImpls[name].getImpls()){
+                        for(Node &method : *impl->impl->methods){
+                            auto *fdn = dynamic_cast<FuncDeclNode*>(&method);
+                            if(!fdn || !fdn->decl || !fdn->decl->isFuncDecl())
+                                throw Unsupported{"an impl of " + name.str() + " holds something other than a function"};
+                            addFunction(static_cast<FuncDecl*>(fdn->decl));
+                        }
+                    }
+                }
+            }
+
+            void writeFnDecls(string &out, Module *m){
+                auto keys = sortedKeys(m->fnDecls);
+                writeVarint(out, keys.size());
+                for(auto &name : keys){
+                    writeString(out, name);
+                    writeVarint(out, functionIds.at(m->fnDecls[name]));
+                }
+            }
+
+            /**
+             * The declarations are ordered so that each only refers to those
+             * before it, except for parse trees referring to functions, whose
+             * FuncDecls are all created first.
+             */
+            string writeDecls(string &bodies){
+                string out;
+
+                for(Module *child : sortedChildren(self)){
+                    if(!child->userTypes.empty() || !child->traitDecls.empty()
+                            || !child->traitImpls.empty() || child->childrenBegin() != child->childrenEnd())
+                        throw Unsupported{"its submodule " + child->name + " declares more than functions"};
+                }
+
+                collectFunctions();
+                writeVarint(out, functions.size());
+                for(auto *fd : functions){
+                    writeModule(out, fd->module);
+                    writeString(out, fd->name);
+                    writeVarint(out, fd->traitFuncDecl);
+                }
+
+                auto typeNames = sortedKeys(self->userTypes);
+                writeVarint(out, typeNames.size());
+                for(auto &name : typeNames){
+                    TypeDecl &decl = self->userTypes.find(name)->getValue();
+                    writeString(out, name);
+                    writeLoc(out, decl.loc);
+                    writeVarint(out, (decl.isUnionType ? TD_Union : 0) | (decl.isAlias ? TD_Alias : 0)
+                            | (decl.isReprC ? TD_ReprC : 0) | (decl.isNonNull ? TD_NonNull : 0));
+                }
+
+                auto traitNames = sortedKeys(self->traitDecls);
+                writeVarint(out, traitNames.size());
+                for(auto &name : traitNames)
+                    writeString(out, name);
+
+                vector<TraitImpl*> impls;
+                for(auto &name : sortedKeys(self->traitImpls)){
+                    auto &index = self->traitImpls[name].getImpls();
+                    impls.insert(impls.end(), index.begin(), index.end());
+                }
+                writeVarint(out, impls.size());
+                for(auto *impl : impls){
+                    if(!impl->impl->modifiers.empty() || impl->impl->typeExpr)
+                        throw Unsupported{"an impl of " + impl->name + " has modifiers"};
+                    writeString(out, impl->name);
+                    writeLoc(out, impl->impl->loc);
+                }
+
+                //TraitImpls need the number of type arguments of their TraitDecl
+                for(auto &name : traitNames){
+                    TraitDecl *decl = self->traitDecls[name];
+                    writeTypes(out, decl->typeArgs);
+                    writeTypes(out, decl->fundeps);
+                    writeVarint(out, decl->funcs.size());
+                    for(auto &fd : decl->funcs)
+                        writeVarint(out, functionIds.at(fd.get()));
+                }
+
+                for(auto &name : typeNames){
+                    TypeDecl &decl = self->userTypes.find(name)->getValue();
+                    writeType(out, decl.type);
+                    writeType(out, decl.isAlias ? decl.aliasedType : nullptr);
+                    auto &fieldTypes = decl.getUnboundFieldTypes();
+                    writeVarint(out, decl.fields.size());
+                    for(size_t i = 0; i < decl.fields.size(); i++){
+                        writeString(out, decl.fields[i]);
+                        writeType(out, fieldTypes[i]);
+                    }
+                }
+
+                for(auto *impl : impls){
+                    unordered_map<const Declaration*, size_t> decls;
+                    NodeWriter trait{*this, out, decls, impl->impl->trait.get()};
+                    trait.write(impl->impl->trait.get());
+                    trait.finish();
+                    writeTraitImpl(out, impl->impl->traitType);
+                    writeVarint(out, ante::count(*impl->impl->methods));
+                    for(Node &method : *impl->impl->methods)
+                        writeVarint(out, functionIds.at(static_cast<FuncDecl*>(static_cast<FuncDeclNode*>(&method)->decl)));
+                }
+                for(auto *impl : impls)
+                    writeTraitImpl(out, impl);
+
+                for(auto *fd : functions){
+                    //The module may itself have been loaded from an interface
+                    fd->loadBody();
+                    auto *fdn = fd->getFDN();
+                    unordered_map<const Declaration*, size_t> decls;
+                    writeType(out, fd->tval.type);
+
+                    NodeWriter header{*this, out, decls, fdn};
+                    header.write(fdn);
+                    header.finish();
+
+                    if(fdn->child){
+                        writeVarint(out, bodies.size() + 1);
+                        NodeWriter body{*this, bodies, decls};
+                        body.write(fdn->child.get());
+                        body.finish();
+                    }else{
+                        writeVarint(out, 0);
+                    }
+                }
+
+                writeFnDecls(out, self);
+                auto submodules = sortedChildren(self);
+                writeVarint(out, submodules.size());
+                for(Module *child : submodules){
+                    writeString(out, child->name);
+                    writeFnDecls(out, child);
+                    writeVarint(out, child->imports.size());
+                    for(Module *import : child->imports)
+                        writeModule(out, import);
+                }
+                return out;
+            }
+
+            /** A count followed by a fixed size offset to each record so they can be read in any order */
+            static string writeTable(vector<string> const& records){
+                string out;
+                writeVarint(out, records.size());
+                uint32_t offset = 0;
+                for(auto &record : records){
+                    writeU32(out, offset);
+                    offset += record.size();
+                }
+                for(auto &record : records)
+                    out += record;
+                return out;
+            }
+
+            bool write(StringRef source, string &out){
+                string bodies;
+                string sections[SectionCount];
+                try{
+                    sections[Decls] = writeDecls(bodies);
+                }catch(Unsupported const&){
+                    return false;
+                }
+                sections[Bodies] = move(bodies);
+                sections[Types] = writeTable(types);
+                sections[TraitImpls] = writeTable(traitImpls);
+
+                writeVarint(sections[Strings], stringIds.size());
+                sections[Strings] += strings;
+                writeVarint(sections[Modules], moduleIds.size());
+                sections[Modules] += modules;
+
+                string contents;
+                writeVarint(contents, formatVersion);
+                writeRaw(contents, getCompilerHash());
+                writeRaw(contents, hashContents(source));
+
+                writeVarint(contents, self->imports.size());
+                for(Module *import : self->imports){
+                    if(import->importName.empty() || (import != self && import->interfaceHash.empty()))
+                        return false;
+                    writeRaw(contents, import->importName);
+                    writeRaw(contents, import == self ? "" : import->interfaceHash);
+                }
+
+                size_t offset = 0;
+                for(auto &section : sections){
+                    writeVarint(contents, offset);
+                    offset += section.size();
+                }
+                for(auto &section : sections)
+                    contents += section;
+
+                out = magic;
+                out += hashContents(contents);
+                out += contents;
+                return true;
+            }
+        };
+
+
+        void NodeWriter::writeString(StringRef s){
+            w.writeString(out, s);
+        }
+
+        void NodeWriter::finish(){
+            writeVarint(out, newDecls.size());
+            for(auto *decl : newDecls){
+                writeVarint(out, decls[decl]);
+                if(!decl->definition){
+                    writeVarint(out, 0);
+                    continue;
+                }
+
+                auto it = nodeIds.find(decl->definition);
+                if(it == nodeIds.end())
+                    throw Unsupported{decl->name + " is defined outside of the function using it"};
+                writeVarint(out, it->second + 1);
+            }
+            newDecls.clear();
+        }
+
+        void NodeWriter::writeDecl(Declaration *decl){
+            if(!decl){
+                writeVarint(out, DK_None);
+                return;
+            }
+
+            auto local = decls.find(decl);
+            if(local != decls.end()){
+                writeVarint(out, DK_Local);
+                writeVarint(out, local->second);
+                return;
+            }
+
+            if(auto *fd = dynamic_cast<FuncDecl*>(decl)){
+                auto fn = w.functionIds.find(fd);
+                if(fn != w.functionIds.end()){
+                    writeVarint(out, DK_Function);
+                    writeVarint(out, fn->second);
+                    return;
+                }
+
+                auto *fdn = dynamic_cast<FuncDeclNode*>(fd->definition);
+                if(fdn && fdn->name.empty()){
+                    writeVarint(out, DK_Lambda);
+                    writeString(fd->name);
+                    w.writeModule(out, fd->module);
+                    writeVarint(out, fd->traitFuncDecl);
+                    w.writeType(out, fd->tval.type);
+                }else if(fd->module && fd->module->fnDecls.lookup(fd->name) == fd){
+                    writeVarint(out, DK_External);
+                    w.writeModule(out, fd->module);
+                    writeString(fd->name);
+                    return;
+                }else{
+                    throw Unsupported{"it refers to the function " + fd->name + " which is not visible outside its module"};
+                }
+            }else if(auto *var = dynamic_cast<Variable*>(decl)){
+                writeVarint(out, DK_Variable);
+                writeString(var->name);
+                writeVarint(out, var->autoDeref);
+                w.writeType(out, var->tval.type);
+            }else if(dynamic_cast<NoDecl*>(decl)){
+                writeVarint(out, DK_NoDecl);
+                w.writeType(out, decl->tval.type);
+            }else{
+                throw Unsupported{"it refers to an unknown kind of declaration"};
+            }
+
+            decls[decl] = decls.size();
+            newDecls.push_back(decl);
+        }
+
+        void NodeWriter::begin(Node *n, NodeKind kind){
+            nodeIds[n] = nodeIds.size();
+            writeVarint(out, kind);
+            w.writeLoc(out, n->loc);
+            w.writeType(out, n->Node::getType());
+        }
+
+        void NodeWriter::visit(RootNode *n){
+            throw Unsupported{"a function contains a module"};
+        }
+
+        void NodeWriter::visit(IntLitNode *n){
+            begin(n, NK_IntLit);
+            writeString(n->val);
+            writeVarint(out, n->typeTag);
+            end(n);
+        }
+
+        void NodeWriter::visit(FltLitNode *n){
+            begin(n, NK_FltLit);
+            writeString(n->val);
+            writeVarint(out, n->typeTag);
+            end(n);
+        }
+
+        void NodeWriter::visit(BoolLitNode *n){
+            begin(n, NK_BoolLit);
+            writeVarint(out, n->val);
+            end(n);
+        }
+
+        void NodeWriter::visit(CharLitNode *n){
+            begin(n, NK_CharLit);
+            writeVarint(out, (unsigned char)n->val);
+            end(n);
+        }
+
+        void NodeWriter::visit(ArrayNode *n){
+            begin(n, NK_Array);
+            writeAll(n->exprs);
+            end(n);
+        }
+
+        void NodeWriter::visit(TupleNode *n){
+            begin(n, NK_Tuple);
+            writeAll(n->exprs);
+            end(n);
+        }
+
+        void NodeWriter::visit(UnOpNode *n){
+            begin(n, NK_UnOp);
+            writeVarint(out, n->op);
+            write(n->rval.get());
+            end(n);
+        }
+
+        void NodeWriter::visit(BinOpNode *n){
+            begin(n, NK_BinOp);
+            writeVarint(out, n->op);
+            write(n->lval.get());
+            write(n->rval.get());
+            writeDecl(n->decl);
+            end(n);
+        }
+
+        void NodeWriter::visit(SeqNode *n){
+            begin(n, NK_Seq);
+            writeAll(n->sequence);
+            end(n);
+        }
+
+        void NodeWriter::visit(BlockNode *n){
+            begin(n, NK_Block);
+            write(n->block.get());
+            end(n);
+        }
+
+        void NodeWriter::visit(ModNode *n){
+            begin(n, NK_Mod);
+            writeVarint(out, n->mod);
+            write(n->directive.get());
+            write(n->expr.get());
+            end(n);
+        }
+
+        void NodeWriter::visit(TypeNode *n){
+            begin(n, NK_Type);
+            writeModifiers(n);
+            writeVarint(out, n->typeTag);
+            writeString(w.renameTypeVar(n->typeName));
+            write(n->extTy.get());
+            writeAll(n->params);
+            writeVarint(out, n->isRowVar);
+            end(n);
+        }
+
+        void NodeWriter::visit(TypeCastNode *n){
+            begin(n, NK_TypeCast);
+            write(n->typeExpr.get());
+            writeAll(n->args);
+            end(n);
+        }
+
+        void NodeWriter::visit(RetNode *n){
+            begin(n, NK_Ret);
+            write(n->expr.get());
+            end(n);
+        }
+
+        void NodeWriter::visit(NamedValNode *n){
+            begin(n, NK_NamedVal);
+            writeString(n->name);
+            write(n->typeExpr.get());
+            writeDecl(n->decl);
+            end(n);
+        }
+
+        void NodeWriter::visit(VarNode *n){
+            begin(n, NK_Var);
+            writeString(n->name);
+            writeDecl(n->decl);
+            end(n);
+        }
+
+        void NodeWriter::visit(StrLitNode *n){
+            begin(n, NK_StrLit);
+            writeString(n->val);
+            end(n);
+        }
+
+        void NodeWriter::visit(VarAssignNode *n){
+            begin(n, NK_VarAssign);
+            writeModifiers(n);
+            write(n->ref_expr);
+            write(n->expr.get());
+            end(n);
+        }
+
+        void NodeWriter::visit(ExtNode *n){
+            throw Unsupported{"a function contains an impl"};
+        }
+
+        void NodeWriter::visit(ImportNode *n){
+            throw Unsupported{"a function contains an import"};
+        }
+
+        void NodeWriter::visit(JumpNode *n){
+            begin(n, NK_Jump);
+            writeVarint(out, n->jumpType);
+            write(n->expr.get());
+            end(n);
+        }
+
+        void NodeWriter::visit(WhileNode *n){
+            begin(n, NK_While);
+            write(n->condition.get());
+            write(n->child.get());
+            end(n);
+        }
+
+        void NodeWriter::visit(ForNode *n){
+            begin(n, NK_For);
+            write(n->pattern.get());
+            write(n->range.get());
+            write(n->child.get());
+            w.writeTraitImpl(out, n->iterableInstance);
+            end(n);
+        }
+
+        void NodeWriter::visit(MatchBranchNode *n){
+            begin(n, NK_MatchBranch);
+            write(n->pattern.get());
+            write(n->branch.get());
+            end(n);
+        }
+
+        void NodeWriter::visit(MatchNode *n){
+            begin(n, NK_Match);
+            write(n->expr.get());
+            writeAll(n->branches);
+            end(n);
+        }
+
+        void NodeWriter::visit(IfNode *n){
+            begin(n, NK_If);
+            write(n->condition.get());
+            write(n->thenN.get());
+            write(n->elseN.get());
+            end(n);
+        }
+
+        void NodeWriter::visit(FuncDeclNode *n){
+            begin(n, NK_FuncDecl);
+            writeModifiers(n);
+            writeString(n->name);
+            write(n->returnType.get());
+            write(n->params.get());
+            write(n->typeClassConstraints.get());
+            writeVarint(out, n->varargs);
+            writeDecl(n->decl);
+            write(n == root ? nullptr : n->child.get());
+            end(n);
+        }
+
+        void NodeWriter::visit(DataDeclNode *n){
+            throw Unsupported{"a function contains a type declaration"};
+        }
+
+        void NodeWriter::visit(TraitNode *n){
+            throw Unsupported{"a function contains a trait declaration"};
+        }
+    }
+
+
+    struct ModuleInterface::Decoder {
+        ModuleInterface &in;
+        const char *pos;
+
+        /** The declarations of the function whose parse tree is being read */
+        vector<Declaration*> *decls = nullptr;
+
+        /** Every node of the parse tree being read, in preorder */
+        vector<Node*> nodes;
+
+        Decoder(ModuleInterface &in, const char *pos) : in{in}, pos{pos}{}
+
+        const char* end() const {
+            return in.buffer->getBufferEnd();
+        }
+
+        uint64_t varint(){
+            uint64_t value = 0;
+            for(unsigned shift = 0; shift < 64; shift += 7){
+                if(pos == end())
+                    throw Malformed{};
+
+                uint8_t byte = *pos++;
+                value |= uint64_t(byte & 0x7f) << shift;
+                if(!(byte & 0x80))
+                    return value;
+            }
+            throw Malformed{};
+        }
+
+        uint32_t u32(){
+            if(end() - pos < 4)
+                throw Malformed{};
+
+            uint32_t value = 0;
+            for(int i = 0; i < 4; i++)
+                value |= uint32_t(uint8_t(*pos++)) << (8 * i);
+            return value;
+        }
+
+        StringRef raw(){
+            uint64_t size = varint();
+            if(uint64_t(end() - pos) < size)
+                throw Malformed{};
+
+            StringRef s{pos, size};
+            pos += size;
+            return s;
+        }
+
+        template<typename T>
+        static T& at(vector<T> &elems, uint64_t index){
+            if(index >= elems.size())
+                throw Malformed{};
+            return elems[index];
+        }
+
+        string str(){
+            return at(in.strings, varint()).str();
+        }
+
+        string typeVarName(){
+            return renameTypeVar(str(), in.typeVars, [](size_t){
+                return nextTypeVar()->name;
+            });
+        }
+
+        LOC_TY loc(){
+            unsigned beginLine = varint();
+            unsigned beginCol = varint();
+            unsigned endLine = varint();
+            unsigned endCol = varint();
+            return mkLoc(mkPos(in.fileName, beginLine, beginCol), mkPos(in.fileName, endLine, endCol));
+        }
+
+        Module* module(){
+            return at(in.modules, varint());
+        }
+
+        /** Start of the given record of a table written by InterfaceWriter::writeTable */
+        const char* record(Section section, uint64_t index){
+            Decoder table{in, in.sections[section]};
+            uint64_t count = table.varint();
+            if(index >= count || uint64_t(end() - table.pos) < count * 4)
+                throw Malformed{};
+
+            const char *records = table.pos + count * 4;
+            table.pos += index * 4;
+            uint32_t offset = table.u32();
+            if(uint64_t(end() - records) < offset)
+                throw Malformed{};
+            return records + offset;
+        }
+
+        TypeDecl* typeDecl(){
+            Module *m = module();
+            auto it = m->userTypes.find(str());
+            if(it == m->userTypes.end())
+                throw Malformed{};
+            return &it->getValue();
+        }
+
+        TraitDecl* traitDecl(){
+            Module *m = module();
+            auto it = m->traitDecls.find(str());
+            if(it == m->traitDecls.end())
+                throw Malformed{};
+            return it->getValue();
+        }
+
+        ExtNode* extNode(){
+            uint64_t ref = varint();
+            if(!ref)
+                return nullptr;
+
+            Module *m = at(in.modules, ref - 1);
+            string trait = str();
+            uint64_t index = varint();
+            if(m == in.modules[0])
+                return at(in.extNodes[trait], index);
+
+            auto it = m->traitImpls.find(trait);
+            if(it == m->traitImpls.end() || index >= it->getValue().getImpls().size())
+                throw Malformed{};
+            return it->getValue().getImpls()[index]->impl;
+        }
+
+        AnType* type(){
+            uint64_t ref = varint();
+            if(!ref)
+                return nullptr;
+
+            AnType *&t = at(in.types, ref - 1);
+            if(!t)
+                t = Decoder{in, record(Types, ref - 1)}.decodeType();
+            return t;
+        }
+
+        TypeArgs types(){
+            TypeArgs ret(varint());
+            for(auto &t : ret)
+                t = type();
+            return ret;
+        }
+
+        AnType* decodeType(){
+            switch(varint()){
+            case TK_Primitive:
+                return AnType::getPrimitive((TypeTag)varint());
+            case TK_Modifier: {
+                auto mod = (TokenType)varint();
+                AnType *ext = type();
+                if(!ext) throw Malformed{};
+                return (AnType*)BasicModifier::get(ext, mod);
+            }
+            case TK_Ptr:
+                return AnPtrType::get(type());
+            case TK_Array: {
+                AnType *ext = type();
+                return AnArrayType::get(ext, varint());
+            }
+            case TK_Tuple: {
+                auto fields = types();
+                vector<string> fieldNames(varint());
+                for(auto &name : fieldNames)
+                    name = str();
+                return fieldNames.empty() ? AnTupleType::get(fields) : AnTupleType::getAnonRecord(fields, fieldNames);
+            }
+            case TK_TypeVar: {
+                string name = typeVarName();
+                return AnTypeVarType::get(name, varint());
+            }
+            case TK_Function: {
+                AnType *retTy = type();
+                auto params = types();
+                vector<TraitImpl*> constraints(varint());
+                for(auto &tc : constraints)
+                    tc = traitImpl();
+                return AnFunctionType::get(retTy, params, constraints);
+            }
+            case TK_Data: {
+                string name = str();
+                TypeDecl *decl = varint() ? typeDecl() : nullptr;
+                return AnDataType::get(name, types(), decl);
+            }
+            default:
+                throw Malformed{};
+            }
+        }
+
+        TraitImpl* traitImpl(){
+            uint64_t ref = varint();
+            if(!ref)
+                return nullptr;
+
+            TraitImpl *&impl = at(in.traitImpls, ref - 1);
+            if(!impl){
+                Decoder d{in, record(TraitImpls, ref - 1)};
+                TraitDecl *decl = d.traitDecl();
+                auto args = d.types();
+                size_t min = decl->typeArgs.size();
+                if(args.size() < min || args.size() > min + decl->fundeps.size())
+                    throw Malformed{};
+
+                impl = new TraitImpl(decl, args);
+                impl->impl = d.extNode();
+            }
+            return impl;
+        }
+
+        Declaration* introduce(Declaration *decl){
+            decls->push_back(decl);
+            return decl;
+        }
+
+        Declaration* decl(){
+            switch(varint()){
+            case DK_None:
+                return nullptr;
+            case DK_Local:
+                return at(*decls, varint());
+            case DK_Variable: {
+                string name = str();
+                auto *var = new Variable(name, nullptr, varint());
+                var->tval.type = type();
+                return introduce(var);
+            }
+            case DK_NoDecl: {
+                auto *noDecl = new NoDecl(nullptr);
+                noDecl->tval.type = type();
+                return introduce(noDecl);
+            }
+            case DK_Lambda: {
+                string name = str();
+                Module *m = module();
+                auto *fd = new FuncDecl(nullptr, name, m);
+                fd->traitFuncDecl = varint();
+                fd->tval.type = type();
+                return introduce(fd);
+            }
+            case DK_Function:
+                return at(in.functions, varint());
+            case DK_External: {
+                Module *m = module();
+                auto it = m->fnDecls.find(str());
+                if(it == m->fnDecls.end())
+                    throw Malformed{};
+                return it->getValue();
+            }
+            default:
+                throw Malformed{};
+            }
+        }
+
+        template<typename T>
+        T* node(){
+            return static_cast<T*>(node());
+        }
+
+        template<typename T>
+        vector<ArenaPtr<T>> nodeList(){
+            vector<ArenaPtr<T>> ret(varint());
+            for(auto &n : ret)
+                n.reset(node<T>());
+            return ret;
+        }
+
+        vector<ArenaPtr<ModNode>> modifiers(){
+            return nodeList<ModNode>();
+        }
+
+        Node* node(){
+            uint64_t kind = varint();
+            if(kind == NK_None)
+                return nullptr;
+
+            LOC_TY loc = this->loc();
+            AnType *t = type();
+            size_t id = nodes.size();
+            nodes.push_back(nullptr);
+
+            Node *n = decodeNode(kind, loc);
+            n->Node::setType(t);
+            nodes[id] = n;
+            n->next.reset(node());
+            return n;
+        }
+
+        Node* decodeNode(uint64_t kind, LOC_TY &loc){
+            NodeArena &arena = *in.arena;
+            switch(kind){
+            case NK_IntLit: {
+                string val = str();
+                return arena.make<IntLitNode>(loc, val, (TypeTag)varint());
+            }
+            case NK_FltLit: {
+                string val = str();
+                return arena.make<FltLitNode>(loc, val, (TypeTag)varint());
+            }
+            case NK_BoolLit:
+                return arena.make<BoolLitNode>(loc, (char)varint());
+            case NK_CharLit:
+                return arena.make<CharLitNode>(loc, (char)varint());
+            case NK_Array: {
+                auto exprs = nodeList<Node>();
+                return arena.make<ArrayNode>(loc, exprs);
+            }
+            case NK_Tuple: {
+                auto exprs = nodeList<Node>();
+                return arena.make<TupleNode>(loc, exprs);
+            }
+            case NK_UnOp: {
+                int op = varint();
+                return arena.make<UnOpNode>(loc, op, node());
+            }
+            case NK_BinOp: {
+                int op = varint();
+                Node *lval = node();
+                Node *rval = node();
+                auto *n = arena.make<BinOpNode>(loc, op, lval, rval);
+                n->decl = decl();
+                return n;
+            }
+            case NK_Seq: {
+                auto *n = arena.make<SeqNode>(loc);
+                n->sequence = nodeList<Node>();
+                return n;
+            }
+            case NK_Block:
+                return arena.make<BlockNode>(loc, node());
+            case NK_Mod: {
+                int mod = varint();
+                Node *directive = node();
+                auto *n = arena.make<ModNode>(loc, mod, node());
+                n->directive.reset(directive);
+                return n;
+            }
+            case NK_Type: {
+                auto mods = modifiers();
+                auto typeTag = (TypeTag)varint();
+                string typeName = typeVarName();
+                auto *n = arena.make<TypeNode>(loc, typeTag, typeName, node<TypeNode>());
+                n->modifiers = move(mods);
+                n->params = nodeList<TypeNode>();
+                n->isRowVar = varint();
+                return n;
+            }
+            case NK_TypeCast: {
+                auto *typeExpr = node<TypeNode>();
+                return arena.make<TypeCastNode>(loc, typeExpr, nodeList<Node>());
+            }
+            case NK_Ret:
+                return arena.make<RetNode>(loc, node());
+            case NK_NamedVal: {
+                string name = str();
+                auto *n = arena.make<NamedValNode>(loc, name, node());
+                n->decl = decl();
+                return n;
+            }
+            case NK_Var: {
+                auto *n = arena.make<VarNode>(loc, str());
+                n->decl = decl();
+                return n;
+            }
+            case NK_StrLit:
+                return arena.make<StrLitNode>(loc, str());
+            case NK_VarAssign: {
+                auto mods = modifiers();
+                Node *ref = node();
+                auto *n = arena.make<VarAssignNode>(loc, ref, node());
+                n->modifiers = move(mods);
+                return n;
+            }
+            case NK_Jump: {
+                int jumpType = varint();
+                return arena.make<JumpNode>(loc, jumpType, node());
+            }
+            case NK_While: {
+                Node *condition = node();
+                return arena.make<WhileNode>(loc, condition, node());
+            }
+            case NK_For: {
+                Node *pattern = node();
+                Node *range = node();
+                auto *n = arena.make<ForNode>(loc, pattern, range, node());
+                n->iterableInstance = traitImpl();
+                return n;
+            }
+            case NK_MatchBranch: {
+                Node *pattern = node();
+                return arena.make<MatchBranchNode>(loc, pattern, node());
+            }
+            case NK_Match: {
+                Node *expr = node();
+                auto branches = nodeList<MatchBranchNode>();
+                return arena.make<MatchNode>(loc, expr, branches);
+            }
+            case NK_If: {
+                Node *condition = node();
+                Node *thenN = node();
+                return arena.make<IfNode>(loc, condition, thenN, node());
+            }
+            case NK_FuncDecl: {
+                auto mods = modifiers();
+                string name = str();
+                auto *returnType = node<TypeNode>();
+                auto *params = node<NamedValNode>();
+                auto *typeClassConstraints = node<TypeNode>();
+                bool varargs = varint();
+                Declaration *fd = decl();
+                auto *n = arena.make<FuncDeclNode>(loc, name, returnType, params, typeClassConstraints, node(), varargs);
+                n->modifiers = move(mods);
+                n->decl = fd;
+                return n;
+            }
+            default:
+                throw Malformed{};
+            }
+        }
+
+        /** Read a parse tree and the definitions of the declarations it introduces */
+        template<typename T>
+        T* tree(vector<Declaration*> &functionDecls){
+            decls = &functionDecls;
+            nodes.clear();
+            auto *ret = node<T>();
+
+            uint64_t count = varint();
+            for(uint64_t i = 0; i < count; i++){
+                Declaration *decl = at(functionDecls, varint());
+                uint64_t definition = varint();
+                decl->definition = definition ? at(nodes, definition - 1) : nullptr;
+            }
+            return ret;
+        }
+
+        void readFnDecls(Module *m){
+            uint64_t count = varint();
+            for(uint64_t i = 0; i < count; i++){
+                string name = str();
+                m->fnDecls[name] = at(in.functions, varint());
+            }
+        }
+    };
+
+
+    [[noreturn]] void reportMalformed(string const& fileName){
+        cerr << "Error: The interface " << ModuleInterface::getPath(fileName)
+             << " is corrupt, delete it to compile " << fileName << " instead.\n";
+        exit(EXIT_FAILURE);
+    }
+
+
+    ModuleInterface::ModuleInterface(unique_ptr<MemoryBuffer> buffer) : buffer{move(buffer)}{}
+
+    ModuleInterface::~ModuleInterface() = default;
+
+
+    string ModuleInterface::getPath(string const& sourcePath){
+        return sourcePath + 'i';
+    }
+
+
+    unique_ptr<ModuleInterface> ModuleInterface::open(string const& path, StringRef source){
+        //The file is memory-mapped and not copied, most of it is only read if used
+        auto buffer = MemoryBuffer::getFile(path, -1, false);
+        if(!buffer)
+            return nullptr;
+        return get(move(*buffer), source);
+    }
+
+
+    unique_ptr<ModuleInterface> ModuleInterface::get(unique_ptr<MemoryBuffer> buffer, StringRef source){
+        StringRef contents = buffer->getBuffer();
+        if(contents.size() < magicSize + hashSize || !contents.startswith(StringRef(magic, magicSize)))
+            return nullptr;
+
+        unique_ptr<ModuleInterface> ret{new ModuleInterface(move(buffer))};
+        ret->hash = contents.substr(magicSize, hashSize).str();
+
+        Decoder d{*ret, contents.data() + magicSize + hashSize};
+        try{
+            if(d.varint() != formatVersion || d.raw() != getCompilerHash() || d.raw() != hashContents(source))
+                return nullptr;
+
+            uint64_t importCount = d.varint();
+            for(uint64_t i = 0; i < importCount; i++){
+                ret->importNames.push_back(d.raw().str());
+                ret->importHashes.push_back(d.raw().str());
+            }
+
+            vector<uint64_t> offsets(SectionCount);
+            for(auto &offset : offsets)
+                offset = d.varint();
+
+            for(auto offset : offsets){
+                if(uint64_t(d.end() - d.pos) < offset)
+                    return nullptr;
+                ret->sections.push_back(d.pos + offset);
+            }
+
+            Decoder strings{*ret, ret->sections[Strings]};
+            ret->strings.resize(strings.varint());
+            for(auto &s : ret->strings)
+                s = strings.raw();
+        }catch(Malformed const&){
+            return nullptr;
+        }
+        return ret;
+    }
+
+
+    bool ModuleInterface::load(unique_ptr<ModuleInterface> interface, Module *m, string *fileName){
+        ModuleInterface &in = *interface;
+        Module &root = Module::getRoot();
+        in.fileName = fileName;
+
+        try{
+            //Each module referred to must be found before m is changed
+            Decoder d{in, in.sections[Modules]};
+            in.modules.resize(d.varint());
+            vector<string> children(in.modules.size());
+            for(size_t i = 0; i < in.modules.size(); i++){
+                switch(d.varint()){
+                case MK_Self:
+                    in.modules[i] = m;
+                    break;
+                case MK_Child:
+                    children[i] = d.str();
+                    break;
+                case MK_Path: {
+                    vector<string> path(d.varint());
+                    for(auto &name : path)
+                        name = d.str();
+
+                    in.modules[i] = root.findPath(path);
+                    if(!in.modules[i])
+                        return false;
+                    break;
+                }
+                default:
+                    throw Malformed{};
+                }
+            }
+            if(in.modules.empty() || in.modules[0] != m)
+                throw Malformed{};
+
+            for(size_t i = 0; i < children.size(); i++){
+                if(!children[i].empty()){
+                    in.modules[i] = &m->addChild(children[i]);
+                }
+            }
+
+            auto loc = mkLoc(mkPos(fileName, 0, 0), mkPos(fileName, 0, 0));
+            auto *ast = new RootNode(loc);
+            ast->arena = make_unique<NodeArena>();
+            in.arena = ast->arena.get();
+            m->ast.reset(ast);
+
+            in.types.resize(Decoder{in, in.sections[Types]}.varint());
+            in.traitImpls.resize(Decoder{in, in.sections[TraitImpls]}.varint());
+
+            d.pos = in.sections[Decls];
+            in.functions.resize(d.varint());
+            for(auto &fd : in.functions){
+                Module *mod = d.module();
+                string name = d.str();
+                fd = new FuncDecl(nullptr, name, mod);
+                fd->traitFuncDecl = d.varint();
+            }
+
+            vector<TypeDecl*> typeDecls(d.varint());
+            for(auto &decl : typeDecls){
+                string name = d.str();
+                in.locs.push_back(d.loc());
+                uint64_t flags = d.varint();
+                decl = &m->userTypes.try_emplace(name, nullptr, in.locs.back()).first->getValue();
+                decl->isUnionType = flags & TD_Union;
+                decl->isAlias = flags & TD_Alias;
+                decl->isReprC = flags & TD_ReprC;
+                decl->isNonNull = flags & TD_NonNull;
+            }
+
+            vector<TraitDecl*> traitDecls(d.varint());
+            for(auto &decl : traitDecls){
+                string name = d.str();
+                decl = new TraitDecl(name, {}, {});
+                m->traitDecls[name] = decl;
+            }
+
+            vector<ExtNode*> extNodes(d.varint());
+            for(auto &ext : extNodes){
+                string trait = d.str();
+                auto extLoc = d.loc();
+                ext = in.arena->make<ExtNode>(extLoc, nullptr, nullptr, nullptr);
+                in.extNodes[trait].push_back(ext);
+            }
+
+            for(auto *decl : traitDecls){
+                decl->typeArgs = d.types();
+                decl->fundeps = d.types();
+                uint64_t count = d.varint();
+                for(uint64_t i = 0; i < count; i++)
+                    decl->funcs.emplace_back(Decoder::at(in.functions, d.varint()));
+            }
+
+            for(auto *decl : typeDecls){
+                decl->type = d.type();
+                decl->aliasedType = d.type();
+                uint64_t count = d.varint();
+                for(uint64_t i = 0; i < count; i++){
+                    string name = d.str();
+                    decl->addField(name, d.type());
+                }
+            }
+
+            vector<vector<FuncDecl*>> methods(extNodes.size());
+            for(size_t i = 0; i < extNodes.size(); i++){
+                vector<Declaration*> none;
+                extNodes[i]->trait.reset(d.tree<TypeNode>(none));
+                extNodes[i]->traitType = d.traitImpl();
+                methods[i].resize(d.varint());
+                for(auto &fd : methods[i])
+                    fd = Decoder::at(in.functions, d.varint());
+            }
+
+            for(size_t i = 0; i < extNodes.size(); i++)
+                m->addTraitImpl(d.traitImpl());
+
+            in.bodies.resize(in.functions.size());
+            in.functionDecls.resize(in.functions.size());
+            for(size_t i = 0; i < in.functions.size(); i++){
+                FuncDecl *fd = in.functions[i];
+                fd->tval.type = d.type();
+                fd->definition = d.tree<FuncDeclNode>(in.functionDecls[i]);
+                if(!fd->definition)
+                    throw Malformed{};
+
+                uint64_t body = d.varint();
+                if(body){
+                    if(uint64_t(d.end() - in.sections[Bodies]) < body - 1)
+                        throw Malformed{};
+                    in.bodies[i] = in.sections[Bodies] + body - 1;
+                    fd->bodySource = &in;
+                    fd->bodyIndex = i;
+                }
+            }
+
+            for(size_t i = 0; i < extNodes.size(); i++){
+                Node *prev = nullptr;
+                for(FuncDecl *fd : methods[i]){
+                    if(prev) prev->next.reset(fd->getFDN());
+                    else extNodes[i]->methods.reset(fd->getFDN());
+                    prev = fd->getFDN();
+                }
+            }
+
+            d.readFnDecls(m);
+            uint64_t submodules = d.varint();
+            for(uint64_t i = 0; i < submodules; i++){
+                string name = d.str();
+                Module *child = &m->addChild(name);
+                d.readFnDecls(child);
+
+                uint64_t imports = d.varint();
+                for(uint64_t j = 0; j < imports; j++)
+                    child->imports.push_back(d.module());
+            }
+        }catch(Malformed const&){
+            reportMalformed(*fileName);
+        }
+
+        m->interfaceHash = in.hash;
+        m->interface = move(interface);
+        return true;
+    }
+
+
+    void ModuleInterface::readBody(FuncDecl *fd){
+        Decoder d{*this, bodies[fd->bodyIndex]};
+        try{
+            fd->getFDN()->child.reset(d.tree<Node>(functionDecls[fd->bodyIndex]));
+        }catch(Malformed const&){
+            reportMalformed(*fileName);
+        }
+    }
+
+
+    bool ModuleInterface::write(Module *m, StringRef source, string &out){
+        if(!InterfaceWriter{m}.write(source, out))
+            return false;
+
+        m->interfaceHash = out.substr(magicSize, hashSize);
+        return true;
+    }
+
+
+    void FuncDecl::loadBody(){
+        if(auto *source = bodySource){
+            bodySource = nullptr;
+            source->readBody(this);
+        }
+    }
+}
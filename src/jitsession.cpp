@@ -0,0 +1,289 @@
+#include "jitsession.h"
+#include "target.h"
+#include "targetcpu.h"
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/ValueMapper.h>
+
+using namespace std;
+using namespace llvm;
+
+namespace ante {
+
+    /**
+     * Code run by the JIT always runs on this machine.  Compile-time code may
+     * use all of its features, even if -mcpu selects a different cpu for the
+     * output, while -r programs use the selected cpu if there is one.
+     */
+    orc::JITTargetMachineBuilder getHostTargetMachineBuilder(TargetCpu const& target){
+        InitializeNativeTarget();
+        InitializeNativeTargetAsmPrinter();
+
+        orc::JITTargetMachineBuilder jtmb{Triple(AN_NATIVE_ARCH, AN_NATIVE_VENDOR, AN_NATIVE_OS)};
+        jtmb.setCPU(target.cpu);
+        jtmb.getFeatures() = SubtargetFeatures(target.features);
+        return jtmb;
+    }
+
+    /** The cpu a -r program is run with, the host's unless one was selected */
+    TargetCpu getRunTargetCpu(){
+        auto &target = getTargetCpu();
+        if(target.cpu.empty() && target.features.empty())
+            return getHostCpu();
+        return target;
+    }
+
+    /** Let code in the JIT call into libc and the compiler's own C API */
+    void addProcessSymbols(orc::LLJIT &jit){
+        auto generator = orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+                jit.getDataLayout().getGlobalPrefix());
+
+        if(generator)
+            jit.getMainJITDylib().addGenerator(move(*generator));
+        else
+            logAllUnhandledErrors(generator.takeError(), errs(), "Error when searching the current process for symbols: ");
+    }
+
+
+    JitSession::JitSession(orc::ThreadSafeContext llvmCtxt) :
+            tsctx{llvmCtxt}, uniqueNameCount{0}{
+
+        auto created = orc::LLLazyJITBuilder().setJITTargetMachineBuilder(getHostTargetMachineBuilder(getHostCpu())).create();
+        if(!created){
+            logAllUnhandledErrors(created.takeError(), errs(), "Error when initializing the JIT: ");
+            exit(EXIT_FAILURE);
+        }
+        jit = move(*created);
+        addProcessSymbols(*jit);
+    }
+
+    JitSession::~JitSession(){}
+
+
+    bool isComplete(const GlobalValue *gv){
+        if(auto *f = dyn_cast<Function>(gv)){
+            for(auto &bb : *f){
+                if(!bb.getTerminator())
+                    return false;
+            }
+        }
+        return !gv->isDeclaration();
+    }
+
+
+    string JitSession::claimName(const GlobalValue *gv){
+        string name = gv->hasName() ? gv->getName().str() : "ct.anon";
+        if(!gv->hasName() || definedNames.count(name))
+            name += ".ct" + to_string(uniqueNameCount++);
+
+        definedNames.insert(name);
+        return name;
+    }
+
+
+    /**
+     * Copies each global referenced by the definitions being added into the
+     * increment module given to the JIT.  Globals already in the JIT, external
+     * ones, and unfinished functions become declarations.  Any other global is
+     * defined in the increment and queued so its body or initializer is copied.
+     */
+    class IncrementMaterializer : public ValueMaterializer {
+        JitSession &session;
+        Module &increment;
+
+    public:
+        vector<pair<GlobalValue*, GlobalValue*>> queued;
+
+        IncrementMaterializer(JitSession &session, Module &increment)
+            : session{session}, increment{increment}{}
+
+        Value* materialize(Value *v) override {
+            auto *gv = dyn_cast<GlobalValue>(v);
+            if(!gv)
+                return nullptr;
+
+            auto it = session.jitNames.find(gv);
+            bool define = it == session.jitNames.end() && isComplete(gv)
+                && (isa<Function>(gv) || isa<GlobalVariable>(gv));
+
+            string name = define ? session.claimName(gv)
+                : it != session.jitNames.end() ? it->second
+                : gv->getName().str();
+
+            GlobalValue *copy;
+            if(auto *f = dyn_cast<Function>(gv)){
+                //the rest of a definition's attributes are copied along with its body
+                auto *fnCopy = Function::Create(f->getFunctionType(), GlobalValue::ExternalLinkage, name, &increment);
+                fnCopy->setAttributes(f->getAttributes());
+                fnCopy->setCallingConv(f->getCallingConv());
+                copy = fnCopy;
+            }else if(auto *var = dyn_cast<GlobalVariable>(gv)){
+                auto *varCopy = new GlobalVariable(increment, var->getValueType(), var->isConstant(),
+                        GlobalValue::ExternalLinkage, nullptr, name, nullptr,
+                        var->getThreadLocalMode(), var->getAddressSpace());
+                varCopy->copyAttributesFrom(var);
+                copy = varCopy;
+            }else{
+                copy = new GlobalVariable(increment, gv->getValueType(), false,
+                        GlobalValue::ExternalLinkage, nullptr, name);
+            }
+            copy->setVisibility(GlobalValue::DefaultVisibility);
+
+            if(define){
+                session.jitNames[gv] = name;
+                queued.emplace_back(gv, copy);
+            }
+            return copy;
+        }
+    };
+
+
+    bool JitSession::addNewDefinitions(Module &mod, vector<WeakVH> &finished){
+        vector<GlobalValue*> definitions;
+        for(auto &handle : finished){
+            auto *gv = dyn_cast_or_null<GlobalValue>(handle);
+            if(!gv || !isComplete(gv))
+                continue;
+
+            //A function finished again after being added was redefined,
+            //so its new definition must be given a new symbol
+            if(jitNames.erase(gv) && onRedefinition){
+                if(auto *f = dyn_cast<Function>(gv))
+                    onRedefinition(f);
+            }
+            definitions.push_back(gv);
+        }
+        finished.clear();
+
+        if(definitions.empty())
+            return true;
+
+        assert(&mod.getContext() == tsctx.getContext() && "module is not in the JIT's context");
+        auto lock = tsctx.getLock();
+
+        auto increment = make_unique<Module>(mod.getName(), mod.getContext());
+        increment->setDataLayout(mod.getDataLayout());
+        increment->setTargetTriple(mod.getTargetTriple());
+
+        ValueToValueMapTy vmap;
+        IncrementMaterializer materializer{*this, *increment};
+        for(auto *gv : definitions)
+            MapValue(gv, vmap, RF_None, nullptr, &materializer);
+
+        //Copying a body may reference further globals, queueing them in turn
+        while(!materializer.queued.empty()){
+            auto defn = materializer.queued.back();
+            materializer.queued.pop_back();
+
+            if(auto *f = dyn_cast<Function>(defn.first)){
+                auto *copy = cast<Function>(defn.second);
+                auto arg = copy->arg_begin();
+                for(auto &oldArg : f->args()){
+                    arg->setName(oldArg.getName());
+                    vmap[&oldArg] = &*arg++;
+                }
+
+                SmallVector<ReturnInst*, 8> returns;
+                CloneFunctionInto(copy, f, vmap, true, returns, "", nullptr, nullptr, &materializer);
+            }else{
+                auto *var = cast<GlobalVariable>(defn.first);
+                cast<GlobalVariable>(defn.second)->setInitializer(
+                        MapValue(var->getInitializer(), vmap, RF_None, nullptr, &materializer));
+            }
+
+            //private definitions still need to be visible to later increments
+            defn.second->setLinkage(GlobalValue::ExternalLinkage);
+            defn.second->setVisibility(GlobalValue::DefaultVisibility);
+        }
+
+        if(auto err = jit->addLazyIRModule(orc::ThreadSafeModule(move(increment), tsctx))){
+            logAllUnhandledErrors(move(err), errs(), "Error when adding module to the JIT: ");
+            return false;
+        }
+        return true;
+    }
+
+
+    void JitSession::giveUniqueName(GlobalValue *gv){
+        string name = gv->getName().str();
+        gv->setName(name + ".ct" + to_string(uniqueNameCount++));
+    }
+
+
+    JITTargetAddress JitSession::lookup(StringRef name){
+        auto symbol = jit->lookup(name);
+        if(!symbol){
+            consumeError(symbol.takeError());
+            return 0;
+        }
+        return symbol->getAddress();
+    }
+
+
+    /** Looks up main in the given JIT and calls it with the given arguments */
+    int runMain(orc::LLJIT &jit, string const& programName, vector<string> const& args){
+        auto main = jit.lookup("main");
+        if(!main){
+            logAllUnhandledErrors(main.takeError(), errs(), "Error when running main: ");
+            return -1;
+        }
+
+        auto fn = (int(*)(int, char*[]))main->getAddress();
+        return orc::runAsMain(fn, args, StringRef(programName));
+    }
+
+
+    int runObjInJit(unique_ptr<MemoryBuffer> obj, string const& programName, vector<string> const& args){
+        auto created = orc::LLJITBuilder().setJITTargetMachineBuilder(getHostTargetMachineBuilder(getRunTargetCpu())).create();
+        if(!created){
+            logAllUnhandledErrors(created.takeError(), errs(), "Error when initializing the JIT: ");
+            return -1;
+        }
+        auto &jit = **created;
+        addProcessSymbols(jit);
+
+        if(auto err = jit.addObjectFile(move(obj))){
+            logAllUnhandledErrors(move(err), errs(), "Error when adding object to the JIT: ");
+            return -1;
+        }
+        return runMain(jit, programName, args);
+    }
+
+
+    int runModuleLazilyInJit(Module &mod, string const& programName, vector<string> const& args){
+        auto created = orc::LLLazyJITBuilder().setJITTargetMachineBuilder(getHostTargetMachineBuilder(getRunTargetCpu())).create();
+        if(!created){
+            logAllUnhandledErrors(created.takeError(), errs(), "Error when initializing the JIT: ");
+            return -1;
+        }
+        auto &jit = **created;
+        addProcessSymbols(jit);
+
+        //The module's context is shared with the rest of the compiler so
+        //it is moved into one owned by the JIT
+        SmallVector<char, 0> buffer;
+        raw_svector_ostream os{buffer};
+        WriteBitcodeToFile(mod, os);
+
+        orc::ThreadSafeContext ctxt{make_unique<LLVMContext>()};
+        auto parsed = parseBitcodeFile(MemoryBufferRef{StringRef(buffer.data(), buffer.size()), mod.getName()},
+                *ctxt.getContext());
+
+        if(!parsed){
+            logAllUnhandledErrors(parsed.takeError(), errs(), "Error when adding module to the JIT: ");
+            return -1;
+        }
+
+        if(auto err = jit.addLazyIRModule(orc::ThreadSafeModule(move(*parsed), ctxt))){
+            logAllUnhandledErrors(move(err), errs(), "Error when adding module to the JIT: ");
+            return -1;
+        }
+        return runMain(jit, programName, args);
+    }
+}
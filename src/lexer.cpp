@@ -1,4 +1,7 @@
 #include "lexer.h"
+#include "ptree.h"
+#include "sourcemanager.h"
+#include "scan.h"
 #include "lazystr.h"
 #include <cstdlib>
 #include <cstring>
@@ -7,114 +10,130 @@ using namespace ante;
 using namespace std;
 
 /*
- *  Maps each non-literal token to a string representing
- *  its type.
+ *  The string representation of each non-literal token,
+ *  indexed by its TokenType - Tok_Ident.  This must be kept
+ *  in the same order as the TokenType enum in tokens.h
  */
-map<int, const char*> tokDict = {
-    {Tok_Ident, "Identifier"},
-    {Tok_UserType, "UserType"},
-    {Tok_TypeVar, "TypeVar"},
+const char* tokNames[] = {
+    "Identifier",    // Tok_Ident
+    "UserType",      // Tok_UserType
+    "TypeVar",       // Tok_TypeVar
 
     //types
-    {Tok_I8, "i8"},
-    {Tok_I16, "i16"},
-    {Tok_I32, "i32"},
-    {Tok_I64, "i64"},
-    {Tok_U8, "u8"},
-    {Tok_U16, "u16"},
-    {Tok_U32, "u32"},
-    {Tok_U64, "u64"},
-    {Tok_Isz, "isz"},
-    {Tok_Usz, "usz"},
-    {Tok_F16, "f16"},
-    {Tok_F32, "f32"},
-    {Tok_F64, "f64"},
-    {Tok_C8, "c8"},
-    {Tok_Bool, "bool"},
-    {Tok_Unit, "unit"},
-
-    {Tok_Assign, ":="},
-    {Tok_EqEq, "=="},
-    {Tok_NotEq, "!="},
-    {Tok_AddEq, "+="},
-    {Tok_SubEq, "-="},
-    {Tok_MulEq, "*="},
-    {Tok_DivEq, "/="},
-    {Tok_GrtrEq, ">="},
-    {Tok_LesrEq, "<="},
-    {Tok_Or, "or"},
-    {Tok_And, "and"},
-    {Tok_Range, ".."},
-    {Tok_VarArgs, "..."},
-    {Tok_RArrow, "->"},
-    {Tok_ApplyL, "<|"},
-    {Tok_ApplyR, "|>"},
-    {Tok_Append, "++"},
-    {Tok_New, "new"},
-    {Tok_Not, "not"},
-    {Tok_Is, "is"},
-    {Tok_Isnt, "isnt"},
+    "i8",            // Tok_I8
+    "i16",           // Tok_I16
+    "i32",           // Tok_I32
+    "i64",           // Tok_I64
+    "u8",            // Tok_U8
+    "u16",           // Tok_U16
+    "u32",           // Tok_U32
+    "u64",           // Tok_U64
+    "isz",           // Tok_Isz
+    "usz",           // Tok_Usz
+    "f16",           // Tok_F16
+    "f32",           // Tok_F32
+    "f64",           // Tok_F64
+    "c8",            // Tok_C8
+    "bool",          // Tok_Bool
+    "unit",          // Tok_Unit
+
+    ":=",            // Tok_Assign
+    "==",            // Tok_EqEq
+    "!=",            // Tok_NotEq
+    "+=",            // Tok_AddEq
+    "-=",            // Tok_SubEq
+    "*=",            // Tok_MulEq
+    "/=",            // Tok_DivEq
+    ">=",            // Tok_GrtrEq
+    "<=",            // Tok_LesrEq
+    "or",            // Tok_Or
+    "and",           // Tok_And
+    "..",            // Tok_Range
+    "...",           // Tok_VarArgs
+    "->",            // Tok_RArrow
+    "<|",            // Tok_ApplyL
+    "|>",            // Tok_ApplyR
+    "++",            // Tok_Append
+    "new",           // Tok_New
+    "not",           // Tok_Not
+    "is",            // Tok_Is
+    "isnt",          // Tok_Isnt
 
     //literals
-    {Tok_True, "true"},
-    {Tok_False, "false"},
-    {Tok_IntLit, "IntLit"},
-    {Tok_FltLit, "FltLit"},
-    {Tok_StrLit, "StrLit"},
-    {Tok_CharLit, "CharLit"},
+    "true",          // Tok_True
+    "false",         // Tok_False
+    "IntLit",        // Tok_IntLit
+    "FltLit",        // Tok_FltLit
+    "StrLit",        // Tok_StrLit
+    "CharLit",       // Tok_CharLit
 
     //keywords
-    {Tok_Return, "return"},
-    {Tok_If, "if"},
-    {Tok_Then, "then"},
-    {Tok_Elif, "elif"},
-    {Tok_Else, "else"},
-    {Tok_For, "for"},
-    {Tok_While, "while"},
-    {Tok_Do, "do"},
-    {Tok_In, "in"},
-    {Tok_Continue, "continue"},
-    {Tok_Break, "break"},
-    {Tok_Import, "import"},
-    {Tok_Let, "let"},
-    {Tok_Match, "match"},
-    {Tok_With, "with"},
-    {Tok_Ref, "ref"},
-    {Tok_Type, "type"},
-    {Tok_Trait, "trait"},
-    {Tok_Given, "given"},
-    {Tok_Module, "module"},
-    {Tok_Impl, "impl"},
-    {Tok_Block, "block"},
-    {Tok_As, "as"},
+    "return",        // Tok_Return
+    "if",            // Tok_If
+    "then",          // Tok_Then
+    "elif",          // Tok_Elif
+    "else",          // Tok_Else
+    "for",           // Tok_For
+    "while",         // Tok_While
+    "do",            // Tok_Do
+    "in",            // Tok_In
+    "continue",      // Tok_Continue
+    "break",         // Tok_Break
+    "import",        // Tok_Import
+    "let",           // Tok_Let
+    "match",         // Tok_Match
+    "with",          // Tok_With
+    "ref",           // Tok_Ref
+    "type",          // Tok_Type
+    "trait",         // Tok_Trait
+    "given",         // Tok_Given
+    "module",        // Tok_Module
+    "impl",          // Tok_Impl
+    "block",         // Tok_Block
+    "as",            // Tok_As
 
     //pseudo-keywords
-    {Tok_Self, "self"},
+    "self",          // Tok_Self
 
     //modifiers
-    {Tok_Pub, "pub"},
-    {Tok_Pri, "pri"},
-    {Tok_Pro, "pro"},
-    {Tok_Const, "const"},
-    {Tok_Mut, "mut"},
-    {Tok_Global, "global"},
-    {Tok_Ante, "ante"},
+    "pub",           // Tok_Pub
+    "pri",           // Tok_Pri
+    "pro",           // Tok_Pro
+    "const",         // Tok_Const
+    "mut",           // Tok_Mut
+    "global",        // Tok_Global
+    "ante",          // Tok_Ante
 
     //other
-    {Tok_Where, "where"},
-    {Tok_InterpolateBegin, "${"},
-    {Tok_InterpolateEnd, "}"},
-    {Tok_UnfinishedStr, "UStrLit"},
-
-    {Tok_Newline, "Newline"},
-    {Tok_Indent, "Indent"},
-    {Tok_Unindent, "Unindent"},
+    "where",         // Tok_Where
+    "${",            // Tok_InterpolateBegin
+    "}",             // Tok_InterpolateEnd
+    "UStrLit",       // Tok_UnfinishedStr
+
+    "Newline",       // Tok_Newline
+    "Indent",        // Tok_Indent
+    "Unindent",      // Tok_Unindent
+};
+
+static_assert(sizeof(tokNames) / sizeof(*tokNames) == Tok_Unindent - Tok_Ident + 1,
+        "tokNames must have exactly one entry per TokenType");
+
+
+struct Keyword {
+    const char *name;
+    size_t len;
+    int tok;
+
+    constexpr Keyword() : name{nullptr}, len{0}, tok{0}{}
+    constexpr Keyword(const char *name, int tok) : name{name}, len{0}, tok{tok}{
+        while(name[len]) len++;
+    }
 };
 
 /*
- *  Maps each keyword to its corresponding TokenType
+ *  Each keyword and its corresponding TokenType
  */
-map<string, int> keywords = {
+constexpr Keyword keywordList[] = {
     {"i8",       Tok_I8},
     {"i16",      Tok_I16},
     {"i32",      Tok_I32},
@@ -179,24 +198,64 @@ map<string, int> keywords = {
     {"where",    Tok_Where},
 };
 
+/*
+ *  Keywords are looked up in a perfect hash table built at compile-time.
+ *  The hash is FNV-1a with a seed chosen so that no two keywords share a
+ *  slot; if a keyword is added and the static_assert below fails a new
+ *  seed must be found.
+ */
+constexpr uint32_t keywordHashSeed = 45;
+constexpr size_t keywordTableSize = 256;
 
-/* Raw text to store identifiers and usertypes in */
-char *lextxt;
+constexpr size_t hashKeyword(const char *s, size_t len){
+    uint32_t h = keywordHashSeed;
+    for(size_t i = 0; i < len; i++){
+        h = (h ^ (unsigned char)s[i]) * 16777619u;
+    }
+    return (h ^ (h >> 16)) & (keywordTableSize - 1);
+}
 
-Lexer *yylexer;
+constexpr bool keywordHashHasCollision(){
+    size_t numKeywords = sizeof(keywordList) / sizeof(*keywordList);
+    for(size_t i = 0; i < numKeywords; i++){
+        for(size_t j = 0; j < i; j++){
+            if(hashKeyword(keywordList[i].name, keywordList[i].len) == hashKeyword(keywordList[j].name, keywordList[j].len))
+                return true;
+        }
+    }
+    return false;
+}
 
-bool ante::colored_output = true;
+static_assert(!keywordHashHasCollision(), "keywordHashSeed no longer gives a perfect hash of every keyword");
+
+struct KeywordTable {
+    Keyword slots[keywordTableSize];
 
-/* Sets lexer instance for yylex to use */
-void setLexer(Lexer *l){
-    if(yylexer)
-        delete yylexer;
+    constexpr KeywordTable() : slots{} {
+        for(auto &kw : keywordList){
+            slots[hashKeyword(kw.name, kw.len)] = kw;
+        }
+    }
+};
+
+constexpr KeywordTable keywordTable;
 
-    yylexer = l;
+/*
+ *  Returns the keyword with the given spelling or
+ *  nullptr if the given string is not a keyword
+ */
+const Keyword* lookupKeyword(const char *s, size_t len){
+    const Keyword &kw = keywordTable.slots[hashKeyword(s, len)];
+    if(kw.len == len && memcmp(kw.name, s, len) == 0)
+        return &kw;
+    return nullptr;
 }
 
-int yylex(yy::parser::semantic_type* st, yy::location* yyloc){
-    return yylexer->next(yyloc);
+
+bool ante::colored_output = true;
+
+int yylex(yy::parser::semantic_type* st, yy::location* yyloc, ante::parser::ParseContext &ctxt){
+    return ctxt.lexer.next(yyloc);
 }
 
 
@@ -206,33 +265,36 @@ int yylex(yy::parser::semantic_type* st, yy::location* yyloc){
  * If file = nullptr then stdin will be opened instead
  */
 Lexer::Lexer(string* file) :
-    isPseudoFile{false},
+    lextxt{nullptr},
     interpolationLevel{0},
     unfinishedStrLiteral{false},
     row{1},
     col{1},
     rowOffset{0},
     colOffset{0},
-    cur{0},
-    nxt{0},
+    cur{1}, //Cannot initialize cur=nxt=0 as 0 is treated as end of file
+    nxt{1},
     scopes{new stack<unsigned int>()},
     cscope{0},
     manualScopeLevel{0},
     shouldReturnNewline{false},
     printInput{false}
 {
+    SourceFile *source;
     if(file){
-        in = new ifstream(*file);
+        source = SourceManager::getFile(*file);
         fileName = file;
     }else{
-        in = &cin;
+        source = SourceManager::getStdin();
         fileName = new string("stdin");
     }
 
-    if(!*in){
-        cerr << "Error: Unable to open file '" << *file << "'\n";
+    if(!source){
+        cerr << "Error: Unable to open file '" << *fileName << "'\n";
         exit(EXIT_FAILURE);
     }
+    src = source->begin();
+    srcEnd = source->end();
 
     incPos(2);
     row = col = 1;
@@ -249,14 +311,14 @@ Lexer::Lexer(string* file) :
  */
 Lexer::Lexer(string* fName, string& pFile,
         unsigned int ro, unsigned int co, bool pi) :
-    isPseudoFile{true},
+    lextxt{nullptr},
     interpolationLevel{0},
     unfinishedStrLiteral{false},
     row{1},
     col{1},
     rowOffset{ro},
     colOffset{co},
-    cur{1}, //Cannot initialize cur=nxt=0 as 0 is treated as end of file for a pseudo-file
+    cur{1}, //Cannot initialize cur=nxt=0 as 0 is treated as end of file
     nxt{1},
     scopes{new stack<unsigned int>()},
     cscope{0},
@@ -265,15 +327,14 @@ Lexer::Lexer(string* fName, string& pFile,
     printInput{pi}
 {
     fileName = fName;
-    pseudoFile = (char*)pFile.c_str();
+    src = pFile.c_str();
+    srcEnd = src + pFile.size();
     incPos(2);
     scopes->push(0);
 }
 
 Lexer::~Lexer(){
     delete scopes;
-    if(!isPseudoFile && in != &cin)
-        delete in;
 }
 
 char Lexer::peek() const{
@@ -313,7 +374,7 @@ string Lexer::getTokStr(int t){
     if(IS_LITERAL(t)){
         s += (char)t;
     }else{
-        s += tokDict[t];
+        s += tokNames[t - Tok_Ident];
     }
     return s;
 }
@@ -321,16 +382,7 @@ string Lexer::getTokStr(int t){
 inline void Lexer::incPos(){
     cur = nxt;
     col++;
-
-    if(isPseudoFile){
-        nxt = !nxt ? 0 : *(pseudoFile++);
-    }else{
-        if(in->good()){
-            in->get(nxt);
-        }else {
-            cur = nxt = 0;
-        }
-    }
+    nxt = !nxt ? 0 : *(src++);
 }
 
 void Lexer::incPos(int end){
@@ -339,6 +391,25 @@ void Lexer::incPos(int end){
     }
 }
 
+/*
+ * Moves cur to pos in a single step, as if incPos were called
+ * once for each character skipped.  cur must not be the end of
+ * input and pos must not be past a newline or the end of the source
+ * since only col is updated.  This is used along with the vectorized
+ * scans in scan.h to skip over long runs of characters at once.
+ */
+void Lexer::skipTo(const char *pos){
+    col += pos - (src - 2);
+    cur = *pos;
+    if(cur){
+        nxt = pos[1];
+        src = pos + 2;
+    }else{
+        nxt = 0;
+        src = pos + 1;
+    }
+}
+
 unsigned int Lexer::getManualScopeLevel() const {
     return manualScopeLevel;
 }
@@ -384,12 +455,12 @@ int Lexer::handleComment(yy::parser::location_type* loc){
         }
 
         incPos(2);
-    }else{ //single line comment
-        if(printInput)
-            setTermFGColor(AN_COMMENT_COLOR);
+    }else if(!printInput){ //single line comment
+        skipTo(scan::findLineEnd(src - 2, srcEnd));
+    }else{
+        setTermFGColor(AN_COMMENT_COLOR);
         while(cur != '\n' && cur != '\0'){
-            if(printInput)
-                putchar(cur);
+            putchar(cur);
             incPos();
         }
     }
@@ -411,24 +482,46 @@ void Lexer::setlextxt(string &str){
     lextxt = strdup(str.c_str());
 }
 
+void Lexer::setlextxt(const char *str, size_t len){
+    lextxt = (char*)malloc(len + 1);
+    memcpy(lextxt, str, len);
+    lextxt[len] = '\0';
+}
+
 int Lexer::genAlphaNumTok(yy::parser::location_type* loc){
-    string s = "";
+    //cur is always 2 characters behind src, and
+    //identifiers are never split across buffers
+    const char *start = src - 2;
+    size_t len = 0;
     loc->begin = getPos();
 
     bool isUsertype = cur >= 'A' && cur <= 'Z';
-    if(isUsertype){
+    if(!printInput){
+        const char *tokEnd = scan::skipIdentChars(start, srcEnd);
+        len = tokEnd - start;
+
+        if(isUsertype){
+            auto *underscore = (const char*)memchr(start, '_', len);
+            if(underscore){
+                skipTo(underscore);
+                loc->end = getPos();
+                lexErr("Usertypes cannot contain an underscore.", loc);
+            }
+        }
+        skipTo(tokEnd);
+    }else if(isUsertype){
         while(IS_ALPHANUM(cur)){
             if(cur == '_'){
                 loc->end = getPos();
                 lexErr("Usertypes cannot contain an underscore.", loc);
             }
 
-            s += cur;
+            len++;
             incPos();
         }
     }else{
         while(IS_ALPHANUM(cur)){
-            s += cur;
+            len++;
             incPos();
         }
     }
@@ -437,26 +530,26 @@ int Lexer::genAlphaNumTok(yy::parser::location_type* loc){
 
     if(isUsertype){
         if(printInput)
-            cout << AN_TYPE_COLOR << s << AN_CONSOLE_RESET;
-        setlextxt(s);
+            cout << AN_TYPE_COLOR << string(start, len) << AN_CONSOLE_RESET;
+        setlextxt(start, len);
         return Tok_UserType;
     }else{ //ident or keyword
-        auto key = keywords.find(s.c_str());
-        if(key != keywords.end()){
+        auto *key = lookupKeyword(start, len);
+        if(key){
             if(printInput){
-                if(isKeywordAType(key->second))
+                if(isKeywordAType(key->tok))
                     cout << AN_TYPE_COLOR;
-                else if(key->second == Tok_True || key->second == Tok_False)
+                else if(key->tok == Tok_True || key->tok == Tok_False)
                     cout << AN_CONSTANT_COLOR;
                 else cout << AN_KEYWORD_COLOR;
 
-                cout << key->first << AN_CONSOLE_RESET;
+                cout << key->name << AN_CONSOLE_RESET;
             }
-            return key->second;
+            return key->tok;
         }else{//ident
             if(printInput)
-                cout << s;
-            setlextxt(s);
+                cout << string(start, len);
+            setlextxt(start, len);
             return Tok_Ident;
         }
     }
@@ -566,6 +659,15 @@ int Lexer::genWsTok(yy::parser::location_type* loc){
         unsigned int newScope = 0;
 
         while(IS_WHITESPACE(cur) && cur != '\0'){
+            //indentation is usually a long run of spaces, skip it all at once
+            if(cur == ' ' && !printInput){
+                const char *spacesEnd = scan::skipSpaces(src - 2, srcEnd);
+                newScope += spacesEnd - (src - 2);
+                skipTo(spacesEnd);
+                if(IS_COMMENT(cur, nxt)) return handleComment(loc);
+                continue;
+            }
+
             switch(cur){
                 case ' ': newScope++; break;
                 case '\n':
@@ -615,13 +717,27 @@ int Lexer::skipWsAndReturnNext(yy::parser::location_type* loc){
             putchar(cur);
 
         incPos();
-    }while(cur == ' ');
+    }while(cur == ' ' && printInput);
+
+    if(cur == ' ')
+        skipTo(scan::skipSpaces(src - 2, srcEnd));
     return next(loc);
 }
 
 int Lexer::genStrLitTokNoOpenQuotes(yy::parser::location_type* loc, TokenType tokTy){
     string s = "";
     while(cur != '"' && cur != '\0'){
+        //append the run of characters needing no special handling all at once
+        if(!printInput){
+            const char *start = src - 2;
+            const char *runEnd = scan::findStrLitSpecial(start, srcEnd);
+            if(runEnd != start){
+                s.append(start, runEnd - start);
+                skipTo(runEnd);
+                continue;
+            }
+        }
+
         if(cur == '\\'){
             if(printInput)
                 putchar('\\');
@@ -658,7 +774,8 @@ int Lexer::genStrLitTokNoOpenQuotes(yy::parser::location_type* loc, TokenType to
                         cha += cur - '0';
 
                         s += cha;
-                        in->putback(nxt);
+                        //put nxt back to be read again after cur
+                        if(nxt) src--;
                         nxt = cur;
                     }
                     break;
@@ -777,7 +894,8 @@ int Lexer::genCharLitTok(yy::parser::location_type* loc){
                     cha += cur - '0';
 
                     s += cha;
-                    in->putback(nxt);
+                    //put nxt back to be read again after cur
+                    if(nxt) src--;
                     nxt = cur;
                 }
                 break;
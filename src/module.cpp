@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <cctype>
 #include "antype.h"
+#include "interface.h"
 #include "module.h"
 #include "antype.h"
 #include "trait.h"
@@ -8,14 +9,27 @@
 #include "util.h"
 
 namespace ante {
+    Module::Module(std::string const& name) : name{name} {}
+
+    //Defined here since ModuleInterface is incomplete in module.h
+    Module::~Module() = default;
+
     Module rootModule{""};
 
     Module& Module::getRoot(){
         return rootModule;
     }
 
-    llvm::StringMap<Module>::iterator Module::findChild(std::string const& name) {
-        return children.find(name);
+    std::mutex Module::treeMutex;
+
+    Module* Module::findChild(std::string const& name) {
+        std::lock_guard<std::mutex> lock{treeMutex};
+        auto it = children.find(name);
+        return it != children.end() ? &it->getValue() : nullptr;
+    }
+
+    llvm::StringMap<Module>::iterator Module::childrenBegin() {
+        return children.begin();
     }
 
     llvm::StringMap<Module>::iterator Module::childrenEnd() {
@@ -23,8 +37,8 @@ namespace ante {
     }
 
     Module& Module::addChild(std::string const& childName){
-        children.try_emplace(childName, childName);
-        return children.find(childName)->second;
+        std::lock_guard<std::mutex> lock{treeMutex};
+        return children.try_emplace(childName, childName).first->getValue();
     }
 
     void ModulePath::removeTrailingFileType(){
@@ -110,29 +124,109 @@ namespace ante {
         return nullptr;
     }
 
+    /**
+     * Append a key for the outermost type constructor of each type in typeArgs to key.
+     * Returns false if any of the types is a type variable and thus has no such key.
+     */
+    bool getHeadTypeKey(TypeArgs const& typeArgs, std::string &key){
+        for(AnType *t : typeArgs){
+            if(t->typeTag == TT_TypeVar)
+                return false;
+
+            key += (char)t->typeTag;
+            if(auto dt = try_cast<AnDataType>(t)){
+                key += dt->name;
+            }
+            key += ';';
+        }
+        return true;
+    }
+
+    void TraitImplIndex::add(TraitImpl *impl){
+        std::string key;
+        if(getHeadTypeKey(impl->typeArgs, key)){
+            byHead[key].push_back(impls.size());
+        }else{
+            generic.push_back(impls.size());
+        }
+        impls.push_back(impl);
+    }
+
+    TraitImpl* TraitImplIndex::lookup(TypeArgs const& typeArgs, UnionFind &scratch) const {
+        auto matches = [&](size_t i){
+            return tryUnify(impls[i]->typeArgs, typeArgs, scratch) == UnifyStatus::Success;
+        };
+
+        std::string key;
+        if(!getHeadTypeKey(typeArgs, key)){
+            // A type variable may unify with any impl so all must be checked
+            for(size_t i = 0; i < impls.size(); i++){
+                if(matches(i))
+                    return impls[i];
+            }
+            return nullptr;
+        }
+
+        // Merge the matching bucket with the generic bucket so
+        // candidates are still checked in declaration order.
+        static const std::vector<size_t> empty;
+        auto it = byHead.find(key);
+        auto &bucket = it != byHead.end() ? it->getValue() : empty;
+
+        auto b = bucket.begin(), g = generic.begin();
+        while(b != bucket.end() || g != generic.end()){
+            size_t i;
+            if(g == generic.end() || (b != bucket.end() && *b < *g)){
+                i = *b++;
+            }else{
+                i = *g++;
+            }
+
+            if(matches(i))
+                return impls[i];
+        }
+        return nullptr;
+    }
+
+    std::atomic<size_t> Module::traitImplGeneration{0};
+
+    void Module::addTraitImpl(TraitImpl *impl){
+        traitImpls[impl->name].add(impl);
+        traitImplGeneration++;
+    }
+
     /** Lookup the given TraitInstance* and return it if found, null otherwise */
     TraitImpl* Module::lookupTraitImpl(std::string const& name, TypeArgs const& typeArgs) const {
+        if(traitImplCacheGeneration != traitImplGeneration){
+            traitImplCache.clear();
+            traitImplCacheGeneration = traitImplGeneration;
+        }
+
+        bool cacheable = !ante::any(typeArgs, [](AnType *t){ return t->isGeneric; });
+        if(cacheable){
+            auto cached = traitImplCache.find({name, typeArgs});
+            if(cached != traitImplCache.end())
+                return cached->second;
+        }
+
+        UnionFind scratch;
+        TraitImpl *ret = nullptr;
+
         auto it = traitImpls.find(name);
         if(it != traitImpls.end()){
-            for(auto *impl : it->getValue()){
-                auto pair = tryUnify(impl->typeArgs, typeArgs);
-                if(pair.first){
-                    return impl;
-                }
-            }
+            ret = it->getValue().lookup(typeArgs, scratch);
         }
-        for(Module *import : this->imports){
-            auto it = import->traitImpls.find(name);
-            if(it != import->traitImpls.end()){
-                for(auto *impl : it->getValue()){
-                    auto pair = tryUnify(impl->typeArgs, typeArgs);
-                    if(pair.first){
-                        return impl;
-                    }
-                }
+        for(auto importIt = imports.begin(); !ret && importIt != imports.end(); ++importIt){
+            auto it = (*importIt)->traitImpls.find(name);
+            if(it != (*importIt)->traitImpls.end()){
+                ret = it->getValue().lookup(typeArgs, scratch);
             }
         }
-        return nullptr;
+
+        if(ret && cacheable){
+            traitImplCache[{name, typeArgs}] = ret;
+        }
+        return ret;
     }
 
     /** Lookup the TraitDecl and return a new, unimplemented instance of it */
@@ -1,5 +1,8 @@
 #include "nameresolution.h"
+#include "buildcache.h"
 #include "compiler.h"
+#include "interface.h"
+#include "sourcemanager.h"
 #include "target.h"
 #include "types.h"
 #include "uniontag.h"
@@ -10,6 +13,11 @@
 #include "typeinference.h"
 #include "trait.h"
 #include "util.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
 
 using namespace std;
 
@@ -18,6 +26,32 @@ using namespace std;
 //deleted, including the FuncDeclNodes within ante::Modules
 //that all have a static lifetime
 list<string> fileNames;
+mutex fileNamesMutex;
+
+//Parse trees of modules parsed ahead of time by preparseImports
+//that have not been imported yet, keyed by their full path.
+//A null tree means the module failed to parse.
+unordered_map<string, unique_ptr<ante::parser::RootNode>> preparsedModules;
+mutex preparsedModulesMutex;
+
+//A module found by preparseImports which resolveImports has not loaded yet
+struct PendingImport {
+    //The name the module was first imported by
+    string name;
+
+    //Full path of each of its imports which was not loaded when it was found
+    unordered_set<string> imports;
+};
+
+//Each module found by preparseImports which resolveImports has not loaded yet, by full path
+unordered_map<string, PendingImport> pendingImports;
+
+//Set while each module compiled from source should be
+//serialized to find the hash of its interface
+bool hashInterfaces = false;
+
+//Where interfaces of imported modules are cached between builds, if anywhere
+ante::BuildCache *buildCache = nullptr;
 
 
 namespace ante {
@@ -36,7 +70,7 @@ namespace ante {
         return isGlobal() || tval.type->hasModifier(Tok_Mut);
     }
 
-    TypeArgs convertToTypeArgs(vector<unique_ptr<TypeNode>> const& types, Module *module){
+    TypeArgs convertToTypeArgs(vector<ArenaPtr<TypeNode>> const& types, Module *module){
         TypeArgs ret;
         ret.reserve(types.size());
         for(auto &t : types){
@@ -45,7 +79,7 @@ namespace ante {
         return ret;
     }
 
-    TypeArgs convertToNewTypeArgs(vector<unique_ptr<TypeNode>> const& types, Module *module,
+    TypeArgs convertToNewTypeArgs(vector<ArenaPtr<TypeNode>> const& types, Module *module,
             unordered_map<string, AnTypeVarType*> &mapping){
 
         TypeArgs ret;
@@ -225,6 +259,30 @@ namespace ante {
         return "";
     }
 
+    bool isPreparsed(string const& fullPath){
+        lock_guard<mutex> lock{preparsedModulesMutex};
+        return preparsedModules.count(fullPath);
+    }
+
+    /** Copy the given file name to fileNames, returning a pointer that lives as long as the nodes using it */
+    string* addFileName(string const& fileName){
+        lock_guard<mutex> lock{fileNamesMutex};
+        fileNames.emplace_back(fileName);
+        return &fileNames.back();
+    }
+
+    /** Take the parse tree of the given file if preparseImports parsed it, returns false otherwise */
+    bool takePreparsed(string const& fullPath, unique_ptr<RootNode> &tree){
+        lock_guard<mutex> lock{preparsedModulesMutex};
+        auto preparsed = preparsedModules.find(fullPath);
+        if(preparsed == preparsedModules.end())
+            return false;
+
+        tree = move(preparsed->second);
+        preparsedModules.erase(preparsed);
+        return true;
+    }
+
     /** Return true if the given file has already been imported into the current module. */
     bool alreadyImported(NameResolutionVisitor &v, std::string const& name){
         return std::any_of(v.compUnit->imports.begin(), v.compUnit->imports.end(), [&](Module *mod){
@@ -289,7 +347,7 @@ namespace ante {
         auto decl = m->lookupTraitDecl(tn->typeName);
         if(!decl) return nullptr;
 
-        auto typeArgs = ante::applyToAll(tn->params, [m](unique_ptr<TypeNode> const& tn) -> AnType*{
+        auto typeArgs = ante::applyToAll(tn->params, [m](ArenaPtr<TypeNode> const& tn) -> AnType*{
             return toAnType(tn.get(), m);
         });
 
@@ -530,14 +588,10 @@ namespace ante {
 
     Module *findModule(NameResolutionVisitor *v, string const& name){
         for(Module *m : v->compUnit->imports){
-            auto it = m->findChild(name);
-            if(it != m->childrenEnd())
-                return &it->second;
+            if(Module *child = m->findChild(name))
+                return child;
         }
-
-        Module &root = Module::getRoot();
-        auto it = root.findChild(name);
-        return it != root.childrenEnd() ? &it->second : nullptr;
+        return Module::getRoot().findChild(name);
     }
 
 
@@ -554,11 +608,11 @@ namespace ante {
             if(m == nullptr){
                 m = findModule(v, tn->typeName);
             }else{
-                auto it = m->findChild(tn->typeName);
-                if(it == m->childrenEnd()){
+                Module *child = m->findChild(tn->typeName);
+                if(!child){
                     error("Cannot find module " + lazy_str(tn->typeName, AN_TYPE_COLOR), tn->loc);
                 }
-                m = &it->second;
+                m = child;
             }
 
             rhs = cur->rval.get();
@@ -623,35 +677,102 @@ namespace ante {
     }
 
 
-    template<class StringIt>
-    NameResolutionVisitor visitImport(string const& filename, StringIt path){
-        //The lexer stores the fileName in the loc field of all Nodes. The fileName is copied
-        //to let Node's outlive the context they were made in, ensuring they work with imports.
-        fileNames.emplace_back(filename);
-        setLexer(new Lexer(&fileNames.back()));
-        yy::parser p{};
-        int flag = p.parse();
-        if(flag != PE_OK){ //parsing error, cannot procede
-            //print out remaining errors
-            int tok;
-            yy::location loc;
-            while((tok = yylexer->next(&loc)) != Tok_Newline && tok != 0);
-            while(p.parse() != PE_OK && yylexer->peek() != 0);
+    /**
+     * Load the module of the given visitor from the interface next to its
+     * source at fullPath, or else from the build cache, if there is one
+     * matching the source and the current interface of each of its
+     * imports.  The imports are loaded first.
+     */
+    bool loadInterface(NameResolutionVisitor &v, string const& fullPath){
+        auto *source = SourceManager::getFile(fullPath);
+        if(!source)
+            return false;
+
+        auto interface = ModuleInterface::open(ModuleInterface::getPath(fullPath), source->getContents());
+        vector<string> names;
+        if(interface)
+            names = interface->getImportNames();
+        else if(!buildCache || !buildCache->lookupImports(source->getContents(), names))
+            return false;
+
+        string *fileName = addFileName(fullPath);
+        auto loc = mkLoc(mkPos(fileName, 0, 0), mkPos(fileName, 0, 0));
+
+        Module *m = v.compUnit;
+        for(auto &name : names){
+            if(findFile(name).empty()){
+                m->imports.clear();
+                return false;
+            }
+            v.importFile(name, loc);
+        }
 
-            cerr << "Syntax error, aborting.\n";
-            exit(flag);
+        //The key of a cached interface depends on the interface hashes of the imports
+        if(!interface)
+            interface = buildCache->lookupInterface(m, source->getContents());
+
+        if(!interface || interface->getImportNames() != names || m->imports.size() != names.size()){
+            m->imports.clear();
+            return false;
         }
+
+        auto &hashes = interface->getImportHashes();
+        for(size_t i = 0; i < names.size(); i++){
+            Module *import = m->imports[i];
+            if(import != m && import->interfaceHash != hashes[i]){
+                m->imports.clear();
+                return false;
+            }
+        }
+
+        if(!ModuleInterface::load(move(interface), m, fileName)){
+            m->imports.clear();
+            return false;
+        }
+        unique_ptr<RootNode> unused;
+        takePreparsed(fullPath, unused);
+        return true;
+    }
+
+
+    template<class StringIt>
+    NameResolutionVisitor visitImport(string const& importName, string const& filename, StringIt path){
         string modName = "";
         for(string s : path) modName = s;
 
         //Add this module to the cache first to ensure it is not compiled twice
         NameResolutionVisitor newVisitor{modName};
         newVisitor.compUnit = &Module::getRoot().addPath(path);
-        RootNode *root = parser::getRootNode();
-        root->accept(newVisitor);
+        newVisitor.compUnit->importName = importName;
+
+        if(loadInterface(newVisitor, filename))
+            return newVisitor;
+
+        //The lexer stores the fileName in the loc field of all Nodes. The fileName is copied
+        //to let Node's outlive the context they were made in, ensuring they work with imports.
+        unique_ptr<RootNode> root;
+        if(!takePreparsed(filename, root)){
+            root = parser::parseFile(addFileName(filename));
+        }
+
+        if(!root){ //parsing error, cannot procede
+            cerr << "Syntax error, aborting.\n";
+            exit(EXIT_FAILURE);
+        }
+
+        // The module takes ownership of the parse tree when visited
+        RootNode *ast = root.release();
+        ast->accept(newVisitor);
 
         if (errorCount()) return newVisitor;
-        TypeInferenceVisitor::infer(root, newVisitor.compUnit);
+        TypeInferenceVisitor::infer(ast, newVisitor.compUnit);
+
+        if(hashInterfaces && !errorCount()){
+            string interface;
+            llvm::StringRef source = SourceManager::getFile(filename)->getContents();
+            if(ModuleInterface::write(newVisitor.compUnit, source, interface) && buildCache)
+                buildCache->storeInterface(newVisitor.compUnit, source, interface);
+        }
         return newVisitor;
     }
 
@@ -698,10 +819,8 @@ namespace ante {
         }
         auto modPath = ModulePath(fName);
         Module &root = Module::getRoot();
-        auto it = root.findPath(modPath);
-        if(it != root.childrenEnd()){
+        if(Module *import = root.findPath(modPath)){
             //module already compiled
-            Module *import = &it->getValue();
             for(auto *mod : compUnit->imports){
                 if(mod->name == import->name){
                     error("Module " + lazy_str(import->name, AN_TYPE_COLOR) + " has already been imported", loc, ErrorType::Warning);
@@ -713,11 +832,75 @@ namespace ante {
             compUnit->imports.push_back(import);
         }else{
             //module not found
-            NameResolutionVisitor newVisitor = visitImport(fullPath, modPath);
+            NameResolutionVisitor newVisitor = visitImport(fName, fullPath, modPath);
             compUnit->imports.push_back(newVisitor.compUnit);
         }
     }
 
+    bool importModules(vector<string> const& names, vector<Module*> &modules){
+        NameResolutionVisitor v{""};
+        LOC_TY loc;
+        try{
+            for(auto &name : names){
+                if(findFile(name).empty())
+                    return false;
+                v.importFile(name, loc);
+            }
+        }catch(CtError const&){
+            return false;
+        }
+        if(errorCount())
+            return false;
+
+        modules = v.compUnit->imports;
+        return true;
+    }
+
+    void setBuildCache(BuildCache *cache){
+        buildCache = cache;
+        hashInterfaces = cache != nullptr;
+    }
+
+    bool emitInterface(string const& fileName){
+        string fullPath = findFile(fileName);
+        if(fullPath.empty()){
+            cerr << "No file named '" << fileName << "' was found.\n";
+            return false;
+        }
+
+        //Each import of the module needs an interface hash to be recorded in its interface
+        TMP_SET(hashInterfaces, true);
+        string *fullPathPtr = addFileName(fullPath);
+        auto loc = mkLoc(mkPos(fullPathPtr, 0, 0), mkPos(fullPathPtr, 0, 0));
+        NameResolutionVisitor v{""};
+        try{
+            v.importFile(fileName, loc);
+        }catch(CtError const&){
+            return false;
+        }
+        if(errorCount())
+            return false;
+
+        Module &root = Module::getRoot();
+        Module *m = root.findPath(ModulePath(fileName));
+        //The module was loaded from an interface that is already up to date
+        if(m->interface)
+            return true;
+
+        string interface;
+        if(!ModuleInterface::write(m, SourceManager::getFile(fullPath)->getContents(), interface)){
+            cerr << fullPath << " cannot be stored as an interface.\n";
+            return false;
+        }
+
+        string path = ModuleInterface::getPath(fullPath);
+        if(!writeFile(path, interface)){
+            cerr << "Could not write " << path << "\n";
+            return false;
+        }
+        return true;
+    }
+
     /**
     * Return a copy of the given string with the first character in lowercase.
     */
@@ -764,6 +947,208 @@ namespace ante {
         }
     }
 
+    /**
+     * Return the name and full path of each of the given modules which is not already loaded.
+     * Imports that cannot be found are skipped here and reported by importFile.
+     */
+    vector<pair<string, string>> findUnloadedImports(vector<string> const& imports){
+        vector<pair<string, string>> ret;
+        Module &moduleRoot = Module::getRoot();
+
+        for(auto &fName : imports){
+            string fullPath = findFile(fName);
+            if(!fullPath.empty() && !moduleRoot.findPath(ModulePath(fName))){
+                ret.emplace_back(fName, fullPath);
+            }
+        }
+        return ret;
+    }
+
+    /**
+     * Return the name and full path of each module imported by the given parse
+     * tree, including the implicit prelude import, which is not already loaded.
+     */
+    vector<pair<string, string>> findUnloadedImports(RootNode *root){
+        vector<string> imports{AN_PRELUDE_FILE};
+        for(auto &n : root->imports){
+            if(auto import = dynamic_cast<ImportNode*>(n.get())){
+                imports.push_back(importExprToStr(import->expr.get()));
+            }
+        }
+        return findUnloadedImports(imports);
+    }
+
+    void preparseImports(RootNode *root){
+        mutex m;
+        condition_variable changed;
+        deque<string*> queue;
+        unordered_set<string> seen;
+        size_t busy = 0;
+        exception_ptr failure;
+        pendingImports.clear();
+
+        //m must be held when calling this
+        auto enqueue = [&](vector<pair<string, string>> const& imports){
+            for(auto &import : imports){
+                auto &path = import.second;
+                if(!seen.insert(path).second || isPreparsed(path))
+                    continue;
+
+                pendingImports[path].name = import.first;
+                queue.push_back(addFileName(path));
+            }
+            changed.notify_all();
+        };
+
+        // Each worker takes the next module from the shared queue and queues its
+        // imports once parsed, so no worker waits for the rest of its level.
+        // Workers stop once the queue is empty and no module is being parsed.
+        auto worker = [&]{
+            unique_lock<mutex> lock{m};
+            while(true){
+                changed.wait(lock, [&]{ return !queue.empty() || busy == 0 || failure; });
+                if(queue.empty() || failure)
+                    return;
+
+                string *path = queue.front();
+                queue.pop_front();
+                busy++;
+                lock.unlock();
+
+                unique_ptr<RootNode> tree;
+                vector<pair<string, string>> imports;
+                bool hasInterface = false;
+                exception_ptr err;
+                try{
+                    //A module with an up to date interface is loaded from it instead of being parsed
+                    auto *source = SourceManager::getFile(*path);
+                    auto interface = source ? ModuleInterface::open(ModuleInterface::getPath(*path), source->getContents()) : nullptr;
+                    if(interface){
+                        hasInterface = true;
+                        imports = findUnloadedImports(interface->getImportNames());
+                    }else{
+                        tree = parser::parseFile(path);
+                        if(tree) imports = findUnloadedImports(tree.get());
+                    }
+                }catch(...){
+                    err = current_exception();
+                }
+
+                if(!hasInterface){
+                    lock_guard<mutex> preparsedLock{preparsedModulesMutex};
+                    preparsedModules[*path] = move(tree);
+                }
+
+                lock.lock();
+                for(auto &import : imports)
+                    pendingImports[*path].imports.insert(import.second);
+                busy--;
+                if(err && !failure)
+                    failure = err;
+                enqueue(imports);
+            }
+        };
+
+        enqueue(findUnloadedImports(root));
+        if(queue.empty())
+            return;
+
+        size_t threadCount = std::max(1u, thread::hardware_concurrency());
+        vector<thread> workers;
+        for(size_t i = 0; i < threadCount; i++){
+            workers.emplace_back(worker);
+        }
+        for(auto &w : workers){
+            w.join();
+        }
+
+        if(failure)
+            rethrow_exception(failure);
+    }
+
+    void resolveImports(){
+        unordered_map<string, PendingImport> pending;
+        swap(pending, pendingImports);
+
+        // A module is ready once each of its imports found by preparseImports is loaded.
+        // Modules in an import cycle are never ready and are left for importFile.
+        unordered_map<string, size_t> waitingOn;
+        unordered_map<string, vector<string>> dependents;
+        deque<string> ready;
+        for(auto &module : pending){
+            size_t count = 0;
+            for(auto &import : module.second.imports){
+                if(import != module.first && pending.count(import)){
+                    dependents[import].push_back(module.first);
+                    count++;
+                }
+            }
+            waitingOn[module.first] = count;
+            if(count == 0)
+                ready.push_back(module.first);
+        }
+
+        mutex m;
+        condition_variable changed;
+        size_t busy = 0;
+        exception_ptr failure;
+
+        auto worker = [&]{
+            unique_lock<mutex> lock{m};
+            while(true){
+                changed.wait(lock, [&]{ return !ready.empty() || busy == 0 || failure; });
+                if(ready.empty() || failure)
+                    return;
+
+                string path = ready.front();
+                ready.pop_front();
+                busy++;
+                lock.unlock();
+
+                exception_ptr err;
+                try{
+                    string *fileName = addFileName(path);
+                    auto loc = mkLoc(mkPos(fileName, 0, 0), mkPos(fileName, 0, 0));
+                    NameResolutionVisitor v{""};
+                    v.importFile(pending.at(path).name, loc);
+                }catch(CtError const&){
+                    //Already reported, the module is left as a serial import would leave it
+                }catch(...){
+                    err = current_exception();
+                }
+
+                lock.lock();
+                busy--;
+                if(err && !failure)
+                    failure = err;
+
+                auto it = dependents.find(path);
+                if(it != dependents.end()){
+                    for(auto &dependent : it->second){
+                        if(--waitingOn[dependent] == 0)
+                            ready.push_back(dependent);
+                    }
+                }
+                changed.notify_all();
+            }
+        };
+
+        if(ready.empty())
+            return;
+
+        size_t threadCount = std::min<size_t>(std::max(1u, thread::hardware_concurrency()), pending.size());
+        vector<thread> workers;
+        for(size_t i = 0; i < threadCount; i++){
+            workers.emplace_back(worker);
+        }
+        for(auto &w : workers){
+            w.join();
+        }
+
+        if(failure)
+            rethrow_exception(failure);
+    }
+
     void NameResolutionVisitor::visit(ImportNode *n){
         //TODO: handle name resolution for custom overloads of import
         std::string path = importExprToStr(n->expr.get());
@@ -830,7 +1215,7 @@ namespace ante {
         if(n->typeExpr){
             string name = typeNodeToStr(n->typeExpr.get());
             NameResolutionVisitor submodule{name};
-            submodule.compUnit = &compUnit->findChild(name)->second;
+            submodule.compUnit = compUnit->findChild(name);
             assert(submodule.compUnit && ("Could not find submodule " + name).c_str());
 
             for(Node &m : *n->methods)
@@ -842,7 +1227,7 @@ namespace ante {
                 TRY_TO(m.accept(*this));
 
             string traitName = n->trait->typeName;
-            auto args = ante::applyToAll(n->trait->params, [this](unique_ptr<TypeNode> const& param){
+            auto args = ante::applyToAll(n->trait->params, [this](ArenaPtr<TypeNode> const& param){
                 return toAnType(param.get(), this->compUnit);
             });
 
@@ -853,7 +1238,7 @@ namespace ante {
 
             auto impl = new TraitImpl(decl, args);
             impl->impl = n;
-            compUnit->traitImpls[traitName].push_back(impl);
+            compUnit->addTraitImpl(impl);
         }
     }
 
@@ -956,12 +1341,25 @@ namespace ante {
     }
 
 
+    /** Returns true if the declaration is preceded by the compiler directive ![name] */
+    bool hasDirective(DataDeclNode *n, string const& name){
+        for(auto &mod : n->modifiers){
+            if(mod->isCompilerDirective()){
+                auto *vn = dynamic_cast<VarNode*>(mod->directive.get());
+                if(vn && vn->name == name)
+                    return true;
+            }
+        }
+        return false;
+    }
+
     void NameResolutionVisitor::visitUnionDecl(parser::DataDeclNode *decl){
         auto generics = convertToTypeArgs(decl->generics, compUnit);
-        auto data = AnDataType::get(decl->name, generics, nullptr);
-        TypeDecl &typeDecl = define(decl->name, data, decl->loc);
+        TypeDecl &typeDecl = define(decl->name, nullptr, decl->loc);
+        auto data = AnDataType::get(decl->name, generics, &typeDecl);
+        typeDecl.type = data;
         typeDecl.isUnionType = true;
-        data->decl = &typeDecl;
+        typeDecl.isNonNull = hasDirective(decl, "nonnull");
 
         for(Node& child : *decl->child){
             auto nvn = static_cast<NamedValNode*>(&child);
@@ -999,9 +1397,10 @@ namespace ante {
         auto *nvn = (NamedValNode*)n->child.get();
         assert(nvn);
 
-        auto data = AnDataType::get(n->name, convertToTypeArgs(n->generics, compUnit), nullptr);
-        TypeDecl &typeDecl = define(n->name, data, n->loc);
-        data->decl = &typeDecl;
+        TypeDecl &typeDecl = define(n->name, nullptr, n->loc);
+        auto data = AnDataType::get(n->name, convertToTypeArgs(n->generics, compUnit), &typeDecl);
+        typeDecl.type = data;
+        typeDecl.isReprC = hasDirective(n, "repr_c");
         // typeDecl->isAlias = n->isAlias;
 
         while(nvn){
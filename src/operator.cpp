@@ -1,5 +1,3 @@
-#include <llvm/ExecutionEngine/Orc/LLJIT.h>
-#include <llvm/Transforms/Utils/Cloning.h>
 #include "unification.h"
 #include "scopeguard.h"
 #include "antevalue.h"
@@ -152,13 +150,14 @@ vector<AnType*> toTuple(AnType *ty){
  *  For example, given the definition type T = U and a variable u: U
  *  the cast T u will be managed by this function with from = u and to = T
  */
-TypedValue reinterpretTuple(Compiler *c, vector<TypedValue> const& args, AnType *to){
+TypedValue reinterpretTuple(Compiler *c, vector<TypedValue> const& args, AnDataType *to){
     auto *structTy = c->anTypeToLlvmType(to);
     Value *rstruct = UndefValue::get(structTy);
 
-    auto nElems = rstruct->getType()->getStructNumElements();
-    for(size_t i = 0; i < nElems; i++){
-        rstruct = c->builder.CreateInsertValue(rstruct, args[i].val, i);
+    //fields may be stored in a different order than they are declared
+    auto &indices = to->decl->getFieldIndices(c, to);
+    for(size_t i = 0; i < indices.size(); i++){
+        rstruct = c->builder.CreateInsertValue(rstruct, args[i].val, indices[i]);
     }
 
     return TypedValue(rstruct, to);
@@ -329,27 +328,47 @@ Declaration* findFnInImpl(string const& fnName, TraitImpl *impl){
     ASSERT_UNREACHABLE();
 }
 
+AnFunctionType* applyMonomorphisationBindings(AnFunctionType *type, Substitutions const& bindings){
+    return static_cast<AnFunctionType*>(ante::applySubstitutions(bindings, type));
+}
+
 TypedValue monomorphise(Compiler *c, FuncDecl *fd, AnFunctionType *boundType, LOC_TY &loc){
     auto fnTy = try_cast<AnFunctionType>(fd->definition->getType());
 
     //To be monomorphised, the function must be both generic and a definition, ie external
     //decls like printf: (ref c8) ... -> i32  are generic but cannot be monomorphised.
+    fd->loadBody();
     auto isGenericDef = fnTy->isGeneric && static_cast<FuncDeclNode*>(fd->definition)->child;
-    if(isGenericDef){
-        TypeError err{"Error in monomorphisation of " + fd->name + ", types are "
-            + anTypeToColoredStr(fnTy) + " bound to " + anTypeToColoredStr(boundType), loc};
-        auto subs = unify({{fnTy, boundType, err}});
-        c->compCtxt->insertMonomorphisationMappings(subs);
+    if(!isGenericDef){
+        auto ret = c->compFn(fd);
+        fd->tval.val = ret.val;
+        return ret;
+    }
+
+    //Only fully concrete instances are cached, any typevars left in the key
+    //could be bound differently by a later call site.  isGeneric is not enough
+    //to check this since it is false for types containing eg. Vec 'a
+    boundType = applyMonomorphisationBindings(boundType, c->compCtxt->monomorphisationMappings);
+    auto *instanceKey = static_cast<AnFunctionType*>(bindTypeVars(c, boundType));
+    bool cacheable = !containsTypeVar(instanceKey);
+    if(cacheable){
+        auto it = fd->instances.find(instanceKey);
+        if(it != fd->instances.end())
+            return it->second;
     }
+
+    TypeError err{"Error in monomorphisation of " + fd->name + ", types are "
+        + anTypeToColoredStr(fnTy) + " bound to " + anTypeToColoredStr(boundType), loc};
+    auto subs = unify({{fnTy, boundType, err}});
+    c->compCtxt->insertMonomorphisationMappings(subs);
+
     auto ret = c->compFn(fd);
-    fd->tval.val = isGenericDef ? nullptr : ret.val;
+    fd->tval.val = nullptr;
+    if(cacheable)
+        fd->instances[instanceKey] = ret;
     return ret;
 }
 
-AnFunctionType* applyMonomorphisationBindings(AnFunctionType *type, Substitutions const& bindings){
-    return static_cast<AnFunctionType*>(ante::applySubstitutions(bindings, type));
-}
-
 TypedValue compForLoopTraitFn(Compiler *c, string const& fnName, TraitImpl *impl, AnType *argTy, LOC_TY &loc){
     FuncDecl *fn = static_cast<FuncDecl*>(findFnInImpl(fnName, impl));
 
@@ -674,7 +693,7 @@ TypedValue Compiler::compMemberAccess(Node *ln, VarNode *field, BinOpNode *binop
 
     //check to see if this is a field index
     if(auto *dataTy = try_cast<AnDataType>(tyn)){
-        auto index = dataTy->decl->getFieldIndex(field->name);
+        auto index = dataTy->decl->getFieldIndex(this, dataTy, field->name);
         auto ev = builder.CreateExtractValue(val, index);
         return {ev, binop->getType()};
     }
@@ -778,11 +797,11 @@ TypedValue createMallocAndStore(Compiler *c, TypedValue &val){
  * Unwrap the single i8* argument given to AnteCall into a vector of each value the
  * function it should call requires.
  */
-vector<Value*> unwrapVoidPtrArgs(Compiler *c, Value *anteCallArg, vector<TypedValue> const& typedArgs, FuncDecl *fd){
+vector<Value*> unwrapVoidPtrArgs(Compiler *c, Value *anteCallArg, vector<TypedValue> const& typedArgs, Function *f){
     vector<Value*> ret;
-    bool varargs = cast<Function>(fd->tval.val)->isVarArg();
+    bool varargs = f->isVarArg();
 
-    auto *fnTy = cast<Function>(fd->tval.val)->getFunctionType();
+    auto *fnTy = f->getFunctionType();
     if(fnTy->getNumParams() == 0 && !varargs) return ret;
 
     size_t argc = fnTy->getNumParams();
@@ -802,40 +821,49 @@ vector<Value*> unwrapVoidPtrArgs(Compiler *c, Value *anteCallArg, vector<TypedVa
 }
 
 
+/**
+ * Return the result of the call made by an AnteCall driver, copied to
+ * the heap so it outlives the driver.  Unit results are returned as null.
+ */
+void createDriverReturn(Compiler *c, Value *call, AnType *retTy){
+    Type *voidPtrTy = Type::getInt8Ty(*c->ctxt)->getPointerTo();
+
+    if(retTy->typeTag == TT_Unit){
+        c->builder.CreateRet(ConstantPointerNull::get(cast<PointerType>(voidPtrTy)));
+    }else{
+        auto callTv = TypedValue(call, retTy);
+
+        auto store = createMallocAndStore(c, callTv);
+        auto ret = c->builder.CreateBitCast(store.val, voidPtrTy);
+        c->builder.CreateRet(ret);
+    }
+}
+
+
 /**
  * Creates a function AnteCall that unpacks the given arguments from a void*,
- * and returns the result of a call to the given FuncDecl with those arguments.
+ * and returns the result of a call to f with those arguments.
  *
- * AnteCall has the type 't*->'u* where 't is a tuple of fd's parameter types (to
- * be unpacked within AnteCall) and 'u is the return type of fd.
+ * AnteCall has the type 't*->'u* where 't is a tuple of f's parameter types (to
+ * be unpacked within AnteCall) and 'u is the return type of f.
  */
-void createDriverFunction(Compiler *c, FuncDecl *fd, vector<TypedValue> const& typedArgs){
+Function* createDriverFunction(Compiler *c, Function *f, AnType *retTy, vector<TypedValue> const& typedArgs){
     Type *voidPtrTy = Type::getInt8Ty(*c->ctxt)->getPointerTo();
     FunctionType *fnTy = FunctionType::get(voidPtrTy, voidPtrTy, false);
 
-    //preFn is the predecessor to fn because we do not yet know its return type, so its body must be compiled,
-    //then the type must be checked and the new function with correct return type created, and their bodies swapped.
     Function *fn = Function::Create(fnTy, Function::ExternalLinkage, "AnteCall", c->module.get());
     BasicBlock *entry = BasicBlock::Create(*c->ctxt, "entry", fn);
     c->builder.SetInsertPoint(entry);
 
     auto *fnArg1 = fn->arg_begin();
-    auto args = unwrapVoidPtrArgs(c, fnArg1, typedArgs, fd);
+    auto args = unwrapVoidPtrArgs(c, fnArg1, typedArgs, f);
 
-    Value *call = c->builder.CreateCall(fd->tval.val, args);
-    AnType *retTy = fd->tval.type->getFunctionReturnType();
-    if(retTy->typeTag == TT_Unit){
-        c->builder.CreateRetVoid();
-    }else{
-        auto callTv = TypedValue(call, fd->tval.type->getFunctionReturnType());
-
-        auto store = createMallocAndStore(c, callTv);
-        auto ret = c->builder.CreateBitCast(store.val, voidPtrTy);
-        c->builder.CreateRet(ret);
-    }
+    Value *call = c->builder.CreateCall(f, args);
+    createDriverReturn(c, call, retTy);
+    return fn;
 }
 
-void createDriverFunction(Compiler *c, Function *f, AnType *retTy){
+Function* createDriverFunction(Compiler *c, Function *f, AnType *retTy){
     if(f->arg_size() != 0){
         cerr << "createDriverFunction(Compiler*, Function*, AnType*) can only be used if the function takes no arguments\n"; 
         exit(1);
@@ -849,16 +877,8 @@ void createDriverFunction(Compiler *c, Function *f, AnType *retTy){
     c->builder.SetInsertPoint(entry);
 
     Value *call = c->builder.CreateCall(f, {});
-
-    if(retTy->typeTag == TT_Unit){
-        c->builder.CreateRetVoid();
-    }else{
-        auto callTv = TypedValue(call, retTy);
-
-        auto store = createMallocAndStore(c, callTv);
-        auto ret = c->builder.CreateBitCast(store.val, voidPtrTy);
-        c->builder.CreateRet(ret);
-    }
+    createDriverReturn(c, call, retTy);
+    return fn;
 }
 
 /**
@@ -955,26 +975,29 @@ pair<Function*, AnType*> compileShellFunction(CompilingVisitor &cv, Function *f,
 }
 
 
-TypedValue callAnteFunction(Compiler *c, Function *main, BasicBlock *originalInsertPoint,
-        vector<TypedValue> const& typedArgs, vector<unique_ptr<Node>> const& argExprs,
-        unique_ptr<orc::LLLazyJIT> &jit, AnType *retTy){
+/**
+ * Call the driver function with the given name, which must have already been
+ * added to the JIT, and translate its result back into a TypedValue.
+ * argData holds the packed arguments of the driver, or is null if it is nullary.
+ *
+ * If key is non-empty the called function is pure and its result is memoized.
+ */
+TypedValue callAnteFunction(Compiler *c, JitSession &jit, string const& driverName,
+        string const& key, AnType *retTy, LOC_TY const& loc, void *argData = nullptr){
 
-    auto symbol = jit->lookup("AnteCall").get().getAddress();
+    auto symbol = jit.lookup(driverName);
 
     if(symbol){
-        void *res;
-        if(typedArgs.empty()){
-            auto fn = (void*(*)())symbol;
-            res = fn();
-        }else{
-            auto fn = (void*(*)(void*))symbol;
-            auto arg = AnteValue(c, typedArgs, argExprs);
-            res = fn(arg.asRawData());
-        }
+        void *res = argData
+            ? ((void*(*)(void*))symbol)(argData)
+            : ((void*(*)())symbol)();
+
+        auto size = retTy->getSizeInBits(c);
+        if(size)
+            c->ctCtxt->resultCache.insert(key, res, size.getVal() / 8);
+
         return AnteValue(res, retTy).asTypedValue(c);
     }else{
-        LOC_TY loc;
-        if(!argExprs.empty()) loc = argExprs[0]->loc;
         error("Could not find entry symbol while JITing ante function", loc);
         return c->getUnitLiteral(); //unreachable
     }
@@ -982,13 +1005,13 @@ TypedValue callAnteFunction(Compiler *c, Function *main, BasicBlock *originalIns
 
 
 template<typename T>
-pair<Function*, AnType*> compileAnonAnteFunction(CompilingVisitor &cv, ModNode *n, T &&cleanup){
+pair<Function*, AnType*> compileAnonAnteFunction(CompilingVisitor &cv, Node *expr, T &&cleanup){
     TMP_SET(cv.c->isJIT, true);
     auto shell = createFunctionShell(cv.c);
     try{
-        auto deps = traceDependenciesOfAnteExpr(cv.c, n->expr.get());
+        auto deps = traceDependenciesOfAnteExpr(cv.c, expr);
         insertDependencies(cv, shell, deps);
-        return compileShellFunction(cv, shell, n->expr.get());
+        return compileShellFunction(cv, shell, expr);
     }catch(...){
         //error tracing dependencies, need to cleanup callstack before unwinding
         cleanup();
@@ -997,102 +1020,96 @@ pair<Function*, AnType*> compileAnonAnteFunction(CompilingVisitor &cv, ModNode *
 }
 
 
-/*
-FuncDecl* compileAnteFunction(Compiler *c, string const& baseName, string const& mangledName,
-        vector<TypedValue> const& typedArgs){
-
-    FuncDecl *ret;
-    TMP_SET(c->isJIT, true);
-    ret = c->getFuncDecl(baseName, mangledName);
-    auto argTys = toTypeVector(typedArgs);
-    compFnWithArgs(c, ret, argTys);
-    return ret;
-}
-
-
-
-TypedValue compileAndCallAnteFunction(Compiler *c, ModNode *n){
+TypedValue compileAndCallAnteFunction(Compiler *c, Node *expr){
     CompilingVisitor cv{c};
-
-    //and will crash llvm if we try to clone it without a ReturnInst
-    auto mainFnName = "main";
-    auto main = c->module->getFunction(mainFnName);
-    if(main){
-        main->removeFromParent();
-    }
-
     auto originalInsertPoint = c->builder.GetInsertBlock();
+    Function *driver = nullptr;
 
     auto cleanup = [&]{
-        if(main)
-            c->module->getFunctionList().push_front(main);
-        if(auto f1 = c->module->getFunction("AnteCall")) f1->eraseFromParent();
+        if(driver) driver->eraseFromParent();
         if(auto f2 = c->module->getFunction("EmptyShell")) f2->eraseFromParent();
         c->builder.SetInsertPoint(originalInsertPoint);
     };
 
     //compile ante function and a driver to run it
-    auto shellAndType = compileAnonAnteFunction(cv, n, cleanup);
-    auto shellName = shellAndType.first->getName();
+    auto shellAndType = compileAnonAnteFunction(cv, expr, cleanup);
+    Function *shell = shellAndType.first;
 
-    createDriverFunction(c, shellAndType.first, shellAndType.second);
+    //must be found before the shell is renamed below so identical expressions share a key
+    auto &cache = c->ctCtxt->resultCache;
+    string fnKey = cache.getFunctionKey(c, shell, "", shellAndType.second);
+    if(auto *cached = cache.lookup(fnKey)){
+        cleanup();
+        shell->eraseFromParent();
+        return AnteValue((void*)cached->data(), shellAndType.second).asTypedValue(c);
+    }
 
-    auto clone = llvm::CloneModule(*c->module.get());
-    auto tsm = orc::ThreadSafeModule(move(clone), std::unique_ptr<LLVMContext>(c->ctxt.get()));
+    driver = createDriverFunction(c, shell, shellAndType.second);
 
-    auto triple = Triple(AN_NATIVE_ARCH, AN_NATIVE_VENDOR, AN_NATIVE_OS);
-    DataLayout dl{clone.get()};
-    orc::JITTargetMachineBuilder b{triple};
+    //Only the functions finished since the last ante expression are given to the JIT.
+    //Unfinished functions such as main are declared until they are complete.
+    JitSession &jit = c->ctCtxt->getJitSession();
+    jit.giveUniqueName(shell);
+    jit.giveUniqueName(driver);
+    string driverName = driver->getName().str();
+    c->ctCtxt->finishedDefinitions.emplace_back(shell);
+    c->ctCtxt->finishedDefinitions.emplace_back(driver);
+    bool added = jit.addNewDefinitions(*c->module, c->ctCtxt->finishedDefinitions);
 
-    auto &jit = orc::LLLazyJIT::Create(b, dl).get();
+    cleanup();
+    shell->eraseFromParent();
 
-    jit->addLazyIRModule(move(tsm)).success();
+    if(!added)
+        error("Could not JIT ante expression", expr->loc);
 
-    cleanup();
-    c->module->getFunction(shellName)->removeFromParent();
-    return callAnteFunction(c, main, originalInsertPoint, {}, {}, jit, shellAndType.second);
+    return callAnteFunction(c, jit, driverName, fnKey, shellAndType.second, expr->loc);
 }
 
-TypedValue compileAndCallAnteFunction(Compiler *c, string const& baseName,
-        string const& mangledName, vector<TypedValue> const& typedArgs,
-        vector<unique_ptr<Node>> const& argExprs){
 
-    //temporarily remove main function since it is unfinished
-    //and will crash llvm if we try to clone it without a ReturnInst
-    auto mainFnName = "main";
-    auto main = c->module->getFunction(mainFnName);
-    if(main){
-        main->removeFromParent();
-    }
+TypedValue compileAndCallAnteFunction(Compiler *c, BinOpNode *call,
+        vector<TypedValue> const& typedArgs, vector<ArenaPtr<Node>> const& argExprs){
 
     auto originalInsertPoint = c->builder.GetInsertBlock();
 
-    //compile ante function and a driver to run it
-    FuncDecl *fd = compileAnteFunction(c, baseName, mangledName, typedArgs);
+    //compile the body of the ante function itself rather than its declaration
+    TypedValue fn;
+    {
+        TMP_SET(c->isJIT, true);
+        fn = getFunction(c, call);
+    }
 
-    createDriverFunction(c, fd, typedArgs);
-    auto *retTy = fd->tval.type->getFunctionReturnType();
+    auto *f = dyn_cast_or_null<Function>(fn.val);
+    if(!f)
+        error("Could not compile ante function", call->loc);
 
-    auto clone = llvm::CloneModule(*c->module);
-    auto tsm = orc::ThreadSafeModule(move(clone), std::unique_ptr<LLVMContext>(c->ctxt.get()));
+    AnType *retTy = bindTypeVars(c, fn.type->getFunctionReturnType());
 
-    auto triple = Triple(AN_NATIVE_ARCH, AN_NATIVE_VENDOR, AN_NATIVE_OS);
-    DataLayout dl{clone.get()};
-    orc::JITTargetMachineBuilder b{triple};
+    //A pure function is only called once for each distinct set of arguments
+    auto &cache = c->ctCtxt->resultCache;
+    AnteValue argData{c, typedArgs, argExprs};
+    string fnKey = cache.getFunctionKey(c, f, f->getName(), retTy);
+    string key = cache.getCallKey(c, fnKey, typedArgs, argData);
+    if(auto *cached = cache.lookup(key)){
+        return AnteValue((void*)cached->data(), retTy).asTypedValue(c);
+    }
 
-    auto &jit = orc::LLLazyJIT::Create(b, dl).get();
+    Function *driver = createDriverFunction(c, f, retTy, typedArgs);
+    c->builder.SetInsertPoint(originalInsertPoint);
 
-    jit->addLazyIRModule(move(tsm)).success();
+    //f and any function it calls are given to the JIT along with the driver
+    JitSession &jit = c->ctCtxt->getJitSession();
+    jit.giveUniqueName(driver);
+    string driverName = driver->getName().str();
+    c->ctCtxt->finishedDefinitions.emplace_back(driver);
+    bool added = jit.addNewDefinitions(*c->module, c->ctCtxt->finishedDefinitions);
+    driver->eraseFromParent();
 
-    if(main){
-        c->module->getFunctionList().push_front(main);
-    }
+    if(!added)
+        error("Could not JIT ante function " + f->getName().str(), call->loc);
 
-    c->module->getFunction("AnteCall")->eraseFromParent();
-    c->builder.SetInsertPoint(originalInsertPoint);
-    return callAnteFunction(c, main, originalInsertPoint, typedArgs, argExprs, jit, retTy);
+    return callAnteFunction(c, jit, driverName, key, retTy, call->loc, argData.asRawData());
 }
-*/
+
 
 /*
  *  Compile a compile-time function/macro which should not return a function call,
@@ -1102,20 +1119,20 @@ TypedValue compileAndCallAnteFunction(Compiler *c, string const& baseName,
  *      to get the parse tree during runtime.
  *
  *  - Assumes arguments are already type-checked
- *
-TypedValue compMetaFunctionResult(Compiler *c, LOC_TY const& loc, string const& baseName,
-        string const& mangledName, vector<TypedValue> const& ta, vector<unique_ptr<Node>> const& argExprs){
+ */
+TypedValue compMetaFunctionResult(Compiler *c, BinOpNode *call,
+        vector<TypedValue> const& ta, vector<ArenaPtr<Node>> const& argExprs){
 
-    capi::CtFunc* fn = capi::lookup(baseName);
+    capi::CtFunc* fn = capi::lookup(call->decl->name);
 
     //fn not found, this is a user-defined ante function
     if(!fn){
-        return compileAndCallAnteFunction(c, baseName, mangledName, ta, argExprs);
+        return compileAndCallAnteFunction(c, call, ta, argExprs);
     }
 
     if(ta.size() != fn->params.size())
         error("Called function was given " + to_string(ta.size()) + " argument"
-            + plural(ta.size()) + " but was declared to take " + to_string(fn->params.size()), loc);
+            + plural(ta.size()) + " but was declared to take " + to_string(fn->params.size()), call->loc);
 
     using A = AnteValue;
 
@@ -1138,10 +1155,9 @@ TypedValue compMetaFunctionResult(Compiler *c, LOC_TY const& loc, string const&
         delete res;
         return ret;
     }else{
-        return c->getVoidLiteral();
+        return c->getUnitLiteral();
     }
 }
-*/
 
 
 bool isUnsizedType(Type *t){
@@ -1224,6 +1240,32 @@ vector<Value*> adaptArgsToCompilerAPIFn(Compiler *c, vector<Value*> &args, vecto
     return ret;
 }
 
+/**
+ * Call a compiler API function from within an ante function being compiled for
+ * the JIT.  Only functions returning unit may be called this way since others
+ * return a TypedValue of the compiler, not a value usable by the ante function.
+ */
+TypedValue callCompilerAPIFn(Compiler *c, capi::CtFunc *fn, BinOpNode *bop,
+        vector<Value*> &args, vector<TypedValue> &typedArgs){
+
+    if(fn->retty->typeTag != TT_Unit)
+        error(bop->decl->name + " cannot be called within an ante function", bop->loc);
+
+    auto apiArgs = adaptArgsToCompilerAPIFn(c, args, typedArgs);
+
+    vector<Type*> paramTys;
+    for(auto *arg : apiArgs)
+        paramTys.push_back(arg->getType());
+
+    Type *voidPtrTy = Type::getInt8Ty(*c->ctxt)->getPointerTo();
+    auto *fnTy = FunctionType::get(voidPtrTy, paramTys, false);
+    auto *addr = c->builder.getIntN(AN_USZ_SIZE, (size_t)fn->fn);
+    auto *fnPtr = c->builder.CreateIntToPtr(addr, fnTy->getPointerTo());
+
+    c->builder.CreateCall(fnTy, fnPtr, apiArgs);
+    return c->getUnitLiteral();
+}
+
 TypedValue handleAnteFn(Compiler *c, BinOpNode *bop, vector<TypedValue> &typedArgs){
     if(bop->decl->name == "sizeof" && typedArgs.size() == 1){
         auto dt = try_cast<AnDataType>(typedArgs[0].type);
@@ -1277,6 +1319,23 @@ TypedValue compFnCall(Compiler *c, BinOpNode *bop){
     auto ctval = handleAnteFn(c, bop, typedArgs);
     if(ctval) return ctval;
 
+    //calls to ante functions are evaluated during compile-time and
+    //replaced with their result rather than compiled into a call
+    if(isCompileTimeFunction(bop->decl)){
+        if(!c->isJIT){
+            vector<ArenaPtr<Node>> argExprs;
+            if(auto *tup = dynamic_cast<TupleNode*>(r)){
+                for(auto &expr : tup->exprs)
+                    argExprs.emplace_back(expr.get());
+            }else if(!typedArgs.empty()){
+                argExprs.emplace_back(r);
+            }
+            return compMetaFunctionResult(c, bop, typedArgs, argExprs);
+        }else if(auto *fn = capi::lookup(bop->decl->name)){
+            return callCompilerAPIFn(c, fn, bop, args, typedArgs);
+        }
+    }
+
     //try to compile the function now that the parameters are compiled.
     TypedValue tvf = getFunction(c, bop);
 
@@ -1323,27 +1382,6 @@ TypedValue compFnCall(Compiler *c, BinOpNode *bop){
         }
     }
 
-    //if tvf is a ante function or similar MetaFunction, then compile it in a separate
-    //module and JIT it instead of creating a call instruction
-    /*if(isCompileTimeFunction(tvf)){
-        if(c->isJIT && tvf.type->typeTag == TT_MetaFunction){
-            args = adaptArgsToCompilerAPIFn(c, args, typedArgs);
-        }else{
-            string baseName = getName(l);
-            auto *fnty = try_cast<AnFunctionType>(tvf.type);
-            string mangledName = mangle(baseName, fnty->extTys);
-            if(auto *tup = dynamic_cast<TupleNode*>(r)){
-                return compMetaFunctionResult(c, l->loc, baseName, mangledName, typedArgs, tup->exprs);
-            }else{
-                vector<unique_ptr<Node>> anteExpr;
-                anteExpr.emplace_back(r);
-                auto res = compMetaFunctionResult(c, l->loc, baseName, mangledName, typedArgs, {anteExpr});
-                anteExpr[0].release();
-                return res;
-            }
-        }
-    }*/
-
     //Create the call to tvf.val, not f as if tvf is a function pointer,
     //passing it as f will fail.
     auto *call = c->builder.CreateCall(tvf.val, args);
@@ -9,7 +9,7 @@ using namespace ante::parser;
 namespace ante {
 
     enum LiteralType {
-        Int, Flt, Str
+        Int, Flt
     };
 
     Function* getCurFunction(Compiler *c){
@@ -26,9 +26,6 @@ namespace ante {
             eq = cv.c->builder.CreateICmpEQ(cv.val.val, valToMatch.val);
         }else if(literalType == Flt){
             eq = cv.c->builder.CreateFCmpOEQ(cv.val.val, valToMatch.val);
-        }else if(literalType == Str){
-            error("TODO: resolve == : Str Str -> bool within patterns", pattern->loc);
-            // eq = cv.c->callFn("==", {cv.val, valToMatch}).val;
         }else{
             ASSERT_UNREACHABLE("Unknown literal pattern in match_literal");
         }
@@ -39,6 +36,105 @@ namespace ante {
         cv.c->builder.SetInsertPoint(jmpOnSuccess);
     }
 
+    /** Returns the type of the matched value if it is the prelude's Str, otherwise null */
+    const AnDataType* getStrType(Compiler *c, TypedValue &valToMatch){
+        auto *dt = try_cast<AnDataType>(valToMatch.type);
+        return dt && dt->decl == c->compUnit->lookupTypeDecl("Str") ? dt : nullptr;
+    }
+
+    /** Extract the named field of a Str, whose index depends on the target's layout */
+    Value* extractStrField(Compiler *c, TypedValue &str, std::string const& field){
+        auto *strTy = getStrType(c, str);
+        assert(strTy);
+        return c->builder.CreateExtractValue(str.val, strTy->decl->getFieldIndex(c, strTy, field));
+    }
+
+    /**
+     * Compare the contents of a Str to a string literal with memcmp,
+     * jumping to jmpOnFail if they differ.  The length of str must
+     * already be known to equal the length of the literal.
+     */
+    void match_strContents(Compiler *c, TypedValue &str, StrLitNode *pattern, BasicBlock *jmpOnFail){
+        auto *i8PtrTy = Type::getInt8PtrTy(*c->ctxt);
+        auto *uszTy = Type::getIntNTy(*c->ctxt, AN_USZ_SIZE);
+        auto memcmp = c->module->getOrInsertFunction("memcmp",
+                FunctionType::get(Type::getInt32Ty(*c->ctxt), {i8PtrTy, i8PtrTy, uszTy}, false));
+
+        auto *cStr = extractStrField(c, str, "cStr");
+        auto *literal = c->builder.CreateGlobalStringPtr(pattern->val, "_strlit");
+        auto *len = ConstantInt::get(uszTy, pattern->val.length());
+
+        auto *cmp = c->builder.CreateCall(memcmp, {cStr, literal, len});
+        auto *eq = c->builder.CreateICmpEQ(cmp, ConstantInt::get(cmp->getType(), 0));
+
+        BasicBlock *jmpOnSuccess = BasicBlock::Create(*c->ctxt, "match", getCurFunction(c));
+        c->builder.CreateCondBr(eq, jmpOnSuccess, jmpOnFail);
+        c->builder.SetInsertPoint(jmpOnSuccess);
+    }
+
+    const uint32_t fnvOffsetBasis = 2166136261u;
+    const uint32_t fnvPrime = 16777619u;
+
+    /** The 32-bit FNV-1a hash of a string literal, matching compStrHash */
+    uint32_t strHash(std::string const& s){
+        uint32_t hash = fnvOffsetBasis;
+        for(char ch : s){
+            hash = (hash ^ (uint8_t)ch) * fnvPrime;
+        }
+        return hash;
+    }
+
+    /**
+     * Emit a loop computing the 32-bit FNV-1a hash of
+     * the len bytes at cStr, matching strHash.
+     */
+    Value* compStrHash(Compiler *c, Value *cStr, Value *len){
+        Function *f = getCurFunction(c);
+        BasicBlock *preheader = c->builder.GetInsertBlock();
+        BasicBlock *cond = BasicBlock::Create(*c->ctxt, "hash_cond", f);
+        BasicBlock *body = BasicBlock::Create(*c->ctxt, "hash", f);
+        BasicBlock *end  = BasicBlock::Create(*c->ctxt, "end_hash", f);
+
+        c->builder.CreateBr(cond);
+        c->builder.SetInsertPoint(cond);
+
+        auto *hashTy = Type::getInt32Ty(*c->ctxt);
+        auto *idx = c->builder.CreatePHI(len->getType(), 2, "idx");
+        auto *hash = c->builder.CreatePHI(hashTy, 2, "hash");
+        idx->addIncoming(ConstantInt::get(len->getType(), 0), preheader);
+        hash->addIncoming(ConstantInt::get(hashTy, fnvOffsetBasis), preheader);
+
+        c->builder.CreateCondBr(c->builder.CreateICmpULT(idx, len), body, end);
+        c->builder.SetInsertPoint(body);
+
+        auto *byte = c->builder.CreateLoad(c->builder.CreateInBoundsGEP(cStr, idx));
+        auto *mixed = c->builder.CreateXor(hash, c->builder.CreateZExt(byte, hashTy));
+        hash->addIncoming(c->builder.CreateMul(mixed, ConstantInt::get(hashTy, fnvPrime)), body);
+        idx->addIncoming(c->builder.CreateAdd(idx, ConstantInt::get(len->getType(), 1), "idx_next", true, true), body);
+        c->builder.CreateBr(cond);
+
+        c->builder.SetInsertPoint(end);
+        return hash;
+    }
+
+    /**
+     * Match a string literal pattern.  The lengths are compared
+     * first so the contents are only compared if they are equal.
+     */
+    void match_str(CompilingVisitor &cv, MatchNode *n, StrLitNode *pattern,
+            BasicBlock *jmpOnFail, TypedValue &valToMatch){
+
+        Compiler *c = cv.c;
+        auto *len = extractStrField(c, valToMatch, "len");
+        auto *lenEq = c->builder.CreateICmpEQ(len, ConstantInt::get(len->getType(), pattern->val.length()));
+
+        BasicBlock *sameLen = BasicBlock::Create(*c->ctxt, "match_len", getCurFunction(c));
+        c->builder.CreateCondBr(lenEq, sameLen, jmpOnFail);
+        c->builder.SetInsertPoint(sameLen);
+
+        match_strContents(c, valToMatch, pattern, jmpOnFail);
+    }
+
     /**
      * Match a catch-all var pattern that binds the
      * matched value to the given identifier
@@ -81,56 +177,93 @@ namespace ante {
         }
     }
 
-    vector<TypedValue> unionDowncast(Compiler *c, TypedValue valToMatch, vector<AnType*> const& variantFieldTypes){
-        auto alloca = addrOf(c, valToMatch);
+    vector<TypedValue> unionDowncast(Compiler *c, TypedValue valToMatch, AnDataType *unionTy, size_t tag){
+        auto *variant = unionTy->getVariantType(tag);
 
-        if(variantFieldTypes.empty()){
+        if(variant->fields.empty()){
             // fast-return for simple enum-type unions, we don't need to bind anything
             return {c->getUnitLiteral()};
+        }else if(unionTy->decl->getNicheVariant(c, unionTy) != -1){
+            //the union is only the value held by its non-empty variant
+            auto fields = vecOf<TypedValue>(variant->fields.size());
+            for(auto *fieldTy : variant->fields){
+                if(isEmptyType(c, fieldTy)){
+                    fields.push_back(c->getUnitLiteral());
+                }else{
+                    auto *payloadTy = c->anTypeToLlvmType(fieldTy);
+                    auto *payload = unionTy->decl->getNichePayload(c, unionTy, valToMatch.val, payloadTy);
+                    fields.emplace_back(payload, fieldTy);
+                }
+            }
+            return fields;
         }else{
-            //bitcast valToMatch* to (tag, fields)*
-            auto tagAndFields = vecOf<AnType*>(variantFieldTypes.size() + 1);
-            tagAndFields.push_back(AnType::getU8());
-            tagAndFields.insert(tagAndFields.end(), variantFieldTypes.begin(), variantFieldTypes.end());
-            auto tagAndFieldsTy = AnTupleType::get(tagAndFields);
+            auto alloca = addrOf(c, valToMatch);
 
-            auto *castTy = c->anTypeToLlvmType(tagAndFieldsTy);
+            //bitcast valToMatch* to (tag, variant)*
+            auto *castTy = unionTy->decl->getVariantLlvmType(c, unionTy, tag);
             auto *cast = c->builder.CreateBitCast(alloca.val, castTy->getPointerTo());
 
-            //extract tag_data from (tag, fields...)*
-            size_t len = castTy->getStructNumElements() - 1;
-            auto fields = vecOf<TypedValue>(len);
-            for(size_t i = 0; i < len; ++i){
-                auto *gep = c->builder.CreateStructGEP(castTy, cast, i + 1);
-                auto *deref = c->builder.CreateLoad(gep);
-                fields.emplace_back(deref, variantFieldTypes[i]);
+            //extract each field of the variant, empty fields are not stored
+            auto fields = vecOf<TypedValue>(variant->fields.size());
+            unsigned int index = 0;
+            for(auto *fieldTy : variant->fields){
+                if(isEmptyType(c, fieldTy)){
+                    fields.push_back(c->getUnitLiteral());
+                }else{
+                    auto *gep = c->builder.CreateStructGEP(castTy, cast, 1);
+                    gep = c->builder.CreateStructGEP(castTy->getElementType(1), gep, index++);
+                    fields.emplace_back(c->builder.CreateLoad(gep), fieldTy);
+                }
             }
 
             return fields;
         }
     }
 
+    /**
+     * Bind the fields of a union value already known to be the given variant
+     * @param bindExpr The patterns to match each field against, eg. x in Some x
+     */
+    void bind_variant(CompilingVisitor &cv, MatchNode *n, AnDataType *parentTy, size_t tag,
+            vector<ArenaPtr<Node>> const& bindExpr, BasicBlock *jmpOnFail, TypedValue &valToMatch){
+
+        if(bindExpr.empty())
+            return;
+
+        vector<TypedValue> variantArgs;
+        if(valToMatch.getType()->isStructTy()){
+            variantArgs = unionDowncast(cv.c, valToMatch, parentTy, tag);
+        }else if(valToMatch.getType()->isIntegerTy()){ //integer tag
+            variantArgs = {cv.c->getUnitLiteral()};
+        }else{
+            //all tagged unions are either just their tag (enum) or a tag and value.
+            ASSERT_UNREACHABLE("Unknown variant in bind_variant");
+        }
+        for(size_t i = 0; i < bindExpr.size(); ++i){
+            handlePattern(cv, n, bindExpr[i].get(), jmpOnFail, variantArgs[i]);
+        }
+    }
+
     /**
      * Match a union variant pattern, eg. Some x or None
      * @param pattern The type to match against, eg. Some
      * @param bindExpr The optional expr to bind params to, eg. x
      */
     void match_variant(CompilingVisitor &cv, MatchNode *n, TypeNode *pattern,
-            vector<unique_ptr<Node>> const& bindExpr, BasicBlock *jmpOnFail, TypedValue &valToMatch){
+            vector<ArenaPtr<Node>> const& bindExpr, BasicBlock *jmpOnFail, TypedValue &valToMatch){
 
         Compiler *c = cv.c;
 
         // TODO: Fix with new type information
         auto *parentTy = static_cast<AnDataType*>(pattern->getType()); //wrong
 
-        ConstantInt *ci = ConstantInt::get(*c->ctxt,
-                APInt(8, parentTy->decl->getTagIndex(pattern->typeName), true));
+        auto tag = parentTy->decl->getTagIndex(pattern->typeName);
+        ConstantInt *ci = ConstantInt::get(*c->ctxt, APInt(8, tag, true));
 
         //Extract tag value and check for equality
         Value *eq;
         if(valToMatch.getType()->isStructTy()){
-            Value *tagVal = c->builder.CreateExtractValue(valToMatch.val, 0);
-            eq = c->builder.CreateICmpEQ(tagVal, ci);
+            eq = parentTy->decl->isVariant(c, parentTy, valToMatch.val, tag);
         }else if(valToMatch.getType()->isIntegerTy()){
             eq = c->builder.CreateICmpEQ(valToMatch.val, ci);
         }else{
@@ -143,21 +276,7 @@ namespace ante {
         c->builder.SetInsertPoint(jmpOnSuccess);
 
         //bind any identifiers and match remaining pattern
-        if(!bindExpr.empty()){
-            vector<TypedValue> variantArgs;
-            if(valToMatch.getType()->isStructTy()){
-                auto variantFieldTypes = parentTy->getBoundFieldTypes();
-                variantArgs = unionDowncast(c, valToMatch, variantFieldTypes);
-            }else if(valToMatch.getType()->isIntegerTy()){ //integer tag
-                variantArgs = {c->getUnitLiteral()};
-            }else{
-                //all tagged unions are either just their tag (enum) or a tag and value.
-                ASSERT_UNREACHABLE("Unknown variant in match_variant");
-            }
-            for(size_t i = 0; i < bindExpr.size(); ++i){
-                handlePattern(cv, n, bindExpr[i].get(), jmpOnFail, variantArgs[i]);
-            }
-        }
+        bind_variant(cv, n, parentTy, tag, bindExpr, jmpOnFail, valToMatch);
     }
 
     void handlePattern(CompilingVisitor &cv, MatchNode *n, Node *pattern,
@@ -181,8 +300,8 @@ namespace ante {
         }else if(dynamic_cast<FltLitNode*>(pattern)){
             match_literal(cv, n, pattern, jmpOnFail, valToMatch, Flt);
 
-        }else if(dynamic_cast<StrLitNode*>(pattern)){
-            match_literal(cv, n, pattern, jmpOnFail, valToMatch, Str);
+        }else if(StrLitNode *sn = dynamic_cast<StrLitNode*>(pattern)){
+            match_str(cv, n, sn, jmpOnFail, valToMatch);
 
         }else{
             error("Unknown pattern", pattern->loc);
@@ -190,28 +309,128 @@ namespace ante {
     }
 
 
-    void CompilingVisitor::visit(MatchNode *n){
-        n->expr->accept(*this);
-        auto valToMatch = this->val;
+    /** The part of a pattern that a match can switch on */
+    enum class PatternHead {
+        Any, Variant, Int, Str, Other
+    };
 
-        Function *f = c->builder.GetInsertBlock()->getParent();
+    PatternHead getPatternHead(Node *pattern){
+        if(dynamic_cast<TypeCastNode*>(pattern) || dynamic_cast<TypeNode*>(pattern))
+            return PatternHead::Variant;
+        if(dynamic_cast<VarNode*>(pattern))
+            return PatternHead::Any;
+        if(dynamic_cast<IntLitNode*>(pattern))
+            return PatternHead::Int;
+        if(dynamic_cast<StrLitNode*>(pattern))
+            return PatternHead::Str;
+        return PatternHead::Other;
+    }
 
-        vector<pair<BasicBlock*,TypedValue>> merges;
-        merges.reserve(n->branches.size());
+    /**
+     * Returns the head shared by every pattern of the match that is not a
+     * catch-all, or PatternHead::Other if its branches cannot share a switch.
+     */
+    PatternHead getSwitchHead(Compiler *c, MatchNode *n, TypedValue &valToMatch){
+        PatternHead kind = PatternHead::Any;
+        for(auto &mbn : n->branches){
+            PatternHead head = getPatternHead(mbn->pattern.get());
+            if(head == PatternHead::Any)
+                continue;
+
+            if(head == PatternHead::Other || (kind != PatternHead::Any && kind != head))
+                return PatternHead::Other;
+            kind = head;
+        }
 
-        BasicBlock *endmatch = BasicBlock::Create(*c->ctxt, "end_match", f);
+        Type *ty = valToMatch.getType();
+        if(kind == PatternHead::Any
+                || (kind == PatternHead::Int && !ty->isIntegerTy())
+                || (kind == PatternHead::Str && !getStrType(c, valToMatch))
+                || (kind == PatternHead::Variant && !ty->isStructTy() && !ty->isIntegerTy()))
+            return PatternHead::Other;
+        return kind;
+    }
+
+    /**
+     * Returns the value a match switches on: the tag of a union,
+     * the value of an integer, or the length of a string.
+     */
+    Value* getSwitchValue(Compiler *c, MatchNode *n, PatternHead kind, TypedValue &valToMatch){
+        if(kind == PatternHead::Str)
+            return extractStrField(c, valToMatch, "len");
+
+        if(kind == PatternHead::Variant && valToMatch.getType()->isStructTy()){
+            for(auto &mbn : n->branches){
+                Node *pattern = mbn->pattern.get();
+                if(auto *tcn = dynamic_cast<TypeCastNode*>(pattern))
+                    pattern = tcn->typeExpr.get();
+
+                if(auto *tn = dynamic_cast<TypeNode*>(pattern)){
+                    auto *parentTy = static_cast<AnDataType*>(tn->getType());
+                    return parentTy->decl->getTag(c, parentTy, valToMatch.val);
+                }
+            }
+        }
+        return valToMatch.val;
+    }
+
+    /** Returns the case of the match's switch that the given pattern can match */
+    ConstantInt* getSwitchCase(CompilingVisitor &cv, Node *pattern, IntegerType *switchTy){
+        if(auto *tcn = dynamic_cast<TypeCastNode*>(pattern))
+            pattern = tcn->typeExpr.get();
+
+        if(auto *tn = dynamic_cast<TypeNode*>(pattern)){
+            auto *parentTy = static_cast<AnDataType*>(tn->getType());
+            return ConstantInt::get(switchTy, parentTy->decl->getTagIndex(tn->typeName));
+
+        }else if(auto *sn = dynamic_cast<StrLitNode*>(pattern)){
+            return ConstantInt::get(switchTy, sn->val.length());
+        }
+
+        pattern->accept(cv);
+        auto &value = cast<ConstantInt>(cv.val.val)->getValue();
+        return ConstantInt::get(*cv.c->ctxt, value.sextOrTrunc(switchTy->getBitWidth()));
+    }
+
+    /** Match the rest of a pattern whose head has already been matched by a switch */
+    void match_afterSwitch(CompilingVisitor &cv, MatchNode *n, Node *pattern,
+            BasicBlock *jmpOnFail, TypedValue &valToMatch){
+
+        if(TypeCastNode *tcn = dynamic_cast<TypeCastNode*>(pattern)){
+            auto *parentTy = static_cast<AnDataType*>(tcn->typeExpr->getType());
+            auto tag = parentTy->decl->getTagIndex(tcn->typeExpr->typeName);
+            bind_variant(cv, n, parentTy, tag, tcn->args, jmpOnFail, valToMatch);
+
+        }else if(StrLitNode *sn = dynamic_cast<StrLitNode*>(pattern)){
+            match_strContents(cv.c, valToMatch, sn, jmpOnFail);
+
+        }else if(VarNode *vn = dynamic_cast<VarNode*>(pattern)){
+            match_var(cv, n, vn, jmpOnFail, valToMatch);
+        }
+        //variants without fields and integer literals are fully matched by the switch
+    }
+
+    /**
+     * Compile a match by testing each branch's pattern in order,
+     * jumping to the next branch when one fails to match.
+     */
+    void compLinearMatch(CompilingVisitor &cv, MatchNode *n, TypedValue &valToMatch,
+            vector<pair<BasicBlock*,TypedValue>> &merges, BasicBlock *endmatch){
+
+        Compiler *c = cv.c;
+        Function *f = getCurFunction(c);
         BasicBlock *finalEndPat = nullptr;
 
         for(auto& mbn : n->branches){
             BasicBlock *endpat = &mbn == &n->branches.back() ?
                 endmatch : BasicBlock::Create(*c->ctxt, "end_pattern", f);
 
-            handlePattern(*this, n, mbn->pattern.get(), endpat, valToMatch);
-            mbn->branch->accept(*this);
-            merges.push_back({c->builder.GetInsertBlock(), this->val});
+            handlePattern(cv, n, mbn->pattern.get(), endpat, valToMatch);
+            mbn->branch->accept(cv);
+            merges.push_back({c->builder.GetInsertBlock(), cv.val});
 
             //dont jump to after the match if the branch already returned from the function
-            if(!dyn_cast<ReturnInst>(this->val.val))
+            if(!dyn_cast<ReturnInst>(cv.val.val))
                 c->builder.CreateBr(endmatch);
 
             c->builder.SetInsertPoint(endpat); //set insert point to next branch
@@ -221,9 +440,128 @@ namespace ante {
         // Cannot prove to LLVM match is exhaustive so an uninitialized value must be
         // "returned" each time from the branch where all matches fail.
         if(finalEndPat){
-            TypedValue retOnFailAll = {UndefValue::get(this->val.getType()), val.type};
+            TypedValue retOnFailAll = {UndefValue::get(cv.val.getType()), cv.val.type};
             merges.push_back({finalEndPat, retOnFailAll});
         }
+    }
+
+    /**
+     * Compile a match whose patterns all switch on the same part of the matched
+     * value.  Rather than testing each branch in turn, a single switch jumps
+     * to the first branch that can match the value's tag, integer value, or
+     * string length.  If the rest of that branch's pattern fails to match it
+     * jumps straight to the next branch with the same case or a catch-all,
+     * so no test is repeated.
+     *
+     * When several different string literals share a length, that length's
+     * case switches again on a hash of the string's contents so only the
+     * literals with a matching hash are compared with memcmp.
+     */
+    void compSwitchMatch(CompilingVisitor &cv, MatchNode *n, TypedValue &valToMatch, PatternHead kind,
+            vector<pair<BasicBlock*,TypedValue>> &merges, BasicBlock *endmatch){
+
+        Compiler *c = cv.c;
+        Function *f = getCurFunction(c);
+
+        Value *switchVal = getSwitchValue(c, n, kind, valToMatch);
+        auto *switchTy = cast<IntegerType>(switchVal->getType());
+
+        size_t branchCount = n->branches.size();
+        auto branchBlocks = vecOf<BasicBlock*>(branchCount);
+        auto cases = vecOf<ConstantInt*>(branchCount); //null for catch-all patterns
+
+        for(auto &mbn : n->branches){
+            branchBlocks.push_back(BasicBlock::Create(*c->ctxt, "match_branch", f));
+            cases.push_back(getPatternHead(mbn->pattern.get()) == PatternHead::Any
+                    ? nullptr : getSwitchCase(cv, mbn->pattern.get(), switchTy));
+        }
+
+        //hash of each string literal whose length is shared with a different literal, otherwise null
+        auto hashes = vecOf<ConstantInt*>(branchCount);
+        auto *hashTy = Type::getInt32Ty(*c->ctxt);
+        for(size_t i = 0; i < branchCount; i++){
+            auto *sn = dynamic_cast<StrLitNode*>(n->branches[i]->pattern.get());
+            bool sharesLength = sn && ante::any(n->branches, [&](auto &other){
+                auto *otherSn = dynamic_cast<StrLitNode*>(other->pattern.get());
+                return otherSn && otherSn->val.length() == sn->val.length() && otherSn->val != sn->val;
+            });
+            hashes.push_back(sharesLength ? ConstantInt::get(hashTy, strHash(sn->val)) : nullptr);
+        }
+
+        BasicBlock *noMatch = BasicBlock::Create(*c->ctxt, "no_match", f);
+
+        //find the first branch from start onward that can match values of the given case and hash
+        auto nextBranch = [&](size_t start, ConstantInt *switchCase, ConstantInt *hash){
+            for(size_t i = start; i < branchCount; i++){
+                if(!cases[i] || (cases[i] == switchCase && (!hash || hashes[i] == hash)))
+                    return branchBlocks[i];
+            }
+            return noMatch;
+        };
+
+        //each case starts at the first branch that can match it, which may be an earlier catch-all
+        auto *sw = c->builder.CreateSwitch(switchVal, nextBranch(0, nullptr, nullptr), branchCount);
+        for(size_t i = 0; i < branchCount; i++){
+            if(!cases[i] || sw->findCaseValue(cases[i]) != sw->case_default())
+                continue;
+
+            if(!hashes[i]){
+                sw->addCase(cases[i], nextBranch(0, cases[i], nullptr));
+                continue;
+            }
+
+            //switch on the hash of the contents, any other hash can only match a catch-all
+            BasicBlock *hashBlock = BasicBlock::Create(*c->ctxt, "match_hash", f);
+            sw->addCase(cases[i], hashBlock);
+            c->builder.SetInsertPoint(hashBlock);
+
+            auto *hash = compStrHash(c, extractStrField(c, valToMatch, "cStr"), switchVal);
+            auto *hashSw = c->builder.CreateSwitch(hash, nextBranch(0, nullptr, nullptr));
+            for(size_t j = i; j < branchCount; j++){
+                if(cases[j] == cases[i] && hashSw->findCaseValue(hashes[j]) == hashSw->case_default())
+                    hashSw->addCase(hashes[j], nextBranch(0, cases[i], hashes[j]));
+            }
+        }
+
+        for(size_t i = 0; i < branchCount; i++){
+            auto &mbn = n->branches[i];
+            c->builder.SetInsertPoint(branchBlocks[i]);
+
+            match_afterSwitch(cv, n, mbn->pattern.get(), nextBranch(i + 1, cases[i], hashes[i]), valToMatch);
+            mbn->branch->accept(cv);
+            merges.push_back({c->builder.GetInsertBlock(), cv.val});
+
+            //dont jump to after the match if the branch already returned from the function
+            if(!dyn_cast<ReturnInst>(cv.val.val))
+                c->builder.CreateBr(endmatch);
+        }
+
+        c->builder.SetInsertPoint(noMatch);
+        TypedValue retOnFailAll = {UndefValue::get(cv.val.getType()), cv.val.type};
+        merges.push_back({noMatch, retOnFailAll});
+        c->builder.CreateBr(endmatch);
+
+        c->builder.SetInsertPoint(endmatch);
+    }
+
+
+    void CompilingVisitor::visit(MatchNode *n){
+        n->expr->accept(*this);
+        auto valToMatch = this->val;
+
+        Function *f = c->builder.GetInsertBlock()->getParent();
+
+        vector<pair<BasicBlock*,TypedValue>> merges;
+        merges.reserve(n->branches.size() + 1);
+
+        BasicBlock *endmatch = BasicBlock::Create(*c->ctxt, "end_match", f);
+
+        PatternHead kind = getSwitchHead(c, n, valToMatch);
+        if(kind == PatternHead::Other){
+            compLinearMatch(*this, n, valToMatch, merges, endmatch);
+        }else{
+            compSwitchMatch(*this, n, valToMatch, kind, merges, endmatch);
+        }
 
         //merges can be empty if each branch has an early return
         if(merges.empty() or merges[0].second.type->typeTag == TT_Unit){
@@ -231,16 +569,13 @@ namespace ante {
             return;
         }
 
-        int i = 1;
-        auto *phi = c->builder.CreatePHI(merges[0].second.getType(), n->branches.size());
+        auto *phi = c->builder.CreatePHI(merges[0].second.getType(), merges.size());
         for(auto &pair : merges){
             //add each branch to the phi node if it does not return early
             if(!dyn_cast<ReturnInst>(pair.second.val)){
                 phi->addIncoming(pair.second.val, pair.first);
             }
-            i++;
         }
-        //phi->addIncoming(UndefValue::get(merges[0].second.getType()), matchbb);
         this->val = TypedValue(phi, merges[0].second.type);
     }
 
@@ -4,9 +4,12 @@
  *  syntax.y which creates and links nodes to a parse tree.
  */
 #include "compiler.h"
+#include "ptree.h"
+#include "lexer.h"
 #include "yyparser.h"
 #include "unification.h"
 #include "util.h"
+#include "scopeguard.h"
 #include <stack>
 
 #include <compiler.h>
@@ -18,16 +21,57 @@ namespace ante {
 
     namespace parser {
 
-        //stack of relative roots, eg. a FuncDeclNode's first statement would be set as the
-        //relative root, where the last would be returned by the parser.  Relative roots are
-        //returned through getRoot() which also pops the stack.
-        stack<Node*> roots;
+        /**
+         * The arena the mk*Node functions below allocate in.  This is
+         * set for the duration of each parse on the thread doing the parsing.
+         */
+        thread_local NodeArena *curArena = nullptr;
 
-        //The single true-root of the compiled file.  One RootNode per file parsed.
-        RootNode *root;
+        template<typename T, typename... Args>
+        T* newNode(Args&&... args){
+            return curArena->make<T>(std::forward<Args>(args)...);
+        }
+
+        NodeArena::~NodeArena(){
+            for(auto it = nodes.rbegin(); it != nodes.rend(); ++it){
+                (*it)->~Node();
+            }
+        }
+
+        /**
+         * Drive the parser over the given lexer, returning the resulting
+         * parse tree or nullptr if a syntax error was encountered.
+         */
+        unique_ptr<RootNode> parse(Lexer &lexer){
+            auto arena = make_unique<NodeArena>();
+            auto setArena = TemporarilySet<NodeArena*>::set(curArena, arena.get());
+
+            ParseContext ctxt{lexer};
+            yy::parser p{ctxt};
+            int flag = p.parse();
+            if(flag != PE_OK){ //parsing error, cannot procede
+                //print out remaining errors
+                int tok;
+                yy::location loc;
+                while((tok = lexer.next(&loc)) != Tok_Newline && tok != 0);
+                while(p.parse() != PE_OK && lexer.peek() != 0);
+
+                delete ctxt.root;
+                return nullptr;
+            }
+            ctxt.root->arena = move(arena);
+            return unique_ptr<RootNode>(ctxt.root);
+        }
+
+        unique_ptr<RootNode> parseFile(string *fileName){
+            Lexer lexer{fileName};
+            return parse(lexer);
+        }
 
-        RootNode* getRootNode(){
-            return root;
+        unique_ptr<RootNode> parseBuffer(string *fileName, string &source,
+                unsigned int rowOffset, unsigned int colOffset){
+            Lexer lexer{fileName, source, rowOffset, colOffset};
+            return parse(lexer);
         }
 
         AnType* VarNode::getType() const {
@@ -92,43 +136,46 @@ namespace ante {
         }
 
         //initializes the root node
-        void createRoot(LOC_TY& loc){
-            root = new RootNode(loc);
+        void createRoot(ParseContext &ctxt, LOC_TY& loc){
+            //the parser is re-run after a syntax error to report any
+            //further errors, so a root from a previous pass may remain
+            delete ctxt.root;
+            ctxt.root = new RootNode(loc);
         }
 
-        void createRoot(){
-            auto loc = mkLoc(mkPos(yylexer->fileName, 0, 0),
-                             mkPos(yylexer->fileName, 0, 0));
-            createRoot(loc);
+        void createRoot(ParseContext &ctxt){
+            auto loc = mkLoc(mkPos(ctxt.lexer.fileName, 0, 0),
+                             mkPos(ctxt.lexer.fileName, 0, 0));
+            createRoot(ctxt, loc);
         }
 
-        Node* append_main(Node *n){
-            root->main.emplace_back(n);
+        Node* append_main(ParseContext &ctxt, Node *n){
+            ctxt.root->main.emplace_back(n);
             return n;
         }
 
-        Node* append_fn(Node *n){
-            root->funcs.emplace_back(n);
+        Node* append_fn(ParseContext &ctxt, Node *n){
+            ctxt.root->funcs.emplace_back(n);
             return n;
         }
 
-        Node* append_type(Node *n){
-            root->types.emplace_back(n);
+        Node* append_type(ParseContext &ctxt, Node *n){
+            ctxt.root->types.emplace_back(n);
             return n;
         }
 
-        Node* append_extension(Node *n){
-            root->extensions.emplace_back(n);
+        Node* append_extension(ParseContext &ctxt, Node *n){
+            ctxt.root->extensions.emplace_back(n);
             return n;
         }
 
-        Node* append_trait(Node *n){
-            root->traits.emplace_back(n);
+        Node* append_trait(ParseContext &ctxt, Node *n){
+            ctxt.root->traits.emplace_back(n);
             return n;
         }
 
-        Node* append_import(Node *n){
-            root->imports.emplace_back(n);
+        Node* append_import(ParseContext &ctxt, Node *n){
+            ctxt.root->imports.emplace_back(n);
             return n;
         }
 
@@ -137,7 +184,7 @@ namespace ante {
                 if(ExtNode *en = dynamic_cast<ExtNode*>(n)){
                     for(Node &f : *en->methods){
                         if(ModifiableNode *fmn = dynamic_cast<ModifiableNode*>(&f)){
-                            ModNode *cpy = new ModNode(m->loc, m->mod, nullptr);
+                            ModNode *cpy = newNode<ModNode>(m->loc, m->mod, nullptr);
                             fmn->modifiers.emplace_back(cpy);
                         }
                     }
@@ -154,8 +201,7 @@ namespace ante {
                 return van;
             }else if(BinOpNode *assign = dynamic_cast<BinOpNode*>(modifiableNode)){
                 if(assign->op == '='){
-                    auto *vas = new VarAssignNode(assign->loc, assign->lval.release(), assign->rval.release(), false);
-                    delete assign;
+                    auto *vas = newNode<VarAssignNode>(assign->loc, assign->lval.release(), assign->rval.release());
                     vas->modifiers.emplace_back(m);
                     return vas;
                 }
@@ -179,17 +225,17 @@ namespace ante {
         /*
         *  Saves the root of a new block and returns it.
         */
-        Node* setRoot(Node* node){
-            roots.push(node);
+        Node* setRoot(ParseContext &ctxt, Node* node){
+            ctxt.roots.push(node);
             return node;
         }
 
         /*
         *  Pops and returns the root of the current block
         */
-        Node* getRoot(){
-            Node *ret = roots.top();
-            roots.pop();
+        Node* getRoot(ParseContext &ctxt){
+            Node *ret = ctxt.roots.top();
+            ctxt.roots.pop();
             return ret;
         }
 
@@ -244,7 +290,7 @@ namespace ante {
                 }
             }
 
-            return new IntLitNode(loc, str, type);
+            return newNode<IntLitNode>(loc, str, type);
         }
 
         Node* mkFltLitNode(LOC_TY loc, char* s){
@@ -266,57 +312,57 @@ namespace ante {
                 }
             }
 
-            return new FltLitNode(loc, str, type);
+            return newNode<FltLitNode>(loc, str, type);
         }
 
         Node* mkStrLitNode(LOC_TY loc, char* s){
-            return new StrLitNode(loc, s);
+            return newNode<StrLitNode>(loc, s);
         }
 
         Node* mkCharLitNode(LOC_TY loc, char* s){
-            return new CharLitNode(loc, s[0]);
+            return newNode<CharLitNode>(loc, s[0]);
         }
 
         Node* mkBoolLitNode(LOC_TY loc, char b){
-            return new BoolLitNode(loc, b);
+            return newNode<BoolLitNode>(loc, b);
         }
 
         Node* mkArrayNode(LOC_TY loc, Node *expr){
-            vector<unique_ptr<Node>> exprs;
+            vector<ArenaPtr<Node>> exprs;
             while(expr){
                 exprs.emplace_back(expr);
                 auto *nxt = expr->next.get();
                 expr->next.release();
                 expr = nxt;
             }
-            return new ArrayNode(loc, exprs);
+            return newNode<ArrayNode>(loc, exprs);
         }
 
         Node* mkTupleNode(LOC_TY loc, Node *expr){
-            vector<unique_ptr<Node>> exprs;
+            vector<ArenaPtr<Node>> exprs;
             while(expr){
                 exprs.emplace_back(expr);
                 auto *nxt = expr->next.get();
                 expr->next.release();
                 expr = nxt;
             }
-            return new TupleNode(loc, exprs);
+            return newNode<TupleNode>(loc, exprs);
         }
 
         Node* mkModNode(LOC_TY loc, ante::TokenType mod){
-            return new ModNode(loc, mod, nullptr);
+            return newNode<ModNode>(loc, mod, nullptr);
         }
 
         Node* mkModExprNode(LOC_TY loc, ante::TokenType mod, Node *expr){
-            return new ModNode(loc, mod, expr);
+            return newNode<ModNode>(loc, mod, expr);
         }
 
         Node* mkCompilerDirective(LOC_TY loc, Node *directive){
-            return new ModNode(loc, directive, nullptr);
+            return newNode<ModNode>(loc, directive, nullptr);
         }
 
         Node* mkCompilerDirectiveExpr(LOC_TY loc, Node *directive, Node *expr){
-            return new ModNode(loc, directive, expr);
+            return newNode<ModNode>(loc, directive, expr);
         }
 
         Node* mkTypeNode(LOC_TY loc, TypeTag type, char* typeName, Node* extTy){
@@ -328,17 +374,17 @@ namespace ante {
                     ante::error("Size of array must be an integer literal", extTy->next->loc);
                 }
             }
-            return new TypeNode(loc, type, typeName, static_cast<TypeNode*>(extTy));
+            return newNode<TypeNode>(loc, type, typeName, static_cast<TypeNode*>(extTy));
         }
 
         Node* mkInferredTypeNode(LOC_TY loc){
             auto t = nextTypeVar();
-            return new TypeNode(loc, TT_TypeVar, t->name, nullptr);
+            return newNode<TypeNode>(loc, TT_TypeVar, t->name, nullptr);
         }
 
         Node* mkTypeCastNode(LOC_TY loc, Node *l, Node *r){
             auto type = static_cast<TypeNode*>(l);
-            vector<unique_ptr<Node>> args;
+            vector<ArenaPtr<Node>> args;
             while(r){
                 args.emplace_back(r);
                 r = r->next.release();
@@ -350,23 +396,23 @@ namespace ante {
             //     type->params.emplace_back(arg);
             //     return type;
             // }else{
-            return new TypeCastNode(loc, type, move(args));
+            return newNode<TypeCastNode>(loc, type, move(args));
             // }
         }
 
         Node* mkUnOpNode(LOC_TY loc, int op, Node* r){
-            return new UnOpNode(loc, op, r);
+            return newNode<UnOpNode>(loc, op, r);
         }
 
         Node* mkBinOpNode(LOC_TY loc, int op, Node* l, Node* r){
-            return new BinOpNode(loc, op, l, r);
+            return newNode<BinOpNode>(loc, op, l, r);
         }
 
         Node* mkAsNode(LOC_TY loc, Node *expr, Node *type){
-            auto fn = new VarNode(loc, "cast");
+            auto fn = newNode<VarNode>(loc, "cast");
             auto args = mkTupleNode(loc, expr);
-            auto call = new BinOpNode(loc, '(', fn, args);
-            return new BinOpNode(loc, ':', call, type);
+            auto call = newNode<BinOpNode>(loc, '(', fn, args);
+            return newNode<BinOpNode>(loc, ':', call, type);
         }
 
         Node* mkSeqNode(LOC_TY loc, Node *l, Node *r){
@@ -374,7 +420,7 @@ namespace ante {
                 seq->sequence.emplace_back(r);
                 return seq;
             }else{
-                SeqNode *s = new SeqNode(loc);
+                SeqNode *s = newNode<SeqNode>(loc);
                 s->sequence.emplace_back(l);
                 s->sequence.emplace_back(r);
                 return s;
@@ -382,55 +428,55 @@ namespace ante {
         }
 
         Node* mkBlockNode(LOC_TY loc, Node *b){
-            return new BlockNode(loc, b);
+            return newNode<BlockNode>(loc, b);
         }
 
         Node* mkRetNode(LOC_TY loc, Node* expr){
-            return new RetNode(loc, expr);
+            return newNode<RetNode>(loc, expr);
         }
 
 
         Node* mkNamedValNode(LOC_TY loc, Node* varNode, Node* tExpr){
             const TypeNode* ty = (TypeNode*)tExpr;
             VarNode* vn = (VarNode*)varNode;
-            return new NamedValNode(loc, vn->name, tExpr);
+            return newNode<NamedValNode>(loc, vn->name, tExpr);
         }
 
         Node* mkVarNode(LOC_TY loc, char* s){
-            return new VarNode(loc, s);
+            return newNode<VarNode>(loc, s);
         }
 
         Node* mkImportNode(LOC_TY loc, Node* expr){
-            return new ImportNode(loc, expr);
+            return newNode<ImportNode>(loc, expr);
         }
 
-        Node* mkVarAssignNode(LOC_TY loc, Node* var, Node* expr, bool freeLval){
-            return new VarAssignNode(loc, var, expr, freeLval);
+        Node* mkVarAssignNode(LOC_TY loc, Node* var, Node* expr){
+            return newNode<VarAssignNode>(loc, var, expr);
         }
 
         Node* mkExtNode(LOC_TY loc, Node* ty, Node* methods, Node* traits){
-            return new ExtNode(loc, (TypeNode*)ty, methods, (TypeNode*)traits);
+            return newNode<ExtNode>(loc, (TypeNode*)ty, methods, (TypeNode*)traits);
         }
 
         Node* mkIfNode(LOC_TY loc, Node* con, Node* then, Node* els){
-            return new IfNode(loc, con, then, els);
+            return newNode<IfNode>(loc, con, then, els);
         }
 
         Node* mkJumpNode(LOC_TY loc, int jumpType, Node* expr){
-            return new JumpNode(loc, jumpType, expr);
+            return newNode<JumpNode>(loc, jumpType, expr);
         }
 
         Node* mkWhileNode(LOC_TY loc, Node* con, Node* body){
-            return new WhileNode(loc, con, body);
+            return newNode<WhileNode>(loc, con, body);
         }
 
         Node* mkForNode(LOC_TY loc, Node* var, Node* range, Node* body){
-            return new ForNode(loc, new VarNode(loc, (char*)var), range, body);
+            return newNode<ForNode>(loc, newNode<VarNode>(loc, (char*)var), range, body);
         }
 
         Node* nextVarArgsTypeNode(LOC_TY loc){
             auto name = strdup((ante::nextTypeVar()->name + "...").c_str());
-            auto node = new TypeNode(loc, TT_TypeVar, name, nullptr);
+            auto node = newNode<TypeNode>(loc, TT_TypeVar, name, nullptr);
             node->isRowVar = true;
             return node;
         }
@@ -438,11 +484,11 @@ namespace ante {
         NamedValNode* convertParam(Node *param){
             TypeNode *tn = dynamic_cast<TypeNode*>(param);
             if(tn){
-                return new NamedValNode(tn->loc, "_", tn);
+                return newNode<NamedValNode>(tn->loc, "_", tn);
             }
             VarNode *vn = dynamic_cast<VarNode*>(param);
             if(vn){
-                return new NamedValNode(vn->loc, vn->name, mkInferredTypeNode(vn->loc));
+                return newNode<NamedValNode>(vn->loc, vn->name, mkInferredTypeNode(vn->loc));
             }
             BinOpNode *bop = dynamic_cast<BinOpNode*>(param);
             if(bop){
@@ -452,7 +498,7 @@ namespace ante {
                     if(!vn || !tn){
                         ante::error("Invalid syntax in type ascription", bop->loc);
                     }
-                    return new NamedValNode(bop->loc, vn->name, tn);
+                    return newNode<NamedValNode>(bop->loc, vn->name, tn);
 
                 //manually fix a parsing glitch that causes (var: Type TypeArg TypeArg) to be parsed as ((var:Type) TypeArg TypeArg)
                 }else if(bop->op == '('){
@@ -469,7 +515,7 @@ namespace ante {
                                 }
                                 basety->params.emplace_back(tn);
                             }
-                            return new NamedValNode(bop->loc, var->name, basety);
+                            return newNode<NamedValNode>(bop->loc, var->name, basety);
                         }
                     }
                 }
@@ -478,7 +524,7 @@ namespace ante {
             TupleNode *tup = dynamic_cast<TupleNode*>(param);
             if(tup){
                 if(tup->exprs.empty()){
-                    return new NamedValNode(tup->loc, "", new TypeNode(tup->loc, TT_Unit, "", nullptr));
+                    return newNode<NamedValNode>(tup->loc, "", newNode<TypeNode>(tup->loc, TT_Unit, "", nullptr));
                 }else{
                     ante::error("Pattern matching on a function's parameters is currently unimplemented", param->loc);
                 }
@@ -513,42 +559,42 @@ namespace ante {
                 ante::error("Expected function name here to start function declaration", nameAndParams->loc);
             }
             auto params = convertParams(name->next.release());
-            return new FuncDeclNode(loc, name->name.c_str(), (TypeNode*)tExpr, params, (TypeNode*)tcc, body);
+            return newNode<FuncDeclNode>(loc, name->name.c_str(), (TypeNode*)tExpr, params, (TypeNode*)tcc, body);
         }
 
         Node* mkFuncCallNode(LOC_TY loc, Node* nameAndArgs){
             Node *fn = nameAndArgs;
             Node *args = nameAndArgs->next.release();
             Node *argTup = mkTupleNode(loc, args);
-            return new BinOpNode(loc, '(', fn, argTup);
+            return newNode<BinOpNode>(loc, '(', fn, argTup);
         }
 
         Node* mkDataDeclNode(LOC_TY loc, char* s, Node *p, Node* b, bool isAlias, bool isUnion){
-            vector<unique_ptr<TypeNode>> params;
+            vector<ArenaPtr<TypeNode>> params;
             while(p){
                 params.emplace_back((TypeNode*)p);
                 p = p->next.release();
             }
-            return new DataDeclNode(loc, s, b, getTupleSize(b), move(params), isAlias, isUnion);
+            return newNode<DataDeclNode>(loc, s, b, getTupleSize(b), move(params), isAlias, isUnion);
         }
 
         Node* mkMatchNode(LOC_TY loc, Node* expr, Node* branch){
-            vector<unique_ptr<MatchBranchNode>> branches;
+            vector<ArenaPtr<MatchBranchNode>> branches;
             auto nextBranch = branch->next.release();
             if(nextBranch){
                 ASSERT_UNREACHABLE("error in parse logic, match branch should not have a ->next pointer");
             }
             branches.emplace_back((MatchBranchNode*)branch);
-            return new MatchNode(loc, expr, branches);
+            return newNode<MatchNode>(loc, expr, branches);
         }
 
         Node* mkMatchBranchNode(LOC_TY loc, Node* pattern, Node* branch){
-            return new MatchBranchNode(loc, pattern, branch);
+            return newNode<MatchBranchNode>(loc, pattern, branch);
         }
 
         Node* mkTraitNode(LOC_TY loc, char* s, Node* generics, Node* fundeps, Node* fns){
-            vector<unique_ptr<TypeNode>> genericsVec;
-            vector<unique_ptr<TypeNode>> fundepsVec;
+            vector<ArenaPtr<TypeNode>> genericsVec;
+            vector<ArenaPtr<TypeNode>> fundepsVec;
 
             while(generics){
                 genericsVec.emplace_back((TypeNode*)generics);
@@ -559,7 +605,7 @@ namespace ante {
                 fundepsVec.emplace_back((TypeNode*)fundeps);
                 fundeps = fundeps->next.release();
             }
-            return new TraitNode(loc, s, move(genericsVec), move(fundepsVec), fns);
+            return newNode<TraitNode>(loc, s, move(genericsVec), move(fundepsVec), fns);
         }
     } //end of namespace ante::parser
 } //end of namespace ante
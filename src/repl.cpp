@@ -18,7 +18,6 @@ using namespace std;
 using namespace ante;
 using namespace ante::parser;
 
-extern char* lextxt;
 
 extern "C" void* Ante_debug(Compiler *c, AnteValue &tv);
 
@@ -415,11 +414,9 @@ namespace ante {
         auto cmd = getInputColorized();
 
         while(cmd != "exit\n"){
-            int flag;
+            unique_ptr<RootNode> parseTree;
             try{
-                setLexer(new Lexer(nullptr, cmd, /*line*/1, /*col*/1));
-                yy::parser p{};
-                flag = p.parse();
+                parseTree = parser::parseBuffer(nullptr, cmd, /*line*/1, /*col*/1);
             }catch(CtError e){
                 continue;
             }
@@ -427,13 +424,14 @@ namespace ante {
             c->isJIT = true;
 
             LOC_TY loc;
-            ModNode *expr = new ModNode(loc, Tok_Ante, nullptr);
-            if(flag == PE_OK){
-                RootNode *root = parser::getRootNode();
-                auto leak = expr->expr.release();
-                expr->expr.reset(root);
+            ModNode expr{loc, Tok_Ante, nullptr};
+            if(parseTree){
+                RootNode *root = parseTree.release();
+                expr.expr.reset(root);
 
-                TypedValue val = mergeAndCompile(c, root, expr);
+                //the module of each line owns its parse tree and is freed along with it
+                unique_ptr<Module> unit;
+                TypedValue val = mergeAndCompile(c, root, &expr, unit);
 
                 // Only print types until compile-time eval is setup again
                 if(val.type){
@@ -451,10 +449,11 @@ namespace ante {
      * Compile an expression and merge it with the current AST
      * if it is well-formed.
      */
-    TypedValue mergeAndCompile(Compiler *c, RootNode *rn, ModNode *anteExpr){
+    TypedValue mergeAndCompile(Compiler *c, RootNode *rn, ModNode *anteExpr, unique_ptr<Module> &unit){
         TypedValue ret;
         try{
             NameResolutionVisitor v{"repl"};
+            unit.reset(v.compUnit);
             size_t errc = errorCount();
             v.visit(rn);
             if(errorCount() > errc) return {};
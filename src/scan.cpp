@@ -0,0 +1,205 @@
+#include "scan.h"
+#include "lexer.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#  define AN_SCAN_X86 1
+#  include <immintrin.h>
+#  define AN_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace ante {
+    namespace scan {
+
+        /*
+         * Each kind of scan is described by a struct with a scalar predicate
+         * returning true for the characters that stop the scan and, on x86,
+         * vector versions of the same predicate returning a byte mask.
+         */
+        struct IdentChars {
+            static bool stops(char c){ return !IS_ALPHANUM(c); }
+
+#ifdef AN_SCAN_X86
+            static __m128i inRange(__m128i c, char lo, char hi){
+                return _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8(lo - 1)),
+                                     _mm_cmplt_epi8(c, _mm_set1_epi8(hi + 1)));
+            }
+
+            static __m128i stops(__m128i c){
+                // c | 0x20 maps only 'A'-'Z' onto 'a'-'z'
+                __m128i alpha = inRange(_mm_or_si128(c, _mm_set1_epi8(0x20)), 'a', 'z');
+                __m128i digit = inRange(c, '0', '9');
+                __m128i under = _mm_cmpeq_epi8(c, _mm_set1_epi8('_'));
+                __m128i ident = _mm_or_si128(_mm_or_si128(alpha, digit), under);
+                return _mm_xor_si128(ident, _mm_set1_epi8(-1));
+            }
+
+            AN_TARGET_AVX2 static __m256i inRange(__m256i c, char lo, char hi){
+                return _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8(lo - 1)),
+                                        _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), c));
+            }
+
+            AN_TARGET_AVX2 static __m256i stops(__m256i c){
+                __m256i alpha = inRange(_mm256_or_si256(c, _mm256_set1_epi8(0x20)), 'a', 'z');
+                __m256i digit = inRange(c, '0', '9');
+                __m256i under = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('_'));
+                __m256i ident = _mm256_or_si256(_mm256_or_si256(alpha, digit), under);
+                return _mm256_xor_si256(ident, _mm256_set1_epi8(-1));
+            }
+#endif
+        };
+
+        struct Spaces {
+            static bool stops(char c){ return c != ' '; }
+
+#ifdef AN_SCAN_X86
+            static __m128i stops(__m128i c){
+                return _mm_xor_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(' ')), _mm_set1_epi8(-1));
+            }
+
+            AN_TARGET_AVX2 static __m256i stops(__m256i c){
+                return _mm256_xor_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8(' ')), _mm256_set1_epi8(-1));
+            }
+#endif
+        };
+
+        struct LineEnd {
+            static bool stops(char c){ return c == '\n' || c == '\0'; }
+
+#ifdef AN_SCAN_X86
+            static __m128i stops(__m128i c){
+                return _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('\n')),
+                                    _mm_cmpeq_epi8(c, _mm_setzero_si128()));
+            }
+
+            AN_TARGET_AVX2 static __m256i stops(__m256i c){
+                return _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('\n')),
+                                       _mm256_cmpeq_epi8(c, _mm256_setzero_si256()));
+            }
+#endif
+        };
+
+        struct StrLitSpecial {
+            static bool stops(char c){
+                return c == '"' || c == '\\' || c == '\n' || c == '$' || c == '\0';
+            }
+
+#ifdef AN_SCAN_X86
+            static __m128i stops(__m128i c){
+                __m128i quote  = _mm_cmpeq_epi8(c, _mm_set1_epi8('"'));
+                __m128i escape = _mm_cmpeq_epi8(c, _mm_set1_epi8('\\'));
+                __m128i nl     = _mm_cmpeq_epi8(c, _mm_set1_epi8('\n'));
+                __m128i dollar = _mm_cmpeq_epi8(c, _mm_set1_epi8('$'));
+                __m128i nul    = _mm_cmpeq_epi8(c, _mm_setzero_si128());
+                return _mm_or_si128(_mm_or_si128(_mm_or_si128(quote, escape), _mm_or_si128(nl, dollar)), nul);
+            }
+
+            AN_TARGET_AVX2 static __m256i stops(__m256i c){
+                __m256i quote  = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('"'));
+                __m256i escape = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('\\'));
+                __m256i nl     = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('\n'));
+                __m256i dollar = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('$'));
+                __m256i nul    = _mm256_cmpeq_epi8(c, _mm256_setzero_si256());
+                return _mm256_or_si256(_mm256_or_si256(_mm256_or_si256(quote, escape), _mm256_or_si256(nl, dollar)), nul);
+            }
+#endif
+        };
+
+
+        template<class Pred>
+        const char* scanScalar(const char *p, const char *end){
+            while(p != end && !Pred::stops(*p)) p++;
+            return p;
+        }
+
+#ifdef AN_SCAN_X86
+        template<class Pred>
+        const char* scanSSE2(const char *p, const char *end){
+            for(; end - p >= 16; p += 16){
+                __m128i c = _mm_loadu_si128((const __m128i*)p);
+                unsigned int mask = _mm_movemask_epi8(Pred::stops(c));
+                if(mask) return p + __builtin_ctz(mask);
+            }
+            return scanScalar<Pred>(p, end);
+        }
+
+        template<class Pred>
+        AN_TARGET_AVX2 const char* scanAVX2(const char *p, const char *end){
+            for(; end - p >= 32; p += 32){
+                __m256i c = _mm256_loadu_si256((const __m256i*)p);
+                unsigned int mask = _mm256_movemask_epi8(Pred::stops(c));
+                if(mask) return p + __builtin_ctz(mask);
+            }
+            return scanScalar<Pred>(p, end);
+        }
+#endif
+
+        bool isSupported(Isa isa){
+#ifdef AN_SCAN_X86
+            switch(isa){
+                case Isa::Scalar: return true;
+                case Isa::SSE2: return true; //always available on x86-64
+                case Isa::AVX2: return __builtin_cpu_supports("avx2");
+            }
+            return false;
+#else
+            return isa == Isa::Scalar;
+#endif
+        }
+
+        Isa detectIsa(){
+            if(isSupported(Isa::AVX2)) return Isa::AVX2;
+            if(isSupported(Isa::SSE2)) return Isa::SSE2;
+            return Isa::Scalar;
+        }
+
+        Isa currentIsa = detectIsa();
+
+        Isa getIsa(){
+            return currentIsa;
+        }
+
+        bool setIsa(Isa isa){
+            if(!isSupported(isa))
+                return false;
+            currentIsa = isa;
+            return true;
+        }
+
+        const char* getIsaName(Isa isa){
+            switch(isa){
+                case Isa::Scalar: return "scalar";
+                case Isa::SSE2: return "sse2";
+                case Isa::AVX2: return "avx2";
+            }
+            return "unknown";
+        }
+
+        template<class Pred>
+        const char* scanWith(const char *begin, const char *end){
+#ifdef AN_SCAN_X86
+            switch(currentIsa){
+                case Isa::AVX2: return scanAVX2<Pred>(begin, end);
+                case Isa::SSE2: return scanSSE2<Pred>(begin, end);
+                default: break;
+            }
+#endif
+            return scanScalar<Pred>(begin, end);
+        }
+
+        const char* skipIdentChars(const char *begin, const char *end){
+            return scanWith<IdentChars>(begin, end);
+        }
+
+        const char* skipSpaces(const char *begin, const char *end){
+            return scanWith<Spaces>(begin, end);
+        }
+
+        const char* findLineEnd(const char *begin, const char *end){
+            return scanWith<LineEnd>(begin, end);
+        }
+
+        const char* findStrLitSpecial(const char *begin, const char *end){
+            return scanWith<StrLitSpecial>(begin, end);
+        }
+    }
+}
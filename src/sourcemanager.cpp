@@ -0,0 +1,69 @@
+#include "sourcemanager.h"
+#include <mutex>
+#include <llvm/ADT/StringMap.h>
+
+using namespace std;
+
+namespace ante {
+
+    SourceFile::SourceFile(unique_ptr<llvm::MemoryBuffer> buf) : buffer{move(buf)} {
+        lineOffsets.push_back(0);
+        for(const char *c = begin(); c != end(); c++){
+            if(*c == '\n'){
+                lineOffsets.push_back(c - begin() + 1);
+            }
+        }
+    }
+
+    llvm::StringRef SourceFile::getLine(unsigned int line) const {
+        if(line == 0 || line > lineOffsets.size())
+            return "";
+
+        const char *lineStart = begin() + lineOffsets[line - 1];
+        const char *lineEnd = line < lineOffsets.size()
+            ? begin() + lineOffsets[line] - 1
+            : end();
+
+        return llvm::StringRef(lineStart, lineEnd - lineStart);
+    }
+
+    mutex sourceFilesMutex;
+    llvm::StringMap<unique_ptr<SourceFile>> sourceFiles;
+    vector<unique_ptr<SourceFile>> stdinFiles;
+
+    SourceFile* SourceManager::getFile(string const& fileName){
+        lock_guard<mutex> lock{sourceFilesMutex};
+
+        auto it = sourceFiles.find(fileName);
+        if(it != sourceFiles.end())
+            return it->getValue().get();
+
+        auto buffer = llvm::MemoryBuffer::getFile(fileName);
+        if(!buffer)
+            return nullptr;
+
+        auto file = new SourceFile(move(buffer.get()));
+        sourceFiles[fileName].reset(file);
+        return file;
+    }
+
+    SourceFile* SourceManager::getStdin(){
+        lock_guard<mutex> lock{sourceFilesMutex};
+
+        auto buffer = llvm::MemoryBuffer::getSTDIN();
+        if(!buffer)
+            return nullptr;
+
+        stdinFiles.emplace_back(new SourceFile(move(buffer.get())));
+        return stdinFiles.back().get();
+    }
+
+    vector<string> SourceManager::getLoadedFileNames(){
+        lock_guard<mutex> lock{sourceFilesMutex};
+
+        vector<string> names;
+        for(auto &file : sourceFiles)
+            names.push_back(file.getKey().str());
+        return names;
+    }
+}
@@ -28,7 +28,7 @@ namespace ante {
         for(auto &m : n->main){
             m->accept(*this);
         }
-        n->setType(applySubstitutions(substitutions, n->getType()));
+        n->setType(bindings.resolve(n->getType()));
     }
 
     void SubstitutingVisitor::visit(IntLitNode *n){}
@@ -45,7 +45,7 @@ namespace ante {
         for(auto &e : n->exprs)
             e->accept(*this);
 
-        n->setType(applySubstitutions(substitutions, n->getType()));
+        n->setType(bindings.resolve(n->getType()));
     }
 
     void SubstitutingVisitor::visit(TupleNode *n){
@@ -53,18 +53,18 @@ namespace ante {
             e->accept(*this);
 
         if(!n->exprs.empty())
-            n->setType(applySubstitutions(substitutions, n->getType()));
+            n->setType(bindings.resolve(n->getType()));
     }
 
     void SubstitutingVisitor::visit(ModNode *n){
         if(n->expr)
             n->expr->accept(*this);
-        n->setType(applySubstitutions(substitutions, n->getType()));
+        n->setType(bindings.resolve(n->getType()));
     }
 
     void SubstitutingVisitor::visit(TypeNode *n){
         if(n->getType()){
-            n->setType(applySubstitutions(substitutions, n->getType()));
+            n->setType(bindings.resolve(n->getType()));
         }
     }
 
@@ -73,19 +73,19 @@ namespace ante {
             arg->accept(*this);
         }
         n->typeExpr->accept(*this);
-        n->setType(applySubstitutions(substitutions, n->getType()));
+        n->setType(bindings.resolve(n->getType()));
     }
 
     void SubstitutingVisitor::visit(UnOpNode *n){
         n->rval->accept(*this);
-        n->setType(applySubstitutions(substitutions, n->getType()));
+        n->setType(bindings.resolve(n->getType()));
     }
 
     void SubstitutingVisitor::visit(SeqNode *n){
         for(auto &stmt : n->sequence){
             stmt->accept(*this);
         }
-        n->setType(applySubstitutions(substitutions, n->getType()));
+        n->setType(bindings.resolve(n->getType()));
     }
 
     bool SubstitutingVisitor::inScope(llvm::StringRef typevar) const {
@@ -125,7 +125,7 @@ namespace ante {
     }
 
     void SubstitutingVisitor::visit(VarNode *n){
-        n->setType(applySubstitutions(substitutions, n->getType()));
+        n->setType(bindings.resolve(n->getType()));
 
         auto fn = try_cast<AnFunctionType>(n->getType());
         if(fn){
@@ -136,12 +136,12 @@ namespace ante {
     void SubstitutingVisitor::visit(BinOpNode *n){
         n->lval->accept(*this);
         n->rval->accept(*this);
-        n->setType(applySubstitutions(substitutions, n->getType()));
+        n->setType(bindings.resolve(n->getType()));
     }
 
     void SubstitutingVisitor::visit(BlockNode *n){
         n->block->accept(*this);
-        n->setType(applySubstitutions(substitutions, n->getType()));
+        n->setType(bindings.resolve(n->getType()));
     }
 
     void SubstitutingVisitor::visit(RetNode *n){
@@ -156,14 +156,14 @@ namespace ante {
         n->thenN->accept(*this);
         if(n->elseN){
             n->elseN->accept(*this);
-            n->setType(applySubstitutions(substitutions, n->getType()));
+            n->setType(bindings.resolve(n->getType()));
         }
     }
 
     void SubstitutingVisitor::visit(NamedValNode *n){
         if(n->typeExpr)
             n->typeExpr->accept(*this);
-        n->setType(applySubstitutions(substitutions, n->getType()));
+        n->setType(bindings.resolve(n->getType()));
     }
 
     void SubstitutingVisitor::visit(VarAssignNode *n){
@@ -171,7 +171,7 @@ namespace ante {
         n->ref_expr->accept(*this);
 
         if(!n->modifiers.empty())
-            n->setType(applySubstitutions(substitutions, n->getType()));
+            n->setType(bindings.resolve(n->getType()));
     }
 
     void SubstitutingVisitor::visit(ExtNode *n){
@@ -192,7 +192,7 @@ namespace ante {
         n->range->accept(*this);
         n->pattern->accept(*this);
         n->child->accept(*this);
-        n->iterableInstance = applySubstitutions(substitutions, n->iterableInstance);
+        n->iterableInstance = bindings.resolve(n->iterableInstance);
     }
 
     void SubstitutingVisitor::visit(MatchNode *n){
@@ -200,13 +200,13 @@ namespace ante {
         for(auto &b : n->branches){
             b->accept(*this);
         }
-        n->setType(applySubstitutions(substitutions, n->getType()));
+        n->setType(bindings.resolve(n->getType()));
     }
 
     void SubstitutingVisitor::visit(MatchBranchNode *n){
         n->pattern->accept(*this);
         n->branch->accept(*this);
-        n->setType(applySubstitutions(substitutions, n->getType()));
+        n->setType(bindings.resolve(n->getType()));
     }
 
     void SubstitutingVisitor::visit(FuncDeclNode *n){
@@ -214,7 +214,7 @@ namespace ante {
             p.accept(*this);
         }
 
-        n->setType(applySubstitutions(substitutions, n->getType()));
+        n->setType(bindings.resolve(n->getType()));
 
         auto fn = try_cast<AnFunctionType>(n->getType());
         assert(fn);
@@ -13,32 +13,37 @@
 #define YYERROR_VERBOSE 1
 
 #include "yyparser.h"
+#include "lexer.h"
 #include <cstring>
 using namespace std;
 using namespace ante;
 using namespace ante::parser;
 
 /* Defined in lexer.cpp */
-extern int yylex(yy::parser::semantic_type*, yy::location*);
+extern int yylex(yy::parser::semantic_type*, yy::location*, ante::parser::ParseContext&);
 
 namespace ante {
     extern string typeNodeToStr(const TypeNode*);
     extern string mangle(std::string const& base, NamedValNode *paramTys);
-    static size_t ante_parser_errcount = 0;
 
     namespace parser {
         struct TypeNode;
 
-        vector<unique_ptr<TypeNode>> toOwnedVec(Node *tn);
-        vector<unique_ptr<TypeNode>> concat(vector<unique_ptr<TypeNode>>&& l, Node *tn);
+        vector<ArenaPtr<TypeNode>> toNodeVec(Node *tn);
+        vector<ArenaPtr<TypeNode>> concat(vector<ArenaPtr<TypeNode>>&& l, Node *tn);
         Node* name(Node *varNode);
     }
 }
 
 %}
 
+%code requires {
+    namespace ante { namespace parser { struct ParseContext; } }
+}
+
 %locations
 %define parse.error verbose
+%param {ante::parser::ParseContext &ctxt}
 
 %token Ident UserType TypeVar
 
@@ -157,15 +162,15 @@ namespace ante {
 %start begin
 %%
 
-begin:  maybe_newline {createRoot();} top_level_expr_list
-     |  maybe_newline {createRoot();}
+begin:  maybe_newline {createRoot(ctxt);} top_level_expr_list
+     |  maybe_newline {createRoot(ctxt);}
      ;
 
 top_level_expr_list: top_level_expr_list top_level_expr  %prec Newline
-                   | top_level_expr_list expr_no_decl    %prec Newline    {$$ = append_main($2);}
+                   | top_level_expr_list expr_no_decl    %prec Newline    {$$ = append_main(ctxt, $2);}
                    | top_level_expr_list Newline         
                    | top_level_expr
-                   | expr_no_decl                        %prec Newline  {$$ = append_main($1);}
+                   | expr_no_decl                        %prec Newline  {$$ = append_main(ctxt, $1);}
 
                    | top_level_expr_list Elif expr Then expr_no_decl_or_jump    %prec MEDIF {auto*elif = mkIfNode(@$, $3, $5, 0); $$ = setElse($1, elif);}
                    | top_level_expr_list Else expr_no_decl_or_jump                    %prec Else  {$$ = setElse($1, $3);}
@@ -175,11 +180,11 @@ top_level_expr: modifiers top_level_expr_nm     {$$ = append_modifiers($1, $2);}
               | top_level_expr_nm
               ;
 
-top_level_expr_nm: function                                   {$$ = append_fn($1);}
-                 | data_decl                                  {$$ = append_type($1);}
-                 | extension                                  {$$ = append_extension($1);}
-                 | trait_decl                                 {$$ = append_trait($1);}
-                 | import_expr                                {$$ = append_import($1);}
+top_level_expr_nm: function                                   {$$ = append_fn(ctxt, $1);}
+                 | data_decl                                  {$$ = append_type(ctxt, $1);}
+                 | extension                                  {$$ = append_extension(ctxt, $1);}
+                 | trait_decl                                 {$$ = append_trait(ctxt, $1);}
+                 | import_expr                                {$$ = append_import(ctxt, $1);}
                  ;
 
 /*
@@ -194,31 +199,31 @@ maybe_newline: Newline  %prec Newline
 import_expr: Import expr {$$ = mkImportNode(@$, $2);}
 
 
-ident: Ident {$$ = (Node*)lextxt;}
+ident: Ident {$$ = (Node*)ctxt.lexer.lextxt;}
      | Self  {$$ = (Node*)strdup("self");}
      ;
 
-usertype: UserType {$$ = (Node*)lextxt;}
+usertype: UserType {$$ = (Node*)ctxt.lexer.lextxt;}
         ;
 
 usertype_node: usertype {$$ = mkTypeNode(@$, TT_Data, (char*)$1);}
              ;
 
-typevar: TypeVar {$$ = (Node*)lextxt;}
+typevar: TypeVar {$$ = (Node*)ctxt.lexer.lextxt;}
        ;
 
-intlit: IntLit {$$ = mkIntLitNode(@$, lextxt);}
+intlit: IntLit {$$ = mkIntLitNode(@$, ctxt.lexer.lextxt);}
       ;
 
-fltlit: FltLit {$$ = mkFltLitNode(@$, lextxt);}
+fltlit: FltLit {$$ = mkFltLitNode(@$, ctxt.lexer.lextxt);}
       ;
 
-strlit: StrLit                                       {$$ = mkStrLitNode(@$, lextxt);}
-      | strlit UnfinishedStr                         {$$ = mkBinOpNode(@$, Tok_Append, $1, mkStrLitNode(@2, lextxt));}
+strlit: StrLit                                       {$$ = mkStrLitNode(@$, ctxt.lexer.lextxt);}
+      | strlit UnfinishedStr                         {$$ = mkBinOpNode(@$, Tok_Append, $1, mkStrLitNode(@2, ctxt.lexer.lextxt));}
       | strlit InterpolateBegin expr InterpolateEnd  {$$ = mkBinOpNode(@$, Tok_Append, $1, mkAsNode(@2, $3, mkTypeNode(@2, TT_Data, (char*)"Str")));}
       ;
 
-charlit: CharLit {$$ = mkCharLitNode(@$, lextxt);}
+charlit: CharLit {$$ = mkCharLitNode(@$, ctxt.lexer.lextxt);}
       ;
 
 lit_type: I8                  {$$ = mkTypeNode(@$, TT_I8,  (char*)"");}
@@ -256,12 +261,12 @@ arr_type: '[' intlit small_type ']' {$3->next.reset($2);
                                      $$ = mkTypeNode(@$, TT_Array, (char*)"", $2);}
         ;
 
-tuple_type: '(' comma_delimited_types ')'      {$$ = mkTypeNode(@$, TT_Tuple, (char*)"", getRoot());}
-          | '(' comma_delimited_types ',' ')'  {$$ = mkTypeNode(@$, TT_Tuple, (char*)"", getRoot());}
+tuple_type: '(' comma_delimited_types ')'      {$$ = mkTypeNode(@$, TT_Tuple, (char*)"", getRoot(ctxt));}
+          | '(' comma_delimited_types ',' ')'  {$$ = mkTypeNode(@$, TT_Tuple, (char*)"", getRoot(ctxt));}
           ;
 
 comma_delimited_types: comma_delimited_types ',' type      {$$ = setNext($1, $3);}
-                     | type                                {$$ = setRoot($1);}
+                     | type                                {$$ = setRoot(ctxt, $1);}
                      ;
 
 type_with_generics: type_with_generics small_type   %prec STMT  {$$ = $1; ((TypeNode*)$1)->params.emplace_back((TypeNode*)$2); $1->loc = @$;}
@@ -277,10 +282,10 @@ small_type: lit_type
           ;
 
 modifiers: modifiers modifier maybe_newline   %prec MEDLOW   {$$ = setNext($1, $2);}
-         | modifier maybe_newline             %prec LOW      {$$ = setRoot($1);}
+         | modifier maybe_newline             %prec LOW      {$$ = setRoot(ctxt, $1);}
          ;
 
-modified_type: modifiers type_with_generics %prec MEDLOW  {$$ = append_modifiers(getRoot(), $2);}
+modified_type: modifiers type_with_generics %prec MEDLOW  {$$ = append_modifiers(getRoot(ctxt), $2);}
              | type_with_generics           %prec LOW     {$$ = $1;}
              ;
 
@@ -305,12 +310,12 @@ trait_decl: Trait usertype generic_params RArrow generic_params Indent trait_fn_
           | Trait usertype generic_params Indent trait_fn_list Unindent                        {$$ = mkTraitNode(@$, (char*)$2, $3,  0, $5);}
           ;
 
-trait_fn_list: _trait_fn_list maybe_newline {$$ = getRoot();}
+trait_fn_list: _trait_fn_list maybe_newline {$$ = getRoot(ctxt);}
 
 _trait_fn_list: _trait_fn_list Newline trait_fn    {$$ = setNext($1, $3);}
               | _trait_fn_list Newline type_family {$$ = setNext($1, $3);}
-              | trait_fn                           {$$ = setRoot($1);}
-              | type_family                        {$$ = setRoot($1);}
+              | trait_fn                           {$$ = setRoot(ctxt, $1);}
+              | type_family                        {$$ = setRoot(ctxt, $1);}
               ;
 
 
@@ -322,26 +327,26 @@ type_family: Type usertype                  {$$ = mkDataDeclNode(@2, (char*)$2,
 params: params var ':' small_type          {$$ = setNext($1, mkNamedValNode(@2, $2, $4));}
       | params '(' var ':' type ')'        {$$ = setNext($1, mkNamedValNode(@3, $3, $5));}
       | params small_type                  {$$ = setNext($1, mkNamedValNode(@2, mkVarNode(@2, (char*)""), $2));}
-      | var ':' small_type                 {$$ = setRoot(mkNamedValNode(@$, $1, $3));}
-      | '(' var ':' type ')'               {$$ = setRoot(mkNamedValNode(@$, $2, $4));}
-      | small_type                         {$$ = setRoot(mkNamedValNode(@$, mkVarNode(@1, (char*)""), $1));}
+      | var ':' small_type                 {$$ = setRoot(ctxt, mkNamedValNode(@$, $1, $3));}
+      | '(' var ':' type ')'               {$$ = setRoot(ctxt, mkNamedValNode(@$, $2, $4));}
+      | small_type                         {$$ = setRoot(ctxt, mkNamedValNode(@$, mkVarNode(@1, (char*)""), $1));}
       ;
 
 
-trait_fn_no_mods: var params RArrow type Given tc_constraints  {setNext($1, getRoot()); $$ = mkFuncDeclNode(@2, /*fn_name*/$1, /*ret_ty*/$4, /*constraints*/$6, /*body*/0);}
-                | var params RArrow type                       {setNext($1, getRoot()); $$ = mkFuncDeclNode(@2, /*fn_name*/$1, /*ret_ty*/$4, /*constraints*/0,  /*body*/0);}
+trait_fn_no_mods: var params RArrow type Given tc_constraints  {setNext($1, getRoot(ctxt)); $$ = mkFuncDeclNode(@2, /*fn_name*/$1, /*ret_ty*/$4, /*constraints*/$6, /*body*/0);}
+                | var params RArrow type                       {setNext($1, getRoot(ctxt)); $$ = mkFuncDeclNode(@2, /*fn_name*/$1, /*ret_ty*/$4, /*constraints*/0,  /*body*/0);}
                 ;
 
-trait_fn: modifiers trait_fn_no_mods  {$$ = append_modifiers(getRoot(), $2);}
+trait_fn: modifiers trait_fn_no_mods  {$$ = append_modifiers(getRoot(ctxt), $2);}
         | trait_fn_no_mods
         ;
 
 
 typevar_list: typevar_list typevar  %prec LOW  {$$ = setNext($1, mkTypeNode(@$, TT_TypeVar, (char*)$2)); }
-            | typevar               %prec LOW  {$$ = setRoot(mkTypeNode(@$, TT_TypeVar, (char*)$1)); }
+            | typevar               %prec LOW  {$$ = setRoot(ctxt, mkTypeNode(@$, TT_TypeVar, (char*)$1)); }
             ;
 
-generic_params: typevar_list  %prec LOW {$$ = getRoot();}
+generic_params: typevar_list  %prec LOW {$$ = getRoot(ctxt);}
               ;
 
 
@@ -355,30 +360,30 @@ data_decl: Type usertype generic_params '=' union_rhs     {$$ = mkDataDeclNode(@
          | Type usertype Is struct_rhs                    {$$ = mkDataDeclNode(@$, (char*)$2,  0, $4, true,  false);}
          ;
 
-union_rhs: Indent union_block Unindent              {$$ = getRoot();}
-         | explicit_tagged_union_list   %prec STMT  {$$ = getRoot();}
+union_rhs: Indent union_block Unindent              {$$ = getRoot(ctxt);}
+         | explicit_tagged_union_list   %prec STMT  {$$ = getRoot(ctxt);}
          ;
 
-struct_rhs: Indent struct_block Unindent   {$$ = getRoot();}
-          | params            %prec LOW    {$$ = getRoot();}
+struct_rhs: Indent struct_block Unindent   {$$ = getRoot(ctxt);}
+          | params            %prec LOW    {$$ = getRoot(ctxt);}
           ;
 
-union_block: union_block Newline explicit_tagged_union_list  {$$ = setNext($1, getRoot());}
+union_block: union_block Newline explicit_tagged_union_list  {$$ = setNext($1, getRoot(ctxt));}
            | explicit_tagged_union_list                    {$$ = $1;}
            ;
 
-struct_block: struct_block Newline params    {$$ = setNext($1, getRoot());}
+struct_block: struct_block Newline params    {$$ = setNext($1, getRoot(ctxt));}
             | params                       {$$ = $1;} /* leave root set */
             ;
 
 small_type_list: small_type_list small_type   {$$ = setNext($1, $2);}
-               | small_type                   {$$ = setRoot($1);}
+               | small_type                   {$$ = setRoot(ctxt, $1);}
                ;
 
-explicit_tagged_union_list: explicit_tagged_union_list '|' usertype small_type_list    %prec STMT  {$$ = setNext($1, mkNamedValNode(@$, mkVarNode(@3, (char*)$3), mkTypeNode(@4, TT_Data, (char*)"", getRoot())));}
+explicit_tagged_union_list: explicit_tagged_union_list '|' usertype small_type_list    %prec STMT  {$$ = setNext($1, mkNamedValNode(@$, mkVarNode(@3, (char*)$3), mkTypeNode(@4, TT_Data, (char*)"", getRoot(ctxt))));}
                           | explicit_tagged_union_list '|' usertype                    %prec STMT  {$$ = setNext($1, mkNamedValNode(@$, mkVarNode(@3, (char*)$3), mkTypeNode(@3, TT_Data, (char*)"", 0)));}
-                          | '|' usertype small_type_list                               %prec STMT  {$$ = setRoot(mkNamedValNode(@$, mkVarNode(@2, (char*)$2), mkTypeNode(@3, TT_Data, (char*)"", getRoot())));}
-                          | '|' usertype                                               %prec STMT  {$$ = setRoot(mkNamedValNode(@$, mkVarNode(@2, (char*)$2), mkTypeNode(@2, TT_Data, (char*)"", 0)));}
+                          | '|' usertype small_type_list                               %prec STMT  {$$ = setRoot(ctxt, mkNamedValNode(@$, mkVarNode(@2, (char*)$2), mkTypeNode(@3, TT_Data, (char*)"", getRoot(ctxt))));}
+                          | '|' usertype                                               %prec STMT  {$$ = setRoot(ctxt, mkNamedValNode(@$, mkVarNode(@2, (char*)$2), mkTypeNode(@2, TT_Data, (char*)"", 0)));}
                           ;
 
 block: Indent expr Unindent                   {$$ = mkBlockNode(@$, $2);}
@@ -437,35 +442,35 @@ tc_constraints: type  %prec LOW
 
 function_call: function_call val_no_decl    %prec LOW   {$$ = setNext($1, $2);}
              | function_call varargs        %prec LOW   {$$ = setNext($1, $2);}
-             | val_no_decl val_no_decl      %prec LOW   {setRoot($1); $$ = setNext($1, $2);}
-             | val_no_decl varargs          %prec LOW   {setRoot($1); $$ = setNext($1, $2);}
+             | val_no_decl val_no_decl      %prec LOW   {setRoot(ctxt, $1); $$ = setNext($1, $2);}
+             | val_no_decl varargs          %prec LOW   {setRoot(ctxt, $1); $$ = setNext($1, $2);}
              ;
 
 lambda_params: lambda_params var ':' small_type     {$$ = setNext($1, mkNamedValNode(@2, $2, $4));}
              | lambda_params '(' var ':' type ')'   {$$ = setNext($1, mkNamedValNode(@3, $3, $5));}
              | lambda_params small_type             {$$ = setNext($1, mkNamedValNode(@2, mkVarNode(@2, (char*)""), $2));}
              | lambda_params var                    {$$ = setNext($1, $2);}
-             | var ':' small_type                   {$$ = setRoot(mkNamedValNode(@$, $1, $3));}
-             | '(' var ':' type ')'                 {$$ = setRoot(mkNamedValNode(@$, $2, $4));}
-             | small_type                           {$$ = setRoot(mkNamedValNode(@$, mkVarNode(@1, (char*)""), $1));}
-             | var                                  {$$ = setRoot($1);}
+             | var ':' small_type                   {$$ = setRoot(ctxt, mkNamedValNode(@$, $1, $3));}
+             | '(' var ':' type ')'                 {$$ = setRoot(ctxt, mkNamedValNode(@$, $2, $4));}
+             | small_type                           {$$ = setRoot(ctxt, mkNamedValNode(@$, mkVarNode(@1, (char*)""), $1));}
+             | var                                  {$$ = setRoot(ctxt, $1);}
              ;
 
 /* NOTE: lextxt contents from fn_name and the mangleFn result are freed in the call to mkFuncDeclNode */
-fn_def: function_call RArrow type Given tc_constraints '=' expr_or_block  {$$ = mkFuncDeclNode(@1, /*name and params*/getRoot(), /*ret_ty*/$3, /*constraints*/$5, /*body*/$7);}
-      | function_call RArrow type '=' expr_or_block                       {$$ = mkFuncDeclNode(@1, /*name and params*/getRoot(), /*ret_ty*/$3, /*constraints*/0, /*body*/$5);}
+fn_def: function_call RArrow type Given tc_constraints '=' expr_or_block  {$$ = mkFuncDeclNode(@1, /*name and params*/getRoot(ctxt), /*ret_ty*/$3, /*constraints*/$5, /*body*/$7);}
+      | function_call RArrow type '=' expr_or_block                       {$$ = mkFuncDeclNode(@1, /*name and params*/getRoot(ctxt), /*ret_ty*/$3, /*constraints*/0, /*body*/$5);}
       ;
 
-fn_inferredRet: function_call Given tc_constraints '=' expr_or_block  %prec Newline  {$$ = mkFuncDeclNode(@1, /*name and params*/getRoot(), /*ret_ty*/0, /*constraints*/$3, /*body*/$5);}
-              | function_call '=' expr_or_block                       %prec Newline  {$$ = mkFuncDeclNode(@1, /*name and params*/getRoot(), /*ret_ty*/0, /*constraints*/0,  /*body*/$3);}
+fn_inferredRet: function_call Given tc_constraints '=' expr_or_block  %prec Newline  {$$ = mkFuncDeclNode(@1, /*name and params*/getRoot(ctxt), /*ret_ty*/0, /*constraints*/$3, /*body*/$5);}
+              | function_call '=' expr_or_block                       %prec Newline  {$$ = mkFuncDeclNode(@1, /*name and params*/getRoot(ctxt), /*ret_ty*/0, /*constraints*/0,  /*body*/$3);}
               ;
 
-fn_decl: function_call RArrow type Given tc_constraints  %prec Fun  {$$ = mkFuncDeclNode(@1, /*name and params*/getRoot(), /*ret_ty*/$3, /*constraints*/$5, /*body*/0);}
-       | function_call RArrow type                       %prec Fun  {$$ = mkFuncDeclNode(@1, /*name and params*/getRoot(), /*ret_ty*/$3, /*constraints*/0,  /*body*/0);}
+fn_decl: function_call RArrow type Given tc_constraints  %prec Fun  {$$ = mkFuncDeclNode(@1, /*name and params*/getRoot(ctxt), /*ret_ty*/$3, /*constraints*/$5, /*body*/0);}
+       | function_call RArrow type                       %prec Fun  {$$ = mkFuncDeclNode(@1, /*name and params*/getRoot(ctxt), /*ret_ty*/$3, /*constraints*/0,  /*body*/0);}
        ;
 
-fn_lambda: '\\' lambda_params '=' expr_or_block  %prec Fun  {auto name = new VarNode(@1, ""); setNext(name, getRoot()); $$ = mkFuncDeclNode(@$, /*name and params*/name, /*ret_ty*/0,  /*constraints*/0, /*body*/$4);}
-         | '\\' '=' expr_or_block                %prec Fun  {auto name = new VarNode(@1, "");                           $$ = mkFuncDeclNode(@$, /*name and params*/name, /*ret_ty*/0,  /*constraints*/0, /*body*/$3);}
+fn_lambda: '\\' lambda_params '=' expr_or_block  %prec Fun  {auto name = mkVarNode(@1, (char*)""); setNext(name, getRoot(ctxt)); $$ = mkFuncDeclNode(@$, /*name and params*/name, /*ret_ty*/0,  /*constraints*/0, /*body*/$4);}
+         | '\\' '=' expr_or_block                %prec Fun  {auto name = mkVarNode(@1, (char*)"");                           $$ = mkFuncDeclNode(@$, /*name and params*/name, /*ret_ty*/0,  /*constraints*/0, /*body*/$3);}
          ;
 
 ret_expr: Return expr {$$ = mkRetNode(@$, $2);}
@@ -477,19 +482,19 @@ extension: Module type Indent ext_list Unindent                     {$$ = mkExtN
          | Impl   type Given tc_constraints Indent ext_list Unindent  {$$ = mkExtNode(@$,  0, $6, $2);}
          ;
 
-ext_list: fn_list_ {$$ = getRoot();}
+ext_list: fn_list_ {$$ = getRoot(ctxt);}
 
 fn_list_: fn_list_ ext_fn maybe_newline  {$$ = setNext($1, $2);}
         | fn_list_ ext_dd maybe_newline  {$$ = setNext($1, $2);}
-        | ext_fn maybe_newline           {$$ = setRoot($1);}
-        | ext_dd maybe_newline           {$$ = setRoot($1);}
+        | ext_fn maybe_newline           {$$ = setRoot(ctxt, $1);}
+        | ext_dd maybe_newline           {$$ = setRoot(ctxt, $1);}
         ;
 
-ext_fn: modifiers function  {$$ = append_modifiers(getRoot(), $2);}
+ext_fn: modifiers function  {$$ = append_modifiers(getRoot(ctxt), $2);}
       | function
       ;
 
-ext_dd: modifiers data_decl  {$$ = append_modifiers(getRoot(), $2);}
+ext_dd: modifiers data_decl  {$$ = append_modifiers(getRoot(ctxt), $2);}
       | data_decl
       ;
 
@@ -572,7 +577,7 @@ array: '[' expr_list ']' {$$ = mkArrayNode(@$, $2);}
      ;
 
 constructor_args: constructor_args val_no_decl   %prec LOW   {$$ = setNext($1, $2);}
-                | val_no_decl                    %prec LOW   {setRoot($1);}
+                | val_no_decl                    %prec LOW   {setRoot(ctxt, $1);}
                 ;
 
 unary_op: '@' expr                                    {$$ = mkUnOpNode(@$, '@', $2);}
@@ -582,12 +587,12 @@ unary_op: '@' expr                                    {$$ = mkUnOpNode(@$, '@',
         ;
 
 /* expr is used in expression blocks and can span multiple lines */
-expr_list: expr_list_p {$$ = getRoot();}
+expr_list: expr_list_p {$$ = getRoot(ctxt);}
          ;
 
 
 expr_list_p: expr_list_p ',' maybe_newline expr  %prec ',' {$$ = setNext($1, $4);}
-           | expr                                %prec LOW {$$ = setRoot($1);}
+           | expr                                %prec LOW {$$ = setRoot(ctxt, $1);}
            ;
 
 expr_no_decl_or_jump: expr_no_decl  %prec MEDIF
@@ -628,8 +633,8 @@ expr_no_decl: expr_no_decl '+' maybe_newline expr_no_decl                      {
             | val_no_decl                                           %prec MED  {$$ = $1;}
             | unary_op                                                         {$$ = $1;}
 
-            | function_call                                         %prec LOW  {$$ = mkFuncCallNode(@$, getRoot());}
-            | usertype_node constructor_args                        %prec LOW  {$$ = mkTypeCastNode(@$, $1, getRoot());}
+            | function_call                                         %prec LOW  {$$ = mkFuncCallNode(@$, getRoot(ctxt));}
+            | usertype_node constructor_args                        %prec LOW  {$$ = mkTypeCastNode(@$, $1, getRoot(ctxt));}
             | var '=' maybe_newline expr_or_block                              {$$ = mkVarAssignNode(@$, $1, $4); append_modifiers(mkModNode(@1, Tok_Let), $$);}
             | var '=' Mut maybe_newline expr_or_block                          {$$ = mkVarAssignNode(@$, $1, $5); append_modifiers(mkModNode(@1, Tok_Mut), $$);}
             | var '=' Global maybe_newline expr_or_block                       {$$ = mkVarAssignNode(@$, $1, $5); append_modifiers(mkModNode(@1, Tok_Global), $$);}
@@ -640,10 +645,10 @@ expr_no_decl: expr_no_decl '+' maybe_newline expr_no_decl                      {
             | var '=' Const maybe_newline expr_or_block                        {$$ = mkVarAssignNode(@$, $1, $5); append_modifiers(mkModNode(@1, Tok_Const), $$);}
             | var '=' preproc maybe_newline expr_or_block                      {$$ = mkVarAssignNode(@$, $1, $5); append_modifiers($3, $$);}
 
-            | expr_no_decl AddEq maybe_newline expr_no_decl             {$$ = mkVarAssignNode(@$, $1, mkBinOpNode(@$, '+', $1, $4), false);}
-            | expr_no_decl SubEq maybe_newline expr_no_decl             {$$ = mkVarAssignNode(@$, $1, mkBinOpNode(@$, '-', $1, $4), false);}
-            | expr_no_decl MulEq maybe_newline expr_no_decl             {$$ = mkVarAssignNode(@$, $1, mkBinOpNode(@$, '*', $1, $4), false);}
-            | expr_no_decl DivEq maybe_newline expr_no_decl             {$$ = mkVarAssignNode(@$, $1, mkBinOpNode(@$, '/', $1, $4), false);}
+            | expr_no_decl AddEq maybe_newline expr_no_decl             {$$ = mkVarAssignNode(@$, $1, mkBinOpNode(@$, '+', $1, $4));}
+            | expr_no_decl SubEq maybe_newline expr_no_decl             {$$ = mkVarAssignNode(@$, $1, mkBinOpNode(@$, '-', $1, $4));}
+            | expr_no_decl MulEq maybe_newline expr_no_decl             {$$ = mkVarAssignNode(@$, $1, mkBinOpNode(@$, '*', $1, $4));}
+            | expr_no_decl DivEq maybe_newline expr_no_decl             {$$ = mkVarAssignNode(@$, $1, mkBinOpNode(@$, '/', $1, $4));}
             | expr_no_decl Assign maybe_newline expr_no_decl            {$$ = mkVarAssignNode(@$, $1, $4);} /* All VarAssignNodes return unit values */
             | expr_no_decl Assign maybe_newline block                   {$$ = mkVarAssignNode(@$, $1, $4);} /* All VarAssignNodes return unit values */
 //            | modifiers expr_no_decl  %prec Newline       {$$ = append_modifiers($1, $2);}
@@ -698,8 +703,8 @@ expr: expr '+' maybe_newline expr                               {$$ = mkBinOpNod
     | val                                            %prec MED  {$$ = $1;}
     | unary_op                                                  {$$ = $1;}
 
-    | function_call                                  %prec LOW  {$$ = mkFuncCallNode(@$, getRoot());}
-    | usertype_node constructor_args                 %prec LOW  {$$ = mkTypeCastNode(@$, $1, getRoot());}
+    | function_call                                  %prec LOW  {$$ = mkFuncCallNode(@$, getRoot(ctxt));}
+    | usertype_node constructor_args                 %prec LOW  {$$ = mkTypeCastNode(@$, $1, getRoot(ctxt));}
     | var '=' maybe_newline expr_or_block                       {$$ = mkVarAssignNode(@$, $1, $4); append_modifiers(mkModNode(@1, Tok_Let), $$);}
     | var '=' Mut maybe_newline expr_or_block                   {$$ = mkVarAssignNode(@$, $1, $5); append_modifiers(mkModNode(@1, Tok_Mut), $$);}
     | var '=' Global maybe_newline expr_or_block                {$$ = mkVarAssignNode(@$, $1, $5); append_modifiers(mkModNode(@1, Tok_Global), $$);}
@@ -710,10 +715,10 @@ expr: expr '+' maybe_newline expr                               {$$ = mkBinOpNod
     | var '=' Const maybe_newline expr_or_block                 {$$ = mkVarAssignNode(@$, $1, $5); append_modifiers(mkModNode(@1, Tok_Const), $$);}
     | var '=' preproc maybe_newline expr_or_block               {$$ = mkVarAssignNode(@$, $1, $5); append_modifiers($3, $$);}
 
-    | expr AddEq maybe_newline expr                             {$$ = mkVarAssignNode(@$, $1, mkBinOpNode(@$, '+', $1, $4), false);}
-    | expr SubEq maybe_newline expr                             {$$ = mkVarAssignNode(@$, $1, mkBinOpNode(@$, '-', $1, $4), false);}
-    | expr MulEq maybe_newline expr                             {$$ = mkVarAssignNode(@$, $1, mkBinOpNode(@$, '*', $1, $4), false);}
-    | expr DivEq maybe_newline expr                             {$$ = mkVarAssignNode(@$, $1, mkBinOpNode(@$, '/', $1, $4), false);}
+    | expr AddEq maybe_newline expr                             {$$ = mkVarAssignNode(@$, $1, mkBinOpNode(@$, '+', $1, $4));}
+    | expr SubEq maybe_newline expr                             {$$ = mkVarAssignNode(@$, $1, mkBinOpNode(@$, '-', $1, $4));}
+    | expr MulEq maybe_newline expr                             {$$ = mkVarAssignNode(@$, $1, mkBinOpNode(@$, '*', $1, $4));}
+    | expr DivEq maybe_newline expr                             {$$ = mkVarAssignNode(@$, $1, mkBinOpNode(@$, '/', $1, $4));}
     | expr Assign maybe_newline expr                            {$$ = mkVarAssignNode(@$, $1, $4);} /* All VarAssignNodes return unit values */
     | expr Assign maybe_newline block                           {$$ = mkVarAssignNode(@$, $1, $4);} /* All VarAssignNodes return unit values */
 //    | modifiers expr  %prec Newline                {$$ = append_modifiers($1, $2);}
@@ -734,7 +739,7 @@ expr: expr '+' maybe_newline expr                               {$$ = mkBinOpNod
 
 /* location parser error */
 void yy::parser::error(const location& loc, const string& msg){
-    if(++ante_parser_errcount > 5){
+    if(++ctxt.errorCount > 5){
         std::cerr << "Too many errors, exiting.\n";
         exit(2);
     }
@@ -744,18 +749,18 @@ void yy::parser::error(const location& loc, const string& msg){
 
 namespace ante {
     namespace parser {
-        vector<unique_ptr<TypeNode>> toOwnedVec(Node *tn){
-            vector<unique_ptr<TypeNode>> ret;
+        vector<ArenaPtr<TypeNode>> toNodeVec(Node *tn){
+            vector<ArenaPtr<TypeNode>> ret;
             while(tn){
-                ret.push_back(unique_ptr<TypeNode>((TypeNode*)tn));
+                ret.push_back(ArenaPtr<TypeNode>((TypeNode*)tn));
                 tn = tn->next.get();
             }
             return ret;
         }
 
-        vector<unique_ptr<TypeNode>> concat(vector<unique_ptr<TypeNode>>&& l, Node *tn){
-            auto r = toOwnedVec(tn);
-            vector<unique_ptr<TypeNode>> ret;
+        vector<ArenaPtr<TypeNode>> concat(vector<ArenaPtr<TypeNode>>&& l, Node *tn){
+            auto r = toNodeVec(tn);
+            vector<ArenaPtr<TypeNode>> ret;
             ret.reserve(l.size() + r.size());
             for(auto &&e : l) ret.insert(ret.end(), move(e));
             for(auto &&e : r) ret.insert(ret.end(), move(e));
@@ -764,7 +769,6 @@ namespace ante {
 
         Node* name(Node *varNode){
             char* name = strdup(((VarNode*)varNode)->name.c_str());
-            delete varNode;
             return (Node*)name;
         }
     }
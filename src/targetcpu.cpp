@@ -0,0 +1,81 @@
+#include "targetcpu.h"
+#include <algorithm>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/IR/Module.h>
+#include <llvm/MC/SubtargetFeature.h>
+#include <llvm/Support/Host.h>
+
+using namespace std;
+using namespace llvm;
+
+namespace ante {
+
+    TargetCpu targetCpu;
+
+    TargetCpu getHostCpu(){
+        SubtargetFeatures features;
+
+        StringMap<bool> hostFeatures;
+        if(sys::getHostCPUFeatures(hostFeatures)){
+            for(auto &feature : hostFeatures)
+                features.AddFeature(feature.first(), feature.second);
+        }
+
+        return {sys::getHostCPUName().str(), features.getString()};
+    }
+
+
+    void setTargetCpu(string const& cpu, string const& extraFeatures){
+        if(cpu == "native"){
+            targetCpu = getHostCpu();
+        }else{
+            targetCpu.cpu = cpu;
+            targetCpu.features = "";
+        }
+
+        //features given later take precedence over the host's
+        if(!extraFeatures.empty()){
+            if(!targetCpu.features.empty())
+                targetCpu.features += ',';
+            targetCpu.features += extraFeatures;
+        }
+    }
+
+
+    TargetCpu const& getTargetCpu(){
+        return targetCpu;
+    }
+
+
+    bool runsOnHost(TargetCpu const& target){
+        auto host = getHostCpu();
+        if(!target.cpu.empty() && target.cpu != host.cpu)
+            return false;
+
+        auto hostFeatures = SubtargetFeatures(host.features).getFeatures();
+        SubtargetFeatures targetFeatures{target.features};
+        for(auto &feature : targetFeatures.getFeatures()){
+            //disabling a feature is always safe
+            if(SubtargetFeatures::hasFlag(feature) && feature[0] == '-')
+                continue;
+
+            string enabled = SubtargetFeatures::hasFlag(feature) ? feature : '+' + feature;
+            if(find(hostFeatures.begin(), hostFeatures.end(), enabled) == hostFeatures.end())
+                return false;
+        }
+        return true;
+    }
+
+
+    void addTargetCpuAttributes(Module &mod){
+        for(auto &f : mod){
+            if(f.isDeclaration())
+                continue;
+
+            if(!targetCpu.cpu.empty())
+                f.addFnAttr("target-cpu", targetCpu.cpu);
+            if(!targetCpu.features.empty())
+                f.addFnAttr("target-features", targetCpu.features);
+        }
+    }
+}
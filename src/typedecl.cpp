@@ -1,7 +1,9 @@
 #include "typedecl.h"
 #include "antype.h"
 #include "compiler.h"
+#include "types.h"
 #include "util.h"
+#include <numeric>
 
 namespace ante {
     using std::vector;
@@ -14,11 +16,12 @@ namespace ante {
 
     vector<AnType*> TypeDecl::getBoundFieldTypes(const AnDataType *dt) const {
         auto baseType = cast<AnDataType>(this->type);
-        auto pair = ante::tryUnify(baseType->typeArgs, dt->typeArgs);
-        assert(pair.first);
+        UnionFind bindings;
+        auto status = ante::tryUnify(baseType->typeArgs, dt->typeArgs, bindings);
+        assert(status == UnifyStatus::Success);
 
         return ante::applyToAll(fieldTypes, [&](AnType *field){
-            return ante::applySubstitutions(pair.second, field);
+            return bindings.resolve(field);
         });
     }
 
@@ -26,61 +29,289 @@ namespace ante {
         return fieldTypes;
     }
 
-    vector<AnType*> TypeDecl::getLargestVariantFieldTypes(Compiler *c, const AnDataType *dt) const {
-        auto variant = dt->decl->getLargestVariant(c, dt);
-        vector<AnType*> fields = { AnType::getU8(), const_cast<AnType*>(variant) };
+    /**
+     * Fields are sorted by decreasing alignment, which minimizes padding
+     * since each alignment is a power of 2.  The sort is stable so types
+     * with uniformly aligned fields keep their declaration order.
+     */
+    vector<llvm::Type*> TypeDecl::getStructBody(Compiler *c, const AnDataType *dt) const {
+        auto &layout = c->module->getDataLayout();
 
-        auto baseType = cast<AnDataType>(this->type);
-        auto pair = ante::tryUnify(baseType->typeArgs, dt->typeArgs);
-        assert(pair.first);
-
-        return ante::applyToAll(fields, [&](AnType *field){
-            return ante::applySubstitutions(pair.second, field);
+        auto tys = ante::applyToAll(getBoundFieldTypes(dt), [&](AnType *t){
+            return c->anTypeToLlvmType(t);
         });
+
+        vector<unsigned int> order(tys.size());
+        std::iota(order.begin(), order.end(), 0);
+
+        if(!isReprC){
+            auto alignOf = [&](llvm::Type *t){
+                return t->isSized() ? layout.getABITypeAlignment(t) : 1;
+            };
+            std::stable_sort(order.begin(), order.end(), [&](unsigned int l, unsigned int r){
+                return alignOf(tys[l]) > alignOf(tys[r]);
+            });
+        }
+
+        vector<llvm::Type*> body(tys.size());
+        vector<unsigned int> indices(tys.size());
+        for(unsigned int i = 0; i < order.size(); i++){
+            body[i] = tys[order[i]];
+            indices[order[i]] = i;
+        }
+
+        fieldIndices[dt->typeArgs] = move(indices);
+        return body;
+    }
+
+    /**
+     * A union is laid out as its u8 tag followed by its most aligned variant,
+     * padded to the size of its largest variant.  Each variant is stored as
+     * (u8, variant) in this space so its fields are always naturally aligned.
+     */
+    vector<llvm::Type*> TypeDecl::getUnionBody(Compiler *c, const AnDataType *dt) const {
+        auto &layout = c->module->getDataLayout();
+        auto *tagTy = llvm::Type::getInt8Ty(*c->ctxt);
+        auto variants = getBoundFieldTypes(dt);
+
+        auto niche = findNiche(c, dt);
+        niches[dt->typeArgs] = niche;
+        if(niche.kind == UnionNiche::Kind::SpareBool){
+            return {tagTy};
+        }else if(niche.kind != UnionNiche::Kind::None){
+            //stored the same as the variant's own tuple, which holds only the one value
+            auto *variantTy = llvm::cast<llvm::StructType>(c->anTypeToLlvmType(variants[niche.variant]));
+            return variantTy->elements().vec();
+        }
+
+        llvm::Type *payload = nullptr;
+        uint64_t size = 0;
+
+        for(size_t i = 0; i < variants.size(); i++){
+            auto *variantTy = c->anTypeToLlvmType(variants[i]);
+
+            //a variant containing this union by value leaves it unsized,
+            //which getSizeInBits reports as an infinite size
+            auto *taggedVariantTy = getVariantLlvmType(c, dt, i);
+            if(!taggedVariantTy->isSized())
+                return {tagTy, variantTy};
+
+            size = std::max(size, layout.getTypeAllocSize(taggedVariantTy).getFixedSize());
+
+            if(!payload || layout.getABITypeAlignment(variantTy) > layout.getABITypeAlignment(payload))
+                payload = variantTy;
+        }
+
+        vector<llvm::Type*> body = {tagTy, payload};
+        auto *structLayout = layout.getStructLayout(llvm::StructType::get(*c->ctxt, body));
+        uint64_t end = structLayout->getElementOffset(1) + layout.getTypeAllocSize(payload).getFixedSize();
+
+        if(end < size)
+            body.push_back(llvm::ArrayType::get(tagTy, size - end));
+        return body;
+    }
+
+    /**
+     * Pointers in Ante may be null so a null pointer is only free to represent
+     * the union's other variant if the union is declared ![nonnull].  Spare tag
+     * and bool values are never held by a valid value, but ![repr_c] unions
+     * still keep their tag so their layout matches C's.
+     */
+    UnionNiche TypeDecl::findNiche(Compiler *c, const AnDataType *dt) const {
+        auto variants = getBoundFieldTypes(dt);
+        if(variants.size() != 2)
+            return {};
+
+        auto countStoredFields = [&](AnType *variant, AnType **stored){
+            size_t count = 0;
+            for(auto *field : cast<AnTupleType>(variant)->fields){
+                if(!isEmptyType(c, field)){
+                    *stored = field;
+                    count++;
+                }
+            }
+            return count;
+        };
+
+        AnType *stored = nullptr;
+        for(int i = 0; i < 2; i++){
+            AnType *other = nullptr;
+            if(countStoredFields(variants[i], &stored) != 1 || countStoredFields(variants[1 - i], &other) != 0)
+                continue;
+
+            auto *field = applySubstitutions(c->compCtxt->monomorphisationMappings, stored);
+            if(field->typeTag == TT_Ptr){
+                if(isNonNull)
+                    return {UnionNiche::Kind::NullPtr, i, 0};
+
+            }else if(isReprC || field->hasModifier(Tok_Mut)){
+                continue;
+
+            }else if(field->typeTag == TT_Bool){
+                return {UnionNiche::Kind::SpareBool, i, 2};
+
+            }else if(auto *inner = try_cast<AnDataType>(field)){
+                int spare = inner->decl->getSpareTagValue(c, inner);
+                if(spare != -1)
+                    return {UnionNiche::Kind::SpareTag, i, (uint8_t)spare};
+            }
+        }
+        return {};
+    }
+
+    /**
+     * Layouts are cached per list of type args, so generic types like Pair 'a 'b
+     * must be bound to the current monomorphisation mappings before a lookup
+     * or every instantiation would share the layout of the first one lowered.
+     */
+    static const AnDataType* bindTypeArgs(Compiler *c, const AnDataType *dt){
+        return cast<AnDataType>(bindTypeVars(c, (AnType*)dt));
+    }
+
+    UnionNiche const& TypeDecl::getNiche(Compiler *c, const AnDataType *dt) const {
+        static const UnionNiche tagged;
+        if(!isUnionType)
+            return tagged;
+
+        dt = bindTypeArgs(c, dt);
+        toLlvmType(c, dt);
+        auto it = niches.find(dt->typeArgs);
+        return it != niches.end() ? it->second : tagged;
+    }
+
+    int TypeDecl::getNicheVariant(Compiler *c, const AnDataType *dt) const {
+        return getNiche(c, dt).variant;
+    }
+
+    int TypeDecl::getSpareTagValue(Compiler *c, const AnDataType *dt) const {
+        if(!isUnionType)
+            return -1;
+
+        dt = bindTypeArgs(c, dt);
+
+        //a union still being laid out, eg. one containing itself, is unsized
+        //and has no entry in niches yet
+        auto *ty = toLlvmType(c, dt);
+        auto it = niches.find(dt->typeArgs);
+        if(!ty->isSized() || it == niches.end())
+            return -1;
+
+        size_t spare;
+        switch(it->second.kind){
+            case UnionNiche::Kind::None:    spare = fields.size(); break;
+            case UnionNiche::Kind::NullPtr: return -1;
+            default:                        spare = it->second.value + 1; break;
+        }
+        return spare <= UINT8_MAX ? (int)spare : -1;
+    }
+
+    /**
+     * Returns the indices of the niche within a union stored without a tag:
+     * its pointer, bool byte, or the tag byte of the union or enum it holds.
+     * The niche is always the first scalar of the union.
+     */
+    static vector<unsigned int> getNichePath(llvm::Type *unionTy){
+        vector<unsigned int> path;
+        while(auto *structTy = llvm::dyn_cast<llvm::StructType>(unionTy)){
+            path.push_back(0);
+            unionTy = structTy->getElementType(0);
+        }
+        return path;
+    }
+
+    static llvm::Constant* getNicheConstant(UnionNiche const& niche, llvm::Type *nicheTy){
+        if(niche.kind == UnionNiche::Kind::NullPtr)
+            return llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(nicheTy));
+        return llvm::ConstantInt::get(nicheTy, niche.value);
+    }
+
+    /** Returns an i1 which is true if the given niche-tagged union holds its empty variant */
+    static llvm::Value* isNicheEmpty(Compiler *c, UnionNiche const& niche, llvm::Value *unionVal){
+        auto *nicheVal = c->builder.CreateExtractValue(unionVal, getNichePath(unionVal->getType()));
+        return c->builder.CreateICmpEQ(nicheVal, getNicheConstant(niche, nicheVal->getType()));
+    }
+
+    llvm::Value* TypeDecl::isVariant(Compiler *c, const AnDataType *dt, llvm::Value *unionVal, size_t tag) const {
+        dt = bindTypeArgs(c, dt);
+
+        auto &niche = getNiche(c, dt);
+        if(niche.kind != UnionNiche::Kind::None){
+            auto *isEmpty = isNicheEmpty(c, niche, unionVal);
+            return (int)tag == niche.variant
+                ? c->builder.CreateNot(isEmpty)
+                : isEmpty;
+        }
+
+        auto *first = c->builder.CreateExtractValue(unionVal, 0);
+        auto *tagVal = llvm::ConstantInt::get(first->getType(), tag);
+        return c->builder.CreateICmpEQ(first, tagVal);
+    }
+
+    llvm::Value* TypeDecl::getTag(Compiler *c, const AnDataType *dt, llvm::Value *unionVal) const {
+        dt = bindTypeArgs(c, dt);
+
+        auto &niche = getNiche(c, dt);
+        if(niche.kind == UnionNiche::Kind::None){
+            return c->builder.CreateExtractValue(unionVal, 0);
+        }
+
+        auto *tagTy = llvm::Type::getInt8Ty(*c->ctxt);
+        return c->builder.CreateSelect(isNicheEmpty(c, niche, unionVal),
+                llvm::ConstantInt::get(tagTy, 1 - niche.variant),
+                llvm::ConstantInt::get(tagTy, niche.variant));
+    }
+
+    llvm::Value* TypeDecl::getNichePayload(Compiler *c, const AnDataType *dt, llvm::Value *unionVal, llvm::Type *payloadTy) const {
+        auto *payload = c->builder.CreateExtractValue(unionVal, 0);
+        if(getNiche(c, dt).kind == UnionNiche::Kind::SpareBool)
+            return c->builder.CreateTrunc(payload, payloadTy);
+        return c->builder.CreateBitCast(payload, payloadTy);
+    }
+
+    llvm::StructType* TypeDecl::getVariantLlvmType(Compiler *c, const AnDataType *dt, size_t tag) const {
+        auto *variant = getBoundFieldTypes(dt)[tag];
+        return llvm::StructType::get(*c->ctxt, {llvm::Type::getInt8Ty(*c->ctxt), c->anTypeToLlvmType(variant)});
     }
 
     llvm::Type* TypeDecl::toLlvmType(Compiler *c, const AnDataType *dt) const {
+        dt = bindTypeArgs(c, dt);
         auto it = variantTypes.find(dt->typeArgs);
         if(it != variantTypes.end()){
             return it->second;
         }
 
-        bool isPacked = this->isUnionType;
         auto structTy = llvm::StructType::create(*c->ctxt, dt->name);
 
         variantTypes[dt->typeArgs] = structTy;
 
-        vector<AnType*> fields = isUnionType
-            ? getLargestVariantFieldTypes(c, dt)
-            : getBoundFieldTypes(dt);
+        auto body = isUnionType
+            ? getUnionBody(c, dt)
+            : getStructBody(c, dt);
 
-        auto tys = ante::applyToAll(fields, [&](AnType *t){
-            return c->anTypeToLlvmType(t);
-        });
-
-        structTy->setBody(tys, isPacked);
+        structTy->setBody(body);
         return structTy;
     }
 
     Result<size_t, string>
     TypeDecl::getSizeInBits(Compiler *c, string const& incompleteType, const AnDataType *type) const {
-        if(isUnionType){
-            auto size = getLargestVariant(c, type)->getSizeInBits(c, incompleteType);
-            if(size) return size.getVal() + 8;
-            else return size;
-        }else{
-            auto t = AnTupleType::get(getBoundFieldTypes(type));
-            auto size = t->getSizeInBits(c, incompleteType);
-            delete t;
-            return size;
-        }
+        auto *ty = toLlvmType(c, type);
+        if(!ty->isSized())
+            return "Type " + anTypeToStr(type) + " has infinite size";
+
+        return c->module->getDataLayout().getTypeAllocSizeInBits(ty).getFixedSize();
     }
 
-    size_t TypeDecl::getFieldIndex(std::string const& field) const {
+    size_t TypeDecl::getFieldIndex(Compiler *c, const AnDataType *type, std::string const& field) const {
         assert(!isUnionType);
         auto it = ante::find(fields, field);
         assert(it != fields.end());
-        return it - fields.begin();
+        return getFieldIndices(c, type)[it - fields.begin()];
+    }
+
+    vector<unsigned int> const& TypeDecl::getFieldIndices(Compiler *c, const AnDataType *type) const {
+        type = bindTypeArgs(c, type);
+        toLlvmType(c, type);
+        return fieldIndices[type->typeArgs];
     }
 
     size_t TypeDecl::getTagIndex(std::string const& tag) const {
@@ -90,47 +321,51 @@ namespace ante {
         return it - fields.begin();
     }
 
-    const AnType* TypeDecl::getLargestVariant(Compiler *c, const AnDataType *type) const {
-        const AnType* largest = nullptr;
-        size_t largestSize = 0;
-
-        auto fields = getBoundFieldTypes(type);
-        for(auto field : fields){
-            auto size = field->getSizeInBits(c);
-            if(size.getVal() >= largestSize){
-                largest = field;
-                largestSize = size.getVal();
-            }
-        }
-
-        return largest;
-    }
-
     llvm::Value* TypeDecl::getTagValue(Compiler *c, const AnDataType *type,
             string const& variantName, vector<TypedValue> const& args) const {
 
-        vector<llvm::Type*> unionTys;
-        vector<llvm::Constant*> unionVals;
-
         size_t tag = type->decl->getTagIndex(variantName);
-        unionTys.push_back(llvm::Type::getInt8Ty(*c->ctxt));
-        unionVals.push_back(llvm::ConstantInt::get(*c->ctxt, llvm::APInt(8, tag, true))); //tag
+        auto *variant = cast<AnTupleType>(getBoundFieldTypes(type)[tag]);
 
-        for(auto &tval : args){
-            unionTys.push_back(tval.getType());
-            unionVals.push_back(llvm::UndefValue::get(tval.getType()));
-        }
+        auto &niche = getNiche(c, type);
+        if(niche.kind != UnionNiche::Kind::None){
+            auto *unionTy = llvm::cast<llvm::StructType>(c->anTypeToLlvmType(type));
+            llvm::Value *unionVal = llvm::UndefValue::get(unionTy);
 
-        auto unionTy = c->anTypeToLlvmType(type);
+            if((int)tag == niche.variant){
+                llvm::Value *payload = nullptr;
+                for(size_t arg = 0; arg < args.size(); arg++){
+                    if(!isEmptyType(c, variant->fields[arg]))
+                        payload = args[arg].val;
+                }
+
+                auto *storedTy = unionTy->getElementType(0);
+                payload = niche.kind == UnionNiche::Kind::SpareBool
+                    ? c->builder.CreateZExt(payload, storedTy)
+                    : c->builder.CreateBitCast(payload, storedTy);
+                return c->builder.CreateInsertValue(unionVal, payload, 0);
+            }
+
+            auto path = getNichePath(unionTy);
+            auto *nicheTy = llvm::ExtractValueInst::getIndexedType(unionTy, path);
+            return c->builder.CreateInsertValue(unionVal, getNicheConstant(niche, nicheTy), path);
+        }
 
         //create a struct of (u8 tag, <union member type>)
-        auto structTy = llvm::StructType::get(*c->ctxt, unionTys, true);
-        llvm::Value *taggedUnion = llvm::ConstantStruct::get(structTy, unionVals);
-        size_t i = 0;
-        for(auto &arg : args){
-            taggedUnion = c->builder.CreateInsertValue(taggedUnion, arg.val, ++i);
+        auto structTy = getVariantLlvmType(c, type, tag);
+        auto *tagVal = llvm::ConstantInt::get(*c->ctxt, llvm::APInt(8, tag, true));
+        llvm::Value *taggedUnion = llvm::ConstantStruct::get(structTy,
+                {tagVal, llvm::UndefValue::get(structTy->getElementType(1))});
+
+        //empty fields are not stored in the variant's llvm type
+        unsigned int i = 0;
+        for(size_t arg = 0; arg < args.size(); arg++){
+            if(!isEmptyType(c, variant->fields[arg]))
+                taggedUnion = c->builder.CreateInsertValue(taggedUnion, args[arg].val, {1, i++});
         }
 
+        auto unionTy = c->anTypeToLlvmType(type);
+
         //allocate for the largest possible union member
         auto *alloca = c->builder.CreateAlloca(unionTy);
 
@@ -219,19 +219,19 @@ namespace ante {
     }
 
     vector<TraitImpl*> getAllTcConstraints(AnFunctionType *fn, UnificationList const& constraints,
-            Substitutions const& substitutions){
+            UnionFind &bindings){
 
         auto tcConstraints = fn->typeClassConstraints;
         for(auto &c : constraints){
             if(!c.isEqConstraint()){
-                auto resolved = applySubstitutions(substitutions, c.asTypeClassConstraint());
+                auto resolved = bindings.resolve(c.asTypeClassConstraint());
                 tcConstraints.push_back(resolved);
             }
         }
         return tcConstraints;
     }
 
-    vector<TraitImpl*> toTraitTypeVec(std::unique_ptr<TypeNode> const& tn, Module *module){
+    vector<TraitImpl*> toTraitTypeVec(ArenaPtr<TypeNode> const& tn, Module *module){
         vector<TraitImpl*> ret;
         for(Node &n : *tn){
             ret.push_back(toTrait((TypeNode*)&n, module));
@@ -271,9 +271,10 @@ namespace ante {
             ConstraintFindingVisitor step2{module};
             step2.visit(n);
             auto constraints = step2.getConstraints();
-            auto substitutions = unify(constraints);
-            if(!substitutions.empty()){
-                SubstitutingVisitor::substituteIntoAst(n, substitutions, module);
+            UnionFind bindings;
+            unify(constraints, bindings);
+            if(!bindings.empty()){
+                SubstitutingVisitor::substituteIntoAst(n, bindings, module);
             }
         }else{
             for(Node &m : *n->methods){
@@ -343,18 +344,19 @@ namespace ante {
         tryTo([&]{
             n->accept(step2);
             auto constraints = step2.getConstraints();
-            auto substitutions = unify(constraints);
-            if(!substitutions.empty()){
+            UnionFind bindings;
+            unify(constraints, bindings);
+            if(!bindings.empty()){
                 // apply typeclass constraints to function before substitution.
                 // it may save some time for non-generic functions to apply them afterward separately.
                 auto fnTy = try_cast<AnFunctionType>(n->getType());
-                auto tcConstraints = getAllTcConstraints(fnTy, constraints, substitutions);
+                auto tcConstraints = getAllTcConstraints(fnTy, constraints, bindings);
                 auto newFnTy = AnFunctionType::get(fnTy->retTy, fnTy->paramTys, tcConstraints);
 
                 newFnTy = cleanTypeClassConstraints(newFnTy);
                 n->setType(newFnTy);
 
-                SubstitutingVisitor::substituteIntoAst(n, substitutions, this->module);
+                SubstitutingVisitor::substituteIntoAst(n, bindings, this->module);
             }
         });
     }
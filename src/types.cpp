@@ -50,6 +50,42 @@ bool isEmptyType(Compiler *c, AnType *ty){
 }
 
 
+AnType* bindTypeVars(Compiler *c, AnType *t){
+    if(!containsTypeVar(t))
+        return t;
+
+    auto bindAll = [&](vector<AnType*> const& tys){
+        return ante::applyToAll(tys, [&](AnType *ty){ return bindTypeVars(c, ty); });
+    };
+
+    if(t->isModifierType()){
+        auto modTy = static_cast<AnModifier*>(t);
+        return (AnType*)modTy->addModifiersTo(bindTypeVars(c, (AnType*)modTy->extTy));
+    }
+
+    if(auto tv = try_cast<AnTypeVarType>(t)){
+        auto binding = findBinding(c->compCtxt->monomorphisationMappings, tv);
+        return binding ? bindTypeVars(c, binding) : t;
+
+    }else if(auto dt = try_cast<AnDataType>(t)){
+        return AnDataType::get(dt->name, bindAll(dt->typeArgs), dt->decl);
+
+    }else if(auto ptr = try_cast<AnPtrType>(t)){
+        return AnPtrType::get(bindTypeVars(c, ptr->elemTy));
+
+    }else if(auto arr = try_cast<AnArrayType>(t)){
+        return AnArrayType::get(bindTypeVars(c, arr->extTy), arr->len);
+
+    }else if(auto tup = try_cast<AnTupleType>(t)){
+        return AnTupleType::getAnonRecord(bindAll(tup->fields), tup->fieldNames);
+
+    }else if(auto fn = try_cast<AnFunctionType>(t)){
+        return AnFunctionType::get(bindTypeVars(c, fn->retTy), bindAll(fn->paramTys), fn->typeClassConstraints);
+    }
+    return t;
+}
+
+
 /*
  *  Returns the TypeNode* value of a TypedValue of type TT_Type
  */
@@ -58,36 +94,19 @@ AnType* extractTypeValue(const TypedValue &tv){
     return (AnType*) zext;
 }
 
+/*
+ *  Sizes include any padding needed by the target's alignment
+ *  requirements so they always match llvm's DataLayout.
+ */
 Result<size_t, string> AnType::getSizeInBits(Compiler *c, string const& incompleteType) const{
-    size_t total = 0;
-
-    if(isPrimitiveTypeTag(this->typeTag))
-        return getBitWidthOfTypeTag(this->typeTag);
-
     if(auto *dataTy = try_cast<AnDataType>(this)){
         if(dataTy->name == incompleteType){
             cerr << "Incomplete type " << anTypeToColoredStr(this) << endl;
             throw IncompleteTypeError();
         }
 
-        return dataTy->decl->getSizeInBits(c, incompleteType, dataTy);
-
-    // function & metafunction are aggregate types but have different sizes than
-    // a tuple so this case must be checked for before AnTupleType is
-    }else if(typeTag == TT_Ptr || typeTag == TT_Function){
-        return AN_USZ_SIZE;
-
-    }else if(auto *tup = try_cast<AnTupleType>(this)){
-        for(auto *ext : tup->fields){
-            auto val = ext->getSizeInBits(c, incompleteType);
-            if(!val) return val;
-            total += val.getVal();
-        }
-
-    }else if(auto *arr = try_cast<AnArrayType>(this)){
-        auto val = arr->extTy->getSizeInBits(c, incompleteType);
-        if(!val) return val;
-        return arr->len * val.getVal();
+        auto *bound = cast<AnDataType>(bindTypeVars(c, (AnType*)dataTy));
+        return bound->decl->getSizeInBits(c, incompleteType, bound);
 
     }else if(auto *tvt = try_cast<AnTypeVarType>(this)){
         AnType *lookup = findBinding(c->compCtxt->monomorphisationMappings, tvt);
@@ -98,9 +117,39 @@ Result<size_t, string> AnType::getSizeInBits(Compiler *c, string const& incomple
             // so we treat them as () here
             return 0; //"Unknown typevar " + tvt->name;
         }
+
+    }else if(auto *arr = try_cast<AnArrayType>(this)){
+        auto val = arr->extTy->getSizeInBits(c, incompleteType);
+        if(!val) return val;
+        return arr->len * val.getVal();
+
+    }else if(typeTag == TT_Unit){
+        return 0;
     }
 
-    return total;
+    auto *ty = c->anTypeToLlvmType(this);
+    if(!ty->isSized())
+        return "Type " + anTypeToStr(this) + " has infinite size";
+
+    return c->module->getDataLayout().getTypeAllocSizeInBits(ty).getFixedSize();
+}
+
+
+vector<size_t> getFieldOffsets(Compiler *c, const AnTupleType *tuple){
+    auto *structTy = cast<StructType>(c->anTypeToLlvmType(tuple));
+    auto *layout = c->module->getDataLayout().getStructLayout(structTy);
+
+    vector<size_t> offsets;
+    unsigned int index = 0;
+    for(auto *field : tuple->fields){
+        //empty fields are not stored so they share the offset of the next field
+        if(isEmptyType(c, field)){
+            offsets.push_back(index < structTy->getNumElements() ? layout->getElementOffset(index) : layout->getSizeInBytes());
+        }else{
+            offsets.push_back(layout->getElementOffset(index++));
+        }
+    }
+    return offsets;
 }
 
 
@@ -172,6 +221,20 @@ Type* typeTagToLlvmType(TypeTag ty, LLVMContext &ctxt){
  *  unfortunate necessity for the use of a TypedValue for the storage of this information.
  */
 Type* Compiler::anTypeToLlvmType(const AnType *ty, int recursionLimit){
+    //Only types containing typevars depend on the current monomorphisation mappings.
+    //isGeneric cannot be used here since it is false for data types like Maybe 't
+    unsigned int version = containsTypeVar(ty) ? compCtxt->mappingsVersion : 0;
+
+    auto it = llvmTypeCache.find(ty);
+    if(it != llvmTypeCache.end() && it->second.second == version)
+        return it->second.first;
+
+    Type *ret = lowerAnType(ty, recursionLimit);
+    llvmTypeCache[ty] = {ret, version};
+    return ret;
+}
+
+Type* Compiler::lowerAnType(const AnType *ty, int recursionLimit){
     vector<Type*> tys;
     if(!recursionLimit){
         ASSERT_UNREACHABLE("anTypeToLlvmType hit internal recursion limit");
@@ -200,7 +263,9 @@ Type* Compiler::anTypeToLlvmType(const AnType *ty, int recursionLimit){
             }
             return StructType::get(*ctxt, tys);
         case TT_Data: {
-            auto *dt = cast<AnDataType>(ty);
+            //the decl caches a layout per list of type args, so they must be bound
+            //first or each instantiation of Maybe 't would share the first's layout
+            auto *dt = cast<AnDataType>(bindTypeVars(this, (AnType*)ty));
             return dt->decl->toLlvmType(this, dt);
         }
         case TT_Function: {
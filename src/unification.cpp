@@ -2,9 +2,11 @@
 #include "types.h"
 #include "trait.h"
 #include "util.h"
+#include <atomic>
 
 namespace ante {
-    size_t curTypeVar = 0;
+    /** Atomic since the parser creates typevars for inferred types while parsing imports in parallel */
+    std::atomic<size_t> curTypeVar{0};
 
     AnTypeVarType* nextTypeVar(){
         return AnTypeVarType::get('\'' + std::to_string(++curTypeVar));
@@ -52,7 +54,7 @@ namespace ante {
             }else{
                 auto newtv = nextTypeVar();
                 if(tv->isRowVar())
-                    newtv->isRowVariable = true;
+                    newtv = AnTypeVarType::get(newtv->name, true);
 
                 map[tv->name] = newtv;
                 return newtv;
@@ -139,53 +141,6 @@ namespace ante {
     }
 
 
-    bool containsTypeVarHelper(const AnType *t, AnTypeVarType *typeVar){
-        if(!t->isGeneric)
-            return false;
-
-        if(t->isModifierType()){
-            auto modTy = (AnModifier*)t;
-            return containsTypeVarHelper(modTy->extTy, typeVar);
-        }
-
-        if(auto ptr = try_cast<AnPtrType>(t)){
-            return containsTypeVarHelper(ptr->elemTy, typeVar);
-
-        }else if(auto arr = try_cast<AnArrayType>(t)){
-            return containsTypeVarHelper(arr->extTy, typeVar);
-
-        }else if(auto tv = try_cast<AnTypeVarType>(t)){
-            return tv == typeVar;
-
-        }else if(auto dt = try_cast<AnDataType>(t)){
-            return ante::any(dt->typeArgs, [&](AnType *f){ return containsTypeVarHelper(f, typeVar); });
-
-        }else if(auto fn = try_cast<AnFunctionType>(t)){
-            if(ante::any(fn->paramTys, [&](AnType *f){ return containsTypeVarHelper(f, typeVar); }))
-                return true;
-
-            if(containsTypeVarHelper(fn->retTy, typeVar))
-                return true;
-
-            auto tccContainsTypeVar = [&](TraitImpl *t){
-                return ante::any(t->typeArgs, [&](AnType *t){ return containsTypeVarHelper(t, typeVar); });
-            };
-
-            return ante::any(fn->typeClassConstraints, tccContainsTypeVar);
-
-        }else if(auto tup = try_cast<AnTupleType>(t)){
-            return ante::any(tup->fields, [&](AnType *f){ return containsTypeVarHelper(f, typeVar); });
-
-        }else{
-            return false;
-        }
-    }
-
-    bool containsTypeVar(AnType *t, AnTypeVarType *typeVar){
-        if(t == typeVar) return false;
-        return containsTypeVarHelper(t, typeVar);
-    }
-
     bool hasTypeVarNotInMap(const AnType *t, llvm::StringMap<const AnTypeVarType*> &map){
         if(!t->isGeneric)
             return false;
@@ -291,6 +246,156 @@ namespace ante {
         return AnFunctionType::get(t->retTy, t->paramTys, c);
     }
 
+    AnType* UnionFind::find(AnType *t){
+        auto tv = try_cast<AnTypeVarType>(t);
+        if(!tv) return t;
+
+        auto it = parent.find(tv);
+        if(it == parent.end()) return t;
+
+        AnType *root = find(it->second);
+        if(root != it->second){
+            trail.emplace_back(tv, it->second);
+            it->second = root;
+        }
+        return (AnType*)t->addModifiersTo(root);
+    }
+
+    bool UnionFind::bind(AnTypeVarType *tv, AnType *t){
+        if(occurs(tv, t))
+            return false;
+
+        parent[tv] = t;
+        bindOrder.push_back(tv);
+        trail.emplace_back(tv, nullptr);
+        return true;
+    }
+
+    void UnionFind::clear(){
+        parent.clear();
+        bindOrder.clear();
+        trail.clear();
+    }
+
+    size_t UnionFind::checkpoint(){
+        trail.clear();
+        return bindOrder.size();
+    }
+
+    void UnionFind::rollback(size_t c){
+        for(auto it = trail.rbegin(); it != trail.rend(); ++it){
+            if(it->second)
+                parent[it->first] = it->second;
+            else
+                parent.erase(it->first);
+        }
+        trail.clear();
+        bindOrder.resize(c);
+    }
+
+    bool UnionFind::occurs(AnTypeVarType *tv, AnType *t){
+        if(!t->isGeneric)
+            return false;
+
+        if(t->isModifierType()){
+            return occurs(tv, (AnType*)static_cast<AnModifier*>(t)->extTy);
+        }
+
+        if(auto ptr = try_cast<AnPtrType>(t)){
+            return occurs(tv, ptr->elemTy);
+
+        }else if(auto arr = try_cast<AnArrayType>(t)){
+            return occurs(tv, arr->extTy);
+
+        }else if(auto tv2 = try_cast<AnTypeVarType>(t)){
+            if(tv2 == tv) return true;
+            auto root = find(tv2);
+            return root != tv2 && occurs(tv, root);
+
+        }else if(auto dt = try_cast<AnDataType>(t)){
+            return ante::any(dt->typeArgs, [&](AnType *f){ return occurs(tv, f); });
+
+        }else if(auto fn = try_cast<AnFunctionType>(t)){
+            auto tccContainsTypeVar = [&](TraitImpl *t){
+                return ante::any(t->typeArgs, [&](AnType *t){ return occurs(tv, t); });
+            };
+
+            return ante::any(fn->paramTys, [&](AnType *f){ return occurs(tv, f); })
+                || occurs(tv, fn->retTy)
+                || ante::any(fn->typeClassConstraints, tccContainsTypeVar);
+
+        }else if(auto tup = try_cast<AnTupleType>(t)){
+            return ante::any(tup->fields, [&](AnType *f){ return occurs(tv, f); });
+
+        }else{
+            return false;
+        }
+    }
+
+    template<class T>
+    std::vector<T*> resolveAll(UnionFind &uf, std::vector<T*> const& vec, int recursionLimit){
+        return ante::applyToAll(vec, [&](T *elem){
+            return (T*)uf.resolve(elem, recursionLimit - 1);
+        });
+    }
+
+    TraitImpl* UnionFind::resolve(TraitImpl *impl, int recursionLimit){
+        return new TraitImpl(impl->decl,
+                resolveAll(*this, impl->typeArgs, recursionLimit - 1),
+                resolveAll(*this, impl->fundeps,  recursionLimit - 1));
+    }
+
+    AnType* UnionFind::resolve(AnType *t, int recursionLimit){
+        if(!t->isGeneric || parent.empty())
+            return t;
+
+        if(recursionLimit < 0){
+            std::cerr << "t = " << anTypeToColoredStr(t) << '\n';
+            ASSERT_UNREACHABLE("internal recursion limit (10,000) reached in ante::UnionFind::resolve");
+        }
+
+        if(t->isModifierType()){
+            auto modTy = static_cast<AnModifier*>(t);
+            return (AnType*)modTy->addModifiersTo(resolve((AnType*)modTy->extTy, recursionLimit - 1));
+        }
+
+        if(auto ptr = try_cast<AnPtrType>(t)){
+            return AnPtrType::get(resolve(ptr->elemTy, recursionLimit - 1));
+
+        }else if(auto arr = try_cast<AnArrayType>(t)){
+            return AnArrayType::get(resolve(arr->extTy, recursionLimit - 1), arr->len);
+
+        }else if(auto tv = try_cast<AnTypeVarType>(t)){
+            auto root = find(tv);
+            return root == tv ? t : resolve(root, recursionLimit - 1);
+
+        }else if(auto dt = try_cast<AnDataType>(t)){
+            auto generics = resolveAll(*this, dt->typeArgs, recursionLimit - 1);
+            return AnDataType::get(dt->name, generics, dt->decl);
+
+        }else if(auto fn = try_cast<AnFunctionType>(t)){
+            auto exts = resolveAll(*this, fn->paramTys, recursionLimit - 1);
+            auto rett = resolve(fn->retTy, recursionLimit - 1);
+            auto tcc  = resolveAll(*this, fn->typeClassConstraints, recursionLimit - 1);
+            return AnFunctionType::get(rett, exts, tcc);
+
+        }else if(auto tup = try_cast<AnTupleType>(t)){
+            auto exts = resolveAll(*this, tup->fields, recursionLimit - 1);
+            return AnTupleType::getAnonRecord(exts, tup->fieldNames);
+
+        }else{
+            return t;
+        }
+    }
+
+    Substitutions UnionFind::getSubstitutions(){
+        Substitutions ret;
+        for(auto *tv : bindOrder){
+            ret.emplace_front(tv, resolve(tv));
+        }
+        return ret;
+    }
+
 
     AnType* applySubstitutions(Substitutions const& substitutions, AnType *t){
         for(auto it = substitutions.rbegin(); it != substitutions.rend(); ++it){
@@ -313,40 +418,38 @@ namespace ante {
         Mismatch, InfRecursion1, InfRecursion2
     };
 
-    struct TypeErrorContext : public std::exception {
-        const AnType *t1, *t2;
-        const TypeErrorKind kind;
-        Substitutions subs;
-
-        TypeErrorContext(const AnType *t1, const AnType *t2, TypeErrorKind kind)
-            : t1{t1}, t2{t2}, kind{kind}, subs{}{}
+    /** The innermost pair of types that failed to unify */
+    struct TypeErrorContext {
+        AnType *t1, *t2;
+        TypeErrorKind kind;
     };
 
-    Substitutions unify(UnificationList const& list, UnificationList::const_reverse_iterator cur, bool isTopLevel);
-
     /**
-     * Helper for a recursive call to unify.
-     * Supplies arguments needed for good error messages.
+     * Unification never throws: each helper returns false on failure
+     * and fills in err with the innermost mismatched types.
      */
-    Substitutions unifyRecursive(UnificationList const& list){
-        return unify(list, list.rbegin(), false);
+    bool unifyOne(UnionFind &uf, AnType *t1, AnType *t2, TypeErrorContext &err);
+
+    bool fail(AnType *t1, AnType *t2, TypeErrorKind kind, TypeErrorContext &err){
+        err = {t1, t2, kind};
+        return false;
     }
 
     template<class T>
-    Substitutions unifyExts(std::vector<T*> const& exts1, std::vector<T*> const& exts2,
-            const AnType *t1, const AnType *t2, TypeError const& err){
+    bool unifyExts(UnionFind &uf, std::vector<T*> const& exts1, std::vector<T*> const& exts2,
+            AnType *t1, AnType *t2, TypeErrorContext &err){
 
         if(exts1.size() != exts2.size()){
-            throw TypeErrorContext(t1, t2, Mismatch);
+            return fail(t1, t2, Mismatch, err);
         }
 
-        UnificationList ret;
         for(size_t i = 0; i < exts1.size(); i++)
-            ret.emplace_back(exts1[i], exts2[i], err);
-        return unifyRecursive(ret);
+            if(!unifyOne(uf, exts1[i], exts2[i], err))
+                return false;
+        return true;
     }
 
-    Substitutions unifyTuple(AnTupleType *tup1, AnTupleType *tup2, TypeError const& err){
+    bool unifyTuple(UnionFind &uf, AnTupleType *tup1, AnTupleType *tup2, TypeErrorContext &err){
         auto len1 = tup1->fields.size();
         auto len2 = tup2->fields.size();
         if(tup1->hasRowVar()) len1--;
@@ -357,169 +460,145 @@ namespace ante {
                 if(tup1->hasRowVar()){
                     len2 = len1;
                 }else{
-                    throw TypeErrorContext(tup1, tup2, Mismatch);
+                    return fail(tup1, tup2, Mismatch, err);
                 }
             }else{
                 if(tup2->hasRowVar()){
                     len1 = len2;
                 }else{
-                    throw TypeErrorContext(tup1, tup2, Mismatch);
+                    return fail(tup1, tup2, Mismatch, err);
                 }
             }
         }
 
-        UnificationList ret;
         for(size_t i = 0; i < len1; i++)
-            ret.emplace_back(tup1->fields[i], tup2->fields[i], err);
-        return unifyRecursive(ret);
+            if(!unifyOne(uf, tup1->fields[i], tup2->fields[i], err))
+                return false;
+        return true;
     }
 
 
-    Substitutions unifyOne(AnType *t1, AnType *t2, TypeError const& err){
+    bool unifyOne(UnionFind &uf, AnType *t1, AnType *t2, TypeErrorContext &err){
+        t1 = uf.find(t1);
+        t2 = uf.find(t2);
+
         auto tv1 = try_cast<AnTypeVarType>(t1);
         auto tv2 = try_cast<AnTypeVarType>(t2);
 
         if(tv1){
-            if(containsTypeVar(t2, tv1)){
-                throw TypeErrorContext(t1, t2, InfRecursion1);
-            }
-            return {{tv1, t2}};
+            if(tv1 == tv2) return true;
+            return uf.bind(tv1, t2) || fail(t1, t2, InfRecursion1, err);
         }else if(tv2){
-            if(containsTypeVar(t1, tv2)){
-                throw TypeErrorContext(t1, t2, InfRecursion2);
-            }
-            return {{tv2, t1}};
+            return uf.bind(tv2, t1) || fail(t1, t2, InfRecursion2, err);
         }
 
         if(t1->typeTag != t2->typeTag){
-            throw TypeErrorContext(t1, t2, Mismatch);
+            return fail(t1, t2, Mismatch, err);
         }
 
-        UnificationList ret;
-
         if(!t1->isGeneric && !t2->isGeneric){
-            if(!t1->approxEq(t2)){
-                throw TypeErrorContext(t1, t2, Mismatch);
-            }
-            return {};
+            return t1->approxEq(t2) || fail(t1, t2, Mismatch, err);
         }
 
         if(auto ptr1 = try_cast<AnPtrType>(t1)){
             auto ptr2 = try_cast<AnPtrType>(t2);
-            ret.emplace_back(ptr1->elemTy, ptr2->elemTy, err);
-            return unifyRecursive(ret);
+            return unifyOne(uf, ptr1->elemTy, ptr2->elemTy, err);
 
         }else if(auto arr1 = try_cast<AnArrayType>(t1)){
             auto arr2 = try_cast<AnArrayType>(t2);
-            ret.emplace_back(arr1->extTy, arr2->extTy, err);
-            return unifyRecursive(ret);
+            return unifyOne(uf, arr1->extTy, arr2->extTy, err);
 
         }else if(auto dt1 = try_cast<AnDataType>(t1)){
             auto dt2 = try_cast<AnDataType>(t2);
-            return unifyExts(dt1->typeArgs, dt2->typeArgs, dt1, dt2, err);
+            return unifyExts(uf, dt1->typeArgs, dt2->typeArgs, dt1, dt2, err);
 
         }else if(auto fn1 = try_cast<AnFunctionType>(t1)){
             auto fn2 = try_cast<AnFunctionType>(t2);
             if(fn1->paramTys.size() != fn2->paramTys.size()){
-                throw TypeErrorContext(t1, t2, Mismatch);
+                return fail(t1, t2, Mismatch, err);
             }
 
             for(size_t i = 0; i < fn1->paramTys.size(); i++)
-                ret.emplace_back(fn1->paramTys[i], fn2->paramTys[i], err);
+                if(!unifyOne(uf, fn1->paramTys[i], fn2->paramTys[i], err))
+                    return false;
 
-            ret.emplace_back(fn1->retTy, fn2->retTy, err);
-            return unifyRecursive(ret);
+            return unifyOne(uf, fn1->retTy, fn2->retTy, err);
 
         }else if(auto tup1 = try_cast<AnTupleType>(t1)){
             auto tup2 = try_cast<AnTupleType>(t2);
-            return unifyTuple(tup1, tup2, err);
+            return unifyTuple(uf, tup1, tup2, err);
 
         }else{
-            return {};
+            return true;
         }
     }
 
 
-    void unifyTypeClassConstraint(TraitImpl *constraint){
-
+    /**
+     * Solve each constraint in order, reporting any type errors found along the way.
+     * Any bindings made by a constraint that fails are undone so they do not
+     * cause further errors.
+     * Typeclass constraints are not solved here, they are checked once their
+     * type arguments are known in SubstitutingVisitor.
+     */
+    void unify(UnificationList const& list, UnionFind &uf){
+        TypeErrorContext e;
+        for(auto &p : list){
+            if(!p.isEqConstraint())
+                continue;
+
+            auto eq = p.asEqConstraint();
+            auto mark = uf.checkpoint();
+            try{
+                if(unifyOne(uf, eq.first, eq.second, e))
+                    continue;
+
+                p.error.show(uf.resolve(eq.first), uf.resolve(eq.second));
+                if(e.kind == InfRecursion1)
+                    showError(anTypeToColoredStr(uf.resolve(e.t1)) + " occurs inside " + anTypeToColoredStr(uf.resolve(e.t2)), p.error.loc, ErrorType::Note);
+                if(e.kind == InfRecursion2)
+                    showError(anTypeToColoredStr(uf.resolve(e.t2)) + " occurs inside " + anTypeToColoredStr(uf.resolve(e.t1)), p.error.loc, ErrorType::Note);
+            }catch(CtError e){}
+            uf.rollback(mark);
+        }
     }
 
+    Substitutions unify(UnificationList const& list){
+        UnionFind uf;
+        unify(list, uf);
+        return uf.getSubstitutions();
+    }
 
-    Substitutions unify(UnificationList const& list, UnificationList::const_reverse_iterator cur, bool isTopLevel){
-        if(cur == list.rend()){
-            return {};
-        }else{
-            auto &p = *cur;
-            auto t2 = unify(list, ++cur, isTopLevel);
-
-            if(!p.isEqConstraint()){
-                auto tc = p.asTypeClassConstraint();
-                unifyTypeClassConstraint(applySubstitutions(t2, tc));
-                return t2;
-            }
-
-            try{
-                auto eq = p.asEqConstraint();
-
-                Substitutions t1;
-                try {
-                    t1 = unifyOne(applySubstitutions(t2, eq.first),
-                                  applySubstitutions(t2, eq.second), p.error);
-                }catch(TypeErrorContext& e){
-                    e.subs.insert(e.subs.end(), t2.begin(), t2.end());
-                    if(!isTopLevel){
-                        throw e;
-                    }
-
-                    p.error.show(applySubstitutions(e.subs, eq.first), applySubstitutions(e.subs, eq.second));
-                    if(e.kind == InfRecursion1)
-                        showError(anTypeToColoredStr(e.t1) + " occurs inside " + anTypeToColoredStr(e.t2), p.error.loc, ErrorType::Note);
-                    if(e.kind == InfRecursion2)
-                        showError(anTypeToColoredStr(e.t2) + " occurs inside " + anTypeToColoredStr(e.t1), p.error.loc, ErrorType::Note);
-                    return {};
-                }
+    UnifyStatus toUnifyStatus(TypeErrorKind kind){
+        return kind == Mismatch ? UnifyStatus::Mismatch : UnifyStatus::InfiniteType;
+    }
 
-                Substitutions ret = t1;
-                ret.insert(ret.end(), t2.begin(), t2.end());
-                return ret;
-            }catch(CtError e){
-                return t2;
-            }
-        }
+    UnifyStatus tryUnify(AnType *a, AnType *b, UnionFind &scratch){
+        TypeErrorContext err;
+        scratch.clear();
+        return unifyOne(scratch, a, b, err) ? UnifyStatus::Success : toUnifyStatus(err.kind);
     }
 
-    Substitutions unify(UnificationList const& cur){
-        return unify(cur, cur.rbegin(), true);
+    UnifyStatus tryUnify(std::vector<AnType*> const& a, std::vector<AnType*> const& b, UnionFind &scratch){
+        TypeErrorContext err;
+        scratch.clear();
+        auto fakeTy = AnType::getUnit();
+        return unifyExts(scratch, a, b, fakeTy, fakeTy, err) ? UnifyStatus::Success : toUnifyStatus(err.kind);
     }
 
     std::pair<bool, Substitutions> tryUnify(AnType *a, AnType *b){
-        yy::location loc;
-        TypeError empty{loc};
-        Substitutions subs;
-
-        // TODO: type errors were designed to be exceptional but we're using
-        // them as control-flow here.  Possible optimization point for traits
-        try {
-            subs = unifyOne(a, b, empty);
-            return {true, subs};
-        }catch(TypeErrorContext const& err){
-            return {false, subs};
+        UnionFind uf;
+        if(tryUnify(a, b, uf) == UnifyStatus::Success){
+            return {true, uf.getSubstitutions()};
         }
+        return {false, {}};
     }
 
     std::pair<bool, Substitutions> tryUnify(std::vector<AnType*> const& a, std::vector<AnType*> const& b){
-        yy::location loc;
-        TypeError empty{loc};
-        Substitutions subs;
-
-        // TODO: type errors were designed to be exceptional but we're using
-        // them as control-flow here.  Possible optimization point for traits
-        try {
-            auto fakeTy = AnType::getUnit();
-            subs = unifyExts(a, b, fakeTy, fakeTy, empty);
-            return {true, subs};
-        }catch(TypeErrorContext const& err){
-            return {false, subs};
+        UnionFind uf;
+        if(tryUnify(a, b, uf) == UnifyStatus::Success){
+            return {true, uf.getSubstitutions()};
         }
+        return {false, {}};
     }
 }
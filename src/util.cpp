@@ -11,7 +11,7 @@ namespace ante {
         show(n.get());
     }
 
-    void show(std::unique_ptr<parser::Node> const& n){
+    void show(parser::ArenaPtr<parser::Node> const& n){
         show(n.get());
     }
 
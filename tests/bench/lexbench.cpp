@@ -0,0 +1,77 @@
+/*
+ * Lexer microbenchmark.
+ *
+ * Lexes a large synthetic Ante source once with each instruction set
+ * supported by the host and reports the throughput of each.
+ *
+ * Usage: antelexbench [megabytes]
+ */
+#include <chrono>
+#include <iostream>
+#include <cstdlib>
+#include "lexer.h"
+#include "scan.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace ante;
+
+/* Representative source mixing long identifiers, indentation, comments and string literals */
+const char *sampleSource =
+    "// Computes a running total over a vector of measurements and logs each step\n"
+    "type MeasurementBuffer = values:Vec i32, total_count:usz, description:Str\n"
+    "\n"
+    "accumulate_measurements (buffer: MeasurementBuffer) (verbose_logging: bool) =\n"
+    "    var running_total_of_values = 0\n"
+    "    /* block comments are lexed too */\n"
+    "    for current_measurement in buffer.values do\n"
+    "        running_total_of_values += current_measurement * 2 + 17\n"
+    "        if verbose_logging then\n"
+    "            print \"Accumulated a new measurement into the running total, now ${running_total_of_values}\"\n"
+    "        else\n"
+    "            print \"A somewhat longer string literal without any escape sequences in it at all\\n\"\n"
+    "    running_total_of_values\n"
+    "\n";
+
+string makeCorpus(size_t bytes){
+    string corpus;
+    corpus.reserve(bytes + 1024);
+    while(corpus.size() < bytes)
+        corpus += sampleSource;
+    return corpus;
+}
+
+void runBenchmark(scan::Isa isa, string &corpus){
+    if(!scan::setIsa(isa)){
+        cout << scan::getIsaName(isa) << ":\tunsupported on this host\n";
+        return;
+    }
+
+    string fileName = "bench.an";
+    size_t tokens = 0;
+    auto start = high_resolution_clock::now();
+
+    Lexer lexer{&fileName, corpus, 0, 0};
+    yy::parser::location_type loc;
+    while(int tok = lexer.next(&loc)){
+        if(tok == Tok_Ident || tok == Tok_UserType || tok == Tok_TypeVar || tok == Tok_StrLit
+                || tok == Tok_UnfinishedStr || tok == Tok_IntLit || tok == Tok_FltLit || tok == Tok_CharLit)
+            free(lexer.lextxt);
+        tokens++;
+    }
+
+    double secs = duration_cast<duration<double>>(high_resolution_clock::now() - start).count();
+    double mb = corpus.size() / (1024.0 * 1024.0);
+    cout << scan::getIsaName(isa) << ":\t" << tokens << " tokens in " << secs << "s ("
+         << (mb / secs) << " MB/s)\n";
+}
+
+int main(int argc, char **argv){
+    size_t megabytes = argc > 1 ? strtoul(argv[1], nullptr, 10) : 64;
+    string corpus = makeCorpus(megabytes * 1024 * 1024);
+
+    runBenchmark(scan::Isa::Scalar, corpus);
+    runBenchmark(scan::Isa::SSE2, corpus);
+    runBenchmark(scan::Isa::AVX2, corpus);
+    return 0;
+}
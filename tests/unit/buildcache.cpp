@@ -0,0 +1,80 @@
+#include "unittest.h"
+#include "args.h"
+#include "buildcache.h"
+#include "interface.h"
+#include "nameresolution.h"
+#include "sourcemanager.h"
+#include "target.h"
+#include <cstdio>
+#include <fstream>
+#include <llvm/Support/FileSystem.h>
+
+using namespace ante;
+using namespace std;
+
+using Objs = vector<llvm::SmallVector<char, 0>>;
+
+Objs makeObjs(string const& contents){
+    Objs objs(1);
+    objs[0].append(contents.begin(), contents.end());
+    return objs;
+}
+
+CompilerArgs makeCacheArgs(string const& dir, string const& optLvl){
+    CompilerArgs args;
+    args.addArg(Args::BuildCacheDir, string(dir));
+    args.addArg(Args::OptLvl, string(optLvl));
+    return args;
+}
+
+/**
+ * buildcachemain.an imports buildcachedep.an, which imports only the prelude
+ */
+TEST_CASE("Build cache entries are keyed by their imports and flags", "[buildcache]"){
+    string dir = AN_EXEC_STR "buildcachetest";
+    string input = AN_EXEC_STR "buildcachemain.an";
+    string dep = AN_EXEC_STR "buildcachedep.an";
+    ofstream{input} << "import Buildcachedep\n\nprint (dep 2)\n";
+    ofstream{dep} << "dep x = x + 1\n";
+
+    auto args = makeCacheArgs(dir, "2");
+    BuildCache cache{dir, input, &args};
+    setBuildCache(&cache);
+
+    Objs objs;
+    REQUIRE(!cache.lookup(objs));
+
+    //importing the dependency stores its interface
+    vector<Module*> imports;
+    REQUIRE(importModules({"buildcachedep.an"}, imports));
+    Module *depModule = imports[0];
+    auto depSource = SourceManager::getFile(findFile("buildcachedep.an"))->getContents();
+    REQUIRE(cache.lookupInterface(depModule, depSource));
+
+    Module mainModule{"Buildcachemain"};
+    mainModule.imports = imports;
+    cache.store(&mainModule, makeObjs("obj contents"));
+
+    //a hit while neither the input nor its imports changed
+    REQUIRE(cache.lookup(objs));
+    REQUIRE(objs.size() == 1);
+    REQUIRE(string(objs[0].data(), objs[0].size()) == "obj contents");
+
+    //a miss once the interface of an import changes, as if its source was touched
+    string depHash = depModule->interfaceHash;
+    depModule->interfaceHash = hashContents("touched");
+    REQUIRE(!cache.lookup(objs));
+    depModule->interfaceHash = depHash;
+    REQUIRE(cache.lookup(objs));
+
+    //a miss for the same sources compiled with different flags
+    auto optArgs = makeCacheArgs(dir, "3");
+    BuildCache optCache{dir, input, &optArgs};
+    REQUIRE(!optCache.lookup(objs));
+    REQUIRE(!optCache.lookupInterface(depModule, depSource));
+
+    setBuildCache(nullptr);
+    remove(input.c_str());
+    remove(dep.c_str());
+    llvm::sys::fs::remove_directories(dir);
+}
@@ -0,0 +1,109 @@
+#include "unittest.h"
+#include "antevalue.h"
+#include "ctcache.h"
+#include <cstring>
+using namespace ante;
+using namespace std;
+using namespace llvm;
+
+/** square (x:i32) = x * x */
+Function* createSquare(Compiler &c){
+    auto *i32 = Type::getInt32Ty(*c.ctxt);
+    auto *fnTy = FunctionType::get(i32, {i32}, false);
+    auto *f = Function::Create(fnTy, Function::ExternalLinkage, "square", c.module.get());
+
+    c.builder.SetInsertPoint(BasicBlock::Create(*c.ctxt, "entry", f));
+    Value *x = f->arg_begin();
+    c.builder.CreateRet(c.builder.CreateMul(x, x));
+    return f;
+}
+
+/** shout (x:i32) = puts "called"; x */
+Function* createShout(Compiler &c){
+    auto *i32 = Type::getInt32Ty(*c.ctxt);
+    auto *c8Ptr = Type::getInt8Ty(*c.ctxt)->getPointerTo();
+    auto puts = c.module->getOrInsertFunction("puts", FunctionType::get(i32, {c8Ptr}, false));
+
+    auto *fnTy = FunctionType::get(i32, {i32}, false);
+    auto *f = Function::Create(fnTy, Function::ExternalLinkage, "shout", c.module.get());
+
+    c.builder.SetInsertPoint(BasicBlock::Create(*c.ctxt, "entry", f));
+    c.builder.CreateCall(puts, {c.builder.CreateGlobalStringPtr("called")});
+    c.builder.CreateRet(f->arg_begin());
+    return f;
+}
+
+string getI32CallKey(Compiler &c, CtResultCache &cache, string const& fnKey, int32_t arg){
+    vector<TypedValue> args{TypedValue(c.builder.getInt32(arg), AnType::getI32())};
+    return cache.getCallKey(&c, fnKey, args, AnteValue(&arg, AnType::getI32()));
+}
+
+TEST_CASE("Calls to pure functions are memoized by their arguments", "[ctcache]"){
+    auto&& c = Compiler(nullptr);
+    CtResultCache cache;
+
+    Function *square = createSquare(c);
+    string fnKey = cache.getFunctionKey(&c, square, square->getName(), AnType::getI32());
+    REQUIRE(!fnKey.empty());
+
+    string key3 = getI32CallKey(c, cache, fnKey, 3);
+    REQUIRE(key3 == getI32CallKey(c, cache, fnKey, 3));
+
+    //first call misses and its result is stored
+    REQUIRE(cache.lookup(key3) == nullptr);
+    int32_t nine = 9;
+    cache.insert(key3, &nine, sizeof(nine));
+
+    //the same call again hits
+    auto *cached = cache.lookup(key3);
+    REQUIRE(cached != nullptr);
+    REQUIRE(cached->size() == sizeof(nine));
+    REQUIRE(*(const int32_t*)cached->data() == 9);
+
+    //different arguments miss
+    string key4 = getI32CallKey(c, cache, fnKey, 4);
+    REQUIRE(key4 != key3);
+    REQUIRE(cache.lookup(key4) == nullptr);
+}
+
+TEST_CASE("Calls to impure functions are never memoized", "[ctcache]"){
+    auto&& c = Compiler(nullptr);
+    CtResultCache cache;
+
+    Function *shout = createShout(c);
+    string fnKey = cache.getFunctionKey(&c, shout, shout->getName(), AnType::getI32());
+    REQUIRE(fnKey.empty());
+
+    string key = getI32CallKey(c, cache, fnKey, 3);
+    REQUIRE(key.empty());
+
+    //each call misses so the function is run every time
+    int32_t three = 3;
+    REQUIRE(cache.lookup(key) == nullptr);
+    cache.insert(key, &three, sizeof(three));
+    REQUIRE(cache.lookup(key) == nullptr);
+}
+
+TEST_CASE("Padding of arguments is not part of a call's key", "[ctcache]"){
+    auto&& c = Compiler(nullptr);
+    CtResultCache cache;
+
+    Function *square = createSquare(c);
+    string fnKey = cache.getFunctionKey(&c, square, square->getName(), AnType::getI32());
+
+    auto *tupTy = AnTupleType::get({AnType::getI8(), AnType::getI32()});
+    auto *llvmTupTy = c.anTypeToLlvmType(tupTy);
+    vector<TypedValue> args{TypedValue(UndefValue::get(llvmTupTy), tupTy)};
+
+    //the same fields with different bytes in the padding between them
+    struct { int8_t a; int32_t b; } tup1, tup2;
+    memset(&tup1, 0x00, sizeof(tup1));
+    memset(&tup2, 0xff, sizeof(tup2));
+    tup1.a = tup2.a = 1;
+    tup1.b = tup2.b = 2;
+
+    string key1 = cache.getCallKey(&c, fnKey, args, AnteValue(&tup1, tupTy));
+    string key2 = cache.getCallKey(&c, fnKey, args, AnteValue(&tup2, tupTy));
+    REQUIRE(!key1.empty());
+    REQUIRE(key1 == key2);
+}
@@ -0,0 +1,82 @@
+#include "unittest.h"
+#include "interface.h"
+#include "nameresolution.h"
+#include "sourcemanager.h"
+#include "target.h"
+#include "trait.h"
+#include <cstdio>
+#include <fstream>
+
+using namespace ante;
+using namespace std;
+using llvm::MemoryBuffer;
+using llvm::StringRef;
+
+static const char *interfaceTestSource =
+    "type Point = x:i32 y:i32\n"
+    "\n"
+    "trait Area 't\n"
+    "    area 't -> i32\n"
+    "\n"
+    "impl Area Point\n"
+    "    area p = p.x * p.y\n"
+    "\n"
+    "double x = x + x\n";
+
+TEST_CASE("Module interfaces round trip", "[interface]"){
+    string sourcePath = AN_EXEC_STR "interfacetest.an";
+    string interfacePath = ModuleInterface::getPath(sourcePath);
+    ofstream{sourcePath} << interfaceTestSource;
+
+    REQUIRE(emitInterface("interfacetest.an"));
+
+    auto file = MemoryBuffer::getFile(interfacePath);
+    REQUIRE(file);
+    string written = (*file)->getBuffer().str();
+    StringRef source = SourceManager::getFile(sourcePath)->getContents();
+
+    Module &root = Module::getRoot();
+    Module *original = root.findPath(ModulePath("interfacetest.an"));
+    REQUIRE(original->interfaceHash == written.substr(8, 40));
+
+    auto interface = ModuleInterface::open(interfacePath, source);
+    REQUIRE(interface);
+    REQUIRE(interface->getHash() == original->interfaceHash);
+
+    //the interface is loaded into a separate module with the same imports
+    Module m{original->name};
+    m.imports = original->imports;
+    m.importName = original->importName;
+    static string fileName = sourcePath;
+    REQUIRE(ModuleInterface::load(move(interface), &m, &fileName));
+
+    auto point = m.userTypes.find("Point");
+    REQUIRE(point != m.userTypes.end());
+    REQUIRE(point->getValue().fields.size() == 2);
+    REQUIRE(m.traitDecls.count("Area"));
+    REQUIRE(m.traitImpls.count("Area"));
+    REQUIRE(m.traitImpls["Area"].getImpls().size() == 1);
+    REQUIRE(m.traitImpls["Area"].getImpls()[0]->typeArgs[0] == m.lookupType("Point"));
+
+    //function types are loaded eagerly but bodies are only read when first needed
+    REQUIRE(m.fnDecls.count("double"));
+    FuncDecl *fd = m.fnDecls["double"];
+    REQUIRE(fd->tval.type);
+    REQUIRE(fd->bodySource);
+    REQUIRE(!fd->getFDN()->child);
+    fd->loadBody();
+    REQUIRE(!fd->bodySource);
+    REQUIRE(fd->getFDN()->child);
+
+    //the loaded module is written back to the same interface
+    string rewritten;
+    REQUIRE(ModuleInterface::write(&m, source, rewritten));
+    REQUIRE(rewritten == written);
+
+    //an interface is not used once its source changes
+    REQUIRE(!ModuleInterface::get(MemoryBuffer::getMemBufferCopy(written), "double x = x * 2\n"));
+    REQUIRE(ModuleInterface::get(MemoryBuffer::getMemBufferCopy(written), source));
+
+    remove(sourcePath.c_str());
+    remove(interfacePath.c_str());
+}
@@ -0,0 +1,126 @@
+#include "unittest.h"
+#include "jitsession.h"
+using namespace ante;
+using namespace std;
+using namespace llvm;
+
+/** Creates a nullary function returning an i32, whose body is left to the caller */
+Function* createNullaryFn(Compiler &c, string const& name){
+    auto *fnTy = FunctionType::get(Type::getInt32Ty(*c.ctxt), {}, false);
+    auto *f = Function::Create(fnTy, Function::ExternalLinkage, name, c.module.get());
+    c.builder.SetInsertPoint(BasicBlock::Create(*c.ctxt, "entry", f));
+    return f;
+}
+
+Function* createConstFn(Compiler &c, string const& name, int32_t value){
+    auto *f = createNullaryFn(c, name);
+    c.builder.CreateRet(c.builder.getInt32(value));
+    return f;
+}
+
+int32_t callNullaryFn(JitSession &jit, StringRef name){
+    auto addr = jit.lookup(name);
+    REQUIRE(addr != 0);
+    return ((int32_t(*)())addr)();
+}
+
+TEST_CASE("Finished definitions are added to the JIT", "[JitSession]"){
+    auto&& c = Compiler(nullptr);
+    JitSession &jit = c.ctCtxt->getJitSession();
+
+    Function *answer = createConstFn(c, "answer", 42);
+    vector<WeakVH> finished{answer};
+
+    REQUIRE(jit.addNewDefinitions(*c.module, finished));
+    REQUIRE(finished.empty());
+    REQUIRE(callNullaryFn(jit, "answer") == 42);
+
+    //the definition given to the JIT is a copy, the compiler's module is untouched
+    REQUIRE(!answer->isDeclaration());
+    REQUIRE(answer->getParent() == c.module.get());
+}
+
+TEST_CASE("Later increments reuse definitions already in the JIT", "[JitSession]"){
+    auto&& c = Compiler(nullptr);
+    JitSession &jit = c.ctCtxt->getJitSession();
+
+    Function *answer = createConstFn(c, "answer", 42);
+    vector<WeakVH> finished{answer};
+    REQUIRE(jit.addNewDefinitions(*c.module, finished));
+
+    //twice () = answer () * 2
+    Function *twice = createNullaryFn(c, "twice");
+    auto *call = c.builder.CreateCall(answer, {});
+    c.builder.CreateRet(c.builder.CreateMul(call, c.builder.getInt32(2)));
+
+    finished.emplace_back(twice);
+    REQUIRE(jit.addNewDefinitions(*c.module, finished));
+    REQUIRE(callNullaryFn(jit, "twice") == 84);
+}
+
+TEST_CASE("Unfinished functions are left until they are complete", "[JitSession]"){
+    auto&& c = Compiler(nullptr);
+    JitSession &jit = c.ctCtxt->getJitSession();
+
+    //a block without a terminator, eg. main while an ante expression within it is evaluated
+    Function *unfinished = createNullaryFn(c, "unfinished");
+    REQUIRE(!isComplete(unfinished));
+
+    vector<WeakVH> finished{unfinished};
+    REQUIRE(jit.addNewDefinitions(*c.module, finished));
+    REQUIRE(jit.lookup("unfinished") == 0);
+
+    c.builder.CreateRet(c.builder.getInt32(7));
+    REQUIRE(isComplete(unfinished));
+
+    finished.emplace_back(unfinished);
+    REQUIRE(jit.addNewDefinitions(*c.module, finished));
+    REQUIRE(callNullaryFn(jit, "unfinished") == 7);
+}
+
+TEST_CASE("Redefined functions are given a new symbol", "[JitSession]"){
+    auto&& c = Compiler(nullptr);
+    JitSession &jit = c.ctCtxt->getJitSession();
+
+    vector<Function*> redefined;
+    jit.onRedefinition = [&](Function *f){ redefined.push_back(f); };
+
+    Function *answer = createConstFn(c, "answer", 42);
+    vector<WeakVH> finished{answer};
+    REQUIRE(jit.addNewDefinitions(*c.module, finished));
+    REQUIRE(redefined.empty());
+
+    //replace the body of answer and finish it again
+    answer->getEntryBlock().getTerminator()->eraseFromParent();
+    c.builder.SetInsertPoint(&answer->getEntryBlock());
+    c.builder.CreateRet(c.builder.getInt32(43));
+
+    finished.emplace_back(answer);
+    REQUIRE(jit.addNewDefinitions(*c.module, finished));
+    REQUIRE(redefined.size() == 1);
+    REQUIRE(redefined[0] == answer);
+
+    //the old symbol is kept for code already linked against it
+    REQUIRE(callNullaryFn(jit, "answer") == 42);
+}
+
+TEST_CASE("Values given unique names never share a symbol", "[JitSession]"){
+    auto&& c = Compiler(nullptr);
+    JitSession &jit = c.ctCtxt->getJitSession();
+
+    Function *first = createConstFn(c, "AnteCall", 1);
+    jit.giveUniqueName(first);
+    vector<WeakVH> finished{first};
+    REQUIRE(jit.addNewDefinitions(*c.module, finished));
+    string firstName = first->getName().str();
+    first->eraseFromParent();
+
+    Function *second = createConstFn(c, "AnteCall", 2);
+    jit.giveUniqueName(second);
+    REQUIRE(second->getName() != firstName);
+    finished.emplace_back(second);
+    REQUIRE(jit.addNewDefinitions(*c.module, finished));
+
+    REQUIRE(callNullaryFn(jit, firstName) == 1);
+    REQUIRE(callNullaryFn(jit, second->getName()) == 2);
+}
@@ -0,0 +1,88 @@
+#include "unittest.h"
+#include "lexer.h"
+#include <algorithm>
+#include <cctype>
+#include <set>
+using namespace ante;
+using namespace std;
+
+/** Lex a single word, returning its token and the text of the token if it has any */
+pair<int, string> lexWord(string source){
+    string fileName = "lexertest.an";
+    Lexer lexer{&fileName, source, 0, 0};
+    yy::parser::location_type loc;
+
+    int tok = lexer.next(&loc);
+    string text;
+    if(tok == Tok_Ident || tok == Tok_UserType){
+        text = lexer.lextxt;
+        free(lexer.lextxt);
+    }
+
+    //the whole word must be a single token
+    REQUIRE(lexer.next(&loc) == 0);
+    return {tok, text};
+}
+
+/**
+ * Every keyword and its token.  tokNames spells each keyword's token
+ * the same as the keyword itself, and is the only one of its names
+ * that starts with a lowercase letter, so an entry missing from the
+ * lexer's keyword table shows up here as a word lexed as an identifier.
+ */
+vector<pair<string, int>> getKeywords(){
+    vector<pair<string, int>> ret;
+    for(int tok = Tok_Ident; tok <= Tok_Unindent; tok++){
+        string name = Lexer::getTokStr(tok);
+        if(islower(name[0]) && all_of(name.begin(), name.end(), [](char c){ return isalnum(c); }))
+            ret.emplace_back(name, tok);
+    }
+    return ret;
+}
+
+TEST_CASE("Each keyword is lexed as its token", "[lexer]"){
+    auto keywords = getKeywords();
+    REQUIRE(keywords.size() > 50);
+
+    for(auto &kw : keywords){
+        INFO(kw.first);
+        REQUIRE(lexWord(kw.first).first == kw.second);
+    }
+}
+
+TEST_CASE("Words close to a keyword are lexed as identifiers", "[lexer]"){
+    set<string> keywords;
+    for(auto &kw : getKeywords())
+        keywords.insert(kw.first);
+
+    auto requireIdent = [&](string const& word, int tok = Tok_Ident){
+        if(keywords.count(word))
+            return;
+
+        INFO(word);
+        auto lexed = lexWord(word);
+        REQUIRE(lexed.first == tok);
+        REQUIRE(lexed.second == word);
+    };
+
+    for(auto &kw : keywords){
+        //every proper prefix
+        for(size_t len = 1; len < kw.size(); len++)
+            requireIdent(kw.substr(0, len));
+
+        //the keyword followed by one more character
+        for(char c : {'a', 'z', '0', '9', '_'})
+            requireIdent(kw + c);
+
+        //the keyword with its other letters capitalized
+        string upperTail = kw;
+        transform(upperTail.begin() + 1, upperTail.end(), upperTail.begin() + 1, ::toupper);
+        if(upperTail != kw)
+            requireIdent(upperTail);
+
+        //a capitalized keyword is a type name
+        string capitalized = kw;
+        capitalized[0] = toupper(capitalized[0]);
+        requireIdent(capitalized, Tok_UserType);
+    }
+}
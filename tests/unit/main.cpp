@@ -1,2 +1,14 @@
-#define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_RUNNER
 #include "unittest.h"
+#include "compapi.h"
+#include <llvm/Support/TargetSelect.h>
+
+//Initialize the same global state the compiler's main does before any test runs
+int main(int argc, char *argv[]){
+    LLVMInitializeNativeTarget();
+    LLVMInitializeNativeAsmPrinter();
+
+    ante::AnType::initTypeSystem();
+    ante::capi::init();
+    return Catch::Session().run(argc, argv);
+}
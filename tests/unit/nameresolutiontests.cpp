@@ -1,6 +1,9 @@
 #include "unittest.h"
 #include "ptree.h"
 #include "nameresolution.h"
+#include "target.h"
+#include <cstdio>
+#include <fstream>
 
 using namespace ante;
 using namespace parser;
@@ -11,12 +14,13 @@ using namespace parser;
  */
 TEST_CASE("Sequence Resolution", "[nameResolution]"){
     LOC_TY loc;
-    auto declThenReference = new SeqNode(loc);
-    auto var1 = new VarNode(loc, "var1");
-    auto var1Cpy = new VarNode(loc, "var1");
-    auto three = new IntLitNode(loc, "3", TT_I32);
-    auto van = new VarAssignNode(loc, var1, three, false);
-    auto modNode = new ModNode(loc, Tok_Mut, nullptr);
+    NodeArena arena;
+    auto declThenReference = arena.make<SeqNode>(loc);
+    auto var1 = arena.make<VarNode>(loc, "var1");
+    auto var1Cpy = arena.make<VarNode>(loc, "var1");
+    auto three = arena.make<IntLitNode>(loc, "3", TT_I32);
+    auto van = arena.make<VarAssignNode>(loc, var1, three);
+    auto modNode = arena.make<ModNode>(loc, Tok_Mut, nullptr);
     van->modifiers.emplace_back(modNode);
 
     declThenReference->sequence.emplace_back(van);
@@ -32,7 +36,6 @@ TEST_CASE("Sequence Resolution", "[nameResolution]"){
     REQUIRE(var1Cpy->decl);
     REQUIRE(var1Cpy->decl == var1->decl);
     REQUIRE(var1Cpy->decl->name == "var1");
-    delete declThenReference;
 }
 
 
@@ -46,30 +49,31 @@ TEST_CASE("Sequence Resolution", "[nameResolution]"){
  */
 TEST_CASE("Mutability Resolution", "[nameResolution]"){
     LOC_TY loc;
-    auto seq = new SeqNode(loc);
-    auto var1a = new VarNode(loc, "var1");
-    auto var1b = new VarNode(loc, "var1");
-    auto var1c = new VarNode(loc, "var1");
-
-    auto var2a = new VarNode(loc, "var2");
-    auto var2b = new VarNode(loc, "var2");
-    auto var2c = new VarNode(loc, "var2");
-
-    auto one = new IntLitNode(loc, "1", TT_I32);
-    auto two = new IntLitNode(loc, "2", TT_I32);
-    auto three = new IntLitNode(loc, "3", TT_I32);
-    auto four = new IntLitNode(loc, "4", TT_I32);
-
-    auto decl1 = new VarAssignNode(loc, var1a, one, true);
-    auto decl2 = new VarAssignNode(loc, var2a, two, true);
-    auto modNode1 = new ModNode(loc, Tok_Mut, nullptr);
-    auto modNode2 = new ModNode(loc, Tok_Mut, nullptr);
+    NodeArena arena;
+    auto seq = arena.make<SeqNode>(loc);
+    auto var1a = arena.make<VarNode>(loc, "var1");
+    auto var1b = arena.make<VarNode>(loc, "var1");
+    auto var1c = arena.make<VarNode>(loc, "var1");
+
+    auto var2a = arena.make<VarNode>(loc, "var2");
+    auto var2b = arena.make<VarNode>(loc, "var2");
+    auto var2c = arena.make<VarNode>(loc, "var2");
+
+    auto one = arena.make<IntLitNode>(loc, "1", TT_I32);
+    auto two = arena.make<IntLitNode>(loc, "2", TT_I32);
+    auto three = arena.make<IntLitNode>(loc, "3", TT_I32);
+    auto four = arena.make<IntLitNode>(loc, "4", TT_I32);
+
+    auto decl1 = arena.make<VarAssignNode>(loc, var1a, one);
+    auto decl2 = arena.make<VarAssignNode>(loc, var2a, two);
+    auto modNode1 = arena.make<ModNode>(loc, Tok_Mut, nullptr);
+    auto modNode2 = arena.make<ModNode>(loc, Tok_Mut, nullptr);
 
     decl1->modifiers.emplace_back(modNode1);
     decl2->modifiers.emplace_back(modNode2);
 
-    auto assign1 = new VarAssignNode(loc, var1c, three, true);
-    auto assign2 = new VarAssignNode(loc, var2b, four, true);
+    auto assign1 = arena.make<VarAssignNode>(loc, var1c, three);
+    auto assign2 = arena.make<VarAssignNode>(loc, var2b, four);
 
     seq->sequence.emplace_back(decl1);
     seq->sequence.emplace_back(decl2);
@@ -95,7 +99,6 @@ TEST_CASE("Mutability Resolution", "[nameResolution]"){
     REQUIRE(var2b->decl == var2c->decl);
 
     REQUIRE(var1a->decl != var2a->decl);
-    delete seq;
 }
 
 /** 
@@ -107,28 +110,29 @@ TEST_CASE("Mutability Resolution", "[nameResolution]"){
  */
 TEST_CASE("Shadowing Resolution", "[nameResolution]"){
     LOC_TY loc;
-    auto seq = new SeqNode(loc);
-    auto innerSeq = new SeqNode(loc);
-    auto var1a = new VarNode(loc, "var1");
-    auto var1b = new VarNode(loc, "var1");
-    auto var1c = new VarNode(loc, "var1");
-    auto var1d = new VarNode(loc, "var1");
+    NodeArena arena;
+    auto seq = arena.make<SeqNode>(loc);
+    auto innerSeq = arena.make<SeqNode>(loc);
+    auto var1a = arena.make<VarNode>(loc, "var1");
+    auto var1b = arena.make<VarNode>(loc, "var1");
+    auto var1c = arena.make<VarNode>(loc, "var1");
+    auto var1d = arena.make<VarNode>(loc, "var1");
 
-    auto one = new IntLitNode(loc, "1", TT_I32);
-    auto two = new IntLitNode(loc, "2", TT_I32);
+    auto one = arena.make<IntLitNode>(loc, "1", TT_I32);
+    auto two = arena.make<IntLitNode>(loc, "2", TT_I32);
 
-    auto decl1 = new VarAssignNode(loc, var1a, one, false);
-    auto decl2 = new VarAssignNode(loc, var1b, two, false);
+    auto decl1 = arena.make<VarAssignNode>(loc, var1a, one);
+    auto decl2 = arena.make<VarAssignNode>(loc, var1b, two);
 
-    auto modNode1 = new ModNode(loc, Tok_Let, nullptr);
-    auto modNode2 = new ModNode(loc, Tok_Let, nullptr);
+    auto modNode1 = arena.make<ModNode>(loc, Tok_Let, nullptr);
+    auto modNode2 = arena.make<ModNode>(loc, Tok_Let, nullptr);
 
     decl1->modifiers.emplace_back(modNode1);
     decl2->modifiers.emplace_back(modNode2);
 
     innerSeq->sequence.emplace_back(decl2);
     innerSeq->sequence.emplace_back(var1c);
-    auto block = new BlockNode(loc, innerSeq);
+    auto block = arena.make<BlockNode>(loc, innerSeq);
 
     seq->sequence.emplace_back(decl1);
     seq->sequence.emplace_back(block);
@@ -146,7 +150,6 @@ TEST_CASE("Shadowing Resolution", "[nameResolution]"){
     REQUIRE(var1b->decl == var1c->decl);
 
     REQUIRE(var1a->decl != var1b->decl);
-    delete seq;
 }
 
 
@@ -162,40 +165,43 @@ TEST_CASE("Shadowing Resolution", "[nameResolution]"){
  */
 TEST_CASE("Function Resolution", "[nameResolution]"){
     LOC_TY loc;
+    //As with parsed trees the root owns the arena and the module takes ownership of the root
     auto root = new RootNode(loc);
+    root->arena = std::make_unique<NodeArena>();
+    NodeArena &arena = *root->arena;
 
-    auto p1Type = new TypeNode(loc, TT_I32, "", nullptr);
-    auto p2Type = new TypeNode(loc, TT_I32, "", nullptr);
-    auto p1a = new NamedValNode(loc, "param1", p1Type);
-    auto p2a = new NamedValNode(loc, "param2", p2Type);
+    auto p1Type = arena.make<TypeNode>(loc, TT_I32, "", nullptr);
+    auto p2Type = arena.make<TypeNode>(loc, TT_I32, "", nullptr);
+    auto p1a = arena.make<NamedValNode>(loc, "param1", p1Type);
+    auto p2a = arena.make<NamedValNode>(loc, "param2", p2Type);
     p1a->next.reset(p2a);
 
-    auto cond = new BoolLitNode(loc, true);
-    auto p1b = new VarNode(loc, "param1");
-    auto p2b = new VarNode(loc, "param2");
+    auto cond = arena.make<BoolLitNode>(loc, true);
+    auto p1b = arena.make<VarNode>(loc, "param1");
+    auto p2b = arena.make<VarNode>(loc, "param2");
 
-    auto ifn = new IfNode(loc, cond, p1b, p2b);
+    auto ifn = arena.make<IfNode>(loc, cond, p1b, p2b);
 
-    auto fdn = new FuncDeclNode(loc, "func", nullptr, p1a, {}, ifn);
+    auto fdn = arena.make<FuncDeclNode>(loc, "func", nullptr, p1a, nullptr, ifn);
 
     root->funcs.emplace_back(fdn);
-    auto funcA = new VarNode(loc, "func");
-    auto funcB = new VarNode(loc, "func");
-    auto one = new IntLitNode(loc, "1", TT_I32);
-    auto two = new IntLitNode(loc, "2", TT_I32);
-    auto three = new IntLitNode(loc, "3", TT_I32);
-
-    auto p1c = new VarNode(loc, "param1");
-    auto param1Decl = new VarAssignNode(loc, p1c, one, false);
-    auto modNode = new ModNode(loc, Tok_Let, nullptr);
+    auto funcA = arena.make<VarNode>(loc, "func");
+    auto funcB = arena.make<VarNode>(loc, "func");
+    auto one = arena.make<IntLitNode>(loc, "1", TT_I32);
+    auto two = arena.make<IntLitNode>(loc, "2", TT_I32);
+    auto three = arena.make<IntLitNode>(loc, "3", TT_I32);
+
+    auto p1c = arena.make<VarNode>(loc, "param1");
+    auto param1Decl = arena.make<VarAssignNode>(loc, p1c, one);
+    auto modNode = arena.make<ModNode>(loc, Tok_Let, nullptr);
     param1Decl->modifiers.emplace_back(modNode);
-    auto p1d = new VarNode(loc, "param1");
+    auto p1d = arena.make<VarNode>(loc, "param1");
 
-    std::vector<std::unique_ptr<Node>> argvec;
+    std::vector<ArenaPtr<Node>> argvec;
     argvec.emplace_back(two);
     argvec.emplace_back(three);
-    auto args = new TupleNode(loc, argvec);
-    auto call = new BinOpNode(loc, '(', funcB, args);
+    auto args = arena.make<TupleNode>(loc, argvec);
+    auto call = arena.make<BinOpNode>(loc, '(', funcB, args);
 
     root->main.emplace_back(funcA);
     root->main.emplace_back(param1Decl);
@@ -227,13 +233,13 @@ TEST_CASE("Function Resolution", "[nameResolution]"){
     REQUIRE(p1c->decl != p1a->decl);
     REQUIRE(p1c->decl != p2a->decl);
     REQUIRE(p1c->decl != funcA->decl);
-    delete root;
 }
 
 
 TEST_CASE("Integer Type Resolution", "[typeResolution]"){
     LOC_TY loc;
-    auto i32 = new TypeNode(loc, TT_I32, "", nullptr);
+    NodeArena arena;
+    auto i32 = arena.make<TypeNode>(loc, TT_I32, "", nullptr);
     
     NameResolutionVisitor{"IntTypeResolutionTest"}.visit(i32);
 
@@ -243,10 +249,11 @@ TEST_CASE("Integer Type Resolution", "[typeResolution]"){
 
 TEST_CASE("Array Type Resolution", "[typeResolution]"){
     LOC_TY loc;
+    NodeArena arena;
 
-    auto usz = new TypeNode(loc, TT_Usz, "", nullptr);
-    auto uszPtr = new TypeNode(loc, TT_Ptr, "", usz);
-    auto arrOfUszPtr = new TypeNode(loc, TT_Array, "", uszPtr);
+    auto usz = arena.make<TypeNode>(loc, TT_Usz, "", nullptr);
+    auto uszPtr = arena.make<TypeNode>(loc, TT_Ptr, "", usz);
+    auto arrOfUszPtr = arena.make<TypeNode>(loc, TT_Array, "", uszPtr);
     
     NameResolutionVisitor{"ArrayTypeResolutionTest"}.visit(arrOfUszPtr);
 
@@ -255,3 +262,86 @@ TEST_CASE("Array Type Resolution", "[typeResolution]"){
     /** Name resolution should not do unnecessary deep-resolving */
     REQUIRE(uszPtr->getType() == nullptr);
 }
+
+
+/**
+ * discover_root.an imports discoverA and discoverB
+ * discoverA.an     imports discoverB
+ * discoverB.an     imports discoverC and a module that does not exist
+ */
+TEST_CASE("Import Discovery", "[preparseImports]"){
+    auto write = [](std::string const& name, std::string const& source){
+        std::ofstream{AN_EXEC_STR + name} << source;
+    };
+
+    write("discover_root.an", "import DiscoverA\nimport DiscoverB\n\nr = 0\n");
+    write("discoverA.an", "import DiscoverB\n\na = 1\n");
+    write("discoverB.an", "import DiscoverC\nimport DiscoverMissing\n\nb = 2\n");
+    write("discoverC.an", "c = 3\n");
+
+    static std::string rootFile = AN_EXEC_STR "discover_root.an";
+    auto root = parseFile(&rootFile);
+    REQUIRE(root);
+
+    preparseImports(root.get());
+
+    //every module reachable from the root is parsed, including
+    //discoverC which only discoverB imports
+    REQUIRE(isPreparsed(findFile("discoverA")));
+    REQUIRE(isPreparsed(findFile("discoverB")));
+    REQUIRE(isPreparsed(findFile("discoverC")));
+
+    //modules that cannot be found are left for importFile to report
+    REQUIRE(findFile("discoverMissing").empty());
+
+    for(auto name : {"discover_root.an", "discoverA.an", "discoverB.an", "discoverC.an"}){
+        std::remove((AN_EXEC_STR + std::string(name)).c_str());
+    }
+}
+
+/**
+ * resolve_root.an imports resolveA and resolveB
+ * resolveA.an     imports resolveC
+ * resolveB.an     imports resolveC
+ * resolveC.an     imports nothing but the prelude
+ */
+TEST_CASE("Import Resolution", "[resolveImports]"){
+    auto write = [](std::string const& name, std::string const& source){
+        std::ofstream{AN_EXEC_STR + name} << source;
+    };
+
+    write("resolve_root.an", "import ResolveA\nimport ResolveB\n\nr = a 1 + b 2\n");
+    write("resolveA.an", "import ResolveC\n\na x = c x + 1\n");
+    write("resolveB.an", "import ResolveC\n\nb x = c x * 2\n");
+    write("resolveC.an", "c x = x + 3\n");
+
+    static std::string rootFile = AN_EXEC_STR "resolve_root.an";
+    auto root = parseFile(&rootFile);
+    REQUIRE(root);
+
+    size_t errors = errorCount();
+    preparseImports(root.get());
+    resolveImports();
+    REQUIRE(errorCount() == errors);
+
+    //resolveA and resolveB only depend on resolveC so both are loaded once it is
+    Module &moduleRoot = Module::getRoot();
+    for(auto name : {"resolveA.an", "resolveB.an", "resolveC.an"}){
+        Module *m = moduleRoot.findPath(ModulePath(name));
+        REQUIRE(m);
+        REQUIRE(m->fnDecls.size() == 1);
+        //inference is skipped once any error was issued, including by earlier tests
+        if(!errors)
+            REQUIRE(m->fnDecls.begin()->getValue()->getFDN()->getType());
+        REQUIRE(!isPreparsed(findFile(name)));
+    }
+
+    //each module shares the one instance of its import
+    Module *c = moduleRoot.findPath(ModulePath("resolveC.an"));
+    REQUIRE(contains(moduleRoot.findPath(ModulePath("resolveA.an"))->imports, c));
+    REQUIRE(contains(moduleRoot.findPath(ModulePath("resolveB.an"))->imports, c));
+
+    for(auto name : {"resolve_root.an", "resolveA.an", "resolveB.an", "resolveC.an"}){
+        std::remove((AN_EXEC_STR + std::string(name)).c_str());
+    }
+}
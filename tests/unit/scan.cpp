@@ -0,0 +1,133 @@
+#include "unittest.h"
+#include "lexer.h"
+#include "scan.h"
+#include <tuple>
+using namespace ante;
+using namespace std;
+
+using ScanFn = const char* (*)(const char*, const char*);
+
+/** A scan function with a byte it skips over and the bytes that stop it */
+struct ScanCase {
+    const char *name;
+    ScanFn fn;
+    char skipped;
+    string stops;
+};
+
+/** Every instruction set this host supports, starting with the scalar reference */
+vector<scan::Isa> supportedIsas(){
+    auto prev = scan::getIsa();
+    vector<scan::Isa> ret;
+    for(auto isa : {scan::Isa::Scalar, scan::Isa::SSE2, scan::Isa::AVX2}){
+        if(scan::setIsa(isa))
+            ret.push_back(isa);
+    }
+    scan::setIsa(prev);
+    return ret;
+}
+
+/** Returns the offset fn stops at in buf when run with each supported instruction set */
+vector<size_t> scanWithEachIsa(ScanFn fn, string const& buf){
+    auto prev = scan::getIsa();
+    vector<size_t> ret;
+    for(auto isa : supportedIsas()){
+        scan::setIsa(isa);
+        ret.push_back(fn(buf.data(), buf.data() + buf.size()) - buf.data());
+    }
+    scan::setIsa(prev);
+    return ret;
+}
+
+TEST_CASE("Vector scans agree with the scalar scan", "[scan]"){
+    vector<ScanCase> cases = {
+        {"IdentChars",    scan::skipIdentChars,    'a', string(" -/:@[`{\x7f\x80\xc3\xff", 12)},
+        {"Spaces",        scan::skipSpaces,        ' ', string("a\t\n\0\x80\xff", 6)},
+        {"LineEnd",       scan::findLineEnd,       'x', string("\n\0", 2)},
+        {"StrLitSpecial", scan::findStrLitSpecial, 'x', string("\"\\\n$\0", 5)},
+    };
+
+    //bytes >= 0x80 must not stop the scans that only look for ascii characters
+    string highBytes("\x80\xc3\xa9\xff", 4);
+
+    for(auto &c : cases){
+        for(size_t len : {0, 1, 15, 16, 17, 31, 32, 33, 63, 64, 65}){
+            INFO(c.name << " over " << len << " bytes");
+            string skipped(len, c.skipped);
+
+            auto results = scanWithEachIsa(c.fn, skipped);
+            for(size_t r : results)
+                REQUIRE(r == len);
+
+            if(c.stops.find('\x80') == string::npos){
+                string high;
+                for(size_t i = 0; i < len; i++)
+                    high += highBytes[i % highBytes.size()];
+
+                for(size_t r : scanWithEachIsa(c.fn, high))
+                    REQUIRE(r == len);
+            }
+
+            for(char stop : c.stops){
+                for(size_t i = 0; i < len; i++){
+                    INFO("stop byte " << (int)(unsigned char)stop << " at offset " << i);
+                    string buf = skipped;
+                    buf[i] = stop;
+
+                    for(size_t r : scanWithEachIsa(c.fn, buf))
+                        REQUIRE(r == i);
+
+                    //a second stop byte after the first must not change the result
+                    if(i + 1 < len){
+                        buf[len - 1] = stop;
+                        for(size_t r : scanWithEachIsa(c.fn, buf))
+                            REQUIRE(r == i);
+                    }
+                }
+            }
+        }
+    }
+}
+
+using LexedTok = tuple<int, string, unsigned, unsigned, unsigned, unsigned>;
+
+vector<LexedTok> lexAll(string source){
+    string fileName = "scantest.an";
+    Lexer lexer{&fileName, source, 0, 0};
+    yy::parser::location_type loc;
+    vector<LexedTok> ret;
+
+    while(int tok = lexer.next(&loc)){
+        string text;
+        if(tok == Tok_Ident || tok == Tok_UserType || tok == Tok_TypeVar || tok == Tok_StrLit
+                || tok == Tok_UnfinishedStr || tok == Tok_IntLit || tok == Tok_FltLit || tok == Tok_CharLit){
+            text = lexer.lextxt;
+            free(lexer.lextxt);
+        }
+        ret.emplace_back(tok, text, loc.begin.line, loc.begin.column, loc.end.line, loc.end.column);
+    }
+    return ret;
+}
+
+TEST_CASE("The lexer gives the same tokens and locations with each instruction set", "[scan]"){
+    string source =
+        "// a comment with bytes >= 0x80: caf\xc3\xa9 \xff and more than thirty-two characters\n"
+        "a_rather_long_identifier_of_more_than_32_chars = 1\n"
+        "x = \"a string with an escape \\n, an interpolation ${x} and caf\xc3\xa9\"\n"
+        "                                  y = 2\n"
+        "abcdefghijklmno abcdefghijklmnop abcdefghijklmnopq\n"
+        "abcdefghijklmnopqrstuvwxyz01234 abcdefghijklmnopqrstuvwxyz012345 abcdefghijklmnopqrstuvwxyz0123456\n"
+        "/* a block comment */ z = \"a string of exactly thirty-two b\"\n"
+        "// no newline at the end";
+
+    auto prev = scan::getIsa();
+    REQUIRE(scan::setIsa(scan::Isa::Scalar));
+    auto expected = lexAll(source);
+
+    for(auto isa : supportedIsas()){
+        INFO("instruction set " << scan::getIsaName(isa));
+        REQUIRE(scan::setIsa(isa));
+        REQUIRE(lexAll(source) == expected);
+    }
+    scan::setIsa(prev);
+}
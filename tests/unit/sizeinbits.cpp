@@ -1,4 +1,5 @@
 #include "unittest.h"
+#include "typedecl.h"
 using namespace ante;
 using namespace std;
 
@@ -87,7 +88,8 @@ TEST_CASE("Size in bits of aggregate (tuple) type", "[getSizeInBits]"){
 
     REQUIRE(aggTy1->getSizeInBits(c).getVal() == 0);
     REQUIRE(aggTy2->getSizeInBits(c).getVal() == 32);
-    REQUIRE(aggTy3->getSizeInBits(c).getVal() == 64 + 8);
+    //the bool is padded to the alignment of the u64
+    REQUIRE(aggTy3->getSizeInBits(c).getVal() == 64 + 64);
     REQUIRE(aggTy4->getSizeInBits(c).getVal() == 8*sizeof(void*) + aggTy3->getSizeInBits(c).getVal());
 }
 
@@ -107,3 +109,197 @@ TEST_CASE("Size in bits of generic type", "[getSizeInBits]"){
     REQUIRE(!tup->getSizeInBits(c));
     REQUIRE(fn->getSizeInBits(c).getVal() == 8*sizeof(void*));
 }
+
+TEST_CASE("Layout of product type", "[getSizeInBits]"){
+    LOC_TY loc;
+    auto u8 = AnType::getU8();
+    auto u16 = AnType::getU16();
+    auto i64 = AnType::getI64();
+
+    //fields are reordered by decreasing alignment to remove padding
+    auto sorted = AnDataType::get("SortedLayoutTest", {}, nullptr);
+    TypeDecl sortedDecl{sorted, loc};
+    sortedDecl.addField("a", u8);
+    sortedDecl.addField("b", i64);
+    sortedDecl.addField("c", u16);
+    sorted->decl = &sortedDecl;
+
+    REQUIRE(sortedDecl.getFieldIndex(c, sorted, "b") == 0);
+    REQUIRE(sortedDecl.getFieldIndex(c, sorted, "c") == 1);
+    REQUIRE(sortedDecl.getFieldIndex(c, sorted, "a") == 2);
+    REQUIRE(((AnType*)sorted)->getSizeInBits(c).getVal() == 128);
+
+    //![repr_c] keeps the declaration order
+    auto reprC = AnDataType::get("ReprCLayoutTest", {}, nullptr);
+    TypeDecl reprCDecl{reprC, loc};
+    reprCDecl.isReprC = true;
+    reprCDecl.addField("a", u8);
+    reprCDecl.addField("b", i64);
+    reprCDecl.addField("c", u16);
+    reprC->decl = &reprCDecl;
+
+    REQUIRE(reprCDecl.getFieldIndex(c, reprC, "a") == 0);
+    REQUIRE(reprCDecl.getFieldIndex(c, reprC, "b") == 1);
+    REQUIRE(reprCDecl.getFieldIndex(c, reprC, "c") == 2);
+    REQUIRE(((AnType*)reprC)->getSizeInBits(c).getVal() == 192);
+}
+
+TEST_CASE("Size in bits of sum type", "[getSizeInBits]"){
+    LOC_TY loc;
+    auto i32 = AnType::getI32();
+    auto i64 = AnType::getI64();
+
+    //tagged, the i64 payload is aligned after the u8 tag
+    auto tagged = AnDataType::get("TaggedSizeTest", {}, nullptr);
+    TypeDecl taggedDecl{tagged, loc};
+    taggedDecl.isUnionType = true;
+    taggedDecl.addField("Small", AnTupleType::get({i32}));
+    taggedDecl.addField("Large", AnTupleType::get({i64}));
+    tagged->decl = &taggedDecl;
+
+    REQUIRE(((AnType*)tagged)->getSizeInBits(c).getVal() == 64 + 64);
+
+    //each variant's payload is aligned within the union even when it is not the largest
+    auto u8 = AnType::getU8();
+    auto aligned = AnDataType::get("AlignedPayloadTest", {}, nullptr);
+    TypeDecl alignedDecl{aligned, loc};
+    alignedDecl.isUnionType = true;
+    alignedDecl.addField("Bytes", AnTupleType::get({u8, u8, u8, u8, u8, u8}));
+    alignedDecl.addField("Word", AnTupleType::get({i32}));
+    aligned->decl = &alignedDecl;
+
+    auto &layout = c->module->getDataLayout();
+    auto *word = alignedDecl.getVariantLlvmType(c, aligned, 1);
+    REQUIRE(layout.getStructLayout(word)->getElementOffset(1) == 4);
+    REQUIRE(((AnType*)aligned)->getSizeInBits(c).getVal() == 64);
+
+    //pointers may be null so they are tagged by default
+    auto nullable = AnDataType::get("NullableSizeTest", {}, nullptr);
+    TypeDecl nullableDecl{nullable, loc};
+    nullableDecl.isUnionType = true;
+    nullableDecl.addField("Some", AnTupleType::get({AnPtrType::get(i32)}));
+    nullableDecl.addField("None", AnTupleType::get({}));
+    nullable->decl = &nullableDecl;
+
+    REQUIRE(nullableDecl.getNicheVariant(c, nullable) == -1);
+    REQUIRE(((AnType*)nullable)->getSizeInBits(c).getVal() == 2 * 8*sizeof(void*));
+
+    //with ![nonnull] the empty variant is stored as a null pointer instead of a tag
+    auto niche = AnDataType::get("NicheSizeTest", {}, nullptr);
+    TypeDecl nicheDecl{niche, loc};
+    nicheDecl.isUnionType = true;
+    nicheDecl.isNonNull = true;
+    nicheDecl.addField("Some", AnTupleType::get({AnPtrType::get(i32)}));
+    nicheDecl.addField("None", AnTupleType::get({}));
+    niche->decl = &nicheDecl;
+
+    REQUIRE(nicheDecl.getNicheVariant(c, niche) == 0);
+    REQUIRE(((AnType*)niche)->getSizeInBits(c).getVal() == 8*sizeof(void*));
+}
+
+TEST_CASE("Size in bits of sum type with a spare tag or bool value", "[getSizeInBits]"){
+    LOC_TY loc;
+    auto makeMaybe = [&](string const& name, AnType *elem){
+        auto maybe = AnDataType::get(name, {}, nullptr);
+        auto decl = new TypeDecl(maybe, loc);
+        decl->isUnionType = true;
+        decl->addField("Some", AnTupleType::get({elem}));
+        decl->addField("None", AnTupleType::get({}));
+        maybe->decl = decl;
+        return maybe;
+    };
+
+    //values other than 0 and 1 of a bool are free to represent None
+    auto maybeBool = makeMaybe("MaybeBoolNicheTest", AnType::getBool());
+    REQUIRE(maybeBool->decl->getNiche(c, maybeBool).kind == UnionNiche::Kind::SpareBool);
+    REQUIRE(maybeBool->decl->getSpareTagValue(c, maybeBool) == 3);
+    REQUIRE(((AnType*)maybeBool)->getSizeInBits(c).getVal() == 8);
+
+    //as are the tags an enum never uses
+    auto color = AnDataType::get("ColorNicheTest", {}, nullptr);
+    TypeDecl colorDecl{color, loc};
+    colorDecl.isUnionType = true;
+    colorDecl.addField("Red", AnTupleType::get({}));
+    colorDecl.addField("Green", AnTupleType::get({}));
+    colorDecl.addField("Blue", AnTupleType::get({}));
+    color->decl = &colorDecl;
+
+    REQUIRE(colorDecl.getSpareTagValue(c, color) == 3);
+
+    auto maybeColor = makeMaybe("MaybeColorNicheTest", color);
+    auto &niche = maybeColor->decl->getNiche(c, maybeColor);
+    REQUIRE(niche.kind == UnionNiche::Kind::SpareTag);
+    REQUIRE(niche.variant == 0);
+    REQUIRE(niche.value == 3);
+    REQUIRE(((AnType*)maybeColor)->getSizeInBits(c).getVal() == ((AnType*)color)->getSizeInBits(c).getVal());
+
+    //nesting takes the next spare value
+    auto maybeMaybeColor = makeMaybe("MaybeMaybeColorNicheTest", maybeColor);
+    REQUIRE(maybeMaybeColor->decl->getNiche(c, maybeMaybeColor).value == 4);
+    REQUIRE(((AnType*)maybeMaybeColor)->getSizeInBits(c).getVal() == ((AnType*)color)->getSizeInBits(c).getVal());
+
+    //the tags of a tagged union with a payload can be reused the same way
+    auto tagged = makeMaybe("MaybeI64NicheTest", AnType::getI64());
+    auto maybeTagged = makeMaybe("MaybeMaybeI64NicheTest", tagged);
+    REQUIRE(maybeTagged->decl->getNiche(c, maybeTagged).value == 2);
+    REQUIRE(((AnType*)maybeTagged)->getSizeInBits(c).getVal() == ((AnType*)tagged)->getSizeInBits(c).getVal());
+
+    //![repr_c] unions keep their tag
+    auto reprC = makeMaybe("ReprCMaybeBoolNicheTest", AnType::getBool());
+    reprC->decl->isReprC = true;
+    REQUIRE(reprC->decl->getNicheVariant(c, reprC) == -1);
+    REQUIRE(((AnType*)reprC)->getSizeInBits(c).getVal() == 16);
+}
+
+TEST_CASE("Lowering a generic type under different mappings", "[getSizeInBits]"){
+    LOC_TY loc;
+    auto t = AnTypeVarType::get("'lowering");
+
+    auto boxDecl = new TypeDecl(nullptr, loc);
+    auto box = AnDataType::get("LoweringTest", {t}, boxDecl);
+    boxDecl->type = box;
+    boxDecl->addField("val", t);
+
+    //each instantiation must get its own layout rather than the first one lowered
+    auto &mappings = c->compCtxt->monomorphisationMappings;
+    c->compCtxt->insertMonomorphisationMappings({{t, AnType::getI32()}});
+    auto *asI32 = llvm::cast<llvm::StructType>(c->anTypeToLlvmType(box));
+    REQUIRE(((AnType*)box)->getSizeInBits(c).getVal() == 32);
+
+    c->compCtxt->insertMonomorphisationMappings({{t, AnType::getF64()}});
+    auto *asF64 = llvm::cast<llvm::StructType>(c->anTypeToLlvmType(box));
+    REQUIRE(((AnType*)box)->getSizeInBits(c).getVal() == 64);
+
+    REQUIRE(asI32 != asF64);
+    REQUIRE(asI32->getElementType(0)->isIntegerTy(32));
+    REQUIRE(asF64->getElementType(0)->isDoubleTy());
+
+    mappings.pop_back();
+    mappings.pop_back();
+}
+
+TEST_CASE("Field indices of a generic type under different mappings", "[getSizeInBits]"){
+    LOC_TY loc;
+    auto a = AnTypeVarType::get("'fieldA");
+    auto b = AnTypeVarType::get("'fieldB");
+
+    auto pairDecl = new TypeDecl(nullptr, loc);
+    auto pair = AnDataType::get("FieldIndexTest", {a, b}, pairDecl);
+    pairDecl->type = pair;
+    pairDecl->addField("first", a);
+    pairDecl->addField("second", b);
+
+    //the generic type is looked up each time, as it is when compiling a generic function
+    auto &mappings = c->compCtxt->monomorphisationMappings;
+    c->compCtxt->insertMonomorphisationMappings({{a, AnType::getI8()}, {b, AnType::getI64()}});
+    REQUIRE(pairDecl->getFieldIndex(c, pair, "first") == 1);
+    REQUIRE(pairDecl->getFieldIndex(c, pair, "second") == 0);
+    mappings.pop_back();
+    mappings.pop_back();
+
+    c->compCtxt->insertMonomorphisationMappings({{a, AnType::getI64()}, {b, AnType::getI8()}});
+    REQUIRE(pairDecl->getFieldIndex(c, pair, "first") == 0);
+    REQUIRE(pairDecl->getFieldIndex(c, pair, "second") == 1);
+    mappings.pop_back();
+    mappings.pop_back();
+}
@@ -1,6 +1,8 @@
 #include "unittest.h"
 #include "types.h"
 #include "unification.h"
+#include "module.h"
+#include "trait.h"
 using namespace ante;
 using namespace std;
 
@@ -49,6 +51,33 @@ TEST_CASE("Type Checks", "[typeEq]"){
         REQUIRE(std::find(subs.begin(), subs.end(), expected2) != subs.end());
     }
 
+    SECTION("Cyclic bindings are refused"){
+        UnionFind bindings;
+        REQUIRE(bindings.bind(t, u));
+        REQUIRE(!bindings.bind(u, t));
+        REQUIRE(!bindings.bind(u, AnPtrType::get(t)));
+
+        REQUIRE(bindings.find(t) == u);
+        REQUIRE(bindings.resolve(AnPtrType::get(t)) == AnPtrType::get(u));
+    }
+
+    SECTION("Bindings are undone by rollback"){
+        UnionFind bindings;
+        auto v = AnTypeVarType::get("'v");
+        REQUIRE(bindings.bind(u, t));
+
+        auto mark = bindings.checkpoint();
+        REQUIRE(bindings.bind(t, boolTy));
+        REQUIRE(bindings.find(u) == boolTy);
+        REQUIRE(bindings.bind(v, intTy));
+        bindings.rollback(mark);
+
+        REQUIRE(bindings.find(u) == t);
+        REQUIRE(bindings.find(t) == t);
+        REQUIRE(bindings.find(v) == v);
+        REQUIRE(bindings.getSubstitutions().size() == 1);
+    }
+
     SECTION("MyType isz == MyType isz"){
         //Empty 't
         auto tvar = AnTypeVarType::get("'t");
@@ -80,10 +109,127 @@ TEST_CASE("Type Uniqueness", "[typeEq]"){
 
     REQUIRE(empty != nullptr);
 
-    REQUIRE(empty_t != empty);
+    REQUIRE(empty_t == empty);
     REQUIRE(empty_t != empty_u);
 
     REQUIRE(empty_t == empty_t2);
+
+    //same-named types from different declarations
+    LOC_TY loc;
+    auto otherDecl = new TypeDecl(nullptr, loc);
+    auto other_t = AnDataType::get("Empty", {t}, otherDecl);
+
+    REQUIRE(other_t != empty_t);
+    REQUIRE(other_t->decl == otherDecl);
+    REQUIRE(AnDataType::get("Empty", {t}, otherDecl) == other_t);
+}
+
+TEST_CASE("tryUnify reports failures without throwing", "[tryUnify]"){
+    auto&& c = Compiler(nullptr);
+    auto t = AnTypeVarType::get("'t");
+    auto u = AnTypeVarType::get("'u");
+    auto i32 = AnType::getI32();
+    auto boolTy = AnType::getBool();
+    UnionFind scratch;
+
+    SECTION("Success binds the type variables"){
+        UnifyStatus status;
+        REQUIRE_NOTHROW(status = tryUnify(AnPtrType::get(t), AnPtrType::get(i32), scratch));
+        REQUIRE(status == UnifyStatus::Success);
+        REQUIRE(scratch.find(t) == i32);
+    }
+
+    SECTION("Failures are returned as a status"){
+        UnifyStatus status;
+        REQUIRE_NOTHROW(status = tryUnify(i32, boolTy, scratch));
+        REQUIRE(status == UnifyStatus::Mismatch);
+
+        REQUIRE_NOTHROW(status = tryUnify(vector<AnType*>{i32}, vector<AnType*>{i32, boolTy}, scratch));
+        REQUIRE(status == UnifyStatus::Mismatch);
+
+        REQUIRE_NOTHROW(status = tryUnify(t, AnPtrType::get(t), scratch));
+        REQUIRE(status == UnifyStatus::InfiniteType);
+    }
+
+    SECTION("Bindings from a failed attempt do not leak into the next"){
+        //'t := i32 succeeds before bool fails to unify with i32
+        auto status = tryUnify(vector<AnType*>{t, boolTy}, vector<AnType*>{i32, i32}, scratch);
+        REQUIRE(status == UnifyStatus::Mismatch);
+
+        REQUIRE(tryUnify(t, boolTy, scratch) == UnifyStatus::Success);
+        REQUIRE(scratch.find(t) == boolTy);
+        REQUIRE(scratch.getSubstitutions().size() == 1);
+    }
+
+    SECTION("Bindings from a successful attempt do not leak into the next"){
+        REQUIRE(tryUnify(vector<AnType*>{t, u}, vector<AnType*>{i32, boolTy}, scratch) == UnifyStatus::Success);
+        REQUIRE(scratch.find(u) == boolTy);
+
+        REQUIRE(tryUnify(t, boolTy, scratch) == UnifyStatus::Success);
+        REQUIRE(scratch.find(t) == boolTy);
+        REQUIRE(scratch.find(u) == u);
+    }
+}
+
+TEST_CASE("Trait impls are found in declaration order", "[traitImpls]"){
+    auto&& c = Compiler(nullptr);
+    auto a = AnTypeVarType::get("'a");
+    auto b = AnTypeVarType::get("'b");
+    auto i32 = AnType::getI32();
+    auto boolTy = AnType::getBool();
+
+    auto show = new TraitDecl("Show", {a}, {});
+    auto conv = new TraitDecl("Conv", {a, b}, {});
+
+    SECTION("A generic impl declared first is preferred over a specific one"){
+        Module m{"GenericFirst"};
+        auto generic = new TraitImpl(show, {a}, {});
+        auto specific = new TraitImpl(show, {i32}, {});
+        m.addTraitImpl(generic);
+        m.addTraitImpl(specific);
+
+        REQUIRE(m.lookupTraitImpl("Show", {i32}) == generic);
+        REQUIRE(m.lookupTraitImpl("Show", {boolTy}) == generic);
+    }
+
+    SECTION("A specific impl declared first is preferred over a generic one"){
+        Module m{"SpecificFirst"};
+        auto specific = new TraitImpl(show, {i32}, {});
+        auto generic = new TraitImpl(show, {a}, {});
+        m.addTraitImpl(specific);
+        m.addTraitImpl(generic);
+
+        REQUIRE(m.lookupTraitImpl("Show", {i32}) == specific);
+        REQUIRE(m.lookupTraitImpl("Show", {boolTy}) == generic);
+    }
+
+    SECTION("A type variable argument is checked against impls in every bucket"){
+        Module m{"TypeVarArg"};
+        auto i32Bool = new TraitImpl(conv, {i32, boolTy}, {});
+        auto boolI32 = new TraitImpl(conv, {boolTy, i32}, {});
+        m.addTraitImpl(i32Bool);
+        m.addTraitImpl(boolI32);
+
+        auto t = AnTypeVarType::get("'t");
+        REQUIRE(m.lookupTraitImpl("Conv", {t, i32}) == boolI32);
+        REQUIRE(m.lookupTraitImpl("Conv", {t, boolTy}) == i32Bool);
+        REQUIRE(m.lookupTraitImpl("Conv", {t, t}) == nullptr);
+    }
+
+    SECTION("An impl added to an imported module invalidates cached lookups"){
+        Module m{"Importer"}, first{"FirstImport"}, second{"SecondImport"};
+        m.imports = {&first, &second};
+
+        auto generic = new TraitImpl(show, {a}, {});
+        second.addTraitImpl(generic);
+        REQUIRE(m.lookupTraitImpl("Show", {i32}) == generic);
+
+        //first is searched before second so its impl must now be found
+        auto specific = new TraitImpl(show, {i32}, {});
+        first.addTraitImpl(specific);
+        REQUIRE(m.lookupTraitImpl("Show", {i32}) == specific);
+        REQUIRE(m.lookupTraitImpl("Show", {boolTy}) == generic);
+    }
 }
 
 /*